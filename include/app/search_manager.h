@@ -4,6 +4,7 @@
 #include "engine/index_manager.h"
 #include "engine/search_engine.h"
 #include "engine/file_watcher.h"
+#include "engine/content_searcher.h"
 #include <memory>
 #include <vector>
 #include <string>
@@ -85,6 +86,14 @@ public:
     void searchAsync(const std::string& queryString, SearchMode mode = SearchMode::Fuzzy, 
                     SearchCompletedCallback callback = nullptr);
     
+    // grep query.contentPattern in the files whose names match the rest of the
+    // query (every indexed file when query.query is empty), narrowed first by
+    // the content index when it is enabled; matches stream to the callback
+    // while the search runs
+    Engine::ContentSearcher::Statistics searchContent(const SearchQuery& query,
+                                                      const Engine::ContentSearcher::MatchCallback& callback);
+    std::vector<Engine::ContentMatch> searchContent(const SearchQuery& query);
+    
     // Index management
     bool buildIndex();
     bool buildIndex(const std::vector<std::string>& drives);
@@ -100,6 +109,9 @@ public:
     void stopFileWatching();
     bool isFileWatching() const { return isWatching_.load(); }
     
+    // Duplicate files, largest reclaimable space first
+    std::vector<Engine::DuplicateGroup> findDuplicates(uint64_t minSize = 1);
+    
     // State queries
     bool isIndexing() const { return isIndexing_.load(); }
     double getIndexingProgress() const;
@@ -174,7 +186,15 @@ public:
 private:
     // Initialization helpers
     bool initializeIndexManager();
+    // settings_.serveStaleIndexOnStartup: searchable as soon as the persisted
+    // index is loaded; results carry isPossiblyStale() until the background
+    // reconcile and watcher catch-up are done
+    bool initializeFromPersistedIndex();
     bool initializeSearchEngine();
+    // Also starts the watcher's lost-event recovery, which feeds dirty
+    // subtrees to indexManager_->reconcileIndex(subtrees, directories), and
+    // sets a batch callback so each coalesced window reaches
+    // indexManager_->updateIndex(events) as one batch
     bool initializeFileWatcher();
     
     // Background processing
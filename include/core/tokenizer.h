@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace FastFileSearch {
+
+// Splits file names into lowercase search tokens in a single pass.
+//
+// Words are runs of ASCII letters/digits and non-ASCII (UTF-8) bytes; every
+// other character separates words. Inside a word, camelCase humps
+// ("fooBar", "HTMLParser") and letter/digit changes ("file2024") start a new
+// token. A word that was split is also emitted whole, so a query for
+// "foobar" still matches "fooBar.txt".
+//
+// Tokens are views into a caller-owned normalized buffer; reusing the
+// buffers across calls makes tokenizing allocation-free once they are warm.
+class Tokenizer {
+public:
+    struct Options {
+        bool splitCamelCase = true;
+        bool splitDigits = true;
+        bool keepCompounds = true;   // Also emit words that were split
+    };
+
+    // Clears both buffers, writes the lowercased words of name to normalized
+    // (separated by single spaces) and appends the token views to tokens.
+    // The views stay valid until normalized is modified.
+    static void tokenize(std::string_view name, std::string& normalized,
+                         std::vector<std::string_view>& tokens);
+    static void tokenize(std::string_view name, std::string& normalized,
+                         std::vector<std::string_view>& tokens, const Options& options);
+
+    static bool isWordByte(char c) {
+        unsigned char u = static_cast<unsigned char>(c);
+        return u >= 0x80 || (u >= '0' && u <= '9') || (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z');
+    }
+
+    static char toLower(char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+};
+
+} // namespace FastFileSearch
@@ -63,6 +63,19 @@ struct DateRange {
     }
 };
 
+// Cheap identity of a file's indexable state. Equal fingerprints mean
+// nothing the index cares about changed; atime-only updates and spurious
+// modify events leave it untouched.
+struct FileFingerprint {
+    uint64_t size = 0;
+    int64_t modifiedNs = 0;
+    int64_t changedNs = 0;
+    uint64_t inode = 0;
+    
+    bool operator==(const FileFingerprint& other) const = default;
+    bool isEmpty() const { return size == 0 && modifiedNs == 0 && changedNs == 0 && inode == 0; }
+};
+
 struct FileEntry {
     uint64_t id = 0;
     std::string fullPath;
@@ -84,15 +97,29 @@ struct FileEntry {
     uint64_t parentId = 0;
     uint64_t driveId = 0;
     
+    // Filesystem identity, when the scanner had it (0 otherwise)
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    uint32_t linkCount = 1;
+    
+    // Nanosecond timestamps for change detection (0 when unknown)
+    int64_t modifiedNs = 0;
+    int64_t changedNs = 0;
+    
     // Constructors
     FileEntry() = default;
     FileEntry(const std::string& path);
     
+    // Build an entry from already-known metadata (no filesystem access)
+    FileEntry(const std::string& path, const std::string& name, FileType fileType,
+              uint64_t fileSize, std::time_t modified);
+    
     // Utility methods
     bool isDirectory() const { return type == FileType::Directory; }
     bool isFile() const { return type == FileType::File; }
     std::string getDisplayName() const;
     void updateTokens();
+    FileFingerprint fingerprint() const { return {size, modifiedNs, changedNs, inode}; }
 };
 
 struct SearchQuery {
@@ -110,6 +137,10 @@ struct SearchQuery {
     // Fuzzy search parameters
     double fuzzyThreshold = 0.6;
     
+    // File contents to grep for among the name matches (empty = names only)
+    std::string contentPattern;
+    bool contentRegex = false;
+    
     // Validation
     bool isValid() const;
     std::string toString() const;
@@ -130,6 +161,7 @@ private:
     std::string query_;
     std::time_t searchTime_;
     uint32_t totalMatches_ = 0;
+    bool possiblyStale_ = false;
     
 public:
     SearchResults(const std::string& query);
@@ -150,6 +182,10 @@ public:
     uint32_t getTotalMatches() const { return totalMatches_; }
     void setTotalMatches(uint32_t total) { totalMatches_ = total; }
     
+    // Served from an index loaded at startup that is still being reconciled
+    bool isPossiblyStale() const { return possiblyStale_; }
+    void setPossiblyStale(bool stale) { possiblyStale_ = stale; }
+    
     // Iterator support
     auto begin() { return results_.begin(); }
     auto end() { return results_.end(); }
@@ -199,6 +235,22 @@ struct AppSettings {
     uint32_t maxMemoryUsage = 512; // MB
     bool enableCache = true;
     uint32_t cacheSize = 100; // MB
+    bool enableIoUring = true; // Batched statx during scans (Linux 5.6+)
+    uint32_t checkpointInterval = 30; // Seconds between scan checkpoints, 0 disables
+    bool deviceAwareScheduling = true; // Per-device read limits (HDD vs SSD/NVMe)
+    bool prioritizeUserDirectories = true; // Scan home and frequently used directories first
+    bool stayOnFilesystem = false; // Do not cross mount points below an indexed root
+    bool shardedInitialBuild = false; // Opt-in: shards skip priority bands and checkpoints until the merge
+    bool serveStaleIndexOnStartup = true; // Search the persisted index while reconciling it in the background
+    uint32_t rebuildCpuPercent = 25; // Share of all cores a background rebuild may use, 100 = unthrottled
+    uint32_t scanFilesPerSecond = 0; // Background scan rate limit, 0 = unlimited
+    uint32_t scanSyscallsPerSecond = 0; // Filesystem calls per second during scans, 0 = unlimited
+    bool lowPriorityIndexing = true; // Scan threads run niced and in the idle I/O class
+    bool adaptiveThrottling = true; // Slow scans down while system load or I/O pressure is high
+    bool duplicateDetection = false; // Hash files that share a size in the background after indexing
+    bool contentIndexing = false; // Trigram index over file contents to speed up content searches
+    std::vector<std::string> contentIndexExtensions; // Files whose contents are indexed, empty = all text files
+    uint32_t contentIndexMaxFileKB = 1024; // Larger files are searched without the content index
     
     // Database settings
     std::string databasePath = "fastfilesearch.db";
@@ -256,6 +308,13 @@ struct IndexStatistics {
     double indexingProgress = 0.0;
     bool isIndexing = false;
     
+    // Running scan: entries indexed so far against the expected total
+    // (0 when unknown) and the time left at the current rate (-1 when unknown)
+    uint64_t itemsProcessed = 0;
+    uint64_t itemsExpected = 0;
+    double itemsPerSecond = 0.0;
+    int64_t etaSeconds = -1;
+    
     void reset();
     std::string toString() const;
 };
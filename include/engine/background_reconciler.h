@@ -0,0 +1,95 @@
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// How far the served index can be trusted
+enum class IndexFreshness : uint8_t {
+    Empty = 0,          // Nothing loaded or built yet
+    Stale = 1,          // Loaded from disk; changes made while we were down are missing
+    Reconciling = 2,    // Stale, and a reconcile is catching up
+    Current = 3         // Built or reconciled in this run, kept current by the watcher
+};
+
+const char* indexFreshnessName(IndexFreshness freshness);
+
+// Brings an index that was loaded from the database up to date without
+// blocking searches.
+//
+// At startup the persisted index is served right away and marked Stale. The
+// reconcile task then runs on a background thread at reduced CPU priority;
+// until it succeeds, results are flagged as possibly stale. A failed or
+// interrupted reconcile is retried with exponential backoff.
+class BackgroundReconciler {
+public:
+    // Returns true once the index matches the disk
+    using ReconcileTask = std::function<bool()>;
+    // Asks a running ReconcileTask to return early. May arrive just before
+    // the task starts; the task must still see it (ReconcileScanner::stop()
+    // stays in effect until resume())
+    using CancelTask = std::function<void()>;
+
+    struct Status {
+        IndexFreshness freshness = IndexFreshness::Empty;
+        std::time_t persistedAt = 0;        // When the loaded index was last written
+        std::time_t reconcileStarted = 0;
+        std::time_t reconcileFinished = 0;
+        uint32_t attempts = 0;
+        bool lastAttemptSucceeded = false;
+    };
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable wakeCondition_;
+    std::thread thread_;
+    std::atomic<bool> shouldStop_;
+    std::atomic<IndexFreshness> freshness_;
+    Status status_;
+
+    ReconcileTask reconcileTask_;
+    CancelTask cancelTask_;
+
+    static constexpr int BACKGROUND_NICE = 10;
+    static constexpr std::chrono::seconds FIRST_RETRY{30};
+    static constexpr std::chrono::seconds MAX_RETRY{30 * 60};
+
+public:
+    BackgroundReconciler();
+    ~BackgroundReconciler();
+
+    // Non-copyable
+    BackgroundReconciler(const BackgroundReconciler&) = delete;
+    BackgroundReconciler& operator=(const BackgroundReconciler&) = delete;
+
+    // State transitions made by the owner
+    void markLoaded(std::time_t persistedAt);
+    void markCurrent();
+    void markEmpty();
+
+    // Runs task in the background after delay (lets startup I/O settle)
+    bool start(ReconcileTask task, CancelTask cancel,
+               std::chrono::milliseconds delay = std::chrono::milliseconds(0));
+    void stop();
+    bool isRunning() const;
+
+    IndexFreshness getFreshness() const { return freshness_.load(); }
+    bool isPossiblyStale() const { return getFreshness() != IndexFreshness::Current; }
+    Status getStatus() const;
+
+private:
+    void run(std::chrono::milliseconds delay);
+    bool sleepFor(std::chrono::milliseconds duration);
+    static void lowerThreadPriority();
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
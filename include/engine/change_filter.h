@@ -0,0 +1,101 @@
+#pragma once
+
+#include "core/types.h"
+#include <array>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// Drops modify events that did not change anything the index stores.
+//
+// Keeps one FileFingerprint per indexed path, keyed by a 64-bit path hash
+// and checked against a second, independent one, so two paths would have to
+// collide in both before one's event is taken for the other's (about 64
+// bytes per file, no path copies). A Modified event costs one
+// lstat(); when the fingerprint matches the recorded one the event is
+// dropped before the trie, tokens or database are touched. Busy log
+// directories emit many such events: atime updates, writes that were
+// already picked up, editors touching files they did not change.
+class ChangeFilter {
+public:
+    struct Statistics {
+        uint64_t tracked = 0;
+        uint64_t checked = 0;       // Modified events looked at
+        uint64_t dropped = 0;       // ... found to be no-ops
+        uint64_t unknown = 0;       // ... for paths without a fingerprint
+    };
+
+private:
+    static constexpr size_t SHARD_COUNT = 64;
+
+    // The parent's path hash is kept so a directory's records can be found
+    // without paths when the directory is renamed or deleted
+    struct Record {
+        FileFingerprint fingerprint;
+        uint64_t check = 0;         // checkPath() of the recorded path
+        uint64_t parent = 0;
+        bool directory = false;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<uint64_t, Record> fingerprints;
+    };
+    std::array<Shard, SHARD_COUNT> shards_;
+
+    std::atomic<uint64_t> checked_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> unknown_;
+
+public:
+    ChangeFilter();
+
+    // Non-copyable
+    ChangeFilter(const ChangeFilter&) = delete;
+    ChangeFilter& operator=(const ChangeFilter&) = delete;
+
+    // Keep in step with the index: record what was indexed, forget what was
+    // removed. Entries without a fingerprint are ignored.
+    void record(const FileEntry& entry);
+    void record(const std::vector<FileEntry>& entries);
+    void record(const std::string& path, const FileFingerprint& fingerprint, bool isDirectory = false);
+    void forget(const std::string& path);
+
+    // Forgets path and, if it is a recorded directory, everything below it.
+    // Records cannot be re-keyed (only hashes are kept), so after a rename
+    // the new paths start out unknown and are recorded on their next event.
+    void forgetSubtree(const std::string& path, bool isDirectory = false);
+
+    // For a modify event: true if the file on disk still matches its
+    // recorded fingerprint. Otherwise the record is refreshed and false is
+    // returned, so the caller goes on to update the index.
+    bool isUnchanged(const std::string& path);
+
+    // Removes no-op Modified events in place; other event types pass
+    // through (and keep the records current: a deleted or renamed directory
+    // takes its whole subtree with it). Returns the number dropped.
+    size_t filter(std::vector<FileChangeEvent>& events);
+
+    // One lstat(); false if the path does not exist
+    static bool capture(const std::string& path, FileFingerprint& fingerprint, bool* isDirectory = nullptr);
+
+    size_t size() const;
+    void clear();
+    Statistics getStatistics() const;
+
+private:
+    static uint64_t hashPath(std::string_view path);
+    static uint64_t checkPath(std::string_view path);
+    static uint64_t hashParent(const std::string& path);
+    Shard& shardFor(uint64_t hash) { return shards_[hash % SHARD_COUNT]; }
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
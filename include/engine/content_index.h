@@ -0,0 +1,171 @@
+#pragma once
+
+#include "core/types.h"
+#include "engine/scan_throttle.h"
+#include "storage/content_index_store.h"
+#include <memory>
+#include <vector>
+#include <string>
+#include <shared_mutex>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+
+namespace FastFileSearch {
+namespace Engine {
+
+struct ContentIndexOptions {
+    // Lowercase, without the dot; empty indexes every text file
+    std::vector<std::string> extensions;
+    uint64_t maxFileSize = 1 << 20;     // Larger files are left to a plain content scan
+    size_t readBufferSize = 256 * 1024;
+    size_t threads = 2;
+    bool lowerPriority = true;          // Index on niced, idle-I/O threads
+    double compactRatio = 0.25;         // Drop dead documents from postings past this share
+};
+
+// Trigram index over file contents, for narrowing content searches before
+// ContentSearcher verifies the survivors.
+//
+// Every covered file becomes a document holding the set of byte trigrams in
+// it (ASCII-lowercased, never spanning a line break, since matches never
+// do); a trigram maps to the sorted ids of the documents containing it. A
+// pattern's literal can only occur in documents holding all of its
+// trigrams, so a query is an intersection of a few postings lists.
+//
+// A changed file gets a new document id and its old one is marked dead
+// rather than removed from every list; dead ids are filtered out at query
+// time and dropped once they pass compactRatio. Files whose fingerprint does
+// not match their document (or that were never indexed) are never filtered
+// out, so a lagging index only costs speed, never matches. Binary files get
+// a document without trigrams, so they are not read again until they
+// change, and are never filtered out either: whether they are searched is
+// ContentSearchOptions::skipBinary's call.
+class ContentIndex {
+public:
+    struct Statistics {
+        uint64_t documents = 0;         // Live
+        uint64_t deadDocuments = 0;
+        uint64_t trigrams = 0;
+        uint64_t postings = 0;
+        uint64_t filesIndexed = 0;      // Read since startup
+        uint64_t binarySkipped = 0;
+        uint64_t bytesRead = 0;
+        uint64_t errors = 0;
+        uint64_t queries = 0;
+        uint64_t queriesNarrowed = 0;   // Queries with a literal of 3+ bytes
+    };
+
+private:
+    struct Document {
+        std::string path;
+        FileFingerprint fingerprint;
+        bool live = false;
+        bool binary = false;
+    };
+
+    ContentIndexOptions options_;
+    std::unordered_set<std::string> extensions_;
+    std::shared_ptr<ScanThrottle> throttle_;
+
+    mutable std::shared_mutex mutex_;
+    std::vector<Document> documents_;               // Indexed by document id
+    std::unordered_map<std::string, uint32_t> byPath_;
+    struct PostingList {
+        std::vector<uint32_t> documents;
+        uint32_t stored = 0;            // Leading ids already in the store
+    };
+    std::unordered_map<uint32_t, PostingList> postings_;
+    uint64_t deadCount_ = 0;
+
+    // Pending persistence; guarded by mutex_. Each entry carries the save
+    // generation it was dirtied in and is only dropped once a save that
+    // covers that generation has been committed.
+    std::unordered_map<uint32_t, uint64_t> dirtyDocuments_;
+    std::unordered_map<uint32_t, uint64_t> dirtyTrigrams_;
+    bool rewritePending_ = false;       // After a compaction or clear()
+    uint64_t rewriteGeneration_ = 0;
+    uint64_t saveGeneration_ = 0;
+    std::mutex saveMutex_;              // One save() at a time
+
+    std::atomic<bool> ready_;
+    std::atomic<bool> cancelled_;
+
+    std::atomic<uint64_t> filesIndexed_;
+    std::atomic<uint64_t> binarySkipped_;
+    std::atomic<uint64_t> bytesRead_;
+    std::atomic<uint64_t> errors_;
+    mutable std::atomic<uint64_t> queries_;
+    mutable std::atomic<uint64_t> queriesNarrowed_;
+
+    static constexpr size_t BINARY_PROBE_BYTES = 8192;
+
+public:
+    explicit ContentIndex(const ContentIndexOptions& options = ContentIndexOptions());
+
+    // Non-copyable
+    ContentIndex(const ContentIndex&) = delete;
+    ContentIndex& operator=(const ContentIndex&) = delete;
+
+    void setOptions(const ContentIndexOptions& options);
+    const ContentIndexOptions& getOptions() const { return options_; }
+    // Shared with the scanners, so indexing and scanning use one budget
+    void setThrottle(std::shared_ptr<ScanThrottle> throttle) { throttle_ = std::move(throttle); }
+
+    // Extension and size allow the file to be indexed
+    bool covers(const FileEntry& entry) const;
+
+    // Bring the index in line with the indexed files: read covered files
+    // that are new or whose fingerprint changed, drop documents of files no
+    // longer among them. Blocks; marks the index ready when done.
+    bool synchronize(const std::vector<FileEntry>& files);
+    void cancel() { cancelled_.store(true); }
+    bool isReady() const { return ready_.load(); }
+
+    // Incremental updates from file change events
+    bool updateFile(const FileEntry& entry);
+    void removeFile(const std::string& path);
+    void renameFile(const std::string& oldPath, const std::string& newPath);
+    // Every document below oldPath keeps its postings under the new prefix
+    void renameDirectory(const std::string& oldPath, const std::string& newPath);
+
+    // Keep the files that may contain the pattern: uncovered, stale or
+    // binary ones, and covered ones holding every trigram of the pattern's literal (the
+    // whole pattern, or the regex's required literal). Returns the input
+    // unchanged when the literal is shorter than a trigram.
+    std::vector<FileEntry> filterCandidates(const std::vector<FileEntry>& files,
+                                            const std::string& pattern, bool regex) const;
+
+    // Persistence through ContentIndexStore. save() writes what changed
+    // since the last successful save; after a failed one the same changes
+    // (and anything newer) are written by the next.
+    void load(std::vector<Storage::ContentIndexDocument> documents,
+              std::vector<Storage::ContentIndexPostings> postings);
+    bool save(Storage::ContentIndexStore& store);
+
+    Statistics getStatistics() const;
+    void clear();
+
+    // Sorted, unique trigrams of one file's contents; false when the file
+    // cannot be read or looks binary
+    bool extractTrigrams(const std::string& path, std::vector<char>& buffer, std::vector<uint32_t>& trigrams,
+                         FileFingerprint& fingerprint, bool& binary);
+    static std::vector<uint32_t> trigramsOf(const std::string& literal);
+
+private:
+    bool coversLocked(const FileEntry& entry) const;
+    void addDocumentLocked(const std::string& path, const FileFingerprint& fingerprint,
+                           const std::vector<uint32_t>& trigrams, bool binary);
+    void killDocumentLocked(uint32_t id);
+    void compactLocked();
+    void compactIfNeededLocked();
+    Storage::ContentIndexChanges takeChanges(uint64_t& generation);
+    void changesSaved(const Storage::ContentIndexChanges& changes, uint64_t generation);
+    // Live ids of documents holding every trigram
+    std::vector<uint32_t> intersectLocked(const std::vector<uint32_t>& trigrams) const;
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "core/types.h"
+#include "utils/literal_search.h"
+#include <memory>
+#include <vector>
+#include <string>
+#include <regex>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <optional>
+#include <cstdint>
+
+namespace FastFileSearch {
+namespace Engine {
+
+struct ContentMatch {
+    std::string path;
+    uint64_t lineNumber = 0;    // 1-based
+    uint32_t column = 0;        // 0-based byte offset within the line
+    std::string line;           // Without the line break, cut at maxLineLength
+};
+
+struct ContentSearchOptions {
+    std::string pattern;
+    bool regex = false;                 // ECMAScript, same engine as name regexes
+    bool caseSensitive = false;         // Case folding is ASCII-only
+    size_t threads = 0;                 // 0 = one per core
+    size_t readBufferSize = 1 << 20;
+    uint64_t maxFileSize = 256ULL << 20;    // Larger files are skipped, 0 = no limit
+    uint32_t maxMatchesPerFile = 100;       // 0 = no limit
+    uint32_t maxResults = 1000;             // 0 = no limit
+    bool skipBinary = true;             // Like grep: a NUL byte near the start means binary
+    size_t maxLineLength = 512;
+    // std::regex recurses per character, so a longer line would overflow
+    // the stack; see ContentSearcher
+    size_t maxRegexLineLength = 2048;
+};
+
+// grep over a candidate set of indexed files.
+//
+// Files are spread over worker threads and read sequentially through a
+// large buffer; only complete lines are searched, the partial last line is
+// carried into the next read. Literal patterns use LiteralFinder. Regex
+// patterns use std::regex per line, but when the regex contains a literal
+// every match must include, that literal picks the candidate lines first,
+// so most of the input is never seen by the regex engine.
+//
+// The regex only sees maxRegexLineLength bytes of a line: around the
+// required literal's hit if there is one, otherwise longer lines are not
+// searched. Lines where that window found no match are counted in
+// longLinesSkipped.
+//
+// Matches are streamed to the callback as they are found, one at a time.
+// Within a file they arrive in order; across files the order depends on
+// scheduling. A match spanning a line longer than the read buffer can be
+// missed.
+class ContentSearcher {
+public:
+    // Return false to stop the search
+    using MatchCallback = std::function<bool(const ContentMatch& match)>;
+
+    struct Statistics {
+        uint64_t filesSearched = 0;
+        uint64_t filesMatched = 0;
+        uint64_t binarySkipped = 0;
+        uint64_t tooLargeSkipped = 0;
+        uint64_t longLinesSkipped = 0;  // Longer than maxRegexLineLength, not fully searched
+        uint64_t errors = 0;
+        uint64_t bytesRead = 0;
+        uint64_t matches = 0;
+        double seconds = 0.0;
+        bool truncated = false;         // Stopped at maxResults, by the callback or cancel()
+    };
+
+private:
+    ContentSearchOptions options_;
+    std::optional<Utils::LiteralFinder> literal_;   // The pattern, or the regex's required literal
+    std::optional<std::regex> regex_;
+    std::string error_;
+
+    std::atomic<bool> stop_;
+    std::mutex callbackMutex_;
+
+    std::atomic<uint64_t> filesSearched_;
+    std::atomic<uint64_t> filesMatched_;
+    std::atomic<uint64_t> binarySkipped_;
+    std::atomic<uint64_t> tooLargeSkipped_;
+    std::atomic<uint64_t> longLinesSkipped_;
+    std::atomic<uint64_t> errors_;
+    std::atomic<uint64_t> bytesRead_;
+    std::atomic<uint64_t> matches_;
+
+    static constexpr size_t BINARY_PROBE_BYTES = 8192;
+
+public:
+    explicit ContentSearcher(const ContentSearchOptions& options);
+
+    // Non-copyable
+    ContentSearcher(const ContentSearcher&) = delete;
+    ContentSearcher& operator=(const ContentSearcher&) = delete;
+
+    // False if the pattern is empty or the regex does not compile
+    bool isValid() const { return error_.empty(); }
+    const std::string& getError() const { return error_; }
+
+    // Blocks until every file was searched or the search stopped
+    Statistics search(const std::vector<FileEntry>& files, const MatchCallback& callback);
+    std::vector<ContentMatch> search(const std::vector<FileEntry>& files);
+
+    // Any thread
+    void cancel() { stop_.store(true); }
+
+    // Longest run of plain characters every match of an ECMAScript pattern
+    // contains; empty if there is none (or the pattern has alternatives)
+    static std::string requiredLiteral(const std::string& pattern);
+
+private:
+    void searchFile(const FileEntry& entry, std::vector<char>& buffer, const MatchCallback& callback);
+    // Search complete lines in [data, data + size); returns matches emitted
+    uint32_t searchLines(const std::string& path, const char* data, size_t size, uint64_t& lineNumber,
+                         uint32_t matchesSoFar, const MatchCallback& callback);
+    // hit is where the literal was found in the line, nullptr if there is
+    // no literal
+    bool lineMatches(const char* begin, const char* end, const char* hit, size_t& column);
+    bool emit(const std::string& path, uint64_t lineNumber, size_t column,
+              const char* begin, const char* end, const MatchCallback& callback);
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// Keeps background work within a share of the machine's CPU.
+//
+// Workers call pace() between units of work. Over short windows the
+// process CPU time is compared with the budget (share x cores x wall time);
+// when it runs ahead, the calling worker sleeps until the budget catches up.
+// Process CPU time includes foreground threads, so the throttle errs on the
+// side of yielding while the user is searching.
+class CpuThrottle {
+private:
+    std::mutex mutex_;
+    std::atomic<double> share_;     // 0 < share <= 1, of all cores
+    unsigned int cores_;
+
+    std::chrono::steady_clock::time_point windowStart_;
+    double windowCpuStart_;
+
+    std::atomic<uint64_t> throttledNs_;
+
+    static constexpr std::chrono::milliseconds WINDOW{250};
+    static constexpr std::chrono::milliseconds MAX_SLEEP{100};
+
+public:
+    explicit CpuThrottle(double share = 1.0);
+
+    // share >= 1 disables throttling
+    void setShare(double share);
+    double getShare() const { return share_.load(); }
+
+    // Any thread; may sleep
+    void pace();
+
+    std::chrono::nanoseconds getThrottledTime() const {
+        return std::chrono::nanoseconds(throttledNs_.load());
+    }
+
+    // CPU seconds used by the whole process
+    static double processCpuSeconds();
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
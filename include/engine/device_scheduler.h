@@ -0,0 +1,101 @@
+#pragma once
+
+#include "engine/storage_topology.h"
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// Bounds how many directory reads are in flight per storage device.
+//
+// Each device starts at the concurrency its kind suggests (one reader for a
+// spinning disk, several for SSD/NVMe) and is tuned from observed
+// per-directory latency: when latency climbs well above its running baseline,
+// the limit is cut (multiplicative decrease); while latency stays close to it
+// and work is waiting, the limit grows by one (additive increase).
+class DeviceScheduler {
+public:
+    struct DeviceStatistics {
+        StorageDevice device;
+        size_t limit = 0;
+        size_t maxLimit = 0;
+        size_t active = 0;
+        double latencyMs = 0.0;     // Smoothed per-directory latency
+        double baselineMs = 0.0;    // Reference latency the limit is tuned against
+        uint64_t directories = 0;
+        uint64_t rejected = 0;      // tryAcquire() calls turned away
+    };
+
+private:
+    struct Slot {
+        StorageDevice device;
+        size_t minLimit = 1;
+        size_t maxLimit = 1;
+        size_t limit = 1;
+        size_t active = 0;
+        bool contended = false;     // Work was turned away since the last adjustment
+        double latencyMs = 0.0;
+        double baselineMs = 0.0;
+        uint32_t windowSamples = 0;
+        uint64_t directories = 0;
+        uint64_t rejected = 0;
+    };
+
+    std::shared_ptr<StorageTopology> topology_;
+    size_t maxThreads_;
+    double concurrencyScale_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<uint64_t, Slot> slots_;
+
+    // Tuning
+    static constexpr uint32_t ADAPT_WINDOW = 32;        // Samples between adjustments
+    static constexpr double LATENCY_SMOOTHING = 0.2;    // EWMA weight of a new sample
+    static constexpr double BACKOFF_RATIO = 2.0;        // Latency vs baseline that triggers a cut
+    static constexpr double GROW_RATIO = 1.25;          // Latency vs baseline that allows growth
+    static constexpr double BASELINE_DRIFT = 0.05;      // How fast the baseline follows slower periods
+    static constexpr double BASELINE_RECOVERY = 0.5;    // ...and faster ones
+
+public:
+    DeviceScheduler(std::shared_ptr<StorageTopology> topology, size_t maxThreads);
+
+    // Non-copyable
+    DeviceScheduler(const DeviceScheduler&) = delete;
+    DeviceScheduler& operator=(const DeviceScheduler&) = delete;
+
+    // Take a read slot on device; false if the device is at its limit
+    bool tryAcquire(uint64_t device);
+
+    // Report a finished directory read and give the slot back
+    void release(uint64_t device, std::chrono::nanoseconds latency);
+
+    // Report a finished read but keep the slot for the next directory on the
+    // same device. Returns false (and releases the slot) when the device is
+    // now over its limit and another reader still holds a slot.
+    bool recordAndKeep(uint64_t device, std::chrono::nanoseconds latency);
+
+    // True if device has a free slot right now
+    bool hasCapacity(uint64_t device) const;
+
+    // Scale every device's concurrency (e.g. 0.5 while the system is busy)
+    void setConcurrencyScale(double scale);
+    void setMaxThreads(size_t maxThreads);
+
+    std::shared_ptr<StorageTopology> getTopology() const { return topology_; }
+    std::vector<DeviceStatistics> getStatistics() const;
+    void reset();
+
+private:
+    Slot& slotLocked(uint64_t device);
+    void recordLocked(Slot& slot, std::chrono::nanoseconds latency);
+    void adaptLocked(Slot& slot);
+    void applyLimitsLocked(Slot& slot);
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "core/types.h"
+#include "engine/metadata_collector.h"
+#include "engine/scan_priority.h"
+#include "engine/exclusion_rules.h"
+#include <memory>
+#include <functional>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ctime>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// Options that let a scanner skip work before any metadata is fetched
+struct ScanOptions {
+    bool includeHidden = false;     // Entries whose name starts with '.'
+    bool followSymlinks = false;    // Report symlinked directories as subdirectories
+    bool enableIoUring = true;      // Batch metadata lookups through io_uring where supported
+    uint32_t metadataThreads = 4;   // Fallback fstatat() workers when io_uring is unavailable; 0 stats inline
+    bool stayOnFilesystem = false;  // Like find -xdev: do not descend into other mounts below a root
+
+    // Matching entries are dropped before any metadata lookup; excluded
+    // directories are never reported, so their subtrees are never opened
+    std::shared_ptr<const ExclusionRules> exclusions;
+};
+
+// Result of enumerating a single directory (immediate children only)
+struct ScannedDirectory {
+    std::string path;
+    std::vector<FileEntry> entries;          // Files, links and directories found
+    std::vector<std::string> subdirectories; // Full paths of child directories to descend into
+
+    // Metadata of the directory itself, taken from the open handle
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    std::time_t lastModified = 0;
+    int64_t modifiedNs = 0;   // mtime, nanoseconds since epoch
+    int64_t changedNs = 0;    // ctime where the platform has one, otherwise 0
+
+    uint64_t statCalls = 0;
+    uint64_t excluded = 0;
+    uint64_t errors = 0;
+
+    // Set when the open check rejected the directory; nothing was enumerated
+    bool skipped = false;
+
+    // Band the directory was queued in (set by ParallelScanner)
+    ScanPriority priority = ScanPriority::Normal;
+
+    void clear();
+};
+
+// Abstract base class for platform-specific directory enumerators
+class DirectoryScanner {
+public:
+    // Consulted with the identity of a directory once it is open and before
+    // it is enumerated; returning false skips it (visited-set and
+    // other-filesystem checks)
+    using OpenCheck = std::function<bool(uint64_t device, uint64_t inode)>;
+
+protected:
+    ScanOptions options_;
+    OpenCheck openCheck_;
+
+public:
+    explicit DirectoryScanner(const ScanOptions& options = ScanOptions());
+    virtual ~DirectoryScanner() = default;
+
+    // Non-copyable
+    DirectoryScanner(const DirectoryScanner&) = delete;
+    DirectoryScanner& operator=(const DirectoryScanner&) = delete;
+
+    // Enumerate the immediate children of path into result (result is cleared first).
+    // Returns false if the directory itself could not be opened.
+    virtual bool scanDirectory(const std::string& path, ScannedDirectory& result) = 0;
+    virtual const char* getName() const = 0;
+
+    void setOptions(const ScanOptions& options) { options_ = options; }
+    const ScanOptions& getOptions() const { return options_; }
+    void setOpenCheck(OpenCheck check) { openCheck_ = std::move(check); }
+
+    // Best scanner available on this platform
+    static std::unique_ptr<DirectoryScanner> create(const ScanOptions& options = ScanOptions());
+
+    // Fill only the directory's own metadata (path, device, inode, times)
+    // without enumerating it. Returns false if the directory does not exist.
+    static bool statDirectory(const std::string& path, ScannedDirectory& result);
+
+protected:
+    bool isHiddenName(const char* name) const { return name[0] == '.'; }
+    bool isExcludedEntry(const std::string& directory, const char* name, bool isDirectory) const {
+        return options_.exclusions && options_.exclusions->isChildExcluded(directory, name, isDirectory);
+    }
+    static std::string joinPath(const std::string& directory, const char* name);
+};
+
+// Portable implementation built on std::filesystem::directory_iterator
+class StdDirectoryScanner : public DirectoryScanner {
+public:
+    explicit StdDirectoryScanner(const ScanOptions& options = ScanOptions());
+
+    bool scanDirectory(const std::string& path, ScannedDirectory& result) override;
+    const char* getName() const override { return "std::filesystem"; }
+};
+
+#ifdef __linux__
+// Reads directories with large getdents64() batches, classifies entries by
+// d_type and hands the entries that need size/mtime to a MetadataCollector
+// as one batch per getdents64() buffer.
+class LinuxDirectoryScanner : public DirectoryScanner {
+private:
+    // An entry from the current getdents64() batch, waiting for its metadata
+    struct PendingEntry {
+        const char* name;
+        unsigned char dType;
+        size_t metadataIndex;
+    };
+
+    std::vector<char> buffer_;
+    static const size_t BUFFER_SIZE = 256 * 1024; // 256KB
+    static const size_t NO_METADATA = static_cast<size_t>(-1);
+
+    // Per-batch scratch space, reused across directories
+    std::vector<PendingEntry> pending_;
+    std::vector<const char*> metadataNames_;
+    std::vector<FileMetadata> metadata_;
+
+    std::unique_ptr<MetadataCollector> metadataCollector_;
+
+public:
+    explicit LinuxDirectoryScanner(const ScanOptions& options = ScanOptions());
+
+    bool scanDirectory(const std::string& path, ScannedDirectory& result) override;
+    const char* getName() const override { return "getdents64"; }
+
+    const char* getMetadataCollectorName() const;
+
+private:
+    void processBatch(int dirFd, const std::string& directory, ScannedDirectory& result);
+    void processEntry(int dirFd, const std::string& directory, const PendingEntry& pendingEntry,
+                      const FileMetadata* metadata, ScannedDirectory& result);
+};
+#endif
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "core/types.h"
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <set>
+#include <ctime>
+#include <cstdint>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// Parts of the tree where watcher events were lost, waiting for a targeted
+// reconcile.
+//
+// Two kinds of loss are tracked. A kernel queue overflow (IN_Q_OVERFLOW,
+// FAN_Q_OVERFLOW, a ReadDirectoryChangesW buffer overrun) says nothing
+// about where changes happened, so the whole watched root becomes a dirty
+// subtree and is reconciled by directory stamps. An event dropped because
+// our own queue was full names its path, so its parent directory is re-read
+// even if its stamp did not change; that also catches in-place
+// modifications, which never touch a directory's mtime. Past
+// maxDirectories the remaining drops fall back to stamp checks of their
+// directories.
+//
+// Recovery waits until no loss was reported for settleDelay, so a checkout
+// storm is reconciled once after it ends instead of over and over while it
+// lasts, but never longer than maxDelay. Work a failed recovery did not
+// finish is merged back and retried.
+class DirtySubtrees {
+public:
+    struct Work {
+        std::vector<std::string> subtrees;      // Reconcile by directory stamps; none nested in another
+        std::vector<std::string> directories;   // Re-read regardless of their stamps
+
+        bool empty() const { return subtrees.empty() && directories.empty(); }
+    };
+
+    // Returns true once the work is reconciled
+    using RecoveryTask = std::function<bool(const Work& work)>;
+    // Asks a running RecoveryTask to return early; like
+    // BackgroundReconciler::CancelTask, it may arrive just before the task
+    // starts and must not be lost
+    using CancelTask = std::function<void()>;
+
+    struct Statistics {
+        uint64_t overflows = 0;             // Kernel queue overflows reported
+        uint64_t droppedEvents = 0;         // Events our queue had no room for
+        uint64_t pendingSubtrees = 0;
+        uint64_t pendingDirectories = 0;
+        uint64_t recoveries = 0;            // Recovery runs that succeeded
+        uint64_t failedRecoveries = 0;
+        uint64_t subtreesReconciled = 0;
+        uint64_t directoriesReconciled = 0;
+        std::time_t lastLoss = 0;
+        std::time_t lastRecovery = 0;
+    };
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable wakeCondition_;
+    std::thread thread_;
+    std::atomic<bool> shouldStop_;
+
+    std::set<std::string> subtrees_;
+    std::set<std::string> directories_;
+    bool recovering_;
+    std::chrono::steady_clock::time_point firstLossAt_;
+    std::chrono::steady_clock::time_point lastLossAt_;
+
+    std::chrono::milliseconds settleDelay_;
+    std::chrono::milliseconds maxDelay_;
+    size_t maxDirectories_;
+
+    RecoveryTask recoveryTask_;
+    CancelTask cancelTask_;
+
+    Statistics stats_;
+
+    static constexpr std::chrono::seconds RETRY_DELAY{30};
+
+public:
+    explicit DirtySubtrees(std::chrono::milliseconds settleDelay = std::chrono::milliseconds(2000),
+                           std::chrono::milliseconds maxDelay = std::chrono::milliseconds(30000),
+                           size_t maxDirectories = 4096);
+    ~DirtySubtrees();
+
+    // Non-copyable
+    DirtySubtrees(const DirtySubtrees&) = delete;
+    DirtySubtrees& operator=(const DirtySubtrees&) = delete;
+
+    // Any thread, typically a watcher thread
+    void markOverflow(const std::string& root);
+    void markDropped(const FileChangeEvent& event);
+    void markSubtree(const std::string& path);
+    // Re-read one directory regardless of its stamp; not a loss, so it
+    // does not count as a dropped event
+    void markDirectory(const std::string& directory);
+
+    // Pending work with nested subtrees folded into their ancestors;
+    // leaves nothing pending
+    Work take();
+    // Put back work a recovery did not finish
+    void restore(const Work& work);
+    bool hasPending() const;
+    // Events may be missing from the index until recovery catches up
+    bool isPossiblyStale() const;
+
+    // Runs task on a background thread whenever marks have settled
+    bool start(RecoveryTask task, CancelTask cancel = CancelTask());
+    void stop();
+    bool isRunning() const;
+
+    Statistics getStatistics() const;
+    void resetStatistics();
+
+private:
+    void run();
+    void addSubtreeLocked(const std::string& path);
+    void addDirectoryLocked(const std::string& directory);
+    void noteLossLocked();
+    static std::string parentOf(const std::string& path);
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "core/types.h"
+#include "engine/scan_throttle.h"
+#include "storage/content_hash_store.h"
+#include "utils/murmur_hash3.h"
+#include <memory>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+
+namespace FastFileSearch {
+namespace Engine {
+
+struct DuplicateOptions {
+    uint64_t minSize = 1;               // Smaller files are ignored; all empty files are "equal"
+    size_t headBytes = 4096;            // Read first to split size groups cheaply
+    size_t readBufferSize = 1 << 20;    // Sequential read size for full hashes
+    size_t threads = 2;
+    bool lowerPriority = true;          // Hash on niced, idle-I/O threads
+};
+
+// Files with identical content. Hard links to one inode are reported once,
+// since removing one of them frees nothing.
+struct DuplicateGroup {
+    uint64_t size = 0;
+    Utils::Hash128 hash;
+    std::vector<std::string> paths;
+
+    uint64_t reclaimableBytes() const { return paths.size() > 1 ? size * (paths.size() - 1) : 0; }
+};
+
+// Finds duplicate files among indexed entries while reading as little as
+// possible:
+//   1. group by size; a file with a unique size has no duplicate
+//   2. hash the first headBytes of every file in a size group
+//   3. hash the rest only where size and head hash still collide
+// Full hashes use large sequential reads with read-ahead hints and drop the
+// pages afterwards, so a run does not evict the page cache of the
+// applications it shares the host with.
+//
+// Hashes are cached by path together with the fingerprint they were taken
+// at; a later run reuses them if a fresh lstat() still matches, so a stale
+// index never yields stale hashes. loadHashes() and saveHashes()
+// move the cache to and from ContentHashStore.
+class DuplicateFinder {
+public:
+    struct Statistics {
+        uint64_t candidates = 0;        // Regular files at or above minSize
+        uint64_t sizeGroups = 0;        // Sizes shared by more than one file
+        uint64_t headHashed = 0;
+        uint64_t fullHashed = 0;
+        uint64_t cacheHits = 0;
+        uint64_t bytesRead = 0;
+        uint64_t hardlinksSkipped = 0;
+        uint64_t changedSkipped = 0;    // Size on disk no longer matches the index
+        uint64_t errors = 0;
+        uint64_t groups = 0;
+        uint64_t reclaimableBytes = 0;
+        double seconds = 0.0;
+    };
+
+private:
+    struct CachedHash {
+        FileFingerprint fingerprint;
+        Utils::Hash128 head;
+        Utils::Hash128 full;
+        bool hasHead = false;
+        bool hasFull = false;
+        bool dirty = false;             // Not yet written by a successful saveHashes()
+        uint64_t dirtied = 0;           // saveGeneration_ of the last change
+    };
+
+    // Per-candidate working state of one find() run
+    struct Candidate {
+        const FileEntry* entry = nullptr;
+        FileFingerprint headFingerprint;    // Of the file the head hash describes
+        Utils::Hash128 head;
+        Utils::Hash128 full;
+        bool valid = false;
+        bool hasFull = false;
+    };
+
+    DuplicateOptions options_;
+    std::shared_ptr<ScanThrottle> throttle_;
+
+    mutable std::mutex cacheMutex_;
+    std::unordered_map<std::string, CachedHash> cache_;
+    uint64_t saveGeneration_ = 0;
+    std::mutex saveMutex_;              // One saveHashes() at a time
+
+    std::atomic<bool> running_;
+    std::atomic<bool> cancelled_;
+
+    // Counters of the running (or last) find()
+    std::atomic<uint64_t> headHashed_;
+    std::atomic<uint64_t> fullHashed_;
+    std::atomic<uint64_t> cacheHits_;
+    std::atomic<uint64_t> bytesRead_;
+    std::atomic<uint64_t> changedSkipped_;
+    std::atomic<uint64_t> errors_;
+
+    mutable std::mutex statsMutex_;
+    Statistics lastStats_;
+
+public:
+    explicit DuplicateFinder(const DuplicateOptions& options = DuplicateOptions());
+
+    // Non-copyable
+    DuplicateFinder(const DuplicateFinder&) = delete;
+    DuplicateFinder& operator=(const DuplicateFinder&) = delete;
+
+    void setOptions(const DuplicateOptions& options) { options_ = options; }
+    const DuplicateOptions& getOptions() const { return options_; }
+    // Shared with the scanners, so hashing and scanning use one budget
+    void setThrottle(std::shared_ptr<ScanThrottle> throttle) { throttle_ = std::move(throttle); }
+
+    // Blocks until done; groups are ordered by reclaimable bytes, largest
+    // first. Returns nothing if cancelled or another find() is running.
+    std::vector<DuplicateGroup> find(const std::vector<FileEntry>& files);
+    void cancel() { cancelled_.store(true); }
+    bool isRunning() const { return running_.load(); }
+
+    // Hash cache. saveHashes() writes the hashes changed since the last
+    // successful save; after a failed one they are written by the next.
+    void loadHashes(const std::vector<Storage::ContentHashRecord>& records);
+    bool saveHashes(Storage::ContentHashStore& store);
+    void forget(const std::string& path);
+    size_t getCachedHashCount() const;
+
+    Statistics getStatistics() const;
+
+    // Hash up to 'limit' bytes of path (UINT64_MAX for all of it) and report
+    // the fingerprint of the file that was actually read
+    static bool hashFile(const std::string& path, uint64_t limit, std::vector<char>& buffer,
+                         Utils::Hash128& hash, FileFingerprint& fingerprint, uint64_t& bytesRead);
+
+private:
+    bool hashCandidate(Candidate& candidate, bool full, std::vector<char>& buffer);
+    bool lookupCache(const std::string& path, const FileFingerprint& current, bool full, Utils::Hash128& hash);
+    // Either hash may be null; a new fingerprint discards what was cached
+    void storeCache(const std::string& path, const FileFingerprint& fingerprint, const Utils::Hash128* head,
+                    const Utils::Hash128* full);
+    void forEachParallel(size_t count, const std::function<void(size_t index, std::vector<char>& buffer)>& work);
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "core/types.h"
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace FastFileSearch {
+namespace Engine {
+
+struct CoalescingOptions {
+    std::chrono::milliseconds minWindow{50};    // Quiet gap that closes a window
+    std::chrono::milliseconds maxWindow{1000};  // A window never stays open longer
+    size_t maxBatch = 10000;                    // Events that close a window early
+    size_t busyBatch = 256;                     // Batches this large widen the quiet gap
+};
+
+// Collects watcher events into short windows and hands them out as one
+// batch per window, reduced to the net effect on each path.
+//
+// Per path, create+modify is a create, create+delete is a delete (a
+// "create" may be a path the index already had, e.g. one replaced in
+// place, so it must not simply vanish), repeated modifies merge, and
+// delete+create becomes a delete followed by a create. Deleting a
+// directory drops what is pending below it. A rename of a path created in
+// the same window (write to a temp file, rename over the target) folds
+// into a delete of the temporary name and a replace of the target; any
+// other rename or move is kept as an ordering barrier, with events before
+// and after it coalesced separately, and the batch must be applied in
+// order. Within a segment events come out sorted by directory, so
+// parents are created before their children and index updates touch one
+// directory at a time.
+//
+// The quiet gap adapts: it doubles after a busy batch and halves after a
+// small one, between minWindow and maxWindow, so sustained churn (a build
+// directory) costs a few batches per second while a single save is applied
+// within minWindow.
+//
+// Not thread-safe; the event processing thread owns it.
+class EventCoalescer {
+public:
+    struct Statistics {
+        uint64_t eventsIn = 0;
+        uint64_t eventsOut = 0;
+        uint64_t batches = 0;
+        uint64_t largestBatch = 0;
+        uint64_t foldedRenames = 0;
+        uint64_t barriers = 0;
+    };
+
+private:
+    enum class NetChange : uint8_t {
+        Created,
+        Modified,
+        Deleted,
+        Replaced        // Deleted, then created again
+    };
+
+    struct Segment {
+        std::map<std::string, NetChange> changes;   // Ordered, so a subtree is a key range
+        std::vector<FileChangeEvent> barrier;       // The rename/move that ended this segment
+    };
+
+    CoalescingOptions options_;
+    std::vector<Segment> segments_;
+    size_t pendingEvents_;
+    std::chrono::milliseconds quietGap_;
+    std::chrono::steady_clock::time_point openedAt_;
+    std::chrono::steady_clock::time_point lastEventAt_;
+    Statistics stats_;
+
+public:
+    explicit EventCoalescer(const CoalescingOptions& options = CoalescingOptions());
+
+    void setOptions(const CoalescingOptions& options);
+    const CoalescingOptions& getOptions() const { return options_; }
+
+    void add(const FileChangeEvent& event);
+
+    bool empty() const { return pendingEvents_ == 0; }
+    // The open window should be handed out now
+    bool isDue() const;
+    // How long until isDue(); max() when nothing is pending
+    std::chrono::milliseconds timeUntilDue() const;
+
+    // Close the window: the coalesced batch, in application order
+    std::vector<FileChangeEvent> take();
+
+    Statistics getStatistics() const { return stats_; }
+    std::chrono::milliseconds getQuietGap() const { return quietGap_; }
+
+private:
+    static void apply(std::map<std::string, NetChange>& changes, FileChangeType type, const std::string& path);
+    static void eraseBelow(std::map<std::string, NetChange>& changes, const std::string& path);
+    static bool hasBelow(const std::map<std::string, NetChange>& changes, const std::string& path);
+    static void emit(const std::map<std::string, NetChange>& changes, std::vector<FileChangeEvent>& batch);
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
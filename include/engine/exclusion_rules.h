@@ -0,0 +1,162 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <bitset>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// Exclusion lists compiled into lookup structures once, so checking a path
+// costs a handful of hash lookups however many rules there are.
+//
+// Rule forms (AppSettings::excludePaths):
+//   /var/cache, C:\Windows     absolute path: excludes that subtree (prefix trie)
+//   node_modules, .git         bare name: excludes any component with that name (hash set)
+//   *.egg-info, ~$*            name glob: matched against single components
+//   /home/*/.cache, a/**/tmp   path glob: matched against the whole path; '*'
+//                              stops at separators, '**' crosses them.
+//                              Relative path rules match at any depth.
+// Extensions (AppSettings::excludeExtensions) are matched case-insensitively
+// without the leading dot.
+//
+// Globs of each kind are compiled into one automaton, so a path is checked
+// against all of them in a single pass over its characters.
+//
+// Instances are immutable; share them through shared_ptr<const ExclusionRules>
+// and replace the pointer when settings change.
+class ExclusionRules {
+private:
+    // Transparent hashing so lookups take string_view without allocating
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+    };
+    using StringSet = std::unordered_set<std::string, StringHash, std::equal_to<>>;
+
+    struct TrieNode {
+        std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> children;
+        bool excluded = false;
+    };
+
+    // Literal-anchored name globs ("*.tmp", "~$*") are grouped by literal
+    // length so each length costs one hash lookup
+    struct AnchoredGlobs {
+        std::unordered_map<size_t, StringSet> byLength;
+        bool matches(std::string_view name, bool suffix) const;
+        bool empty() const { return byLength.empty(); }
+    };
+
+    // Active states of a GlobAutomaton, one bit per state
+    using GlobState = std::vector<uint64_t>;
+
+    // Any number of globs as one NFA simulated bit-parallel (shift-and):
+    // every pattern element is a state, patterns are laid out side by side,
+    // and one step advances all of them at once
+    class GlobAutomaton {
+    private:
+        // Per state while patterns are added; compile() turns them into masks
+        struct State {
+            std::bitset<256> advance;   // Characters that move to the next state
+            std::bitset<256> loop;      // Characters that stay in this state
+            bool skip = false;          // Next state is reachable without input
+            bool jump = false;          // So is the one after it
+        };
+        std::vector<State> states_;
+        std::vector<size_t> starts_;
+        std::vector<size_t> accepts_;
+
+        size_t words_ = 0;
+        std::vector<uint64_t> advance_;  // 256 masks of words_ words
+        std::vector<uint64_t> loop_;
+        GlobState skip_;
+        GlobState jump_;
+        GlobState start_;
+        GlobState accept_;
+
+    public:
+        void add(std::string_view pattern);
+        void compile();
+        bool empty() const { return starts_.empty(); }
+
+        void start(GlobState& state) const { state = start_; }
+        // Returns false once no state is left, i.e. nothing can match any more
+        bool step(GlobState& state, unsigned char c) const;
+        bool accepts(const GlobState& state) const;
+
+        // Whole-text match; allowDescendants also accepts a match that ends
+        // at a separator
+        bool matches(std::string_view text, bool allowDescendants, GlobState& scratch) const;
+
+    private:
+        void close(GlobState& state) const;
+    };
+
+    bool caseSensitive_;
+    std::vector<TrieNode> trie_;                // trie_[0] is the root
+    StringSet names_;
+    AnchoredGlobs suffixGlobs_;
+    AnchoredGlobs prefixGlobs_;
+    GlobAutomaton nameGlobs_;                   // Remaining single-component globs
+    GlobAutomaton pathGlobs_;
+    StringSet extensions_;
+    size_t ruleCount_;
+    uint64_t id_;                               // Keys the per-thread directory cache
+
+    static const uint32_t NO_NODE = static_cast<uint32_t>(-1);
+
+public:
+    ExclusionRules();
+    ExclusionRules(const std::vector<std::string>& pathRules, const std::vector<std::string>& extensions,
+                   bool caseSensitive = defaultCaseSensitivity());
+
+    // Any path, e.g. a watcher event: every component is checked
+    bool isExcluded(std::string_view path) const;
+
+    // A child of a directory that already passed: only the last component,
+    // the prefix trie and path globs are checked. Used to prune directories
+    // before they are opened.
+    bool isChildExcluded(std::string_view path, bool isDirectory) const;
+
+    // Same, for an entry being enumerated. The full path is never built: the
+    // prefix trie and path globs are advanced over the directory once and
+    // that state is kept per thread while its entries are checked.
+    bool isChildExcluded(std::string_view directory, std::string_view name, bool isDirectory) const;
+
+    bool isExtensionExcluded(std::string_view extension) const;
+
+    bool empty() const { return ruleCount_ == 0; }
+    size_t getRuleCount() const { return ruleCount_; }
+
+    static bool defaultCaseSensitivity();
+
+    // Glob match where '*' and '?' do not cross separators (unless
+    // crossSeparators) and "**" always does
+    static bool globMatch(std::string_view pattern, std::string_view text, bool crossSeparators = false);
+
+private:
+    void addRule(std::string rule);
+    void addPrefix(std::string_view path);
+    bool isNameExcluded(std::string_view name) const;
+    bool isPrefixExcluded(std::string_view path) const;
+    // Node reached by the components of path; NO_NODE if no prefix rule can
+    // match below it. Sets excluded if a prefix rule covers path.
+    uint32_t walkPrefix(std::string_view path, uint32_t node, bool& excluded) const;
+    bool isPathGlobExcluded(std::string_view path) const;
+    bool hasPathRules() const { return trie_[0].excluded || !trie_[0].children.empty() || !pathGlobs_.empty(); }
+    bool needsFolding() const;
+    std::string fold(std::string_view text) const;
+
+    static bool hasWildcard(std::string_view text);
+    static bool isSeparator(char c) { return c == '/' || c == '\\'; }
+    static std::string_view lastComponent(std::string_view path);
+    static std::string_view extensionOf(std::string_view name);
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "core/types.h"
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#else
+#include <fstream>
+#endif
+
+namespace FastFileSearch {
+namespace Engine {
+
+#ifndef _WIN32
+// stat() and statx() times as the nanosecond timestamps the index keeps
+inline int64_t toNanoseconds(int64_t seconds, int64_t nanoseconds) {
+    return seconds * 1000000000 + nanoseconds;
+}
+
+inline int64_t modifiedNs(const struct stat& st) {
+#ifdef __APPLE__
+    return toNanoseconds(st.st_mtimespec.tv_sec, st.st_mtimespec.tv_nsec);
+#else
+    return toNanoseconds(st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+#endif
+}
+
+inline int64_t changedNs(const struct stat& st) {
+#ifdef __APPLE__
+    return toNanoseconds(st.st_ctimespec.tv_sec, st.st_ctimespec.tv_nsec);
+#else
+    return toNanoseconds(st.st_ctim.tv_sec, st.st_ctim.tv_nsec);
+#endif
+}
+
+// Same convention as the scanners: only regular files have a size
+inline FileFingerprint fingerprintOf(const struct stat& st) {
+    FileFingerprint fingerprint;
+    fingerprint.size = S_ISREG(st.st_mode) ? static_cast<uint64_t>(st.st_size) : 0;
+    fingerprint.modifiedNs = modifiedNs(st);
+    fingerprint.changedNs = changedNs(st);
+    fingerprint.inode = static_cast<uint64_t>(st.st_ino);
+    return fingerprint;
+}
+#endif
+
+// A regular file read front to back by hashing, content indexing and
+// content search.
+//
+// Opened without updating its access time where that is permitted, so
+// background reads do not look like the user opened the file. The
+// fingerprint comes from the open descriptor and so describes the file
+// actually read, even if the path is replaced meanwhile.
+class SequentialFile {
+private:
+#ifndef _WIN32
+    int fd_ = -1;
+#else
+    std::ifstream stream_;
+#endif
+    FileFingerprint fingerprint_;
+    bool dropCache_ = false;
+
+public:
+    SequentialFile() = default;
+    ~SequentialFile();
+
+    // Non-copyable
+    SequentialFile(const SequentialFile&) = delete;
+    SequentialFile& operator=(const SequentialFile&) = delete;
+
+    // False if the file cannot be opened or is not a regular file
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    // Hint that the whole file will be read; with dropCache its pages are
+    // released on close, so a pass over many files does not evict what
+    // other applications have cached
+    void adviseSequential(bool dropCache);
+
+    // Up to size bytes; 0 at the end of the file, -1 on error
+    long read(char* target, size_t size);
+
+    const FileFingerprint& fingerprint() const { return fingerprint_; }
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -1,6 +1,11 @@
 #pragma once
 
 #include "core/types.h"
+#include "engine/exclusion_rules.h"
+#include "engine/watch_manager.h"
+#include "engine/dirty_subtrees.h"
+#include "engine/move_pairer.h"
+#include "engine/event_coalescer.h"
 #include "utils/thread_safe_queue.h"
 #include <memory>
 #include <vector>
@@ -25,6 +30,7 @@ protected:
     std::atomic<bool> isWatching_;
     std::atomic<bool> shouldStop_;
     Utils::ThreadSafeQueue<FileChangeEvent>* eventQueue_;
+    DirtySubtrees* dirtySubtrees_ = nullptr;
     
 public:
     explicit DriveWatcher(const std::string& drivePath, 
@@ -43,14 +49,29 @@ public:
     // Common interface
     bool isWatching() const { return isWatching_.load(); }
     const std::string& getDrivePath() const { return drivePath_; }
+    
+    // Where lost events are reported; before startWatching()
+    void setDirtySubtrees(DirtySubtrees* dirtySubtrees) { dirtySubtrees_ = dirtySubtrees; }
 
 protected:
+    // Queues with eventQueue_->tryPush(); an event that does not fit goes
+    // to dirtySubtrees_->markDropped() instead
     void postEvent(const FileChangeEvent& event);
+    // The kernel dropped events: every backend calls this on its overflow
+    // indication (IN_Q_OVERFLOW, FAN_Q_OVERFLOW, ReadDirectoryChangesW
+    // returning no records or ERROR_NOTIFY_ENUM_DIR)
+    void reportOverflow(const std::string& subtree) {
+        if (dirtySubtrees_) {
+            dirtySubtrees_->markOverflow(subtree);
+        }
+    }
     bool shouldContinueWatching() const;
 };
 
 // Platform-specific implementations
 #ifdef _WIN32
+// ReadDirectoryChangesW on the drive root. A completion with no records or
+// ERROR_NOTIFY_ENUM_DIR means the buffer overran and reports an overflow.
 class WindowsFileWatcher : public DriveWatcher {
 private:
     void* directoryHandle_;
@@ -76,12 +97,25 @@ private:
 };
 
 #elif defined(__linux__)
+// inotify watcher. Watches are handed out by a WatchManager within a share
+// of max_user_watches; directories without one are polled, and watchLoop()
+// waits on the inotify fd for at most what WatchManager::poll() returns.
+// Polled directories that lost entries go to DirtySubtrees::markDirectory()
+// to be re-read against the index.
+// IN_Q_OVERFLOW reports the drive path as overflowed; polled directories
+// lose nothing, but the watched ones cannot be told apart. Every event goes
+// through a MovePairer, so a directory rename arrives as one Renamed/Moved
+// event (and one WatchManager::directoryMoved()) rather than a delete and
+// create of its subtree.
 class LinuxFileWatcher : public DriveWatcher {
 private:
     int inotifyFd_;
     int watchDescriptor_;
     std::thread watchThread_;
     std::unordered_map<int, std::string> watchDescriptorToPath_;
+    WatchBudgetOptions watchBudget_;
+    std::unique_ptr<WatchManager> watchManager_;   // Replaces addWatchRecursive() on the drive path
+    std::unique_ptr<MovePairer> movePairer_;       // Its expire() also bounds the poll timeout
     
 public:
     explicit LinuxFileWatcher(const std::string& drivePath,
@@ -91,6 +125,12 @@ public:
     bool startWatching() override;
     void stopWatching() override;
     bool isSupported() const override { return true; }
+    
+    // Before startWatching()
+    void setWatchBudget(const WatchBudgetOptions& options) { watchBudget_ = options; }
+    WatchManager::Statistics getWatchStatistics() const;
+    // Any thread: steer watches toward where the user is looking
+    void recordInterest(const std::string& path);
 
 private:
     void watchLoop();
@@ -99,6 +139,65 @@ private:
     FileChangeType convertLinuxMask(uint32_t mask);
 };
 
+// Whole-filesystem watcher: one fanotify mark covers the filesystem holding
+// the drive path, instead of one inotify watch per directory. Events carry
+// the parent directory's file handle and the entry name
+// (FAN_REPORT_DFID_NAME, Linux 5.9+); handles are resolved against the
+// watched root with open_by_handle_at() and cached until a directory is
+// moved or deleted. Resolution happens when the event is read, so an entry
+// in a directory renamed in between is reported at the directory's new
+// location. Events outside the drive path are dropped.
+//
+// Needs CAP_SYS_ADMIN and CAP_DAC_READ_SEARCH, and a filesystem that can
+// encode file handles; createPreferred() falls back to LinuxFileWatcher
+// otherwise.
+class FanotifyFileWatcher : public DriveWatcher {
+private:
+    int fanotifyFd_;
+    int mountFd_;               // The drive path, for open_by_handle_at()
+    int wakeFd_;                // eventfd that interrupts poll() on stop
+    bool renameEvents_;         // FAN_RENAME (5.17+): both names in one event
+    std::string root_;          // drivePath_ without a trailing slash
+    std::thread watchThread_;
+    
+    // Encoded directory handle -> path
+    std::unordered_map<std::string, std::string> directoryCache_;
+    static constexpr size_t MAX_CACHED_DIRECTORIES = 65536;
+    static constexpr size_t BUFFER_SIZE = 256 * 1024;
+    
+    std::atomic<uint64_t> eventsRead_;
+    std::atomic<uint64_t> overflows_;
+    std::atomic<uint64_t> unresolved_;      // Directory handles that no longer resolve; reconciled
+    
+public:
+    explicit FanotifyFileWatcher(const std::string& drivePath,
+                                 Utils::ThreadSafeQueue<FileChangeEvent>* eventQueue);
+    ~FanotifyFileWatcher() override;
+    
+    bool startWatching() override;
+    void stopWatching() override;
+    bool isSupported() const override { return isAvailable(drivePath_); }
+    
+    // This process may put a filesystem mark with directory handles and
+    // names on the filesystem holding path, and can open the handles it
+    // reports (probed on path itself)
+    static bool isAvailable(const std::string& path);
+    // FanotifyFileWatcher when isAvailable(), LinuxFileWatcher otherwise
+    static std::unique_ptr<DriveWatcher> createPreferred(const std::string& drivePath,
+                                                         Utils::ThreadSafeQueue<FileChangeEvent>* eventQueue);
+    
+    uint64_t getEventsRead() const { return eventsRead_.load(); }
+    uint64_t getOverflowCount() const { return overflows_.load(); }
+    uint64_t getUnresolvedCount() const { return unresolved_.load(); }
+
+private:
+    void watchLoop();
+    void processEvents(const char* buffer, size_t length);
+    bool resolveDirectory(const void* fileHandle, std::string& path);
+    bool isUnderRoot(const std::string& path) const;
+    void closeDescriptors();
+};
+
 #elif defined(__APPLE__)
 class MacOSFileWatcher : public DriveWatcher {
 private:
@@ -134,13 +233,22 @@ private:
     std::atomic<bool> isWatching_;
     std::atomic<bool> shouldStop_;
     
-    // Event filtering
+    // Event filtering; recentEvents_ only serves per-event delivery, the
+    // batched path coalesces in coalescer_ instead
     std::unordered_map<std::string, std::chrono::steady_clock::time_point> recentEvents_;
     std::mutex recentEventsMutex_;
     std::chrono::milliseconds eventCoalescingDelay_;
     
+    // Batched delivery: with a batch callback set, eventProcessorLoop()
+    // waits at most coalescer_.timeUntilDue() for the next event and hands
+    // each closed window to batchCallback_ as one vector
+    EventCoalescer coalescer_;
+    EventCoalescer::Statistics coalescingStats_;   // Copied from coalescer_ after each batch
+    mutable std::mutex coalescingStatsMutex_;
+    
     // Callbacks
     std::function<void(const FileChangeEvent&)> eventCallback_;
+    std::function<void(const std::vector<FileChangeEvent>&)> batchCallback_;
     std::function<void(const std::string&)> errorCallback_;
     
     // Statistics
@@ -148,11 +256,18 @@ private:
     std::atomic<uint64_t> eventsFiltered_;
     std::atomic<uint64_t> errorsEncountered_;
     
+    // Lost events (kernel overflows, eventQueue_ over capacity) and their
+    // targeted reconcile; shared with every drive watcher
+    DirtySubtrees dirtySubtrees_;
+    static constexpr size_t DEFAULT_QUEUE_CAPACITY = 262144;  // eventQueue_, set by the constructor
+    
     // Configuration
     bool enableEventCoalescing_;
     bool enableRecursiveWatching_;
     std::vector<std::string> excludedPaths_;
     std::vector<std::string> excludedExtensions_;
+    std::shared_ptr<const ExclusionRules> exclusionRules_; // Compiled from the two lists above
+    bool enableFanotify_ = true; // Linux: one filesystem mark per drive when privileges allow
 
 public:
     FileWatcher();
@@ -173,19 +288,45 @@ public:
     
     // Configuration
     void setEventCallback(std::function<void(const FileChangeEvent&)> callback);
+    // Takes precedence over the event callback; before startWatching()
+    void setBatchCallback(std::function<void(const std::vector<FileChangeEvent>&)> callback) {
+        batchCallback_ = std::move(callback);
+    }
+    void setCoalescingOptions(const CoalescingOptions& options) { coalescer_.setOptions(options); }
     void setErrorCallback(std::function<void(const std::string&)> callback);
     void setEventCoalescingDelay(std::chrono::milliseconds delay);
     void setEventCoalescingEnabled(bool enabled);
     void setRecursiveWatchingEnabled(bool enabled);
     void setExcludedPaths(const std::vector<std::string>& paths);
     void setExcludedExtensions(const std::vector<std::string>& extensions);
+    // Share rules already compiled by IndexManager instead of the lists above
+    void setExclusionRules(std::shared_ptr<const ExclusionRules> rules);
+    void setFanotifyEnabled(bool enabled) { enableFanotify_ = enabled; }
     
     // Statistics
     uint64_t getEventsProcessed() const { return eventsProcessed_.load(); }
     uint64_t getEventsFiltered() const { return eventsFiltered_.load(); }
     uint64_t getErrorsEncountered() const { return errorsEncountered_.load(); }
+    uint64_t getOverflowCount() const { return dirtySubtrees_.getStatistics().overflows; }
+    uint64_t getEventsDropped() const { return dirtySubtrees_.getStatistics().droppedEvents; }
+    DirtySubtrees::Statistics getLostEventStatistics() const { return dirtySubtrees_.getStatistics(); }
+    EventCoalescer::Statistics getCoalescingStatistics() const {
+        std::lock_guard<std::mutex> lock(coalescingStatsMutex_);
+        return coalescingStats_;
+    }
     void resetStatistics();
     
+    // Lost-event recovery: task reconciles the dirty subtrees (see
+    // IndexManager::reconcileIndex()); runs until stopWatching()
+    bool startOverflowRecovery(DirtySubtrees::RecoveryTask task,
+                               DirtySubtrees::CancelTask cancel = DirtySubtrees::CancelTask()) {
+        return dirtySubtrees_.start(std::move(task), std::move(cancel));
+    }
+    bool isPossiblyStale() const { return dirtySubtrees_.isPossiblyStale(); }
+    // Events beyond this many unprocessed ones are dropped and recovered
+    // by a targeted reconcile; 0 = unbounded
+    void setEventQueueCapacity(size_t capacity) { eventQueue_.setCapacity(capacity); }
+    
     // Utility methods
     std::vector<std::string> getSupportedDrives();
     bool isDriveSupported(const std::string& drivePath);
@@ -205,7 +346,9 @@ private:
     void markRecentEvent(const std::string& path);
     void cleanupRecentEvents();
     
-    // Drive watcher management
+    // Drive watcher management; on Linux goes through
+    // FanotifyFileWatcher::createPreferred() unless fanotify is disabled.
+    // Every watcher gets setDirtySubtrees(&dirtySubtrees_).
     std::unique_ptr<DriveWatcher> createDriveWatcher(const std::string& drivePath);
     void removeDriveWatcher(const std::string& drivePath);
     
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "core/types.h"
+#include "utils/inode_set.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <unordered_map>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// Groups the paths under which a multiply-linked file was found. The first
+// path seen becomes the group's primary; later links share its metadata
+// (same inode, so size and times are identical) and can be reported as
+// duplicates instead of independent files.
+class HardlinkRegistry {
+public:
+    struct Group {
+        std::string primaryPath;
+        std::vector<std::string> otherPaths;
+        uint64_t size = 0;
+        std::time_t lastModified = 0;
+        uint32_t linkCount = 0;     // st_nlink, including links outside the scanned roots
+    };
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<Utils::InodeKey, Group, Utils::InodeKeyHash> groups_;
+    uint64_t secondaryLinks_;
+
+public:
+    HardlinkRegistry();
+
+    // Non-copyable
+    HardlinkRegistry(const HardlinkRegistry&) = delete;
+    HardlinkRegistry& operator=(const HardlinkRegistry&) = delete;
+
+    // Record a file with linkCount > 1. Returns true if it is the first path
+    // seen for its inode. Recording a path again (a rescan) adds nothing.
+    bool record(const FileEntry& entry);
+
+    bool getGroup(uint64_t device, uint64_t inode, Group& group) const;
+    std::vector<std::string> getLinks(uint64_t device, uint64_t inode) const;
+
+    size_t getGroupCount() const;
+    uint64_t getSecondaryLinkCount() const;
+    void clear();
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
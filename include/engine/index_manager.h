@@ -4,6 +4,21 @@
 #include "storage/sqlite_database.h"
 #include "storage/memory_index.h"
 #include "storage/cache_manager.h"
+#include "storage/scan_state_store.h"
+#include "engine/parallel_scanner.h"
+#include "engine/reconcile_scanner.h"
+#include "engine/scan_checkpointer.h"
+#include "engine/device_scheduler.h"
+#include "engine/exclusion_rules.h"
+#include "engine/ingestion_pipeline.h"
+#include "engine/sharded_index_builder.h"
+#include "engine/scan_progress.h"
+#include "engine/background_reconciler.h"
+#include "engine/change_filter.h"
+#include "engine/index_rebuilder.h"
+#include "engine/scan_throttle.h"
+#include "engine/duplicate_finder.h"
+#include "engine/content_index.h"
 #include "utils/thread_safe_queue.h"
 #include <memory>
 #include <vector>
@@ -13,31 +28,61 @@
 #include <condition_variable>
 #include <functional>
 #include <filesystem>
+#include <unordered_map>
 
 namespace FastFileSearch {
 namespace Engine {
 
 class IndexManager {
 public:
-    using ProgressCallback = std::function<void(double percentage, const std::string& currentPath)>;
+    // percentage is against the expected entry count; progress carries the
+    // counts, throughput and ETA behind it
+    using ProgressCallback = std::function<void(double percentage, const std::string& currentPath,
+                                                const ScanProgress& progress)>;
     using CompletionCallback = std::function<void(bool success, const std::string& message)>;
 
 private:
     // Core components
     std::unique_ptr<Storage::SQLiteDatabase> database_;
-    std::unique_ptr<Storage::MemoryIndex> memoryIndex_;
+    // Searches and updates go through activeIndex_.acquire(); rebuilds swap
+    // in a new index without interrupting them
+    ActiveIndex activeIndex_;
+    IndexRebuilder indexRebuilder_;
     std::unique_ptr<Storage::CacheManager> cacheManager_;
+    std::unique_ptr<Storage::ScanStateStore> scanStateStore_;
+    std::unique_ptr<Storage::ContentHashStore> contentHashStore_;
+    std::unique_ptr<ParallelScanner> parallelScanner_;
+    std::unique_ptr<ScanCheckpointer> scanCheckpointer_;
+    std::shared_ptr<StorageTopology> storageTopology_;
+    std::shared_ptr<DeviceScheduler> deviceScheduler_;
+    std::shared_ptr<ScanPriorityPlanner> priorityPlanner_;
+    // Built from the scan* settings; shared by every scan so one budget
+    // covers initial builds, resumes and reconciles
+    std::shared_ptr<ScanThrottle> scanThrottle_;
+    // Candidates come from the memory index's size index; hashes persist in
+    // contentHashStore_
+    std::unique_ptr<DuplicateFinder> duplicateFinder_;
+    // Only with settings_.contentIndexing. Synchronized with the memory
+    // index after builds, reconciles and rebuilds, kept current by
+    // updateIndex() and persisted in contentIndexStore_.
+    std::unique_ptr<Storage::ContentIndexStore> contentIndexStore_;
+    std::unique_ptr<ContentIndex> contentIndex_;
+    
+    // Compiled from settings_.excludePaths/excludeExtensions; replaced (not
+    // mutated) by updateSettings() and handed to scanners and the watcher
+    std::shared_ptr<const ExclusionRules> exclusionRules_;
+    std::shared_ptr<HardlinkRegistry> hardlinkRegistry_;
     
     // Threading
     std::vector<std::thread> indexingThreads_;
     Utils::ThreadSafeQueue<FileChangeEvent> changeEventQueue_;
-    Utils::ThreadSafeQueue<std::filesystem::path> scanQueue_;
     
     // Thread control
     std::atomic<bool> isIndexing_;
     std::atomic<bool> shouldStop_;
     std::atomic<bool> isPaused_;
     std::atomic<double> indexingProgress_;
+    ScanProgressEstimator progressEstimator_;
     
     // Synchronization
     mutable std::shared_mutex indexMutex_;
@@ -77,10 +122,47 @@ public:
     // Index building
     bool buildInitialIndex();
     bool buildInitialIndex(const std::vector<std::string>& drives);
+    // Blue/green: builds a fresh index in the background within
+    // settings_.rebuildCpuPercent, replays watcher events that arrived
+    // meanwhile and swaps it in. Returns once the rebuild has started.
     bool rebuildIndex();
     bool rebuildIndex(const std::string& drive);
-    
-    // Incremental updates
+    bool isRebuilding() const { return indexRebuilder_.isRebuilding(); }
+    IndexRebuilder::Status getRebuildStatus() const { return indexRebuilder_.getStatus(); }
+    
+    // Continue an initial index that was interrupted by a shutdown or crash,
+    // starting from the last persisted scan checkpoint
+    bool hasInterruptedIndexing() const;
+    bool resumeInterruptedIndexing();
+    
+    // Startup without a search outage: load the persisted index, serve it
+    // right away as possibly stale and reconcile it in the background. The
+    // caller starts the file watcher first, so changes made during the
+    // reconcile queue up behind it instead of being lost. Falls back to
+    // buildInitialIndex() when nothing was persisted.
+    bool startFromPersistedIndex();
+    IndexFreshness getIndexFreshness() const { return backgroundReconciler_.getFreshness(); }
+    BackgroundReconciler::Status getReconcileStatus() const { return backgroundReconciler_.getStatus(); }
+    
+    // Reconcile an existing index with the disk, re-reading only directories
+    // whose stamps changed since the last scan
+    bool reconcileIndex();
+    bool reconcileIndex(const std::vector<std::string>& roots);
+    // Targeted reconcile after lost watcher events (DirtySubtrees::Work):
+    // stamp checks below roots plus forced re-reads of forcedDirectories
+    bool reconcileIndex(const std::vector<std::string>& roots,
+                        const std::vector<std::string>& forcedDirectories);
+    
+    // Scan ordering: hinted subtrees are enumerated before the rest of their
+    // roots and their entries are committed without waiting for a full batch
+    void prioritizePath(const std::string& path);
+    void recordPathAccess(const std::string& path);
+    std::shared_ptr<ScanPriorityPlanner> getPriorityPlanner() const { return priorityPlanner_; }
+    
+    // Incremental updates. A batch (one EventCoalescer window) is filtered
+    // by changeFilter_, then applied in batch order under a single memory
+    // index write lock (MemoryIndex::applyChanges) and in one database
+    // transaction.
     void updateIndex(const FileChangeEvent& event);
     void updateIndex(const std::vector<FileChangeEvent>& events);
     
@@ -113,6 +195,7 @@ public:
     bool isIndexing() const { return isIndexing_.load(); }
     bool isPaused() const { return isPaused_.load(); }
     double getIndexingProgress() const { return indexingProgress_.load(); }
+    ScanProgress getScanProgress() const { return progressEstimator_.getProgress(); }
     
     // Statistics
     IndexStatistics getStatistics() const;
@@ -120,6 +203,23 @@ public:
     uint64_t getDirectoriesProcessed() const { return directoriesProcessed_.load(); }
     uint64_t getTotalFilesFound() const { return totalFilesFound_.load(); }
     uint64_t getErrorsEncountered() const { return errorsEncountered_.load(); }
+    IngestionPipeline::Statistics getIngestionStatistics() const;
+    ScanThrottle::Statistics getThrottleStatistics() const;
+    
+    // Duplicate detection: only files sharing a size with another file are
+    // read, and only as far as needed to tell them apart
+    std::vector<DuplicateGroup> findDuplicates(uint64_t minSize = 1);
+    void cancelDuplicateSearch();
+    DuplicateFinder::Statistics getDuplicateStatistics() const;
+    
+    // Content index: drops candidates of a content search that cannot
+    // contain query.contentPattern; returns files unchanged while the index
+    // is disabled or still being built
+    std::vector<FileEntry> filterContentCandidates(const std::vector<FileEntry>& files,
+                                                   const SearchQuery& query) const;
+    bool buildContentIndex();
+    bool saveContentIndex();
+    ContentIndex::Statistics getContentIndexStatistics() const;
     
     // Configuration
     void updateSettings(const AppSettings& settings);
@@ -143,13 +243,15 @@ private:
     // Threading methods
     void indexingWorker();
     void changeEventProcessor();
-    void scanDirectoryWorker();
     
     // Scanning methods
     void scanDrive(const std::string& driveLetter);
     void scanDirectory(const std::filesystem::path& directory);
     bool processFile(const std::filesystem::path& filePath);
     bool processDirectory(const std::filesystem::path& dirPath);
+    void processScannedDirectory(const ScannedDirectory& scanned, size_t workerIndex);
+    bool runScan(const std::vector<std::string>& seeds, bool resumed);
+    bool mergeShards();
     
     // File processing
     FileEntry createFileEntry(const std::filesystem::path& path);
@@ -158,24 +260,33 @@ private:
     
     // Change event processing
     void processFileCreated(const FileChangeEvent& event);
-    void processFileModified(const FileChangeEvent& event);
+    void processFileModified(const FileChangeEvent& event);   // after changeFilter_.isUnchanged()
     void processFileDeleted(const FileChangeEvent& event);
+    // Paired moves (see MovePairer): one moveEntry() on the memory index
+    // and the database, ScanStateStore::moveDirectoryStamps() and
+    // ContentIndex::renameDirectory() for directories; the subtree below
+    // is neither deleted nor re-added
     void processFileRenamed(const FileChangeEvent& event);
     void processFileMoved(const FileChangeEvent& event);
+    void updateContentIndex(const FileChangeEvent& event);
     
     // Database operations
     bool syncToDatabase();
     bool loadFromDatabase();
     
     // Progress reporting
-    void updateProgress(double percentage, const std::string& currentPath = "");
+    // Expected totals come from statvfs() and the previous run's per-root
+    // counts (countIndexedEntries); updateProgress() feeds filesProcessed_
+    void beginProgress(const std::vector<std::string>& roots, uint64_t alreadyProcessed);
+    std::unordered_map<std::string, uint64_t> countIndexedEntries(const std::vector<std::string>& roots);
+    void updateProgress(const std::string& currentPath = "");
     void reportCompletion(bool success, const std::string& message = "");
     
     // Utility methods
     std::vector<std::string> getIncludedDrives();
     bool isDriveIncluded(const std::string& driveLetter);
-    bool isPathExcluded(const std::filesystem::path& path);
-    bool isExtensionExcluded(const std::string& extension);
+    bool isPathExcluded(const std::filesystem::path& path);          // exclusionRules_->isExcluded()
+    bool isExtensionExcluded(const std::string& extension);          // exclusionRules_->isExtensionExcluded()
     
     // Error handling
     void handleIndexingError(const std::exception& e, const std::filesystem::path& path);
@@ -190,24 +301,27 @@ private:
     std::vector<DriveInfo> detectAvailableDrives();
     DriveInfo getDriveInfo(const std::string& driveLetter);
     
-    // Performance optimization
+    // Performance optimization; driven by the device kinds StorageTopology
+    // reports for the scanned roots
     void optimizeForSSD();
     void optimizeForHDD();
     void adjustThreadCount();
     
-    // Batch processing
-    struct BatchProcessor {
-        std::vector<FileEntry> entries;
-        std::mutex mutex;
-        size_t batchSize;
-        
-        explicit BatchProcessor(size_t size = 1000) : batchSize(size) {}
-        
-        void addEntry(const FileEntry& entry);
-        void flush(Storage::SQLiteDatabase& db, Storage::MemoryIndex& index);
-    };
-    
-    std::unique_ptr<BatchProcessor> batchProcessor_;
+    // Scanned entries flow through the pipeline to the memory index and the
+    // database; processScannedDirectory() submits and returns immediately
+    std::unique_ptr<IngestionPipeline> ingestionPipeline_;
+    
+    // Set for the duration of a sharded initial build; scanned directories go
+    // to the worker's shard instead of the pipeline until the merge
+    std::unique_ptr<ShardedIndexBuilder> shardedBuilder_;
+    
+    // Freshness of the served index and the low-priority reconcile that
+    // follows a start from the persisted index
+    BackgroundReconciler backgroundReconciler_;
+    
+    // Fingerprints of indexed files; updateIndex() runs events through it so
+    // no-op modifications never reach the index or the database
+    ChangeFilter changeFilter_;
 };
 
 // Helper class for monitoring indexing progress
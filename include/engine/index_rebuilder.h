@@ -0,0 +1,117 @@
+#pragma once
+
+#include "core/types.h"
+#include "storage/memory_index.h"
+#include "engine/cpu_throttle.h"
+#include <memory>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// The memory index searches run against. Readers pin the current index with
+// acquire() and keep using it even if a rebuild swaps in a new one meanwhile;
+// the old index is freed when its last reader lets go.
+class ActiveIndex {
+private:
+    std::atomic<std::shared_ptr<Storage::MemoryIndex>> current_;
+    std::atomic<uint64_t> generation_;
+
+public:
+    explicit ActiveIndex(std::shared_ptr<Storage::MemoryIndex> index = nullptr);
+
+    // Non-copyable
+    ActiveIndex(const ActiveIndex&) = delete;
+    ActiveIndex& operator=(const ActiveIndex&) = delete;
+
+    std::shared_ptr<Storage::MemoryIndex> acquire() const { return current_.load(); }
+    // Returns the index that was replaced
+    std::shared_ptr<Storage::MemoryIndex> swap(std::shared_ptr<Storage::MemoryIndex> next);
+    uint64_t getGeneration() const { return generation_.load(); }
+};
+
+// Blue/green rebuild: a fresh index is built in the background while the
+// active one keeps serving, then swapped in.
+//
+// Watcher events keep being applied to the active index during the build
+// and are also recorded here. After the build they are replayed into the
+// new index; the last drain and the swap happen under the same lock as
+// recordEvents(), so an event is either replayed into the new index or
+// applied after the swap. Applying it to both is harmless: events are
+// upserts and deletes by path. The replaced index is released on a
+// background thread because tearing down a large index takes a while.
+class IndexRebuilder {
+public:
+    // Fills target; pace() the throttle between units of work. Returns false
+    // if cancelled or failed, in which case the active index stays.
+    using BuildTask = std::function<bool(Storage::MemoryIndex& target, CpuThrottle& throttle)>;
+    using ReplayTask = std::function<void(Storage::MemoryIndex& target, const std::vector<FileChangeEvent>& events)>;
+    using CompletionCallback = std::function<void(bool swapped)>;
+
+    struct Status {
+        bool rebuilding = false;
+        uint64_t generation = 0;
+        uint64_t eventsRecorded = 0;
+        uint64_t eventsReplayed = 0;
+        double buildSeconds = 0.0;
+        double throttledSeconds = 0.0;
+        bool lastSucceeded = false;
+    };
+
+private:
+    ActiveIndex& active_;
+    CpuThrottle throttle_;
+
+    std::thread buildThread_;
+    std::atomic<bool> rebuilding_;
+    std::atomic<bool> cancelled_;
+
+    // Events seen while rebuilding, guarded by eventMutex_
+    std::mutex eventMutex_;
+    bool recording_;
+    std::vector<FileChangeEvent> pendingEvents_;
+
+    mutable std::mutex statusMutex_;
+    Status status_;
+
+    static constexpr size_t FINAL_DRAIN_THRESHOLD = 1000;
+    static constexpr int MAX_CATCH_UP_ROUNDS = 8;
+
+public:
+    explicit IndexRebuilder(ActiveIndex& active);
+    ~IndexRebuilder();
+
+    // Non-copyable
+    IndexRebuilder(const IndexRebuilder&) = delete;
+    IndexRebuilder& operator=(const IndexRebuilder&) = delete;
+
+    // cpuShare: fraction of all cores the build may use (1 = unthrottled)
+    bool start(BuildTask build, ReplayTask replay, double cpuShare,
+               CompletionCallback completion = nullptr);
+    void cancel();
+    bool isRebuilding() const { return rebuilding_.load(); }
+    bool isCancelled() const { return cancelled_.load(); }
+
+    // Call with every batch of watcher events, before applying them to the
+    // active index, and acquire() the index to apply them to only after this
+    // returns: an index acquired earlier may already have been swapped out,
+    // and events recorded after the swap are not replayed anywhere. No-op
+    // while no rebuild runs.
+    void recordEvents(const std::vector<FileChangeEvent>& events);
+
+    void setCpuShare(double share) { throttle_.setShare(share); }
+    Status getStatus() const;
+
+private:
+    void run(BuildTask build, ReplayTask replay, CompletionCallback completion);
+    std::vector<FileChangeEvent> takeEventsLocked();
+    static void reclaimInBackground(std::shared_ptr<Storage::MemoryIndex> index);
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
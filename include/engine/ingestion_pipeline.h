@@ -0,0 +1,160 @@
+#pragma once
+
+#include "core/types.h"
+#include "storage/sqlite_database.h"
+#include "storage/memory_index.h"
+#include "engine/index_rebuilder.h"
+#include "engine/scan_checkpointer.h"
+#include "engine/scan_priority.h"
+#include "utils/mpsc_queue.h"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+
+namespace FastFileSearch {
+namespace Engine {
+
+struct IngestionOptions {
+    size_t databaseBatchSize = 5000;        // Entries per database transaction
+    size_t maxPendingEntries = 200000;      // Submitted but not yet committed
+    std::chrono::milliseconds maxCommitDelay{500};  // Upper bound on durability lag
+};
+
+// Moves scanned entries into the memory index and the database in stages:
+//
+//   scanner threads --MPSC--> index builder --SPSC--> database writer
+//
+// Scanners only append to a lock-free queue. A single thread inserts into
+// the active memory index (entries become searchable there first; it is
+// acquired per batch, so a rebuild can swap it meanwhile) and forwards the
+// entries to a single database writer, which groups them into large
+// transactions. A slow commit therefore delays durability, not enumeration.
+// Backpressure only kicks in when more than maxPendingEntries are waiting to
+// be committed; submit() then blocks until the writer catches up.
+//
+// Throughput is bounded by the slowest stage; getStatistics() reports each
+// stage's utilization and names the bottleneck.
+class IngestionPipeline {
+public:
+    struct StageStatistics {
+        uint64_t entries = 0;
+        uint64_t batches = 0;
+        uint64_t queuedEntries = 0;     // Waiting in front of the stage
+        double busySeconds = 0.0;
+        double utilization = 0.0;       // busySeconds / elapsedSeconds
+    };
+
+    struct Statistics {
+        StageStatistics index;
+        StageStatistics database;
+        uint64_t entriesSubmitted = 0;
+        uint64_t entriesFailed = 0;         // Lost to failed commits
+        uint64_t commitFailures = 0;
+        uint64_t producerStalls = 0;        // submit() calls blocked by backpressure
+        double producerStallSeconds = 0.0;
+        double elapsedSeconds = 0.0;
+        double entriesPerSecond = 0.0;      // Committed, end to end
+        const char* bottleneck = "scan";    // "scan", "index" or "database"
+    };
+
+private:
+    struct Batch {
+        std::vector<FileEntry> entries;
+        ScanPriority priority = ScanPriority::Normal;
+        uint64_t checkpointSequence = 0;    // Marker: everything journaled before it precedes it
+    };
+
+    // Lets a consumer sleep on an empty lock-free queue; producers only touch
+    // the mutex when the consumer is actually asleep
+    struct Wakeup {
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::atomic<bool> sleeping{false};
+
+        void notify();
+        template<typename Ready>
+        void wait(std::chrono::milliseconds timeout, Ready ready);
+    };
+
+    Storage::SQLiteDatabase& database_;
+    ActiveIndex& activeIndex_;
+    IngestionOptions options_;
+    ScanCheckpointer* checkpointer_;
+
+    Utils::MpscQueue<Batch> scanQueue_;
+    Utils::MpscQueue<Batch> databaseQueue_;
+    Wakeup indexWakeup_;
+    Wakeup databaseWakeup_;
+
+    std::thread indexThread_;
+    std::thread databaseThread_;
+    std::atomic<bool> running_;
+    std::atomic<bool> indexStopping_;
+    std::atomic<bool> databaseStopping_;
+    std::atomic<uint32_t> flushRequests_;
+    bool checkpointValid_;              // Database thread only
+
+    // Backpressure and flush() wait for commits here
+    std::mutex commitMutex_;
+    std::condition_variable commitCondition_;
+
+    // Statistics
+    std::chrono::steady_clock::time_point startTime_;
+    std::atomic<uint64_t> runNs_;       // Length of the last run, set by stop()
+    std::atomic<uint64_t> entriesSubmitted_;
+    std::atomic<uint64_t> entriesIndexed_;
+    std::atomic<uint64_t> entriesCommitted_;
+    std::atomic<uint64_t> entriesFailed_;
+    std::atomic<uint64_t> indexBatches_;
+    std::atomic<uint64_t> databaseBatches_;
+    std::atomic<uint64_t> commitFailures_;
+    std::atomic<uint64_t> indexBusyNs_;
+    std::atomic<uint64_t> databaseBusyNs_;
+    std::atomic<uint64_t> producerStalls_;
+    std::atomic<uint64_t> producerStallNs_;
+
+public:
+    IngestionPipeline(Storage::SQLiteDatabase& database, ActiveIndex& activeIndex,
+                      const IngestionOptions& options = IngestionOptions());
+    ~IngestionPipeline();
+
+    // Non-copyable
+    IngestionPipeline(const IngestionPipeline&) = delete;
+    IngestionPipeline& operator=(const IngestionPipeline&) = delete;
+
+    // Told about every committed transaction so the scan checkpoint only
+    // covers durable entries. Set before start().
+    void setCheckpointer(ScanCheckpointer* checkpointer) { checkpointer_ = checkpointer; }
+
+    bool start();
+    // Commits everything submitted so far and joins the stage threads
+    void stop();
+    bool isRunning() const { return running_.load(); }
+
+    // Any thread. Entries from directories in an urgent band (above Normal)
+    // are committed without waiting for a full transaction. Call before
+    // ScanCheckpointer::directoryScanned() for the same directory.
+    void submit(std::vector<FileEntry>&& entries, ScanPriority priority = ScanPriority::Normal);
+
+    // Blocks until everything submitted before the call is committed (or
+    // failed). Returns false if any commit failed since start().
+    bool flush();
+
+    uint64_t getPendingEntries() const;
+    Statistics getStatistics() const;
+
+private:
+    void indexLoop();
+    void databaseLoop();
+    void commit(std::vector<FileEntry>& pending, uint64_t checkpointSequence);
+    void waitForCapacity(size_t incoming);
+
+    static uint64_t elapsedNs(std::chrono::steady_clock::time_point since);
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "core/types.h"
+#include "utils/thread_safe_queue.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <cstdint>
+#include <ctime>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// Metadata resolved for one directory entry
+struct FileMetadata {
+    bool valid = false;
+    FileType type = FileType::Unknown;
+    uint64_t size = 0;
+    std::time_t lastModified = 0;
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    uint32_t linkCount = 1;
+    int64_t modifiedNs = 0;
+    int64_t changedNs = 0;
+};
+
+#ifdef __linux__
+// Resolves metadata for a batch of names relative to an open directory.
+// Implementations trade latency for throughput: a whole directory's worth of
+// lookups is handed over at once so they can be overlapped.
+class MetadataCollector {
+public:
+    virtual ~MetadataCollector() = default;
+
+    // results is resized to names.size(); results[i] describes names[i].
+    // Lookups are done without following symlinks.
+    virtual void collect(int dirFd, const std::vector<const char*>& names,
+                         std::vector<FileMetadata>& results) = 0;
+    virtual const char* getName() const = 0;
+
+    // io_uring when enabled and supported by the kernel, otherwise a pool of
+    // synchronous fstatat() workers
+    static std::unique_ptr<MetadataCollector> create(bool enableIoUring, size_t fallbackThreads);
+
+    // Single fstatat() without following symlinks
+    static void statSynchronously(int dirFd, const char* name, FileMetadata& result);
+};
+
+// Splits large batches across worker threads issuing plain fstatat() calls.
+// With zero threads every lookup runs on the calling thread.
+class ThreadPoolMetadataCollector : public MetadataCollector {
+private:
+    std::vector<std::thread> workers_;
+    Utils::ThreadSafeQueue<std::function<void()>> tasks_;
+
+    // Batches smaller than this are resolved on the calling thread
+    static const size_t MIN_PARALLEL_BATCH = 64;
+
+public:
+    explicit ThreadPoolMetadataCollector(size_t numThreads);
+    ~ThreadPoolMetadataCollector() override;
+
+    void collect(int dirFd, const std::vector<const char*>& names,
+                 std::vector<FileMetadata>& results) override;
+    const char* getName() const override { return "thread-pool"; }
+
+private:
+    void workerLoop();
+};
+
+// Submits IORING_OP_STATX requests in ring-sized batches and harvests the
+// completions. One instance (and ring) per scanning thread; not thread-safe.
+class IoUringMetadataCollector : public MetadataCollector {
+private:
+    int ringFd_;
+    uint32_t ringEntries_;
+
+    // Mapped ring memory
+    void* sqRing_;
+    void* cqRing_;
+    void* sqes_;
+    size_t sqRingSize_;
+    size_t cqRingSize_;
+    size_t sqesSize_;
+
+    // Pointers into the rings
+    uint32_t* sqHead_;
+    uint32_t* sqTail_;
+    uint32_t* sqMask_;
+    uint32_t* sqArray_;
+    uint32_t* cqHead_;
+    uint32_t* cqTail_;
+    uint32_t* cqMask_;
+    void* cqes_;
+
+    // statx buffers for the requests in flight, indexed like the batch
+    std::vector<unsigned char> statxBuffers_;
+    // Submitted requests whose completions were not reaped yet; the kernel
+    // may still write into statxBuffers_ for them
+    uint32_t inFlight_;
+
+    static const uint32_t DEFAULT_RING_ENTRIES = 256;
+
+public:
+    explicit IoUringMetadataCollector(uint32_t ringEntries = DEFAULT_RING_ENTRIES);
+    ~IoUringMetadataCollector() override;
+
+    // Non-copyable
+    IoUringMetadataCollector(const IoUringMetadataCollector&) = delete;
+    IoUringMetadataCollector& operator=(const IoUringMetadataCollector&) = delete;
+
+    // Sets up the ring; false if io_uring or IORING_OP_STATX is unavailable
+    bool initialize();
+    bool isInitialized() const { return ringFd_ >= 0; }
+
+    void collect(int dirFd, const std::vector<const char*>& names,
+                 std::vector<FileMetadata>& results) override;
+    const char* getName() const override { return "io_uring"; }
+
+private:
+    bool probeStatxSupport();
+    bool submitBatch(int dirFd, const std::vector<const char*>& names, size_t first, uint32_t count);
+    bool reapCompletions(int dirFd, const std::vector<const char*>& names, size_t first, uint32_t count,
+                         std::vector<FileMetadata>& results);
+    int enter(uint32_t toSubmit, uint32_t minComplete);
+    bool drainInFlight();
+    void teardown();
+};
+#endif
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "core/types.h"
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <string>
+#include <cstdint>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// Joins inotify's IN_MOVED_FROM / IN_MOVED_TO halves into one event.
+//
+// The two halves of a rename share a cookie. A MOVED_FROM is held until its
+// MOVED_TO arrives and both become one Renamed (same directory) or Moved
+// event carrying oldPath, so the index can re-parent a directory instead of
+// deleting and re-adding everything below it. A MOVED_FROM still unpaired
+// after the window moved out of the watched tree and becomes Deleted; a
+// MOVED_TO without a pending MOVED_FROM moved in and becomes Created.
+//
+// Every other event must go through pass(): it first releases held halves
+// the event's path could depend on (same path, ancestor or descendant), so
+// a delete never overtakes what happened at the path afterwards.
+//
+// Not thread-safe; the watcher thread owns it.
+class MovePairer {
+public:
+    // isDirectory: the event is about a directory (IN_ISDIR)
+    using EventSink = std::function<void(const FileChangeEvent& event, bool isDirectory)>;
+
+    struct Statistics {
+        uint64_t paired = 0;
+        uint64_t movedOut = 0;          // MOVED_FROM that expired unpaired
+        uint64_t movedIn = 0;           // MOVED_TO without a MOVED_FROM
+        uint64_t released = 0;          // Held halves pushed out early by pass()
+    };
+
+private:
+    struct PendingMove {
+        uint32_t cookie;
+        std::string path;
+        bool isDirectory;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    EventSink eventSink_;
+    std::chrono::milliseconds window_;
+    std::deque<PendingMove> pending_;   // In arrival order, so also by expiry
+    Statistics stats_;
+
+    static constexpr size_t MAX_PENDING = 4096;
+
+public:
+    explicit MovePairer(EventSink eventSink,
+                        std::chrono::milliseconds window = std::chrono::milliseconds(250));
+
+    // Non-copyable
+    MovePairer(const MovePairer&) = delete;
+    MovePairer& operator=(const MovePairer&) = delete;
+
+    void movedFrom(uint32_t cookie, const std::string& path, bool isDirectory);
+    void movedTo(uint32_t cookie, const std::string& path, bool isDirectory);
+    void pass(const FileChangeEvent& event, bool isDirectory);
+
+    // Turn expired MOVED_FROMs into Deleted. Returns how long the caller
+    // may wait before calling again; max() when nothing is held.
+    std::chrono::milliseconds expire();
+    // Release everything held, e.g. on stop or queue overflow
+    void flush();
+
+    bool hasPending() const { return !pending_.empty(); }
+    Statistics getStatistics() const { return stats_; }
+
+    // Renamed when both paths share a parent directory, Moved otherwise
+    static FileChangeType classify(const std::string& oldPath, const std::string& newPath);
+
+private:
+    void release(const PendingMove& move);
+    static bool related(const std::string& a, const std::string& b);
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
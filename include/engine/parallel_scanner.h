@@ -0,0 +1,175 @@
+#pragma once
+
+#include "engine/directory_scanner.h"
+#include "engine/device_scheduler.h"
+#include "engine/hardlink_registry.h"
+#include "engine/scan_throttle.h"
+#include "utils/inode_set.h"
+#include "utils/work_stealing_queue.h"
+#include <memory>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <unordered_map>
+#include <array>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// Walks one or more directory trees on a fixed set of threads. Each worker
+// owns a DirectoryScanner and a deque in a work-stealing pool: children of a
+// scanned directory are pushed as one batch onto the worker's own deque and
+// idle workers steal the oldest (shallowest) pending directories.
+//
+// With a DeviceScheduler attached, every directory is tagged with the device
+// it lives on and reads are bounded per device. A worker that picks up a
+// directory whose device is saturated parks it instead of waiting; workers
+// already reading from that device drain the parked directories, so a slow
+// disk never holds threads that could be scanning a fast one.
+//
+// Directories are queued in ScanPriority bands; every worker drains the most
+// urgent band (stealing across workers) before touching the next, so hinted
+// subtrees are enumerated first however large the rest of the tree is.
+//
+// Every opened directory's (device, inode) goes into a visited set, so bind
+// mounts, symlink loops (with followSymlinks) and overlapping roots are
+// enumerated once. With ScanOptions::stayOnFilesystem, directories on a
+// different device than their root are not entered.
+//
+// With a ScanThrottle attached, workers run at background priority and
+// charge every directory against its rate limits; its backoff factor also
+// scales the device scheduler's concurrency.
+class ParallelScanner {
+public:
+    // Called on the worker thread for every directory that was enumerated.
+    // 'subdirectories' holds only the children that passed the filter, i.e.
+    // exactly those queued for scanning.
+    using DirectoryCallback = std::function<void(const ScannedDirectory& directory, size_t workerIndex)>;
+    // Return false to skip a child directory (and its whole subtree) before it is opened
+    using DirectoryFilter = std::function<bool(const std::string& path)>;
+
+    struct Statistics {
+        uint64_t directoriesScanned = 0;
+        uint64_t entriesFound = 0;
+        uint64_t statCalls = 0;
+        uint64_t directoriesPruned = 0;
+        uint64_t steals = 0;
+        uint64_t deferrals = 0;
+        uint64_t duplicatesSkipped = 0;     // Already visited through another path
+        uint64_t mountsSkipped = 0;         // Other filesystem under stayOnFilesystem
+        uint64_t hardlinkDuplicates = 0;    // Secondary links of a file already seen
+        uint64_t errors = 0;
+    };
+
+private:
+    struct ScanTask {
+        std::string path;
+        uint64_t device = 0;
+        uint64_t rootDevice = 0;            // Device of the root this task descends from
+        ScanPriorityPlanner::Assignment priority;
+    };
+    using TaskBands = std::array<std::vector<ScanTask>, SCAN_PRIORITY_LEVELS>;
+
+    size_t numThreads_;
+    ScanOptions options_;
+
+    Utils::WorkStealingPool<ScanTask> pool_;
+    std::vector<std::thread> workers_;
+
+    // Per-device limits; directories of a saturated device wait in deferred_
+    std::shared_ptr<DeviceScheduler> deviceScheduler_;
+    std::mutex deferredMutex_;
+    std::unordered_map<uint64_t, TaskBands> deferred_;
+
+    Utils::ConcurrentInodeSet visited_;
+    std::shared_ptr<HardlinkRegistry> hardlinks_;
+
+    // Optional; without it every directory is queued as Normal
+    std::shared_ptr<ScanPriorityPlanner> priorityPlanner_;
+
+    // Optional; without it scans run unthrottled at normal priority
+    std::shared_ptr<ScanThrottle> throttle_;
+    std::atomic<double> appliedFactor_;
+
+    // Thread control
+    std::atomic<bool> isRunning_;
+    std::atomic<bool> shouldStop_;
+    std::atomic<bool> isPaused_;
+    std::mutex pauseMutex_;
+    std::condition_variable pauseCondition_;
+
+    // Callbacks
+    DirectoryCallback directoryCallback_;
+    DirectoryFilter directoryFilter_;
+
+    // Statistics
+    std::atomic<uint64_t> directoriesScanned_;
+    std::atomic<uint64_t> entriesFound_;
+    std::atomic<uint64_t> statCalls_;
+    std::atomic<uint64_t> directoriesPruned_;
+    std::atomic<uint64_t> deferrals_;
+    std::atomic<uint64_t> duplicatesSkipped_;
+    std::atomic<uint64_t> mountsSkipped_;
+    std::atomic<uint64_t> hardlinkDuplicates_;
+    std::atomic<uint64_t> errors_;
+
+public:
+    explicit ParallelScanner(size_t numThreads, const ScanOptions& options = ScanOptions());
+    ~ParallelScanner();
+
+    // Non-copyable
+    ParallelScanner(const ParallelScanner&) = delete;
+    ParallelScanner& operator=(const ParallelScanner&) = delete;
+
+    // Scan all roots and block until every reachable directory has been
+    // processed. Returns false if the scan was stopped before completion.
+    // Roots are not passed through the directory filter, so a resumed scan
+    // can be seeded with its saved frontier.
+    bool run(const std::vector<std::string>& roots);
+
+    // Control operations (safe to call from any thread while run() is active)
+    void pause();
+    void resume();
+    void stop();
+    bool isRunning() const { return isRunning_.load(); }
+    bool isPaused() const { return isPaused_.load(); }
+
+    // Configuration (before run())
+    void setDirectoryCallback(DirectoryCallback callback);
+    void setDirectoryFilter(DirectoryFilter filter);
+    void setOptions(const ScanOptions& options) { options_ = options; }
+    void setDeviceScheduler(std::shared_ptr<DeviceScheduler> scheduler) { deviceScheduler_ = std::move(scheduler); }
+    void setPriorityPlanner(std::shared_ptr<ScanPriorityPlanner> planner) { priorityPlanner_ = std::move(planner); }
+    // Collects files with more than one link; without it links are not grouped
+    void setHardlinkRegistry(std::shared_ptr<HardlinkRegistry> registry) { hardlinks_ = std::move(registry); }
+    void setThrottle(std::shared_ptr<ScanThrottle> throttle) { throttle_ = std::move(throttle); }
+    size_t getThreadCount() const { return numThreads_; }
+
+    // Statistics
+    Statistics getStatistics() const;
+    uint64_t getPendingDirectories() const { return pool_.getPendingCount(); }
+    uint64_t getQueuedDirectories(ScanPriority priority) const {
+        return pool_.getQueuedCount(static_cast<size_t>(priority));
+    }
+    void resetStatistics();
+
+private:
+    void workerLoop(size_t workerIndex);
+    void scanTask(size_t workerIndex, DirectoryScanner& scanner, const ScanTask& task,
+                  ScannedDirectory& scanned, TaskBands& children);
+    bool waitWhilePaused();
+    bool admitDirectory(uint64_t device, uint64_t inode, uint64_t rootDevice);
+    bool throttle(const ScannedDirectory& scanned);
+
+    // Device slot handling (only with a scheduler)
+    bool acquireOrDefer(ScanTask& task);
+    bool finishAndTakeDeferred(size_t workerIndex, const ScanTask& finished,
+                               std::chrono::nanoseconds latency, ScanTask& next);
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
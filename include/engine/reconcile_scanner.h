@@ -0,0 +1,115 @@
+#pragma once
+
+#include "core/types.h"
+#include "engine/directory_scanner.h"
+#include "storage/scan_state_store.h"
+#include <memory>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <unordered_set>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// Brings an existing index up to date with the disk without a full walk.
+//
+// Every directory known from the previous scan is stat()ed; only those whose
+// stamp (mtime/ctime/inode) changed are re-read and diffed against the
+// indexed children, producing Created/Deleted/Modified events. Directories
+// that appeared since are scanned in full. In-place content changes of files
+// in unchanged directories do not touch the directory stamp; those are the
+// file watcher's job, or, where its events were dropped, of the forced
+// directories passed to reconcile().
+class ReconcileScanner {
+public:
+    // Children currently in the index for a directory (by full path)
+    using IndexedChildrenProvider = std::function<std::vector<FileEntry>(const std::string& directory)>;
+    // Receives the diff in batches, in discovery order
+    using BatchCallback = std::function<void(const std::vector<FileChangeEvent>& events)>;
+
+    struct Result {
+        uint64_t directoriesChecked = 0;
+        uint64_t directoriesRescanned = 0;
+        uint64_t directoriesRemoved = 0;
+        uint64_t newDirectoriesScanned = 0;
+        uint64_t created = 0;
+        uint64_t deleted = 0;
+        uint64_t modified = 0;
+    };
+
+private:
+    Storage::ScanStateStore& stateStore_;
+    size_t numThreads_;
+    ScanOptions options_;
+    size_t batchSize_;
+
+    IndexedChildrenProvider childrenProvider_;
+    BatchCallback batchCallback_;
+
+    // Pending output, shared by the checking threads
+    std::mutex outputMutex_;
+    std::vector<FileChangeEvent> pendingEvents_;
+    std::vector<Storage::DirectoryStamp> pendingStamps_;
+    std::vector<std::string> removedDirectories_;
+    std::vector<std::string> newDirectories_;
+    std::unordered_set<std::string> roots_;
+    std::unordered_set<std::string> rescanned_;
+
+    std::atomic<bool> shouldStop_;
+
+    // Statistics
+    std::atomic<uint64_t> directoriesChecked_;
+    std::atomic<uint64_t> directoriesRescanned_;
+    std::atomic<uint64_t> directoriesRemoved_;
+    std::atomic<uint64_t> newDirectoriesScanned_;
+    std::atomic<uint64_t> created_;
+    std::atomic<uint64_t> deleted_;
+    std::atomic<uint64_t> modified_;
+
+public:
+    ReconcileScanner(Storage::ScanStateStore& stateStore, size_t numThreads,
+                     const ScanOptions& options = ScanOptions());
+
+    // Non-copyable
+    ReconcileScanner(const ReconcileScanner&) = delete;
+    ReconcileScanner& operator=(const ReconcileScanner&) = delete;
+
+    // Reconcile the given roots (or subtrees). Returns false if stopped early.
+    bool reconcile(const std::vector<std::string>& roots);
+    // Also re-read forcedDirectories even where their stamps match; a
+    // forced directory that is gone is reported deleted
+    bool reconcile(const std::vector<std::string>& roots, const std::vector<std::string>& forcedDirectories);
+    // Sticky: a stop() before or during reconcile() makes it return early,
+    // and every later one too until resume(). Owners call resume() before
+    // handing a reconcile task to BackgroundReconciler or DirtySubtrees.
+    void stop() { shouldStop_.store(true); }
+    void resume() { shouldStop_.store(false); }
+
+    void setIndexedChildrenProvider(IndexedChildrenProvider provider);
+    void setBatchCallback(BatchCallback callback);
+    void setBatchSize(size_t batchSize) { batchSize_ = batchSize > 0 ? batchSize : 1; }
+
+    Result getResult() const;
+
+    // Stamp describing a freshly scanned directory
+    static Storage::DirectoryStamp makeStamp(const ScannedDirectory& scanned);
+    // A file's indexed entry no longer describes what is on disk
+    static bool isModified(const FileEntry& previous, const FileEntry& current);
+
+private:
+    void checkDirectories(const std::vector<Storage::DirectoryStamp>& known, std::atomic<size_t>& cursor);
+    void rescanDirectory(DirectoryScanner& scanner, const std::string& path);
+    void rescanForced(const std::vector<std::string>& directories);
+    bool scanNewDirectories();
+
+    void emitEvent(FileChangeType type, const std::string& path);
+    void flushEventsLocked();
+    void flushStamps();
+    void resetState();
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "storage/scan_state_store.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// Tracks the progress of a long-running scan so it can be resumed after a
+// restart.
+//
+// A directory only counts as done once its entries are durable, so scanned
+// directories are journaled first and applied to the checkpoint when the
+// batch writer reports a commit. The persisted checkpoint therefore lags the
+// committed data and never runs ahead of it; on resume a few directories may
+// be scanned twice, none are lost.
+//
+// The checkpoint holds two sets:
+//   frontier  - directories discovered by a committed parent, not yet committed
+//   completed - directories committed before their parent (out-of-order
+//               completion across workers); these are skipped when a resumed
+//               scan rediscovers them
+class ScanCheckpointer {
+public:
+    struct Statistics {
+        uint64_t frontierSize = 0;
+        uint64_t completedMarkers = 0;
+        uint64_t journaledDirectories = 0;
+        uint64_t checkpointsWritten = 0;
+        std::time_t lastCheckpoint = 0;
+    };
+
+private:
+    Storage::ScanStateStore& stateStore_;
+    std::chrono::seconds interval_;
+
+    mutable std::mutex mutex_;
+
+    struct JournalEntry {
+        uint64_t sequence;
+        std::string path;
+        std::vector<std::string> children;
+    };
+    std::vector<JournalEntry> journal_;
+    uint64_t nextSequence_;
+
+    // In-memory view of the committed state
+    std::unordered_set<std::string> frontier_;
+    std::unordered_set<std::string> completed_;
+
+    // Changes not yet written to the store (true = present, false = removed)
+    std::unordered_map<std::string, bool> frontierDelta_;
+    std::unordered_map<std::string, bool> completedDelta_;
+
+    std::chrono::steady_clock::time_point lastPersist_;
+    uint64_t checkpointsWritten_;
+    std::time_t lastCheckpoint_;
+
+public:
+    explicit ScanCheckpointer(Storage::ScanStateStore& stateStore,
+                              std::chrono::seconds interval = std::chrono::seconds(30));
+
+    // Non-copyable
+    ScanCheckpointer(const ScanCheckpointer&) = delete;
+    ScanCheckpointer& operator=(const ScanCheckpointer&) = delete;
+
+    // Start a fresh scan of the given roots, discarding any older checkpoint
+    bool begin(const std::vector<std::string>& roots);
+
+    // Load a checkpoint left by an interrupted scan. On success 'frontier'
+    // holds the directories to seed the scanner with and 'roots' the roots of
+    // the original scan.
+    bool resume(std::vector<std::string>& frontier, std::vector<std::string>& roots);
+    bool hasCheckpoint() const;
+
+    // Record a scanned directory and the children that will be descended
+    // into. Call after its entries were handed to the batch writer; the
+    // returned sequence orders it relative to batch commits.
+    uint64_t directoryScanned(const std::string& path, const std::vector<std::string>& children);
+
+    // Sequence to capture when the batch writer takes a batch: everything
+    // journaled before this point is part of that batch
+    uint64_t currentSequence() const;
+
+    // The batch captured at 'sequence' is durable. Applies the journal up to
+    // that point and persists the checkpoint if the interval elapsed.
+    void batchCommitted(uint64_t sequence);
+
+    // Directory filter for resumed scans: false for directories that are
+    // already committed
+    bool shouldScan(const std::string& path) const;
+
+    // Write pending checkpoint changes now
+    bool persist();
+
+    // The scan completed; drop the checkpoint
+    bool finish();
+
+    void setInterval(std::chrono::seconds interval);
+    Statistics getStatistics() const;
+
+private:
+    void applyJournalLocked(uint64_t sequence);
+    void setFrontierLocked(const std::string& path, bool present);
+    void setCompletedLocked(const std::string& path, bool present);
+    bool persistLocked();
+    void resetLocked();
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
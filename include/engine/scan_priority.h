@@ -0,0 +1,104 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <shared_mutex>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// Scheduling bands for directories waiting to be scanned; lower is sooner
+enum class ScanPriority : uint8_t {
+    Hot = 0,        // Paths users search in or open results from
+    User = 1,       // Home directories
+    Recent = 2,     // Children of recently modified directories
+    Normal = 3
+};
+
+constexpr size_t SCAN_PRIORITY_LEVELS = 4;
+
+const char* scanPriorityName(ScanPriority priority);
+
+// Decides which part of a tree is scanned first.
+//
+// Hints name subtrees (home directories, frequently used paths); everything
+// under a hint inherits its band. The ancestors of a hinted path are raised
+// to the same band without passing it on to their other children, so a scan
+// of "/" reaches /home/alice quickly without promoting the rest of "/".
+// Immediate children of a directory modified within the recent window are
+// raised to Recent.
+//
+// Hints are an immutable snapshot replaced whenever they change; scan
+// workers take a reference once per parent directory under a shared lock
+// and assign all of its children from it.
+class ScanPriorityPlanner {
+public:
+    // Band a directory is queued in and the band its children inherit
+    struct Assignment {
+        ScanPriority priority = ScanPriority::Normal;
+        ScanPriority inherited = ScanPriority::Normal;
+    };
+
+private:
+    struct Hints {
+        std::unordered_map<std::string, ScanPriority> subtrees;    // Hinted roots
+        std::unordered_map<std::string, ScanPriority> ancestors;   // Every ancestor of a hinted root
+        std::chrono::seconds recentWindow{std::chrono::hours(24 * 7)};
+    };
+
+public:
+    // What forChild() needs about one parent directory, taken once for all
+    // of its children
+    struct ParentContext {
+        std::shared_ptr<const Hints> hints;
+        Assignment parent;
+        bool recentlyModified = false;
+    };
+
+private:
+    // Serializes writers and guards accessCounts_
+    mutable std::mutex mutex_;
+    // Guards only the pointer swap
+    mutable std::shared_mutex hintsMutex_;
+    std::shared_ptr<const Hints> hints_;
+    std::unordered_map<std::string, uint32_t> accessCounts_;    // Directories seen in query logs
+
+public:
+    ScanPriorityPlanner();
+
+    // Hints
+    void addSubtree(const std::string& path, ScanPriority priority);
+    void addHomeDirectories();
+
+    // Feed a path a user searched in or opened; the directory is counted and
+    // the most used ones become Hot subtrees through promoteFrequentPaths()
+    void recordAccess(const std::string& path);
+    void promoteFrequentPaths(size_t maxPaths = 32, uint32_t minAccesses = 2);
+
+    void setRecentWindow(std::chrono::seconds window);
+    void clear();
+
+    // Assignments
+    Assignment forRoot(const std::string& path) const;
+    // Reads the hints and the clock once per parent
+    ParentContext forParent(const Assignment& parent, int64_t parentModifiedNs) const;
+    static Assignment forChild(const std::string& path, const ParentContext& parent);
+
+    std::vector<std::string> getHintedPaths() const;
+
+private:
+    std::shared_ptr<const Hints> loadHints() const;
+    void storeHints(std::shared_ptr<const Hints> hints);
+    static void addSubtree(Hints& hints, const std::string& path, ScanPriority priority);
+    static ScanPriority higher(ScanPriority a, ScanPriority b) { return a < b ? a : b; }
+    static std::string normalize(const std::string& path);
+    static std::string parentOf(const std::string& path);
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+
+namespace FastFileSearch {
+namespace Engine {
+
+enum class ProgressEstimateSource : uint8_t {
+    Unknown = 0,
+    PriorRun = 1,       // Entry count indexed under the root last time
+    Filesystem = 2,     // Used inodes of a filesystem mounted at the root
+    UpperBound = 3      // Used inodes of a filesystem the root is only part of
+};
+
+const char* progressEstimateSourceName(ProgressEstimateSource source);
+
+struct ScanProgress {
+    uint64_t processed = 0;
+    uint64_t expected = 0;          // 0 when nothing could be estimated
+    double fraction = 0.0;          // 0..1
+    double itemsPerSecond = 0.0;    // Moving average
+    int64_t etaSeconds = -1;        // -1 when unknown
+    double elapsedSeconds = 0.0;
+    ProgressEstimateSource source = ProgressEstimateSource::Unknown;
+    bool finished = false;
+};
+
+// Turns a running count of indexed entries into a progress fraction and an
+// ETA.
+//
+// The expected total per root comes from the previous run's count when the
+// database has one, otherwise from statvfs(): used inodes are exact for a
+// root that is a mount point and an upper bound for a directory inside a
+// larger filesystem (such a filesystem is counted once however many roots
+// share it). If any root has no estimate, neither does the run: a total
+// that leaves it out would overstate the fraction done. Throughput is an
+// exponential moving average over samples at least a second apart, so the
+// ETA follows phases (metadata-heavy trees, slow devices) without jumping
+// on every update. If the count overtakes the
+// estimate, the estimate is raised instead of reporting more than 100%.
+class ScanProgressEstimator {
+public:
+    struct RootEstimate {
+        std::string path;
+        uint64_t expected = 0;
+        ProgressEstimateSource source = ProgressEstimateSource::Unknown;
+    };
+
+private:
+    mutable std::mutex mutex_;
+
+    std::vector<RootEstimate> roots_;
+    uint64_t expected_;
+    uint64_t processed_;
+    ProgressEstimateSource source_;
+    bool finished_;
+
+    std::chrono::steady_clock::time_point startTime_;
+    std::chrono::steady_clock::time_point sampleTime_;
+    uint64_t sampleProcessed_;
+    double rate_;
+
+    static constexpr double RATE_SMOOTHING = 0.2;       // EWMA weight of a new sample
+    static constexpr double MIN_SAMPLE_SECONDS = 1.0;
+    static constexpr double OVERRUN_HEADROOM = 0.05;    // Raise an overtaken estimate by this much
+
+public:
+    ScanProgressEstimator();
+
+    // Starts a run. priorCounts maps roots to the number of entries indexed
+    // under them last time; alreadyProcessed covers entries committed before
+    // a resume.
+    void begin(const std::vector<std::string>& roots,
+               const std::unordered_map<std::string, uint64_t>& priorCounts,
+               uint64_t alreadyProcessed = 0);
+    void update(uint64_t processed);
+    void finish();
+
+    ScanProgress getProgress() const;
+    std::vector<RootEstimate> getRootEstimates() const;
+
+    // Used inodes of the filesystem holding path; isMountPoint tells whether
+    // path is the root of that filesystem
+    static bool usedInodes(const std::string& path, uint64_t& used, uint64_t& device, bool& isMountPoint);
+
+private:
+    ScanProgress snapshotLocked() const;
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "utils/token_bucket.h"
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace FastFileSearch {
+namespace Engine {
+
+struct ScanThrottleOptions {
+    double filesPerSecond = 0.0;        // Entries enumerated per second, 0 = unlimited
+    double syscallsPerSecond = 0.0;     // Filesystem calls per second, 0 = unlimited
+    bool lowerPriority = true;          // Nice and idle I/O class for scan threads
+    int backgroundNice = 10;
+    bool adaptive = true;               // Back off while the system is busy
+    double loadThreshold = 0.75;        // 1-minute load per core, excluding our own workers
+    double ioPressureThreshold = 10.0;  // % of time some task stalled on I/O (PSI avg10)
+    double minimumFactor = 0.05;        // Never slow down further than this
+};
+
+// Keeps background scans polite towards whatever else runs on the host.
+//
+// Worker threads attach once, which lowers their CPU and I/O priority, and
+// call admit() after each directory with the entries and syscalls it cost.
+// Two token buckets turn those into sleeps when the configured rates are
+// exceeded.
+//
+// With adaptive backoff the load average and I/O pressure are sampled about
+// once a second. While either is above its threshold the rate factor is
+// halved (down to minimumFactor); once both have been quiet it grows back
+// by a tenth per sample. When no rate is configured, backing off caps the
+// scan at the factor times the throughput it reached unthrottled.
+class ScanThrottle {
+public:
+    struct Statistics {
+        uint64_t filesAdmitted = 0;
+        uint64_t syscallsAdmitted = 0;
+        double throttledSeconds = 0.0;
+        double factor = 1.0;            // Current share of the configured (or observed) rate
+        double loadPerCore = -1.0;      // Last sample; -1 when unavailable
+        double ioPressure = -1.0;
+        uint64_t backoffs = 0;
+        uint32_t workers = 0;
+    };
+
+private:
+    ScanThrottleOptions options_;
+
+    mutable std::mutex mutex_;
+    Utils::TokenBucket files_;
+    Utils::TokenBucket syscalls_;
+
+    // Adaptive state, guarded by mutex_
+    std::chrono::steady_clock::time_point lastSample_;
+    uint64_t filesAtLastSample_;
+    double observedFilesPerSecond_;
+    double observedSyscallsPerSecond_;
+    uint64_t syscallsAtLastSample_;
+    double loadPerCore_;
+    double ioPressure_;
+    uint64_t backoffs_;
+    std::chrono::steady_clock::time_point lastBackoff_;
+
+    std::atomic<double> factor_;
+    std::atomic<uint32_t> workers_;
+    std::atomic<uint64_t> filesAdmitted_;
+    std::atomic<uint64_t> syscallsAdmitted_;
+    std::atomic<uint64_t> throttledNs_;
+
+    static constexpr std::chrono::seconds SAMPLE_INTERVAL{1};
+    static constexpr std::chrono::milliseconds SLEEP_SLICE{50};
+    // The load average lags by about a minute; without a hold one busy
+    // period would drive the factor straight to its minimum
+    static constexpr std::chrono::seconds BACKOFF_HOLD{5};
+    static constexpr double RECOVERY_STEP = 0.1;
+    static constexpr double RATE_SMOOTHING = 0.3;
+
+public:
+    explicit ScanThrottle(const ScanThrottleOptions& options = ScanThrottleOptions());
+
+    // Non-copyable
+    ScanThrottle(const ScanThrottle&) = delete;
+    ScanThrottle& operator=(const ScanThrottle&) = delete;
+
+    void setOptions(const ScanThrottleOptions& options);
+    ScanThrottleOptions getOptions() const;
+
+    // On the worker thread itself, before it starts scanning
+    void attachWorker();
+    void detachWorker();
+
+    // Charge work just done and sleep as long as the budget requires.
+    // Returns false if cancel was set while waiting.
+    bool admit(uint64_t files, uint64_t syscalls, const std::atomic<bool>& cancel);
+
+    double getFactor() const { return factor_.load(); }
+    Statistics getStatistics() const;
+
+    // Lower the calling thread's nice value and, where supported, move it to
+    // the idle I/O class. Other threads of the process are unaffected.
+    static void lowerCurrentThreadPriority(int nice, bool idleIo);
+
+    // 1-minute load average; -1 if unavailable
+    static double readLoadAverage();
+    // PSI "some avg10" for I/O in percent; -1 without /proc/pressure
+    static double readIoPressure();
+
+private:
+    void sampleLocked(std::chrono::steady_clock::time_point now);
+    void applyRatesLocked();
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "core/types.h"
+#include "engine/directory_scanner.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <cstdint>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// Entries collected by one scanner worker. Only its owner writes to it, so
+// nothing here is synchronized; seal() sorts it by path for the merge.
+class IndexShard {
+private:
+    std::vector<FileEntry> entries_;
+    bool sealed_ = false;
+
+public:
+    void addDirectory(const ScannedDirectory& scanned);
+    void seal();
+    void clear();
+
+    bool isSealed() const { return sealed_; }
+    size_t size() const { return entries_.size(); }
+    std::vector<FileEntry>& entries() { return entries_; }
+    const std::vector<FileEntry>& entries() const { return entries_; }
+};
+
+// Builds an initial index without shared writes: every scanner worker fills
+// its own shard, and once the scan is done the shards are sorted in parallel
+// and k-way merged by path into one ordered stream for the global index.
+//
+// The merged stream is in path order, so parents precede their children
+// (parent ids are resolved during the merge) and database inserts append to
+// the path index instead of scattering across it. Entries only reach the
+// sink after the scan, so nothing is durable - and the scan checkpoint does
+// not advance - until merge() runs.
+class ShardedIndexBuilder {
+public:
+    // Receives merged entries in path order, in batches
+    using MergeSink = std::function<void(std::vector<FileEntry>&& batch)>;
+
+    struct Statistics {
+        size_t shards = 0;
+        uint64_t entries = 0;           // Emitted by the merge
+        uint64_t duplicates = 0;        // Same path collected by several shards
+        uint64_t largestShard = 0;
+        uint64_t smallestShard = 0;
+        double sortSeconds = 0.0;
+        double mergeSeconds = 0.0;
+    };
+
+private:
+    std::vector<IndexShard> shards_;
+    Statistics statistics_;
+
+public:
+    // One shard per scanner worker (ParallelScanner's workerIndex)
+    explicit ShardedIndexBuilder(size_t numShards);
+
+    // Non-copyable
+    ShardedIndexBuilder(const ShardedIndexBuilder&) = delete;
+    ShardedIndexBuilder& operator=(const ShardedIndexBuilder&) = delete;
+
+    // Called from the directory callback of the owning worker
+    void addDirectory(const ScannedDirectory& scanned, size_t workerIndex);
+
+    // Sorts the shards, merges them and hands the result to sink in batches
+    // of batchSize. With firstId > 0, entries get consecutive ids from it and
+    // parentId is set for entries whose parent directory was merged as well.
+    // Consumes the shards; returns the number of entries emitted.
+    uint64_t merge(const MergeSink& sink, size_t batchSize = 50000, uint64_t firstId = 0);
+
+    size_t getShardCount() const { return shards_.size(); }
+    uint64_t getEntryCount() const;
+    Statistics getStatistics() const { return statistics_; }
+    void clear();
+
+private:
+    void sealShards();
+    static std::string_view parentPath(const std::string& path);
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <unordered_map>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// Broad performance class of the storage behind a mount
+enum class StorageKind : uint8_t {
+    Unknown = 0,
+    Rotational = 1,   // Spinning disk: seeks dominate, keep concurrency low
+    SolidState = 2,   // SATA/SAS SSD
+    NVMe = 3,         // Deep hardware queues, scales with many threads
+    Network = 4,      // NFS/SMB/sshfs: latency bound, moderate concurrency
+    Virtual = 5       // tmpfs, procfs and friends: memory speed
+};
+
+const char* storageKindName(StorageKind kind);
+
+// A mounted filesystem and the block device that backs it
+struct StorageDevice {
+    uint64_t device = 0;          // st_dev of files on this mount
+    uint32_t major = 0;
+    uint32_t minor = 0;
+    std::string mountPoint;
+    std::string fileSystem;
+    std::string source;           // e.g. /dev/sda1, server:/export
+    std::string blockDevice;      // Whole-disk name in /sys/block, e.g. sda, nvme0n1
+    StorageKind kind = StorageKind::Unknown;
+
+    // Directory reads this device should have in flight: an initial value and
+    // the ceiling adaptive tuning may grow to
+    size_t initialConcurrency() const;
+    size_t maxConcurrency() const;
+};
+
+// Maps paths to the devices they live on. On Linux the mount table comes from
+// /proc/self/mountinfo and the device class from sysfs
+// (/sys/dev/block/MAJ:MIN/.../queue/rotational); elsewhere every path maps to
+// one device of unknown kind.
+class StorageTopology {
+private:
+    mutable std::mutex mutex_;
+    std::vector<StorageDevice> mounts_;                  // Longest mount point first
+    std::unordered_map<uint64_t, size_t> byDevice_;      // st_dev -> index into mounts_
+
+public:
+    StorageTopology();
+
+    // Re-read the mount table; cheap enough to call before every scan
+    bool refresh();
+
+    // Device holding path. Resolved via stat() when the path exists, by
+    // longest mount-point prefix otherwise.
+    StorageDevice deviceForPath(const std::string& path) const;
+    StorageDevice deviceForId(uint64_t device) const;
+
+    std::vector<StorageDevice> getDevices() const;
+
+    // Threads worth running for a scan of these roots: the sum of the
+    // devices' ceilings, capped at maxThreads
+    size_t recommendedThreads(const std::vector<std::string>& roots, size_t maxThreads) const;
+
+    // Classification helpers, exposed for diagnostics
+    static StorageKind classifyFileSystem(const std::string& fileSystem);
+    static StorageKind classifyBlockDevice(uint32_t major, uint32_t minor, std::string& blockDevice);
+
+private:
+    StorageDevice findByPrefixLocked(const std::string& path) const;
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "core/types.h"
+#include "engine/directory_scanner.h"
+#include "engine/exclusion_rules.h"
+#include <memory>
+#include <vector>
+#include <string>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+
+namespace FastFileSearch {
+namespace Engine {
+
+struct WatchBudgetOptions {
+    double limitShare = 0.5;            // Of the kernel's per-user watch limit; other programs need some too
+    uint32_t maxWatches = 0;            // Explicit cap, 0 = from the kernel limit only
+    uint32_t eagerDepth = 2;            // Levels below each root watched up front
+    std::chrono::seconds pollInterval{30};
+    uint32_t pollStatsPerRound = 20000; // Metadata lookups one poll round may spend on cold directories
+    double changeHalfLifeSeconds = 3600.0;
+    double promoteRatio = 1.5;          // A cold directory must score this much above the weakest watched one
+    bool includeHidden = true;
+    std::shared_ptr<const ExclusionRules> exclusions;
+};
+
+// Decides which directories get one of a limited number of inotify watches
+// and polls the rest.
+//
+// Each directory scores by how often it changed (decaying with
+// changeHalfLifeSeconds), by user interest and, at half weight, by its
+// parent's score, so a busy subtree pulls its children in. The top levels
+// of every root are watched up front; after that each poll round promotes
+// the best cold directories while the budget lasts and, once it is spent,
+// swaps a cold directory in for the weakest watched one when it clearly
+// outscores it. When inotify_add_watch() reports ENOSPC anyway, the budget
+// shrinks to what was actually granted for a while.
+//
+// Cold directories are covered by an mtime-diff poller. It keeps no copy
+// of the listing, which the index already has, only a 16-byte stamp per
+// entry: a hash of the name and one of mtime, size and type. A fresh
+// listing names what is new or changed, posted as Created/Modified events;
+// entries that vanished cannot be named from their hashes, so the
+// directory goes to the reconcile sink and is re-read against the index
+// instead. Rounds are round-robin and capped at pollStatsPerRound lookups,
+// so on a huge cold tree a change may take several rounds to show up, but
+// it is never silently missed.
+//
+// Not thread-safe except recordInterest(); the watcher thread owns it.
+class WatchManager {
+public:
+    // Returns the watch descriptor, or -errno
+    using AddWatch = std::function<int(const std::string& path)>;
+    using RemoveWatch = std::function<void(int wd)>;
+    using EventSink = std::function<void(const FileChangeEvent& event)>;
+    // Entries vanished from a polled directory; re-read it against the index
+    using ReconcileSink = std::function<void(const std::string& directory)>;
+
+    struct Statistics {
+        uint64_t directories = 0;
+        uint64_t watched = 0;
+        uint64_t polled = 0;
+        uint64_t budget = 0;
+        uint64_t kernelLimit = 0;
+        uint64_t promotions = 0;
+        uint64_t evictions = 0;
+        uint64_t limitHits = 0;         // ENOSPC from the kernel
+        uint64_t pollRounds = 0;
+        uint64_t polledLookups = 0;
+        uint64_t polledEvents = 0;
+        uint64_t polledReconciles = 0;  // Directories handed to the reconcile sink
+    };
+
+private:
+    struct EntryStamp {
+        uint64_t name = 0;              // Hash of the entry name
+        uint64_t state = 0;             // Hash of mtime, size and type
+    };
+
+    struct Directory {
+        int wd = -1;                    // -1 while polled
+        uint32_t depth = 0;
+        double changes = 0.0;           // Decayed change count at 'scoredAt'
+        double interest = 0.0;
+        std::chrono::steady_clock::time_point scoredAt;
+        std::vector<EntryStamp> snapshot;       // Sorted by name hash; only while polled
+        bool primed = false;            // Snapshot holds the real contents
+    };
+
+    WatchBudgetOptions options_;
+    AddWatch addWatch_;
+    RemoveWatch removeWatch_;
+    EventSink eventSink_;
+    ReconcileSink reconcileSink_;
+    std::unique_ptr<DirectoryScanner> scanner_;
+
+    std::map<std::string, Directory> directories_;  // Ordered, so a subtree is a key range
+    std::unordered_map<int, std::string> pathByWatch_;
+    uint64_t kernelLimit_;
+    uint64_t budget_;
+    uint64_t maxBudget_;                // Before any ENOSPC
+    std::chrono::steady_clock::time_point limitHitAt_;
+    std::string pollCursor_;
+    std::chrono::steady_clock::time_point nextPoll_;
+
+    std::mutex interestMutex_;
+    std::vector<std::string> pendingInterest_;
+
+    Statistics stats_;
+
+public:
+    WatchManager(const WatchBudgetOptions& options, AddWatch addWatch, RemoveWatch removeWatch,
+                 EventSink eventSink, ReconcileSink reconcileSink);
+    ~WatchManager();
+
+    // Non-copyable
+    WatchManager(const WatchManager&) = delete;
+    WatchManager& operator=(const WatchManager&) = delete;
+
+    // Discover the directories below root, watch its top levels and take
+    // snapshots of the rest
+    bool addRoot(const std::string& root);
+    void removeAll();
+
+    // Path of a watch descriptor from an inotify event; empty if unknown
+    std::string pathOf(int wd) const;
+
+    // From the watcher thread, for every event in a watched directory
+    void recordChange(const std::string& directory);
+    // Any thread: the user searched in or opened something below path
+    void recordInterest(const std::string& path);
+
+    // Directory changes reported by inotify in watched directories
+    void directoryCreated(const std::string& path);
+    void directoryRemoved(const std::string& path);
+    void directoryMoved(const std::string& oldPath, const std::string& newPath);
+    // IN_IGNORED: the kernel dropped the watch (directory deleted or unmounted)
+    void watchRemoved(int wd);
+
+    // One rebalance and poll round when due; returns how long the caller
+    // may wait for inotify events before calling again
+    std::chrono::milliseconds poll();
+
+    Statistics getStatistics() const;
+
+    // max_user_watches, 0 if unknown
+    static uint64_t readKernelLimit();
+
+private:
+    double scoreOf(const std::string& path, Directory& directory, std::chrono::steady_clock::time_point now);
+    void decay(Directory& directory, std::chrono::steady_clock::time_point now) const;
+    bool watch(const std::string& path, Directory& directory);
+    void unwatch(const std::string& path, Directory& directory);
+    void rebalance();
+    void pollRound();
+    // Compare a fresh listing with the snapshot; returns lookups spent
+    uint64_t pollDirectory(const std::string& path, Directory& directory);
+    bool listDirectory(const std::string& path, ScannedDirectory& scanned, uint64_t& lookups);
+    bool takeSnapshot(const std::string& path, std::vector<EntryStamp>& snapshot,
+                      std::vector<std::string>* subdirectories, uint64_t& lookups);
+    static EntryStamp stampOf(const FileEntry& entry);
+    void addDirectory(const std::string& path, uint32_t depth, bool primed);
+    void applyPendingInterest();
+    std::string parentOf(const std::string& path) const;
+    std::map<std::string, Directory>::iterator subtreeEnd(const std::string& path);
+};
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "storage/sqlite_database.h"
+#include "storage/store_connection.h"
+#include "utils/murmur_hash3.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+namespace FastFileSearch {
+namespace Storage {
+
+// Content hashes of one file, valid while its fingerprint is unchanged.
+// Files no larger than the head are fully hashed by the head hash alone.
+// A file that changed between the head and the full pass keeps only the
+// full hash.
+struct ContentHashRecord {
+    std::string path;
+    FileFingerprint fingerprint;
+    Utils::Hash128 headHash;
+    Utils::Hash128 fullHash;
+    bool hasHeadHash = false;
+    bool hasFullHash = false;
+};
+
+// Persists duplicate-detection hashes in the index database, next to the
+// file tables owned by SQLiteDatabase, through a connection of its own, so
+// later runs only read files that changed
+class ContentHashStore {
+private:
+    StoreConnection connection_;
+    mutable std::mutex mutex_;
+
+public:
+    explicit ContentHashStore(SQLiteDatabase& database);
+
+    // Non-copyable
+    ContentHashStore(const ContentHashStore&) = delete;
+    ContentHashStore& operator=(const ContentHashStore&) = delete;
+
+    bool createTables();
+
+    bool saveHashes(const std::vector<ContentHashRecord>& records);
+    bool deleteHashes(const std::vector<std::string>& paths);
+    std::vector<ContentHashRecord> loadHashes();
+    uint64_t getHashCount();
+    bool clear();
+
+private:
+    static const char* CREATE_CONTENT_HASHES_TABLE;
+    static const char* UPSERT_CONTENT_HASH_SQL;
+    static const char* DELETE_CONTENT_HASH_SQL;
+    static const char* SELECT_CONTENT_HASHES_SQL;
+};
+
+} // namespace Storage
+} // namespace FastFileSearch
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "storage/sqlite_database.h"
+#include "storage/store_connection.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+namespace FastFileSearch {
+namespace Storage {
+
+// A file in the content index, valid while its fingerprint is unchanged
+struct ContentIndexDocument {
+    uint32_t id = 0;
+    std::string path;
+    FileFingerprint fingerprint;
+    bool binary = false;            // Contents not indexed, no postings
+};
+
+// Sorted document ids of one trigram
+struct ContentIndexPostings {
+    uint32_t trigram = 0;
+    std::vector<uint32_t> documents;
+};
+
+// Ids appended to a trigram's list since it was last saved
+struct ContentIndexAppend {
+    uint32_t trigram = 0;
+    uint32_t stored = 0;            // Ids of the list already in the store
+    uint32_t previous = 0;          // The last of them, if any
+    std::vector<uint32_t> documents;
+};
+
+// What changed in a ContentIndex since it was last saved
+struct ContentIndexChanges {
+    bool replaceAll = false;                    // Clear the tables first (after a compaction)
+    std::vector<ContentIndexDocument> documents;
+    std::vector<uint32_t> removedDocuments;
+    std::vector<ContentIndexPostings> postings; // Whole lists, replacing what is stored
+    std::vector<ContentIndexAppend> appended;
+    std::vector<uint32_t> removedTrigrams;
+
+    bool empty() const {
+        return !replaceAll && documents.empty() && removedDocuments.empty() &&
+               postings.empty() && appended.empty() && removedTrigrams.empty();
+    }
+};
+
+// Persists the trigram content index in the index database, through a
+// connection of its own. Postings are stored one row per trigram as
+// delta-encoded varints, which keeps a list of ids of a mostly sequential
+// build at about one byte per entry.
+//
+// Ids only ever get appended to a list (compaction rewrites everything), so
+// a save does not rewrite the lists it touches: the new ids go to a log,
+// one row per trigram and save, encoded as deltas from the list's last
+// stored id. Concatenating a list's row and its log rows therefore yields
+// the whole encoded list. Once the log reaches MERGE_LOG_ROWS rows it is
+// folded into the lists within the save that filled it.
+class ContentIndexStore {
+private:
+    StoreConnection connection_;
+    mutable std::mutex mutex_;
+    uint64_t logRows_ = 0;
+    int64_t nextSequence_ = 0;
+
+    static const uint64_t MERGE_LOG_ROWS = 65536;
+
+public:
+    explicit ContentIndexStore(SQLiteDatabase& database);
+
+    // Non-copyable
+    ContentIndexStore(const ContentIndexStore&) = delete;
+    ContentIndexStore& operator=(const ContentIndexStore&) = delete;
+
+    bool createTables();
+
+    // One transaction
+    bool saveChanges(const ContentIndexChanges& changes);
+    std::vector<ContentIndexDocument> loadDocuments();
+    std::vector<ContentIndexPostings> loadPostings();
+    uint64_t getDocumentCount();
+    bool clear();
+
+    static std::string encodePostings(const std::vector<uint32_t>& documents, uint32_t previous = 0);
+    static bool decodePostings(const void* data, size_t size, std::vector<uint32_t>& documents);
+
+private:
+    // Folds the log into the lists; caller holds a transaction
+    bool mergeLog(uint64_t& logRows);
+    bool loadLogState();
+
+    static const char* CREATE_CONTENT_DOCUMENTS_TABLE;
+    static const char* CREATE_CONTENT_TRIGRAMS_TABLE;
+    static const char* CREATE_CONTENT_TRIGRAM_LOG_TABLE;
+    static const char* UPSERT_DOCUMENT_SQL;
+    static const char* DELETE_DOCUMENT_SQL;
+    static const char* UPSERT_TRIGRAM_SQL;
+    static const char* DELETE_TRIGRAM_SQL;
+    static const char* APPEND_TRIGRAM_LOG_SQL;
+    static const char* DELETE_TRIGRAM_LOG_SQL;
+};
+
+} // namespace Storage
+} // namespace FastFileSearch
@@ -33,6 +33,18 @@ struct TrieNode {
     TrieNode& operator=(TrieNode&&) = default;
 };
 
+// One step of MemoryIndex::applyChanges()
+struct IndexChange {
+    enum class Kind : uint8_t {
+        Remove,         // fileId
+        Upsert          // entry, added or updated by path
+    };
+
+    Kind kind = Kind::Upsert;
+    uint64_t fileId = 0;
+    FileEntry entry;
+};
+
 // Bloom filter for fast negative lookups
 class BloomFilter {
 private:
@@ -139,6 +151,10 @@ public:
     bool updateFile(const FileEntry& entry);
     bool removeFile(uint64_t fileId);
     bool removeFileByPath(const std::string& path);
+    // Rename or move: only the moved entry is re-parented and re-tokenized;
+    // descendants keep their ids, parents and name indexes and only have
+    // the path prefix in fullPath and pathToId_ rewritten
+    bool moveEntry(const FileEntry& moved, const std::string& oldPath);
     
     // Retrieval operations
     std::shared_ptr<FileEntry> getFile(uint64_t fileId) const;
@@ -161,6 +177,10 @@ public:
     // Bulk operations
     bool addFilesBatch(const std::vector<FileEntry>& entries);
     bool removeFilesBatch(const std::vector<uint64_t>& fileIds);
+    // A coalesced event batch under one write lock, strictly in the given
+    // order: across a rename barrier the same path may be removed, added
+    // and removed again, so removals cannot be hoisted ahead of upserts
+    bool applyChanges(const std::vector<IndexChange>& changes);
     
     // Index management
     void clear();
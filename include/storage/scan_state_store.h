@@ -0,0 +1,86 @@
+#pragma once
+
+#include "storage/sqlite_database.h"
+#include "storage/store_connection.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <ctime>
+
+namespace FastFileSearch {
+namespace Storage {
+
+// Last observed state of a directory. If none of the stamp fields changed,
+// the directory's immediate children are the same as when it was scanned.
+struct DirectoryStamp {
+    std::string path;
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    int64_t modifiedNs = 0;
+    int64_t changedNs = 0;
+    uint64_t childCount = 0;
+    std::time_t lastScanned = 0;
+
+    bool matches(const DirectoryStamp& other) const {
+        return modifiedNs == other.modifiedNs && changedNs == other.changedNs &&
+               inode == other.inode && device == other.device;
+    }
+};
+
+// Persists scanner bookkeeping (directory stamps, scan checkpoints) in the index database,
+// next to the file tables owned by SQLiteDatabase, through a connection of its own
+class ScanStateStore {
+private:
+    StoreConnection connection_;
+    mutable std::mutex mutex_;
+
+public:
+    explicit ScanStateStore(SQLiteDatabase& database);
+
+    // Non-copyable
+    ScanStateStore(const ScanStateStore&) = delete;
+    ScanStateStore& operator=(const ScanStateStore&) = delete;
+
+    // Opens the store's connection; call after the database is open
+    bool createTables();
+
+    // Directory stamps
+    bool saveDirectoryStamps(const std::vector<DirectoryStamp>& stamps);
+    bool deleteDirectoryStamps(const std::vector<std::string>& paths);
+    bool deleteDirectoryStampsUnder(const std::string& rootPath);
+    // A directory was renamed or moved: rewrite its stamp and those below
+    bool moveDirectoryStamps(const std::string& oldPath, const std::string& newPath);
+    std::vector<DirectoryStamp> loadDirectoryStamps(const std::string& rootPath);
+    uint64_t getDirectoryStampCount();
+    
+    // Checkpoint of an interrupted scan: directories still to be scanned
+    // (frontier) and directories already committed whose parent was not
+    // (completed markers), plus free-form metadata
+    bool saveCheckpointDelta(const std::vector<std::string>& frontierAdded,
+                             const std::vector<std::string>& frontierRemoved,
+                             const std::vector<std::string>& completedAdded,
+                             const std::vector<std::string>& completedRemoved);
+    bool loadCheckpoint(std::vector<std::string>& frontier, std::vector<std::string>& completed);
+    bool setCheckpointValue(const std::string& key, const std::string& value);
+    std::string getCheckpointValue(const std::string& key);
+    bool hasCheckpoint();
+    bool clearCheckpoint();
+
+private:
+    bool executePathBatch(sqlite3_stmt* stmt, const std::vector<std::string>& paths);
+    std::vector<std::string> selectPaths(const char* sql);
+    static std::string subtreePrefix(const std::string& rootPath);
+
+    static const char* CREATE_DIRECTORY_STAMPS_TABLE;
+    static const char* UPSERT_DIRECTORY_STAMP_SQL;
+    static const char* DELETE_DIRECTORY_STAMP_SQL;
+    static const char* DELETE_DIRECTORY_STAMPS_UNDER_SQL;
+    static const char* SELECT_DIRECTORY_STAMPS_UNDER_SQL;
+    static const char* MOVE_DIRECTORY_STAMPS_SQL;
+    
+    static const char* CREATE_CHECKPOINT_TABLES;
+};
+
+} // namespace Storage
+} // namespace FastFileSearch
@@ -80,6 +80,10 @@ public:
     bool updateFile(const FileEntry& entry);
     bool deleteFile(uint64_t fileId);
     bool deleteFileByPath(const std::string& path);
+    // Rename or move a file or directory: the entry itself gets its new
+    // name and parent_id, descendants keep their rows and only have the
+    // path prefix rewritten, in one UPDATE over the path range
+    bool moveEntry(const FileEntry& moved, const std::string& oldPath);
     
     std::unique_ptr<FileEntry> getFile(uint64_t fileId);
     std::unique_ptr<FileEntry> getFileByPath(const std::string& path);
@@ -130,6 +134,9 @@ public:
     void setCacheSize(int pages);
     void setPragma(const std::string& pragma, const std::string& value);
     
+    // Raw connection for companion stores that keep their own tables
+    sqlite3* getHandle() const { return db_; }
+    
     // Callback for progress monitoring
     using ProgressCallback = std::function<void(int percentage)>;
     void setProgressCallback(ProgressCallback callback);
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "storage/sqlite_database.h"
+#include <string>
+
+namespace FastFileSearch {
+namespace Storage {
+
+// A companion store's own connection to the index database file.
+//
+// SQLite transactions belong to a connection: a BEGIN issued on the handle
+// SQLiteDatabase uses would swallow or break its own batch transactions.
+// A second connection to the same file has its transactions serialized by
+// SQLite's file locking instead (waiting up to BUSY_TIMEOUT_MS). In-memory
+// and temporary databases cannot be opened twice, so those keep using the
+// shared handle.
+class StoreConnection {
+private:
+    SQLiteDatabase& database_;
+    sqlite3* db_;           // Owned; nullptr while sharing the database's handle
+    std::string owner_;     // For log messages
+
+    static const int BUSY_TIMEOUT_MS = 10000;
+
+public:
+    StoreConnection(SQLiteDatabase& database, std::string owner);
+    ~StoreConnection();
+
+    // Non-copyable
+    StoreConnection(const StoreConnection&) = delete;
+    StoreConnection& operator=(const StoreConnection&) = delete;
+
+    // Opens the private connection; call once the database itself is open
+    bool open();
+    void close();
+    bool isPrivate() const { return db_ != nullptr; }
+
+    sqlite3* get() const { return db_ ? db_ : database_.getHandle(); }
+    bool execute(const char* sql);
+
+    // BEGIN IMMEDIATE on construction, ROLLBACK on destruction unless
+    // committed, so every early return leaves the connection clean
+    class Transaction {
+    private:
+        StoreConnection& connection_;
+        bool active_;
+
+    public:
+        explicit Transaction(StoreConnection& connection);
+        ~Transaction();
+
+        Transaction(const Transaction&) = delete;
+        Transaction& operator=(const Transaction&) = delete;
+
+        bool isActive() const { return active_; }
+        bool commit();
+    };
+};
+
+} // namespace Storage
+} // namespace FastFileSearch
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace FastFileSearch {
+namespace Utils {
+
+// Identity of a filesystem object
+struct InodeKey {
+    uint64_t device = 0;
+    uint64_t inode = 0;
+
+    bool operator==(const InodeKey& other) const { return device == other.device && inode == other.inode; }
+};
+
+struct InodeKeyHash {
+    size_t operator()(const InodeKey& key) const {
+        // splitmix64 finalizer over both halves
+        uint64_t x = key.inode ^ (key.device * 0x9E3779B97F4A7C15ULL);
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return static_cast<size_t>(x ^ (x >> 31));
+    }
+};
+
+// Set of (device, inode) pairs shared by scanning threads.
+//
+// Open addressing with linear probing over flat arrays of 16-byte keys (no
+// per-node allocation), split into independently locked shards so threads
+// rarely meet on the same mutex. Inode 0 marks an empty slot; callers must
+// not insert it.
+class ConcurrentInodeSet {
+private:
+    static constexpr size_t SHARD_BITS = 6;
+    static constexpr size_t SHARD_COUNT = size_t(1) << SHARD_BITS;
+    static constexpr size_t INITIAL_CAPACITY = 64;
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::vector<InodeKey> slots;
+        size_t count = 0;
+    };
+
+    std::unique_ptr<Shard[]> shards_;
+    std::atomic<size_t> size_;
+
+public:
+    ConcurrentInodeSet() : shards_(new Shard[SHARD_COUNT]), size_(0) {}
+
+    // Non-copyable
+    ConcurrentInodeSet(const ConcurrentInodeSet&) = delete;
+    ConcurrentInodeSet& operator=(const ConcurrentInodeSet&) = delete;
+
+    // Returns true if the key was not present before
+    bool insert(uint64_t device, uint64_t inode) {
+        InodeKey key{device, inode};
+        size_t hash = InodeKeyHash{}(key);
+        Shard& shard = shards_[hash >> (sizeof(size_t) * 8 - SHARD_BITS)];
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.slots.empty()) {
+            shard.slots.resize(INITIAL_CAPACITY);
+        } else if ((shard.count + 1) * 10 > shard.slots.size() * 7) {
+            grow(shard);
+        }
+
+        if (!place(shard.slots, key, hash)) {
+            return false;
+        }
+        shard.count++;
+        size_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool contains(uint64_t device, uint64_t inode) const {
+        InodeKey key{device, inode};
+        size_t hash = InodeKeyHash{}(key);
+        Shard& shard = shards_[hash >> (sizeof(size_t) * 8 - SHARD_BITS)];
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.slots.empty()) {
+            return false;
+        }
+        size_t mask = shard.slots.size() - 1;
+        for (size_t i = hash & mask; shard.slots[i].inode != 0; i = (i + 1) & mask) {
+            if (shard.slots[i] == key) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+    size_t getMemoryUsage() const {
+        size_t bytes = SHARD_COUNT * sizeof(Shard);
+        for (size_t i = 0; i < SHARD_COUNT; ++i) {
+            std::lock_guard<std::mutex> lock(shards_[i].mutex);
+            bytes += shards_[i].slots.capacity() * sizeof(InodeKey);
+        }
+        return bytes;
+    }
+
+    void clear() {
+        for (size_t i = 0; i < SHARD_COUNT; ++i) {
+            std::lock_guard<std::mutex> lock(shards_[i].mutex);
+            std::vector<InodeKey>().swap(shards_[i].slots);
+            shards_[i].count = 0;
+        }
+        size_.store(0);
+    }
+
+private:
+    // Capacity is a power of two; returns false if key is already present
+    static bool place(std::vector<InodeKey>& slots, const InodeKey& key, size_t hash) {
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+            if (slots[i].inode == 0) {
+                slots[i] = key;
+                return true;
+            }
+            if (slots[i] == key) {
+                return false;
+            }
+        }
+    }
+
+    static void grow(Shard& shard) {
+        std::vector<InodeKey> larger(shard.slots.size() * 2);
+        for (const auto& key : shard.slots) {
+            if (key.inode != 0) {
+                place(larger, key, InodeKeyHash{}(key));
+            }
+        }
+        shard.slots.swap(larger);
+    }
+};
+
+} // namespace Utils
+} // namespace FastFileSearch
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define FFS_LITERAL_SEARCH_SSE2 1
+#endif
+
+namespace FastFileSearch {
+namespace Utils {
+
+// Finds a fixed string in a byte buffer, optionally ignoring ASCII case.
+//
+// With SSE2 every 16 positions are tested at once against the needle's
+// first and last byte (both cases when case-insensitive); only positions
+// where both agree are compared in full. On text that rarely contains the
+// first/last byte pair this touches each input byte about once.
+class LiteralFinder {
+private:
+    std::string needle_;        // Lowercased when case-insensitive
+    bool caseSensitive_;
+
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    LiteralFinder(std::string_view needle, bool caseSensitive)
+        : needle_(needle), caseSensitive_(caseSensitive) {
+        if (!caseSensitive_) {
+            for (auto& c : needle_) {
+                c = static_cast<char>(toLower(static_cast<unsigned char>(c)));
+            }
+        }
+    }
+
+    size_t length() const { return needle_.size(); }
+    bool empty() const { return needle_.empty(); }
+
+    // Offset of the first match starting at or after 'from', or npos
+    size_t find(const char* data, size_t size, size_t from = 0) const {
+        size_t n = needle_.size();
+        if (n == 0) {
+            return from <= size ? from : npos;
+        }
+        if (size < n || from > size - n) {
+            return npos;
+        }
+
+        size_t i = from;
+#ifdef FFS_LITERAL_SEARCH_SSE2
+        const unsigned char first = static_cast<unsigned char>(needle_.front());
+        const unsigned char last = static_cast<unsigned char>(needle_.back());
+        const __m128i firstLower = _mm_set1_epi8(static_cast<char>(first));
+        const __m128i lastLower = _mm_set1_epi8(static_cast<char>(last));
+        const __m128i firstUpper = _mm_set1_epi8(static_cast<char>(caseSensitive_ ? first : toUpper(first)));
+        const __m128i lastUpper = _mm_set1_epi8(static_cast<char>(caseSensitive_ ? last : toUpper(last)));
+
+        for (; i + n - 1 + 16 <= size; i += 16) {
+            __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + n - 1));
+            __m128i eqFirst = _mm_or_si128(_mm_cmpeq_epi8(blockFirst, firstLower),
+                                           _mm_cmpeq_epi8(blockFirst, firstUpper));
+            __m128i eqLast = _mm_or_si128(_mm_cmpeq_epi8(blockLast, lastLower),
+                                          _mm_cmpeq_epi8(blockLast, lastUpper));
+            unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_and_si128(eqFirst, eqLast)));
+            while (mask != 0) {
+                unsigned int bit = static_cast<unsigned int>(__builtin_ctz(mask));
+                if (matchesAt(data + i + bit)) {
+                    return i + bit;
+                }
+                mask &= mask - 1;
+            }
+        }
+#endif
+        if (caseSensitive_) {
+            size_t pos = std::string_view(data, size).find(needle_, i);
+            return pos == std::string_view::npos ? npos : pos;
+        }
+        for (; i + n <= size; ++i) {
+            if (matchesAt(data + i)) {
+                return i;
+            }
+        }
+        return npos;
+    }
+
+private:
+    bool matchesAt(const char* text) const {
+        if (caseSensitive_) {
+            return std::memcmp(text, needle_.data(), needle_.size()) == 0;
+        }
+        for (size_t k = 0; k < needle_.size(); ++k) {
+            if (toLower(static_cast<unsigned char>(text[k])) != static_cast<unsigned char>(needle_[k])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static unsigned char toLower(unsigned char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+    }
+    static unsigned char toUpper(unsigned char c) {
+        return (c >= 'a' && c <= 'z') ? static_cast<unsigned char>(c - ('a' - 'A')) : c;
+    }
+};
+
+} // namespace Utils
+} // namespace FastFileSearch
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace FastFileSearch {
+namespace Utils {
+
+// Unbounded multi-producer/single-consumer queue (Vyukov's intrusive
+// design). push() is wait-free: one atomic exchange plus a store, so
+// producers never block on each other or on the consumer. pop() may only be
+// called from one thread at a time.
+//
+// A push is visible to the consumer once its exchange happened; between the
+// exchange and the link store the queue is briefly inconsistent and pop()
+// spins until the link appears, so "pop() returned false" really means every
+// push that started before the call has been consumed.
+template<typename T>
+class MpscQueue {
+private:
+    struct Node {
+        std::atomic<Node*> next;
+        T value;
+
+        Node() : next(nullptr), value() {}
+        explicit Node(T&& item) : next(nullptr), value(std::move(item)) {}
+    };
+
+    alignas(64) std::atomic<Node*> head_;   // Producers exchange here
+    alignas(64) Node* tail_;                // Consumer only
+    std::atomic<size_t> size_;
+
+public:
+    MpscQueue() : size_(0) {
+        Node* stub = new Node();
+        head_.store(stub, std::memory_order_relaxed);
+        tail_ = stub;
+    }
+
+    ~MpscQueue() {
+        T discarded;
+        while (pop(discarded)) {
+        }
+        delete tail_;
+    }
+
+    // Non-copyable
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T&& item) {
+        Node* node = new Node(std::move(item));
+        size_.fetch_add(1, std::memory_order_relaxed);
+        Node* previous = head_.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    void push(const T& item) {
+        T copy(item);
+        push(std::move(copy));
+    }
+
+    // Consumer only
+    bool pop(T& item) {
+        Node* tail = tail_;
+        Node* next = tail->next.load(std::memory_order_acquire);
+
+        while (next == nullptr) {
+            if (head_.load(std::memory_order_acquire) == tail) {
+                return false;
+            }
+            // A producer exchanged head_ but has not linked its node yet
+            next = tail->next.load(std::memory_order_acquire);
+        }
+
+        item = std::move(next->value);
+        tail_ = next;
+        delete tail;
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Approximate while producers are active
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+    bool empty() const { return size() == 0; }
+};
+
+} // namespace Utils
+} // namespace FastFileSearch
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <algorithm>
+
+namespace FastFileSearch {
+namespace Utils {
+
+struct Hash128 {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    bool operator==(const Hash128& other) const = default;
+    bool operator<(const Hash128& other) const {
+        return high != other.high ? high < other.high : low < other.low;
+    }
+
+    // Same byte order as the reference implementation's output
+    std::string toHex() const {
+        static const char digits[] = "0123456789abcdef";
+        std::string hex;
+        hex.reserve(32);
+        for (uint64_t word : {low, high}) {
+            for (int byte = 0; byte < 8; ++byte) {
+                uint8_t value = static_cast<uint8_t>(word >> (byte * 8));
+                hex += digits[value >> 4];
+                hex += digits[value & 0x0f];
+            }
+        }
+        return hex;
+    }
+};
+
+struct Hash128Hasher {
+    size_t operator()(const Hash128& hash) const {
+        return static_cast<size_t>(hash.low ^ (hash.high * 0x9e3779b97f4a7c15ULL));
+    }
+};
+
+// MurmurHash3_x64_128 (Austin Appleby, public domain) fed incrementally, so
+// files can be hashed through a fixed buffer. Produces the same value as
+// the one-shot reference function on little-endian machines. Not
+// cryptographic: equal hashes are treated as equal content, which is fine
+// for finding duplicates but not for anything adversarial.
+class Murmur3Hasher {
+private:
+    uint64_t h1_;
+    uint64_t h2_;
+    uint64_t length_;
+    uint8_t tail_[16];
+    size_t tailSize_;
+
+    static constexpr uint64_t C1 = 0x87c37b91114253d5ULL;
+    static constexpr uint64_t C2 = 0x4cf5ad432745937fULL;
+
+public:
+    explicit Murmur3Hasher(uint32_t seed = 0)
+        : h1_(seed), h2_(seed), length_(0), tail_{}, tailSize_(0) {
+    }
+
+    void update(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        length_ += size;
+
+        if (tailSize_ > 0) {
+            size_t take = std::min(size, sizeof(tail_) - tailSize_);
+            std::memcpy(tail_ + tailSize_, bytes, take);
+            tailSize_ += take;
+            bytes += take;
+            size -= take;
+            if (tailSize_ < sizeof(tail_)) {
+                return;
+            }
+            block(tail_);
+            tailSize_ = 0;
+        }
+
+        while (size >= 16) {
+            block(bytes);
+            bytes += 16;
+            size -= 16;
+        }
+
+        std::memcpy(tail_, bytes, size);
+        tailSize_ = size;
+    }
+
+    Hash128 finish() const {
+        uint64_t h1 = h1_;
+        uint64_t h2 = h2_;
+        uint64_t k1 = 0;
+        uint64_t k2 = 0;
+
+        for (size_t i = tailSize_; i > 8; --i) {
+            k2 ^= static_cast<uint64_t>(tail_[i - 1]) << ((i - 9) * 8);
+        }
+        if (tailSize_ > 8) {
+            k2 *= C2; k2 = rotl(k2, 33); k2 *= C1; h2 ^= k2;
+        }
+        for (size_t i = std::min<size_t>(tailSize_, 8); i > 0; --i) {
+            k1 ^= static_cast<uint64_t>(tail_[i - 1]) << ((i - 1) * 8);
+        }
+        if (tailSize_ > 0) {
+            k1 *= C1; k1 = rotl(k1, 31); k1 *= C2; h1 ^= k1;
+        }
+
+        h1 ^= length_;
+        h2 ^= length_;
+        h1 += h2;
+        h2 += h1;
+        h1 = fmix(h1);
+        h2 = fmix(h2);
+        h1 += h2;
+        h2 += h1;
+        return {h1, h2};
+    }
+
+    static Hash128 hash(const void* data, size_t size, uint32_t seed = 0) {
+        Murmur3Hasher hasher(seed);
+        hasher.update(data, size);
+        return hasher.finish();
+    }
+
+private:
+    void block(const uint8_t* bytes) {
+        uint64_t k1;
+        uint64_t k2;
+        std::memcpy(&k1, bytes, 8);
+        std::memcpy(&k2, bytes + 8, 8);
+
+        k1 *= C1; k1 = rotl(k1, 31); k1 *= C2; h1_ ^= k1;
+        h1_ = rotl(h1_, 27); h1_ += h2_; h1_ = h1_ * 5 + 0x52dce729;
+
+        k2 *= C2; k2 = rotl(k2, 33); k2 *= C1; h2_ ^= k2;
+        h2_ = rotl(h2_, 31); h2_ += h1_; h2_ = h2_ * 5 + 0x38495ab5;
+    }
+
+    static uint64_t rotl(uint64_t value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    static uint64_t fmix(uint64_t k) {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+        return k;
+    }
+};
+
+} // namespace Utils
+} // namespace FastFileSearch
@@ -17,9 +17,10 @@ private:
     std::queue<T> queue_;
     std::condition_variable condition_;
     std::atomic<bool> shutdown_;
+    std::atomic<size_t> capacity_;  // For tryPush(); 0 = unbounded
 
 public:
-    ThreadSafeQueue() : shutdown_(false) {}
+    ThreadSafeQueue() : shutdown_(false), capacity_(0) {}
     
     ~ThreadSafeQueue() {
         shutdown();
@@ -34,6 +35,7 @@ public:
         std::lock_guard<std::mutex> lock(other.mutex_);
         queue_ = std::move(other.queue_);
         shutdown_.store(other.shutdown_.load());
+        capacity_.store(other.capacity_.load());
     }
 
     ThreadSafeQueue& operator=(ThreadSafeQueue&& other) noexcept {
@@ -44,6 +46,7 @@ public:
             
             queue_ = std::move(other.queue_);
             shutdown_.store(other.shutdown_.load());
+            capacity_.store(other.capacity_.load());
         }
         return *this;
     }
@@ -69,6 +72,41 @@ public:
         condition_.notify_one();
     }
 
+    // Push unless the queue already holds capacity items; false if the
+    // item was not queued. push() and emplace() ignore the capacity.
+    bool tryPush(const T& item) {
+        if (shutdown_.load()) {
+            return false;
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t capacity = capacity_.load();
+        if (capacity > 0 && queue_.size() >= capacity) {
+            return false;
+        }
+        queue_.push(item);
+        condition_.notify_one();
+        return true;
+    }
+
+    bool tryPush(T&& item) {
+        if (shutdown_.load()) {
+            return false;
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t capacity = capacity_.load();
+        if (capacity > 0 && queue_.size() >= capacity) {
+            return false;
+        }
+        queue_.push(std::move(item));
+        condition_.notify_one();
+        return true;
+    }
+
+    void setCapacity(size_t capacity) { capacity_.store(capacity); }
+    size_t getCapacity() const { return capacity_.load(); }
+
     // Emplace an item to the queue
     template<typename... Args>
     void emplace(Args&&... args) {
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <algorithm>
+
+namespace FastFileSearch {
+namespace Utils {
+
+// Classic token bucket: refills at 'rate' tokens per second up to 'burst'.
+//
+// take() always succeeds and may leave the bucket in debt, returning how
+// long the caller should wait until the debt is repaid. That lets callers
+// charge work after doing it (a directory's entry count is only known once
+// it has been read) and still converge on the configured rate.
+//
+// Not thread-safe; callers serialize access.
+class TokenBucket {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    double rate_;       // Tokens per second, <= 0 means unlimited
+    double burst_;
+    double tokens_;
+    Clock::time_point last_;
+
+public:
+    explicit TokenBucket(double rate = 0.0, double burst = 0.0)
+        : rate_(0.0), burst_(0.0), tokens_(0.0), last_(Clock::now()) {
+        setRate(rate, burst);
+        tokens_ = burst_;
+    }
+
+    // burst <= 0 allows one second's worth
+    void setRate(double rate, double burst = 0.0) {
+        refill(Clock::now());
+        rate_ = rate;
+        burst_ = burst > 0.0 ? burst : std::max(1.0, rate);
+        tokens_ = std::min(tokens_, burst_);
+    }
+
+    double getRate() const { return rate_; }
+    bool isUnlimited() const { return rate_ <= 0.0; }
+
+    std::chrono::nanoseconds take(double tokens, Clock::time_point now = Clock::now()) {
+        if (isUnlimited()) {
+            return std::chrono::nanoseconds(0);
+        }
+        refill(now);
+        tokens_ -= tokens;
+        if (tokens_ >= 0.0) {
+            return std::chrono::nanoseconds(0);
+        }
+        return std::chrono::nanoseconds(static_cast<int64_t>(-tokens_ / rate_ * 1e9));
+    }
+
+private:
+    void refill(Clock::time_point now) {
+        if (now > last_ && rate_ > 0.0) {
+            double elapsed = std::chrono::duration<double>(now - last_).count();
+            tokens_ = std::min(burst_, tokens_ + elapsed * rate_);
+        }
+        last_ = now;
+    }
+};
+
+} // namespace Utils
+} // namespace FastFileSearch
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+namespace FastFileSearch {
+namespace Utils {
+
+// Double-ended queue owned by one worker. The owner pushes and pops at the
+// bottom (LIFO, keeps the working set depth-first and cache-warm); thieves
+// take from the top (FIFO, i.e. the oldest and usually largest subtrees).
+// The lock is per deque, so it is uncontended except while being stolen from.
+template<typename T>
+class WorkStealingDeque {
+private:
+    mutable std::mutex mutex_;
+    std::deque<T> items_;
+
+public:
+    WorkStealingDeque() = default;
+
+    // Non-copyable
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    void pushBottom(T&& item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        items_.push_back(std::move(item));
+    }
+
+    // Push a whole batch under a single lock acquisition
+    void pushBottomBatch(std::vector<T>& items) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& item : items) {
+            items_.push_back(std::move(item));
+        }
+    }
+
+    bool popBottom(T& item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (items_.empty()) {
+            return false;
+        }
+        item = std::move(items_.back());
+        items_.pop_back();
+        return true;
+    }
+
+    bool stealTop(T& item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (items_.empty()) {
+            return false;
+        }
+        item = std::move(items_.front());
+        items_.pop_front();
+        return true;
+    }
+
+    bool empty() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return items_.empty();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return items_.size();
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        items_.clear();
+    }
+};
+
+// Fixed set of per-worker deques with termination detection.
+//
+// Every pushed item must eventually be matched by one call to complete().
+// Because a worker pushes the children of an item before completing it, the
+// pending count only reaches zero once the whole tree has been processed, at
+// which point acquire() returns false in every worker.
+//
+// Items can be pushed into priority bands (0 = most urgent). Each band has its
+// own set of deques and acquire() drains a band, stealing if needed, before
+// looking at the next one, so urgent work never waits behind bulk work.
+template<typename T>
+class WorkStealingPool {
+private:
+    size_t numWorkers_;
+    size_t numBands_;
+    std::vector<std::unique_ptr<WorkStealingDeque<T>>> deques_;   // band * numWorkers_ + worker
+    std::unique_ptr<std::atomic<int64_t>[]> queuedPerBand_;        // Lets acquire() skip empty bands
+    std::atomic<uint64_t> pendingItems_;
+    std::atomic<bool> shutdown_;
+    std::atomic<size_t> nextExternal_;
+
+    // Idle workers park here instead of spinning
+    std::mutex idleMutex_;
+    std::condition_variable idleCondition_;
+    std::atomic<size_t> idleWorkers_;
+
+    // Statistics
+    std::atomic<uint64_t> steals_;
+    std::atomic<uint64_t> itemsPushed_;
+
+    static constexpr std::chrono::milliseconds IDLE_WAIT{5};
+
+public:
+    explicit WorkStealingPool(size_t numWorkers, size_t numBands = 1)
+        : numWorkers_(numWorkers > 0 ? numWorkers : 1), numBands_(numBands > 0 ? numBands : 1),
+          queuedPerBand_(new std::atomic<int64_t>[numBands_]),
+          pendingItems_(0), shutdown_(false), nextExternal_(0),
+          idleWorkers_(0), steals_(0), itemsPushed_(0) {
+        deques_.reserve(numWorkers_ * numBands_);
+        for (size_t i = 0; i < numWorkers_ * numBands_; ++i) {
+            deques_.push_back(std::make_unique<WorkStealingDeque<T>>());
+        }
+        for (size_t band = 0; band < numBands_; ++band) {
+            queuedPerBand_[band].store(0);
+        }
+    }
+
+    // Non-copyable
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t getWorkerCount() const { return numWorkers_; }
+    size_t getBandCount() const { return numBands_; }
+
+    // Owner push onto a worker's own deque
+    void push(size_t worker, T item, size_t band = 0) {
+        pendingItems_.fetch_add(1);
+        itemsPushed_.fetch_add(1, std::memory_order_relaxed);
+        enqueue(worker, band, std::move(item));
+        wakeIdleWorker();
+    }
+
+    // Owner push of all children of one item; items is left in a moved-from state
+    void pushBatch(size_t worker, std::vector<T>& items, size_t band = 0) {
+        if (items.empty()) {
+            return;
+        }
+        pendingItems_.fetch_add(items.size());
+        itemsPushed_.fetch_add(items.size(), std::memory_order_relaxed);
+        band = std::min(band, numBands_ - 1);
+        queuedPerBand_[band].fetch_add(static_cast<int64_t>(items.size()));
+        deque(worker, band).pushBottomBatch(items);
+        wakeIdleWorker(items.size() > 1);
+    }
+
+    // Hand an acquired item back without completing it (it stays pending);
+    // for workers that defer an item another worker should pick up
+    void requeue(size_t worker, T item, size_t band = 0) {
+        enqueue(worker, band, std::move(item));
+        wakeIdleWorker();
+    }
+
+    // Seeding from outside the pool; spreads items round-robin across workers
+    void pushExternal(T item, size_t band = 0) {
+        push(nextExternal_.fetch_add(1), std::move(item), band);
+    }
+
+    // Next item for worker from the most urgent non-empty band: own deque
+    // first, then steal. Blocks while other workers may still produce work;
+    // returns false once all work is complete or the pool has been shut down.
+    bool acquire(size_t worker, T& item) {
+        worker %= numWorkers_;
+
+        while (!shutdown_.load()) {
+            for (size_t band = 0; band < numBands_; ++band) {
+                if (queuedPerBand_[band].load(std::memory_order_relaxed) <= 0) {
+                    continue;
+                }
+                if (deque(worker, band).popBottom(item) || trySteal(worker, band, item)) {
+                    queuedPerBand_[band].fetch_sub(1);
+                    return true;
+                }
+            }
+
+            if (pendingItems_.load() == 0) {
+                return false;
+            }
+
+            std::unique_lock<std::mutex> lock(idleMutex_);
+            idleWorkers_.fetch_add(1);
+            idleCondition_.wait_for(lock, IDLE_WAIT, [this] {
+                return shutdown_.load() || pendingItems_.load() == 0;
+            });
+            idleWorkers_.fetch_sub(1);
+        }
+
+        return false;
+    }
+
+    // Mark one acquired item as fully processed (children already pushed)
+    void complete() {
+        if (pendingItems_.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(idleMutex_);
+            idleCondition_.notify_all();
+        }
+    }
+
+    void shutdown() {
+        shutdown_.store(true);
+        std::lock_guard<std::mutex> lock(idleMutex_);
+        idleCondition_.notify_all();
+    }
+
+    // Drop all queued items and make the pool reusable
+    void reset() {
+        for (auto& deque : deques_) {
+            deque->clear();
+        }
+        for (size_t band = 0; band < numBands_; ++band) {
+            queuedPerBand_[band].store(0);
+        }
+        pendingItems_.store(0);
+        shutdown_.store(false);
+        steals_.store(0);
+        itemsPushed_.store(0);
+    }
+
+    bool isShutdown() const { return shutdown_.load(); }
+    bool isDone() const { return pendingItems_.load() == 0; }
+    uint64_t getPendingCount() const { return pendingItems_.load(); }
+    uint64_t getStealCount() const { return steals_.load(); }
+    uint64_t getPushCount() const { return itemsPushed_.load(); }
+
+    // Items still queued in deques (excludes items currently being processed)
+    size_t getQueuedCount() const {
+        size_t total = 0;
+        for (const auto& deque : deques_) {
+            total += deque->size();
+        }
+        return total;
+    }
+
+    size_t getQueuedCount(size_t band) const {
+        int64_t queued = band < numBands_ ? queuedPerBand_[band].load() : 0;
+        return queued > 0 ? static_cast<size_t>(queued) : 0;
+    }
+
+private:
+    WorkStealingDeque<T>& deque(size_t worker, size_t band) {
+        return *deques_[band * numWorkers_ + worker % numWorkers_];
+    }
+
+    void enqueue(size_t worker, size_t band, T&& item) {
+        band = std::min(band, numBands_ - 1);
+        queuedPerBand_[band].fetch_add(1);
+        deque(worker, band).pushBottom(std::move(item));
+    }
+
+    bool trySteal(size_t thief, size_t band, T& item) {
+        for (size_t offset = 1; offset < numWorkers_; ++offset) {
+            if (deque(thief + offset, band).stealTop(item)) {
+                steals_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void wakeIdleWorker(bool all = false) {
+        if (idleWorkers_.load() == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(idleMutex_);
+        if (all) {
+            idleCondition_.notify_all();
+        } else {
+            idleCondition_.notify_one();
+        }
+    }
+};
+
+} // namespace Utils
+} // namespace FastFileSearch
@@ -0,0 +1,109 @@
+#include "core/tokenizer.h"
+#include <cstdint>
+
+namespace FastFileSearch {
+
+namespace {
+
+enum class CharClass : uint8_t {
+    Lower,
+    Upper,
+    Digit,
+    Other   // Non-ASCII byte, never a token boundary
+};
+
+CharClass classify(char c) {
+    if (c >= 'a' && c <= 'z') return CharClass::Lower;
+    if (c >= 'A' && c <= 'Z') return CharClass::Upper;
+    if (c >= '0' && c <= '9') return CharClass::Digit;
+    return CharClass::Other;
+}
+
+bool isLetter(CharClass cls) {
+    return cls == CharClass::Lower || cls == CharClass::Upper;
+}
+
+} // namespace
+
+void Tokenizer::tokenize(std::string_view name, std::string& normalized,
+                         std::vector<std::string_view>& tokens) {
+    tokenize(name, normalized, tokens, Options());
+}
+
+void Tokenizer::tokenize(std::string_view name, std::string& normalized,
+                         std::vector<std::string_view>& tokens, const Options& options) {
+    normalized.clear();
+    tokens.clear();
+
+    // The normalized form is never longer than the name, so reserving up
+    // front keeps the views taken below from being invalidated
+    normalized.reserve(name.size());
+
+    size_t wordStart = 0;      // Offsets into normalized
+    size_t partStart = 0;
+    bool inWord = false;
+    bool split = false;
+    CharClass previous = CharClass::Other;
+
+    auto emit = [&](size_t begin, size_t end) {
+        if (end > begin) {
+            tokens.emplace_back(normalized.data() + begin, end - begin);
+        }
+    };
+
+    auto endWord = [&]() {
+        emit(partStart, normalized.size());
+        if (split && options.keepCompounds) {
+            emit(wordStart, normalized.size());
+        }
+        inWord = false;
+    };
+
+    for (size_t i = 0; i < name.size(); ++i) {
+        char c = name[i];
+        if (!isWordByte(c)) {
+            if (inWord) {
+                endWord();
+            }
+            continue;
+        }
+
+        CharClass current = classify(c);
+
+        if (!inWord) {
+            if (!normalized.empty()) {
+                normalized += ' ';
+            }
+            wordStart = partStart = normalized.size();
+            inWord = true;
+            split = false;
+        } else {
+            bool boundary = false;
+            if (options.splitCamelCase) {
+                // "fooBar" -> foo|Bar, "HTMLParser" -> HTML|Parser
+                boundary = (previous == CharClass::Lower && current == CharClass::Upper) ||
+                           (previous == CharClass::Upper && current == CharClass::Upper &&
+                            i + 1 < name.size() && classify(name[i + 1]) == CharClass::Lower);
+            }
+            if (options.splitDigits && !boundary) {
+                boundary = (isLetter(previous) && current == CharClass::Digit) ||
+                           (previous == CharClass::Digit && isLetter(current));
+            }
+
+            if (boundary) {
+                emit(partStart, normalized.size());
+                partStart = normalized.size();
+                split = true;
+            }
+        }
+
+        normalized += toLower(c);
+        previous = current;
+    }
+
+    if (inWord) {
+        endWord();
+    }
+}
+
+} // namespace FastFileSearch
@@ -1,4 +1,5 @@
 #include "core/types.h"
+#include "core/tokenizer.h"
 #include <filesystem>
 #include <algorithm>
 #include <sstream>
@@ -59,6 +60,21 @@ FileEntry::FileEntry(const std::string& path) {
     }
 }
 
+FileEntry::FileEntry(const std::string& path, const std::string& name, FileType fileType,
+                     uint64_t fileSize, std::time_t modified)
+    : fullPath(path), fileName(name), size(fileSize),
+      lastModified(modified), lastAccessed(modified), type(fileType) {
+    
+    // Same rules as std::filesystem::path::extension(): dotfiles and "."/".."
+    // have no extension
+    size_t dot = fileName.rfind('.');
+    if (dot != std::string::npos && dot != 0 && fileName != "..") {
+        extension = fileName.substr(dot + 1);
+    }
+    
+    updateTokens();
+}
+
 std::string FileEntry::getDisplayName() const {
     if (fileName.empty()) {
         return fullPath;
@@ -67,38 +83,31 @@ std::string FileEntry::getDisplayName() const {
 }
 
 void FileEntry::updateTokens() {
-    tokens.clear();
-    normalizedName.clear();
+    // Token views are staged per thread so re-tokenizing entries during a
+    // scan reuses the same buffer; assigning into the existing token strings
+    // keeps their capacity (and short tokens stay in the SSO buffer)
+    thread_local std::vector<std::string_view> spans;
+    Tokenizer::tokenize(fileName, normalizedName, spans);
     
-    if (fileName.empty()) {
-        return;
+    tokens.resize(spans.size());
+    for (size_t i = 0; i < spans.size(); ++i) {
+        tokens[i].assign(spans[i].data(), spans[i].size());
     }
     
-    // Normalize the filename (lowercase, remove special characters)
-    normalizedName.reserve(fileName.length());
-    for (char c : fileName) {
-        if (std::isalnum(c)) {
-            normalizedName += std::tolower(c);
-        } else if (c == '.' || c == '_' || c == '-' || c == ' ') {
-            normalizedName += ' ';
-        }
-    }
-    
-    // Tokenize the normalized name
-    std::istringstream iss(normalizedName);
-    std::string token;
-    while (iss >> token) {
-        if (!token.empty()) {
-            tokens.push_back(token);
-        }
-    }
-    
-    // Add extension as a token if present
+    // The extension is normally the last word already; add it when it holds
+    // characters the tokenizer splits on (e.g. "c++")
     if (!extension.empty()) {
-        std::string extToken = extension;
-        std::transform(extToken.begin(), extToken.end(), extToken.begin(), ::tolower);
-        tokens.push_back(extToken);
+        bool covered = std::any_of(spans.begin(), spans.end(), [this](std::string_view token) {
+            return token.size() == extension.size() &&
+                   std::equal(token.begin(), token.end(), extension.begin(),
+                              [](char a, char b) { return a == Tokenizer::toLower(b); });
+        });
+        if (!covered) {
+            std::string& extToken = tokens.emplace_back(extension);
+            std::transform(extToken.begin(), extToken.end(), extToken.begin(), Tokenizer::toLower);
+        }
     }
+    spans.clear();
 }
 
 // SearchQuery implementation
@@ -136,6 +145,10 @@ std::string SearchQuery::toString() const {
         oss << ", FuzzyThreshold: " << std::fixed << std::setprecision(2) << fuzzyThreshold;
     }
     
+    if (!contentPattern.empty()) {
+        oss << ", Content: '" << contentPattern << "'" << (contentRegex ? " (regex)" : "");
+    }
+    
     return oss.str();
 }
 
@@ -256,6 +269,25 @@ void AppSettings::setDefaults() {
     maxMemoryUsage = 512; // MB
     enableCache = true;
     cacheSize = 100; // MB
+    enableIoUring = true;
+    checkpointInterval = 30;
+    deviceAwareScheduling = true;
+    prioritizeUserDirectories = true;
+    stayOnFilesystem = false;
+    shardedInitialBuild = false;
+    serveStaleIndexOnStartup = true;
+    rebuildCpuPercent = 25;
+    scanFilesPerSecond = 0;
+    scanSyscallsPerSecond = 0;
+    lowPriorityIndexing = true;
+    adaptiveThrottling = true;
+    duplicateDetection = false;
+    contentIndexing = false;
+    contentIndexExtensions = {"c", "cc", "cpp", "cxx", "h", "hh", "hpp", "hxx", "cs", "java", "kt", "go",
+                              "rs", "py", "rb", "js", "jsx", "ts", "tsx", "php", "swift", "m", "mm",
+                              "sh", "sql", "cmake", "txt", "md", "rst", "json", "yaml", "yml", "toml",
+                              "xml", "html", "css", "ini", "cfg", "conf"};
+    contentIndexMaxFileKB = 1024;
     
     // Database settings
     databasePath = "fastfilesearch.db";
@@ -284,6 +316,10 @@ bool AppSettings::validate() const {
         return false;
     }
     
+    if (rebuildCpuPercent == 0 || rebuildCpuPercent > 100) {
+        return false;
+    }
+    
     return true;
 }
 
@@ -294,6 +330,7 @@ void AppSettings::sanitize() {
     cacheSize = std::max(10u, std::min(maxMemoryUsage, cacheSize));
     fuzzyThreshold = std::max(0.0, std::min(1.0, fuzzyThreshold));
     maxSearchResults = std::max(1u, std::min(100000u, maxSearchResults));
+    rebuildCpuPercent = std::max(1u, std::min(100u, rebuildCpuPercent));
     
     // Remove empty strings from vectors
     auto removeEmpty = [](std::vector<std::string>& vec) {
@@ -305,6 +342,7 @@ void AppSettings::sanitize() {
     removeEmpty(includeDrives);
     removeEmpty(excludePaths);
     removeEmpty(excludeExtensions);
+    removeEmpty(contentIndexExtensions);
 }
 
 // RankingConfig implementation
@@ -342,6 +380,10 @@ void IndexStatistics::reset() {
     lastUpdate = 0;
     indexingProgress = 0.0;
     isIndexing = false;
+    itemsProcessed = 0;
+    itemsExpected = 0;
+    itemsPerSecond = 0.0;
+    etaSeconds = -1;
 }
 
 std::string IndexStatistics::toString() const {
@@ -353,6 +395,15 @@ std::string IndexStatistics::toString() const {
         << ", Progress: " << std::fixed << std::setprecision(1) 
         << (indexingProgress * 100) << "%"
         << ", Indexing: " << (isIndexing ? "Yes" : "No");
+    if (isIndexing) {
+        oss << ", Items: " << itemsProcessed;
+        if (itemsExpected > 0) {
+            oss << "/" << itemsExpected;
+        }
+        if (etaSeconds >= 0) {
+            oss << ", ETA: " << etaSeconds << "s";
+        }
+    }
     return oss.str();
 }
 
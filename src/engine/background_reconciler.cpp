@@ -0,0 +1,168 @@
+#include "engine/background_reconciler.h"
+#include "engine/scan_throttle.h"
+#include "core/logger.h"
+#include <algorithm>
+
+namespace FastFileSearch {
+namespace Engine {
+
+const char* indexFreshnessName(IndexFreshness freshness) {
+    switch (freshness) {
+        case IndexFreshness::Empty: return "empty";
+        case IndexFreshness::Stale: return "stale";
+        case IndexFreshness::Reconciling: return "reconciling";
+        case IndexFreshness::Current: return "current";
+        default: return "unknown";
+    }
+}
+
+BackgroundReconciler::BackgroundReconciler()
+    : shouldStop_(false), freshness_(IndexFreshness::Empty) {
+}
+
+BackgroundReconciler::~BackgroundReconciler() {
+    stop();
+}
+
+void BackgroundReconciler::markLoaded(std::time_t persistedAt) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    status_.persistedAt = persistedAt;
+    status_.freshness = IndexFreshness::Stale;
+    freshness_.store(IndexFreshness::Stale);
+}
+
+void BackgroundReconciler::markCurrent() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    status_.freshness = IndexFreshness::Current;
+    freshness_.store(IndexFreshness::Current);
+}
+
+void BackgroundReconciler::markEmpty() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    status_ = Status();
+    freshness_.store(IndexFreshness::Empty);
+}
+
+bool BackgroundReconciler::start(ReconcileTask task, CancelTask cancel, std::chrono::milliseconds delay) {
+    if (!task) {
+        return false;
+    }
+    stop();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reconcileTask_ = std::move(task);
+        cancelTask_ = std::move(cancel);
+        status_.attempts = 0;
+    }
+
+    shouldStop_.store(false);
+    try {
+        thread_ = std::thread(&BackgroundReconciler::run, this, delay);
+    } catch (const std::exception& e) {
+        LOG_ERROR_F("Failed to start background reconcile: {}", e.what());
+        return false;
+    }
+    return true;
+}
+
+void BackgroundReconciler::stop() {
+    shouldStop_.store(true);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cancelTask_) {
+            cancelTask_();
+        }
+    }
+    wakeCondition_.notify_all();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool BackgroundReconciler::isRunning() const {
+    return thread_.joinable() && !shouldStop_.load();
+}
+
+BackgroundReconciler::Status BackgroundReconciler::getStatus() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Status status = status_;
+    status.freshness = freshness_.load();
+    return status;
+}
+
+void BackgroundReconciler::run(std::chrono::milliseconds delay) {
+    lowerThreadPriority();
+
+    if (!sleepFor(delay)) {
+        return;
+    }
+
+    std::chrono::milliseconds retryDelay = FIRST_RETRY;
+    while (!shouldStop_.load()) {
+        ReconcileTask task;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            task = reconcileTask_;
+            status_.attempts++;
+            status_.reconcileStarted = std::time(nullptr);
+            if (freshness_.load() != IndexFreshness::Current) {
+                freshness_.store(IndexFreshness::Reconciling);
+            }
+        }
+
+        LOG_INFO("Reconciling the loaded index in the background; results may be stale until it finishes");
+        bool succeeded = false;
+        try {
+            // A stop() since the loop check has cancelled nothing yet
+            succeeded = !shouldStop_.load() && task();
+        } catch (const std::exception& e) {
+            LOG_ERROR_F("Background reconcile failed: {}", e.what());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            status_.reconcileFinished = std::time(nullptr);
+            status_.lastAttemptSucceeded = succeeded;
+            if (succeeded) {
+                freshness_.store(IndexFreshness::Current);
+            } else if (freshness_.load() == IndexFreshness::Reconciling) {
+                freshness_.store(IndexFreshness::Stale);
+            }
+        }
+
+        if (succeeded) {
+            LOG_INFO("Background reconcile finished, index is current");
+            return;
+        }
+        if (shouldStop_.load()) {
+            return;
+        }
+
+        LOG_WARNING_F("Background reconcile did not complete, retrying in {}s",
+                      std::chrono::duration_cast<std::chrono::seconds>(retryDelay).count());
+        if (!sleepFor(retryDelay)) {
+            return;
+        }
+        retryDelay = std::min<std::chrono::milliseconds>(retryDelay * 2, MAX_RETRY);
+    }
+}
+
+// Returns false if stop() was called while sleeping
+bool BackgroundReconciler::sleepFor(std::chrono::milliseconds duration) {
+    if (duration.count() <= 0) {
+        return !shouldStop_.load();
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    wakeCondition_.wait_for(lock, duration, [this]() { return shouldStop_.load(); });
+    return !shouldStop_.load();
+}
+
+void BackgroundReconciler::lowerThreadPriority() {
+    // Per thread, so the searching threads are left alone
+    ScanThrottle::lowerCurrentThreadPriority(BACKGROUND_NICE, true);
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,237 @@
+#include "engine/change_filter.h"
+#include "engine/file_access.h"
+#include <algorithm>
+#include <functional>
+#include <string_view>
+#include <unordered_set>
+
+#ifdef _WIN32
+#include <chrono>
+#include <filesystem>
+#endif
+
+namespace FastFileSearch {
+namespace Engine {
+
+ChangeFilter::ChangeFilter() : checked_(0), dropped_(0), unknown_(0) {
+}
+
+uint64_t ChangeFilter::hashPath(std::string_view path) {
+    return static_cast<uint64_t>(std::hash<std::string_view>{}(path));
+}
+
+// FNV-1a: unrelated to std::hash, so a collision there is not one here too
+uint64_t ChangeFilter::checkPath(std::string_view path) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : path) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t ChangeFilter::hashParent(const std::string& path) {
+    size_t pos = path.find_last_of("/\\");
+    if (pos == std::string::npos) {
+        return hashPath(std::string_view());
+    }
+    return hashPath(std::string_view(path).substr(0, pos == 0 ? 1 : pos));
+}
+
+bool ChangeFilter::capture(const std::string& path, FileFingerprint& fingerprint, bool* isDirectory) {
+#ifndef _WIN32
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0) {
+        return false;
+    }
+
+    fingerprint = fingerprintOf(st);
+    if (isDirectory) {
+        *isDirectory = S_ISDIR(st.st_mode);
+    }
+    return true;
+#else
+    std::error_code ec;
+    auto status = std::filesystem::symlink_status(path, ec);
+    if (ec || !std::filesystem::exists(status)) {
+        return false;
+    }
+
+    fingerprint = FileFingerprint();
+    if (std::filesystem::is_regular_file(status)) {
+        fingerprint.size = std::filesystem::file_size(path, ec);
+    }
+    if (isDirectory) {
+        *isDirectory = std::filesystem::is_directory(status);
+    }
+    auto modified = std::filesystem::last_write_time(path, ec);
+    if (!ec) {
+        fingerprint.modifiedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            modified.time_since_epoch()).count();
+    }
+    return true;
+#endif
+}
+
+void ChangeFilter::record(const FileEntry& entry) {
+    FileFingerprint fingerprint = entry.fingerprint();
+    if (!fingerprint.isEmpty()) {
+        record(entry.fullPath, fingerprint, entry.type == FileType::Directory);
+    }
+}
+
+void ChangeFilter::record(const std::vector<FileEntry>& entries) {
+    for (const auto& entry : entries) {
+        record(entry);
+    }
+}
+
+void ChangeFilter::record(const std::string& path, const FileFingerprint& fingerprint, bool isDirectory) {
+    uint64_t hash = hashPath(path);
+    Shard& shard = shardFor(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.fingerprints[hash] = Record{fingerprint, checkPath(path), hashParent(path), isDirectory};
+}
+
+void ChangeFilter::forget(const std::string& path) {
+    uint64_t hash = hashPath(path);
+    Shard& shard = shardFor(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.fingerprints.find(hash);
+    if (it != shard.fingerprints.end() && it->second.check == checkPath(path)) {
+        shard.fingerprints.erase(it);
+    }
+}
+
+void ChangeFilter::forgetSubtree(const std::string& path, bool isDirectory) {
+    uint64_t hash = hashPath(path);
+    {
+        Shard& shard = shardFor(hash);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.fingerprints.find(hash);
+        if (it != shard.fingerprints.end() && it->second.check == checkPath(path)) {
+            isDirectory = isDirectory || it->second.directory;
+            shard.fingerprints.erase(it);
+        }
+    }
+    if (!isDirectory) {
+        return;
+    }
+
+    // Only parent hashes are known, so the subtree is peeled one level per
+    // pass over all records. Directory renames and deletes are rare enough
+    // for that; files never get here.
+    std::unordered_set<uint64_t> parents{hash};
+    while (!parents.empty()) {
+        std::unordered_set<uint64_t> next;
+        for (auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (auto it = shard.fingerprints.begin(); it != shard.fingerprints.end();) {
+                if (parents.count(it->second.parent) == 0) {
+                    ++it;
+                    continue;
+                }
+                if (it->second.directory) {
+                    next.insert(it->first);
+                }
+                it = shard.fingerprints.erase(it);
+            }
+        }
+        parents.swap(next);
+    }
+}
+
+bool ChangeFilter::isUnchanged(const std::string& path) {
+    checked_.fetch_add(1, std::memory_order_relaxed);
+
+    FileFingerprint current;
+    bool directory = false;
+    if (!capture(path, current, &directory)) {
+        // Gone already; the delete event that follows will handle it
+        return false;
+    }
+
+    uint64_t hash = hashPath(path);
+    Shard& shard = shardFor(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    uint64_t check = checkPath(path);
+    auto it = shard.fingerprints.find(hash);
+    if (it == shard.fingerprints.end() || it->second.check != check) {
+        // Unknown, or another path with the same hash: this one takes the slot
+        unknown_.fetch_add(1, std::memory_order_relaxed);
+        shard.fingerprints[hash] = Record{current, check, hashParent(path), directory};
+        return false;
+    }
+
+    if (it->second.fingerprint == current) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    it->second.fingerprint = current;
+    it->second.directory = directory;
+    return false;
+}
+
+size_t ChangeFilter::filter(std::vector<FileChangeEvent>& events) {
+    size_t before = events.size();
+
+    auto end = std::remove_if(events.begin(), events.end(), [this](const FileChangeEvent& event) {
+        switch (event.type) {
+            case FileChangeType::Modified:
+                return isUnchanged(event.path);
+            case FileChangeType::Deleted:
+                forgetSubtree(event.path);
+                return false;
+            case FileChangeType::Renamed:
+            case FileChangeType::Moved:
+                if (!event.oldPath.empty()) {
+                    // The old directory itself may be unrecorded while its
+                    // children are; the new path says whether it was one
+                    FileFingerprint moved;
+                    bool directory = false;
+                    capture(event.path, moved, &directory);
+                    forgetSubtree(event.oldPath, directory);
+                }
+                return false;
+            default:
+                // Created: recorded by the caller once the entry is indexed
+                return false;
+        }
+    });
+    events.erase(end, events.end());
+
+    return before - events.size();
+}
+
+size_t ChangeFilter::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.fingerprints.size();
+    }
+    return total;
+}
+
+void ChangeFilter::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.fingerprints.clear();
+    }
+    checked_.store(0);
+    dropped_.store(0);
+    unknown_.store(0);
+}
+
+ChangeFilter::Statistics ChangeFilter::getStatistics() const {
+    Statistics stats;
+    stats.tracked = size();
+    stats.checked = checked_.load();
+    stats.dropped = dropped_.load();
+    stats.unknown = unknown_.load();
+    return stats;
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
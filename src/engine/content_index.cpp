@@ -0,0 +1,687 @@
+#include "engine/content_index.h"
+#include "engine/content_searcher.h"
+#include "engine/change_filter.h"
+#include "engine/file_access.h"
+#include "core/logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include <utility>
+
+namespace FastFileSearch {
+namespace Engine {
+
+namespace {
+
+unsigned char foldByte(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+}
+
+std::string lowercaseExtension(std::string_view extension) {
+    while (!extension.empty() && (extension.front() == '*' || extension.front() == '.')) {
+        extension.remove_prefix(1);
+    }
+    std::string lowered(extension);
+    for (auto& c : lowered) {
+        c = static_cast<char>(foldByte(static_cast<unsigned char>(c)));
+    }
+    return lowered;
+}
+
+// Appends the trigrams of [data, data + size) continuing from the two bytes
+// before it; 'window' holds those (folded) bytes and 'filled' how many are
+// valid since the last line break
+void appendTrigrams(const char* data, size_t size, uint32_t& window, int& filled, std::vector<uint32_t>& out) {
+    for (size_t i = 0; i < size; ++i) {
+        unsigned char c = foldByte(static_cast<unsigned char>(data[i]));
+        if (c == '\n') {
+            filled = 0;
+            continue;
+        }
+        window = ((window << 8) | c) & 0xFFFFFF;
+        if (filled < 2) {
+            ++filled;
+            continue;
+        }
+        out.push_back(window);
+    }
+}
+
+// Entries without nanosecond timestamps (loaded from the database rather
+// than built by a scanner) cannot show that the file is unchanged; a size
+// match alone would hide edits that kept the size
+bool isCurrent(const FileFingerprint& indexed, const FileEntry& entry) {
+    return entry.modifiedNs != 0 && indexed == entry.fingerprint();
+}
+
+} // namespace
+
+ContentIndex::ContentIndex(const ContentIndexOptions& options)
+    : ready_(false), cancelled_(false),
+      filesIndexed_(0), binarySkipped_(0), bytesRead_(0), errors_(0), queries_(0), queriesNarrowed_(0) {
+    setOptions(options);
+}
+
+void ContentIndex::setOptions(const ContentIndexOptions& options) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    options_ = options;
+    extensions_.clear();
+    for (const auto& extension : options_.extensions) {
+        std::string lowered = lowercaseExtension(extension);
+        if (!lowered.empty()) {
+            extensions_.insert(std::move(lowered));
+        }
+    }
+}
+
+bool ContentIndex::covers(const FileEntry& entry) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return coversLocked(entry);
+}
+
+bool ContentIndex::coversLocked(const FileEntry& entry) const {
+    if (!entry.isFile()) {
+        return false;
+    }
+    if (options_.maxFileSize > 0 && entry.size > options_.maxFileSize) {
+        return false;
+    }
+    return extensions_.empty() || extensions_.count(lowercaseExtension(entry.extension)) > 0;
+}
+
+bool ContentIndex::synchronize(const std::vector<FileEntry>& files) {
+    auto started = std::chrono::steady_clock::now();
+    cancelled_.store(false);
+
+    // Files to (re)read and documents whose file is gone
+    std::vector<const FileEntry*> work;
+    std::vector<std::pair<const FileEntry*, FileFingerprint>> unverified;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        std::unordered_set<std::string_view> present;
+        present.reserve(files.size());
+        for (const auto& entry : files) {
+            if (!coversLocked(entry)) {
+                continue;
+            }
+            present.insert(entry.fullPath);
+            auto it = byPath_.find(entry.fullPath);
+            if (it == byPath_.end()) {
+                work.push_back(&entry);
+            } else if (entry.modifiedNs == 0) {
+                unverified.emplace_back(&entry, documents_[it->second].fingerprint);
+            } else if (!isCurrent(documents_[it->second].fingerprint, entry)) {
+                work.push_back(&entry);
+            }
+        }
+
+        std::vector<uint32_t> gone;
+        for (const auto& [path, id] : byPath_) {
+            if (present.find(path) == present.end()) {
+                gone.push_back(id);
+            }
+        }
+        for (uint32_t id : gone) {
+            killDocumentLocked(id);
+        }
+    }
+
+    // Entries without a fingerprint: one lstat() each, outside the lock,
+    // instead of re-reading every file
+    for (const auto& [entry, indexed] : unverified) {
+        FileFingerprint current;
+        if (!ChangeFilter::capture(entry->fullPath, current) || !(current == indexed)) {
+            work.push_back(entry);
+        }
+    }
+
+    std::atomic<size_t> next(0);
+    size_t numThreads = std::clamp<size_t>(options_.threads, 1, std::max<size_t>(1, work.size()));
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads);
+    for (size_t t = 0; t < numThreads && !work.empty(); ++t) {
+        // Fresh threads, so lowering their priority never sticks to the caller
+        threads.emplace_back([this, &work, &next]() {
+            if (options_.lowerPriority) {
+                ScanThrottle::lowerCurrentThreadPriority(ScanThrottleOptions().backgroundNice, true);
+            }
+            std::vector<char> buffer(std::max<size_t>(options_.readBufferSize, 64 * 1024));
+            std::vector<uint32_t> trigrams;
+            for (size_t index = next.fetch_add(1); index < work.size() && !cancelled_.load();
+                 index = next.fetch_add(1)) {
+                const FileEntry& entry = *work[index];
+                FileFingerprint fingerprint;
+                bool binary = false;
+                uint64_t before = bytesRead_.load(std::memory_order_relaxed);
+                if (extractTrigrams(entry.fullPath, buffer, trigrams, fingerprint, binary)) {
+                    std::unique_lock<std::shared_mutex> lock(mutex_);
+                    addDocumentLocked(entry.fullPath, fingerprint, trigrams, false);
+                } else if (binary) {
+                    // Recorded so it is not read again until it changes
+                    std::unique_lock<std::shared_mutex> lock(mutex_);
+                    addDocumentLocked(entry.fullPath, fingerprint, {}, true);
+                }
+
+                if (throttle_) {
+                    // open, fstat, close plus the reads
+                    uint64_t read = bytesRead_.load(std::memory_order_relaxed) - before;
+                    throttle_->admit(1, 4 + read / buffer.size(), cancelled_);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    size_t documentCount = 0;
+    size_t trigramCount = 0;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        compactIfNeededLocked();
+        documentCount = byPath_.size();
+        trigramCount = postings_.size();
+    }
+
+    if (cancelled_.load()) {
+        LOG_INFO("Content indexing cancelled");
+        return false;
+    }
+
+    ready_.store(true);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    LOG_INFO_F("Content index synchronized: {} files read, {} documents, {} trigrams in {}s",
+               work.size(), documentCount, trigramCount, seconds);
+    return true;
+}
+
+bool ContentIndex::updateFile(const FileEntry& entry) {
+    if (!covers(entry)) {
+        removeFile(entry.fullPath);
+        return true;
+    }
+
+    std::vector<char> buffer(std::max<size_t>(options_.readBufferSize, 64 * 1024));
+    std::vector<uint32_t> trigrams;
+    FileFingerprint fingerprint;
+    bool binary = false;
+    if (!extractTrigrams(entry.fullPath, buffer, trigrams, fingerprint, binary)) {
+        if (!binary) {
+            removeFile(entry.fullPath);
+            return false;
+        }
+        trigrams.clear();
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    addDocumentLocked(entry.fullPath, fingerprint, trigrams, binary);
+    compactIfNeededLocked();
+    return true;
+}
+
+void ContentIndex::removeFile(const std::string& path) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = byPath_.find(path);
+    if (it != byPath_.end()) {
+        killDocumentLocked(it->second);
+        compactIfNeededLocked();
+    }
+}
+
+void ContentIndex::renameFile(const std::string& oldPath, const std::string& newPath) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = byPath_.find(oldPath);
+    if (it == byPath_.end()) {
+        return;
+    }
+    uint32_t id = it->second;
+
+    // Same contents under a new name, unless the new name is not covered
+    std::string extension = std::filesystem::path(newPath).extension().string();
+    if (!extensions_.empty() && extensions_.count(lowercaseExtension(extension)) == 0) {
+        killDocumentLocked(id);
+        return;
+    }
+
+    byPath_.erase(it);
+    auto existing = byPath_.find(newPath);
+    if (existing != byPath_.end()) {
+        killDocumentLocked(existing->second);
+    }
+    documents_[id].path = newPath;
+    byPath_[newPath] = id;
+    dirtyDocuments_[id] = saveGeneration_;
+}
+
+void ContentIndex::renameDirectory(const std::string& oldPath, const std::string& newPath) {
+    std::string oldPrefix = oldPath;
+    if (oldPrefix.empty() || oldPrefix.back() != '/') {
+        oldPrefix += '/';
+    }
+    std::string newPrefix = newPath;
+    if (newPrefix.empty() || newPrefix.back() != '/') {
+        newPrefix += '/';
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    // Collect first: byPath_ is rewritten below
+    std::vector<uint32_t> moved;
+    for (const auto& [path, id] : byPath_) {
+        if (path.compare(0, oldPrefix.size(), oldPrefix) == 0) {
+            moved.push_back(id);
+        }
+    }
+    for (uint32_t id : moved) {
+        byPath_.erase(documents_[id].path);
+    }
+    for (uint32_t id : moved) {
+        Document& document = documents_[id];
+        document.path = newPrefix + document.path.substr(oldPrefix.size());
+        auto existing = byPath_.find(document.path);
+        if (existing != byPath_.end()) {
+            killDocumentLocked(existing->second);
+        }
+        byPath_[document.path] = id;
+        dirtyDocuments_[id] = saveGeneration_;
+    }
+}
+
+std::vector<FileEntry> ContentIndex::filterCandidates(const std::vector<FileEntry>& files,
+                                                      const std::string& pattern, bool regex) const {
+    queries_.fetch_add(1, std::memory_order_relaxed);
+    if (!ready_.load()) {
+        return files;
+    }
+
+    std::string literal = regex ? ContentSearcher::requiredLiteral(pattern) : pattern;
+    std::vector<uint32_t> trigrams = trigramsOf(literal);
+    if (trigrams.empty() || literal.find('\n') != std::string::npos) {
+        return files;
+    }
+    queriesNarrowed_.fetch_add(1, std::memory_order_relaxed);
+
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    std::vector<uint32_t> matching = intersectLocked(trigrams);
+
+    std::vector<FileEntry> candidates;
+    for (const auto& entry : files) {
+        if (!coversLocked(entry)) {
+            candidates.push_back(entry);
+            continue;
+        }
+        auto it = byPath_.find(entry.fullPath);
+        if (it == byPath_.end()) {
+            candidates.push_back(entry);
+            continue;
+        }
+        const Document& document = documents_[it->second];
+        if (document.binary || !isCurrent(document.fingerprint, entry)) {
+            candidates.push_back(entry);
+            continue;
+        }
+        if (std::binary_search(matching.begin(), matching.end(), it->second)) {
+            candidates.push_back(entry);
+        }
+    }
+    return candidates;
+}
+
+std::vector<uint32_t> ContentIndex::intersectLocked(const std::vector<uint32_t>& trigrams) const {
+    std::vector<const std::vector<uint32_t>*> lists;
+    lists.reserve(trigrams.size());
+    for (uint32_t trigram : trigrams) {
+        auto it = postings_.find(trigram);
+        if (it == postings_.end()) {
+            return {};
+        }
+        lists.push_back(&it->second.documents);
+    }
+
+    // Shortest list first; every later list only has to be probed for its
+    // survivors
+    std::sort(lists.begin(), lists.end(),
+              [](const auto* a, const auto* b) { return a->size() < b->size(); });
+
+    std::vector<uint32_t> result;
+    result.reserve(lists.front()->size());
+    for (uint32_t id : *lists.front()) {
+        if (documents_[id].live) {
+            result.push_back(id);
+        }
+    }
+
+    for (size_t l = 1; l < lists.size() && !result.empty(); ++l) {
+        const auto& list = *lists[l];
+        auto cursor = list.begin();
+        size_t kept = 0;
+        for (uint32_t id : result) {
+            cursor = std::lower_bound(cursor, list.end(), id);
+            if (cursor == list.end()) {
+                break;
+            }
+            if (*cursor == id) {
+                result[kept++] = id;
+            }
+        }
+        result.resize(kept);
+    }
+    return result;
+}
+
+void ContentIndex::addDocumentLocked(const std::string& path, const FileFingerprint& fingerprint,
+                                     const std::vector<uint32_t>& trigrams, bool binary) {
+    auto it = byPath_.find(path);
+    if (it != byPath_.end()) {
+        killDocumentLocked(it->second);
+    }
+
+    // Ids only grow, so appending keeps every postings list sorted
+    uint32_t id = static_cast<uint32_t>(documents_.size());
+    documents_.push_back({path, fingerprint, true, binary});
+    byPath_[path] = id;
+    dirtyDocuments_[id] = saveGeneration_;
+
+    for (uint32_t trigram : trigrams) {
+        postings_[trigram].documents.push_back(id);
+        dirtyTrigrams_[trigram] = saveGeneration_;
+    }
+}
+
+void ContentIndex::killDocumentLocked(uint32_t id) {
+    Document& document = documents_[id];
+    if (!document.live) {
+        return;
+    }
+    byPath_.erase(document.path);
+    document.live = false;
+    document.path.clear();
+    document.path.shrink_to_fit();
+    deadCount_++;
+    dirtyDocuments_[id] = saveGeneration_;
+}
+
+void ContentIndex::compactIfNeededLocked() {
+    if (deadCount_ > 0 && deadCount_ >= options_.compactRatio * static_cast<double>(documents_.size())) {
+        compactLocked();
+    }
+}
+
+void ContentIndex::compactLocked() {
+    uint64_t before = 0;
+    uint64_t after = 0;
+    for (auto it = postings_.begin(); it != postings_.end();) {
+        auto& list = it->second.documents;
+        before += list.size();
+        list.erase(std::remove_if(list.begin(), list.end(),
+                                  [this](uint32_t id) { return !documents_[id].live; }),
+                   list.end());
+        after += list.size();
+        if (list.empty()) {
+            it = postings_.erase(it);
+        } else {
+            list.shrink_to_fit();
+            ++it;
+        }
+    }
+
+    LOG_DEBUG_F("Content index compacted: {} dead documents, {} of {} postings dropped",
+                deadCount_, before - after, before);
+    deadCount_ = 0;
+
+    // Every list may have changed; the next save rewrites the index. Dead
+    // ids are never reused, so documents_ keeps its slots.
+    dirtyTrigrams_.clear();
+    dirtyDocuments_.clear();
+    rewritePending_ = true;
+    rewriteGeneration_ = saveGeneration_;
+}
+
+void ContentIndex::load(std::vector<Storage::ContentIndexDocument> documents,
+                        std::vector<Storage::ContentIndexPostings> postings) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    documents_.clear();
+    byPath_.clear();
+    postings_.clear();
+    dirtyDocuments_.clear();
+    dirtyTrigrams_.clear();
+    rewritePending_ = false;
+
+    uint32_t maxId = 0;
+    for (const auto& document : documents) {
+        maxId = std::max(maxId, document.id + 1);
+    }
+    for (const auto& entry : postings) {
+        if (!entry.documents.empty()) {
+            maxId = std::max(maxId, entry.documents.back() + 1);
+        }
+    }
+
+    // Ids without a document row died after the last compaction
+    documents_.resize(maxId);
+    for (auto& document : documents) {
+        Document& slot = documents_[document.id];
+        slot.path = std::move(document.path);
+        slot.fingerprint = document.fingerprint;
+        slot.binary = document.binary;
+        slot.live = true;
+        byPath_[slot.path] = document.id;
+    }
+    deadCount_ = documents_.size() - byPath_.size();
+
+    postings_.reserve(postings.size());
+    for (auto& entry : postings) {
+        PostingList& list = postings_[entry.trigram];
+        list.documents = std::move(entry.documents);
+        list.stored = static_cast<uint32_t>(list.documents.size());
+    }
+
+    ready_.store(!byPath_.empty());
+    LOG_INFO_F("Content index loaded: {} documents, {} trigrams", byPath_.size(), postings_.size());
+}
+
+bool ContentIndex::save(Storage::ContentIndexStore& store) {
+    std::lock_guard<std::mutex> saveLock(saveMutex_);
+    uint64_t generation = 0;
+    Storage::ContentIndexChanges changes = takeChanges(generation);
+    if (!changes.empty() && !store.saveChanges(changes)) {
+        LOG_WARNING("Content index changes not saved; they stay pending for the next save");
+        return false;
+    }
+    changesSaved(changes, generation);
+    return true;
+}
+
+// Reads the pending changes without clearing them; changesSaved() does that
+// once they are committed
+Storage::ContentIndexChanges ContentIndex::takeChanges(uint64_t& generation) {
+    Storage::ContentIndexChanges changes;
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    // Everything dirtied from here on belongs to the next save
+    generation = saveGeneration_++;
+
+    changes.replaceAll = rewritePending_;
+    if (changes.replaceAll) {
+        for (uint32_t id = 0; id < documents_.size(); ++id) {
+            if (documents_[id].live) {
+                changes.documents.push_back({id, documents_[id].path, documents_[id].fingerprint,
+                                             documents_[id].binary});
+            }
+        }
+        for (const auto& [trigram, list] : postings_) {
+            changes.postings.push_back({trigram, list.documents});
+        }
+    } else {
+        for (const auto& [id, dirtied] : dirtyDocuments_) {
+            const Document& document = documents_[id];
+            if (document.live) {
+                changes.documents.push_back({id, document.path, document.fingerprint, document.binary});
+            } else {
+                changes.removedDocuments.push_back(id);
+            }
+        }
+        for (const auto& [trigram, dirtied] : dirtyTrigrams_) {
+            // Lists only grow between compactions, so only the ids past
+            // the stored ones are written
+            auto it = postings_.find(trigram);
+            if (it == postings_.end()) {
+                changes.removedTrigrams.push_back(trigram);
+                continue;
+            }
+            const PostingList& list = it->second;
+            if (list.stored >= list.documents.size()) {
+                continue;
+            }
+            Storage::ContentIndexAppend append;
+            append.trigram = trigram;
+            append.stored = list.stored;
+            append.previous = list.stored > 0 ? list.documents[list.stored - 1] : 0;
+            append.documents.assign(list.documents.begin() + list.stored, list.documents.end());
+            changes.appended.push_back(std::move(append));
+        }
+    }
+    return changes;
+}
+
+void ContentIndex::changesSaved(const Storage::ContentIndexChanges& changes, uint64_t generation) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    // Only lengths as of takeChanges(); ids appended since stay unstored
+    auto markStored = [this](uint32_t trigram, size_t stored) {
+        auto it = postings_.find(trigram);
+        if (it != postings_.end()) {
+            it->second.stored = static_cast<uint32_t>(std::min(stored, it->second.documents.size()));
+        }
+    };
+    if (changes.replaceAll) {
+        for (auto& [trigram, list] : postings_) {
+            list.stored = 0;
+        }
+    }
+    for (const auto& postings : changes.postings) {
+        markStored(postings.trigram, postings.documents.size());
+    }
+    for (const auto& append : changes.appended) {
+        markStored(append.trigram, append.stored + append.documents.size());
+    }
+
+    auto dropSaved = [generation](std::unordered_map<uint32_t, uint64_t>& dirty) {
+        for (auto it = dirty.begin(); it != dirty.end();) {
+            it = it->second <= generation ? dirty.erase(it) : std::next(it);
+        }
+    };
+    dropSaved(dirtyDocuments_);
+    dropSaved(dirtyTrigrams_);
+    if (rewritePending_ && rewriteGeneration_ <= generation) {
+        rewritePending_ = false;
+    }
+}
+
+ContentIndex::Statistics ContentIndex::getStatistics() const {
+    Statistics stats;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        stats.documents = byPath_.size();
+        stats.deadDocuments = deadCount_;
+        stats.trigrams = postings_.size();
+        for (const auto& [trigram, list] : postings_) {
+            stats.postings += list.documents.size();
+        }
+    }
+    stats.filesIndexed = filesIndexed_.load();
+    stats.binarySkipped = binarySkipped_.load();
+    stats.bytesRead = bytesRead_.load();
+    stats.errors = errors_.load();
+    stats.queries = queries_.load();
+    stats.queriesNarrowed = queriesNarrowed_.load();
+    return stats;
+}
+
+void ContentIndex::clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    documents_.clear();
+    byPath_.clear();
+    postings_.clear();
+    deadCount_ = 0;
+    dirtyDocuments_.clear();
+    dirtyTrigrams_.clear();
+    rewritePending_ = true;
+    rewriteGeneration_ = saveGeneration_;
+    ready_.store(false);
+}
+
+bool ContentIndex::extractTrigrams(const std::string& path, std::vector<char>& buffer,
+                                   std::vector<uint32_t>& trigrams, FileFingerprint& fingerprint,
+                                   bool& binary) {
+    trigrams.clear();
+    binary = false;
+    if (buffer.empty()) {
+        buffer.resize(options_.readBufferSize);
+    }
+
+    uint32_t window = 0;
+    int filled = 0;
+    bool first = true;
+    uint64_t total = 0;
+
+    SequentialFile file;
+    if (!file.open(path)) {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    fingerprint = file.fingerprint();
+    file.adviseSequential(true);
+
+    bool ok = true;
+    for (;;) {
+        long n = file.read(buffer.data(), buffer.size());
+        if (n < 0) {
+            ok = false;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        size_t size = static_cast<size_t>(n);
+        total += size;
+        if (first) {
+            first = false;
+            if (std::memchr(buffer.data(), 0, std::min(size, BINARY_PROBE_BYTES)) != nullptr) {
+                binary = true;
+                break;
+            }
+        }
+        appendTrigrams(buffer.data(), size, window, filled, trigrams);
+    }
+    file.close();
+
+    bytesRead_.fetch_add(total, std::memory_order_relaxed);
+    if (!ok) {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        trigrams.clear();
+        return false;
+    }
+    if (binary) {
+        binarySkipped_.fetch_add(1, std::memory_order_relaxed);
+        trigrams.clear();
+        return false;
+    }
+
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    filesIndexed_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+std::vector<uint32_t> ContentIndex::trigramsOf(const std::string& literal) {
+    std::vector<uint32_t> trigrams;
+    uint32_t window = 0;
+    int filled = 0;
+    appendTrigrams(literal.data(), literal.size(), window, filled, trigrams);
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,482 @@
+#include "engine/content_searcher.h"
+#include "engine/file_access.h"
+#include "core/logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string_view>
+#include <thread>
+
+namespace FastFileSearch {
+namespace Engine {
+
+ContentSearcher::ContentSearcher(const ContentSearchOptions& options)
+    : options_(options), stop_(false),
+      filesSearched_(0), filesMatched_(0), binarySkipped_(0), tooLargeSkipped_(0),
+      longLinesSkipped_(0), errors_(0), bytesRead_(0), matches_(0) {
+    if (options_.pattern.empty()) {
+        error_ = "Empty pattern";
+        return;
+    }
+
+    if (!options_.regex) {
+        literal_.emplace(options_.pattern, options_.caseSensitive);
+        return;
+    }
+
+    try {
+        auto flags = std::regex_constants::ECMAScript | std::regex_constants::optimize;
+        if (!options_.caseSensitive) {
+            flags |= std::regex_constants::icase;
+        }
+        regex_.emplace(options_.pattern, flags);
+    } catch (const std::regex_error& e) {
+        error_ = e.what();
+        return;
+    }
+
+    std::string required = requiredLiteral(options_.pattern);
+    if (!required.empty()) {
+        literal_.emplace(required, options_.caseSensitive);
+    }
+}
+
+ContentSearcher::Statistics ContentSearcher::search(const std::vector<FileEntry>& files,
+                                                    const MatchCallback& callback) {
+    Statistics stats;
+    if (!isValid()) {
+        LOG_WARNING_F("Content search pattern rejected: {}", error_);
+        return stats;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    stop_.store(false);
+    filesSearched_.store(0);
+    filesMatched_.store(0);
+    binarySkipped_.store(0);
+    tooLargeSkipped_.store(0);
+    longLinesSkipped_.store(0);
+    errors_.store(0);
+    bytesRead_.store(0);
+    matches_.store(0);
+
+    size_t numThreads = options_.threads > 0 ? options_.threads
+                                             : std::max(1u, std::thread::hardware_concurrency());
+    numThreads = std::clamp<size_t>(numThreads, 1, std::max<size_t>(1, files.size()));
+
+    std::atomic<size_t> next(0);
+    auto worker = [this, &files, &next, &callback]() {
+        std::vector<char> buffer(std::max<size_t>(options_.readBufferSize, 64 * 1024));
+        for (size_t index = next.fetch_add(1); index < files.size() && !stop_.load();
+             index = next.fetch_add(1)) {
+            const FileEntry& entry = files[index];
+            if (entry.isFile()) {
+                searchFile(entry, buffer, callback);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads);
+    for (size_t t = 0; t < numThreads; ++t) {
+        threads.emplace_back(worker);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    stats.filesSearched = filesSearched_.load();
+    stats.filesMatched = filesMatched_.load();
+    stats.binarySkipped = binarySkipped_.load();
+    stats.tooLargeSkipped = tooLargeSkipped_.load();
+    stats.longLinesSkipped = longLinesSkipped_.load();
+    stats.errors = errors_.load();
+    stats.bytesRead = bytesRead_.load();
+    stats.matches = matches_.load();
+    stats.truncated = stop_.load();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    LOG_DEBUG_F("Content search: {} matches in {} of {} files, {} MB in {}s",
+                stats.matches, stats.filesMatched, stats.filesSearched,
+                stats.bytesRead / (1024 * 1024), stats.seconds);
+    return stats;
+}
+
+std::vector<ContentMatch> ContentSearcher::search(const std::vector<FileEntry>& files) {
+    std::vector<ContentMatch> matches;
+    search(files, [&matches](const ContentMatch& match) {
+        matches.push_back(match);
+        return true;
+    });
+    return matches;
+}
+
+void ContentSearcher::searchFile(const FileEntry& entry, std::vector<char>& buffer,
+                                 const MatchCallback& callback) {
+    if (options_.maxFileSize > 0 && entry.size > options_.maxFileSize) {
+        tooLargeSkipped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    SequentialFile file;
+    if (!file.open(entry.fullPath)) {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // Matches are likely to be opened next, so their pages stay cached
+    file.adviseSequential(false);
+
+    size_t carry = 0;
+    uint64_t lineNumber = 1;
+    uint32_t fileMatches = 0;
+    bool first = true;
+    bool searched = false;
+
+    while (!stop_.load()) {
+        long n = file.read(buffer.data() + carry, buffer.size() - carry);
+        if (n < 0) {
+            errors_.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        bytesRead_.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+
+        size_t filled = carry + static_cast<size_t>(n);
+        bool eof = n == 0;
+
+        if (first) {
+            first = false;
+            if (options_.skipBinary &&
+                std::memchr(buffer.data(), 0, std::min(filled, BINARY_PROBE_BYTES)) != nullptr) {
+                binarySkipped_.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            searched = true;
+        }
+
+        // Only complete lines; a line longer than the buffer is searched in
+        // pieces
+        size_t complete = filled;
+        if (!eof) {
+            size_t lastBreak = filled;
+            while (lastBreak > 0 && buffer[lastBreak - 1] != '\n') {
+                --lastBreak;
+            }
+            if (lastBreak > 0) {
+                complete = lastBreak;
+            } else if (filled < buffer.size()) {
+                carry = filled;
+                continue;
+            }
+        }
+
+        fileMatches += searchLines(entry.fullPath, buffer.data(), complete, lineNumber, fileMatches, callback);
+        if (eof || (options_.maxMatchesPerFile > 0 && fileMatches >= options_.maxMatchesPerFile)) {
+            break;
+        }
+
+        carry = filled - complete;
+        std::memmove(buffer.data(), buffer.data() + complete, carry);
+    }
+
+    file.close();
+
+    if (searched) {
+        filesSearched_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (fileMatches > 0) {
+        filesMatched_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+uint32_t ContentSearcher::searchLines(const std::string& path, const char* data, size_t size,
+                                      uint64_t& lineNumber, uint32_t matchesSoFar,
+                                      const MatchCallback& callback) {
+    const char* end = data + size;
+    const char* counted = data;     // lineNumber is the number of the line starting here
+    uint32_t emitted = 0;
+    auto limitReached = [this, &emitted, matchesSoFar]() {
+        return options_.maxMatchesPerFile > 0 && matchesSoFar + emitted >= options_.maxMatchesPerFile;
+    };
+
+    if (literal_) {
+        size_t from = 0;
+        while (from < size && !stop_.load() && !limitReached()) {
+            size_t pos = literal_->find(data, size, from);
+            if (pos == Utils::LiteralFinder::npos) {
+                break;
+            }
+
+            const char* hit = data + pos;
+            const char* lineStart = hit;
+            while (lineStart > counted && lineStart[-1] != '\n') {
+                --lineStart;
+            }
+            const char* lineEnd = static_cast<const char*>(std::memchr(hit, '\n', end - hit));
+            if (!lineEnd) {
+                lineEnd = end;
+            }
+
+            lineNumber += std::count(counted, lineStart, '\n');
+            counted = lineStart;
+
+            size_t column = hit - lineStart;
+            if (!regex_ || lineMatches(lineStart, lineEnd, hit, column)) {
+                if (!emit(path, lineNumber, column, lineStart, lineEnd, callback)) {
+                    break;
+                }
+                emitted++;
+            }
+            from = static_cast<size_t>(lineEnd - data) + 1;
+        }
+    } else {
+        // Regex without a required literal: every line goes through it
+        const char* lineStart = data;
+        while (lineStart < end && !stop_.load() && !limitReached()) {
+            const char* lineEnd = static_cast<const char*>(std::memchr(lineStart, '\n', end - lineStart));
+            if (!lineEnd) {
+                lineEnd = end;
+            }
+            lineNumber += std::count(counted, lineStart, '\n');
+            counted = lineStart;
+
+            size_t column = 0;
+            if (lineMatches(lineStart, lineEnd, nullptr, column)) {
+                if (!emit(path, lineNumber, column, lineStart, lineEnd, callback)) {
+                    break;
+                }
+                emitted++;
+            }
+            lineStart = lineEnd + 1;
+        }
+    }
+
+    lineNumber += std::count(counted, end, '\n');
+    return emitted;
+}
+
+bool ContentSearcher::lineMatches(const char* begin, const char* end, const char* hit, size_t& column) {
+    if (!regex_) {
+        size_t pos = literal_->find(begin, static_cast<size_t>(end - begin));
+        if (pos == Utils::LiteralFinder::npos) {
+            return false;
+        }
+        column = pos;
+        return true;
+    }
+
+    // So that '$' matches at the end of CRLF lines
+    if (end > begin && end[-1] == '\r') {
+        --end;
+    }
+
+    const char* from = begin;
+    const char* to = end;
+    auto flags = std::regex_constants::match_default;
+    size_t limit = std::max<size_t>(options_.maxRegexLineLength, 1);
+    bool cut = static_cast<size_t>(end - begin) > limit;
+    if (cut) {
+        if (!hit) {
+            longLinesSkipped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        // Every match contains the literal, so search the bytes around it;
+        // at a cut edge '^', '$' and '\b' see the middle of the line
+        from = hit - std::min<size_t>(static_cast<size_t>(hit - begin), limit / 2);
+        to = from + std::min<size_t>(static_cast<size_t>(end - from), limit);
+        if (from > begin) {
+            flags |= std::regex_constants::match_prev_avail;
+        }
+        if (to < end) {
+            flags |= std::regex_constants::match_not_eol | std::regex_constants::match_not_eow;
+        }
+    }
+
+    std::cmatch match;
+    if (!std::regex_search(from, to, match, *regex_, flags)) {
+        if (cut) {
+            longLinesSkipped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return false;
+    }
+    column = static_cast<size_t>(from - begin) + static_cast<size_t>(match.position(0));
+    return true;
+}
+
+bool ContentSearcher::emit(const std::string& path, uint64_t lineNumber, size_t column,
+                           const char* begin, const char* end, const MatchCallback& callback) {
+    ContentMatch match;
+    match.path = path;
+    match.lineNumber = lineNumber;
+    match.column = static_cast<uint32_t>(column);
+    if (end > begin && end[-1] == '\r') {
+        --end;
+    }
+    match.line.assign(begin, std::min<size_t>(static_cast<size_t>(end - begin), options_.maxLineLength));
+
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    if (stop_.load()) {
+        return false;
+    }
+    // One match past the limit tells the caller the results were truncated
+    if (options_.maxResults > 0 && matches_.load() >= options_.maxResults) {
+        stop_.store(true);
+        return false;
+    }
+    matches_.fetch_add(1);
+    if (!callback(match)) {
+        stop_.store(true);
+        return false;
+    }
+    return true;
+}
+
+namespace {
+
+constexpr bool isHexDigit(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+// Characters after the letter of an escape that belong to it: \xHH, \x{H..},
+// \uHHHH, \u{H..}, \cX, \k<name>, and the digits of a back reference
+constexpr size_t escapePayload(std::string_view pattern, size_t letter) {
+    size_t i = letter + 1;
+    auto upTo = [&pattern, &i](char close) {
+        size_t found = pattern.find(close, i);
+        return (found == std::string_view::npos ? pattern.size() : found + 1) - i;
+    };
+    auto hexDigits = [&pattern, &i](size_t max) {
+        size_t count = 0;
+        while (count < max && i + count < pattern.size() && isHexDigit(pattern[i + count])) {
+            ++count;
+        }
+        return count;
+    };
+
+    switch (pattern[letter]) {
+        case 'x':
+            return i < pattern.size() && pattern[i] == '{' ? upTo('}') : hexDigits(2);
+        case 'u':
+            return i < pattern.size() && pattern[i] == '{' ? upTo('}') : hexDigits(4);
+        case 'c':
+            return i < pattern.size() ? 1 : 0;
+        case 'k':
+            return i < pattern.size() && pattern[i] == '<' ? upTo('>') : 0;
+        default:
+            if (pattern[letter] >= '0' && pattern[letter] <= '9') {
+                size_t count = 0;
+                while (i + count < pattern.size() && pattern[i + count] >= '0' && pattern[i + count] <= '9') {
+                    ++count;
+                }
+                return count;
+            }
+            return 0;
+    }
+}
+
+constexpr std::string findRequiredLiteral(std::string_view pattern) {
+    if (pattern.find('|') != std::string_view::npos) {
+        return "";
+    }
+
+    constexpr std::string_view specialEscapes = "dDwWsSbBnrtfv0123456789cxuk";
+
+    std::string best;
+    std::string current;
+    auto endRun = [&best, &current]() {
+        if (current.size() > best.size()) {
+            best = current;
+        }
+        current.clear();
+    };
+
+    int depth = 0;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        switch (c) {
+            case '\\':
+                if (i + 1 >= pattern.size()) {
+                    endRun();
+                } else if (depth == 0 && specialEscapes.find(pattern[i + 1]) == std::string_view::npos) {
+                    current += pattern[++i];
+                } else {
+                    ++i;
+                    i += escapePayload(pattern, i);
+                    endRun();
+                }
+                break;
+            case '?':
+            case '*':
+                // The preceding character is optional
+                if (!current.empty()) {
+                    current.pop_back();
+                }
+                endRun();
+                break;
+            case '{':
+                if (!current.empty()) {
+                    current.pop_back();
+                }
+                endRun();
+                while (i < pattern.size() && pattern[i] != '}') {
+                    ++i;
+                }
+                break;
+            case '+':
+                endRun();
+                break;
+            case '[':
+                endRun();
+                while (i + 1 < pattern.size() && pattern[i + 1] != ']') {
+                    i += pattern[i + 1] == '\\' ? 2 : 1;
+                }
+                ++i;
+                break;
+            case '(':
+                depth++;
+                endRun();
+                break;
+            case ')':
+                depth = std::max(0, depth - 1);
+                endRun();
+                break;
+            case '^':
+            case '$':
+            case '.':
+                endRun();
+                break;
+            default:
+                if (depth == 0) {
+                    current += c;
+                } else {
+                    endRun();
+                }
+                break;
+        }
+    }
+    endRun();
+    return best;
+}
+
+// Checked at compile time; a regression fails the build instead of
+// silently pruning files that do match
+static_assert(findRequiredLiteral("needle") == "needle");
+static_assert(findRequiredLiteral("foo.*barbaz") == "barbaz");
+static_assert(findRequiredLiteral("colou?r") == "colo");
+static_assert(findRequiredLiteral("a\\.bc") == "a.bc");
+static_assert(findRequiredLiteral("cat|dog").empty());
+static_assert(findRequiredLiteral("ab\\x41cd") == "ab");
+static_assert(findRequiredLiteral("abc\\x{1F600}de") == "abc");
+static_assert(findRequiredLiteral("ab\\u0041cd") == "ab");
+static_assert(findRequiredLiteral("ab\\u{41}cde") == "cde");
+static_assert(findRequiredLiteral("ab\\cJcd") == "ab");
+static_assert(findRequiredLiteral("(a)bc\\1234") == "bc");
+static_assert(findRequiredLiteral("x\\k<name>yz") == "yz");
+
+} // namespace
+
+std::string ContentSearcher::requiredLiteral(const std::string& pattern) {
+    return findRequiredLiteral(pattern);
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,66 @@
+#include "engine/cpu_throttle.h"
+#include <algorithm>
+#include <thread>
+#include <ctime>
+
+namespace FastFileSearch {
+namespace Engine {
+
+CpuThrottle::CpuThrottle(double share)
+    : share_(1.0), cores_(std::max(1u, std::thread::hardware_concurrency())),
+      windowStart_(std::chrono::steady_clock::now()), windowCpuStart_(processCpuSeconds()),
+      throttledNs_(0) {
+    setShare(share);
+}
+
+void CpuThrottle::setShare(double share) {
+    share_.store(std::clamp(share, 0.01, 1.0));
+}
+
+double CpuThrottle::processCpuSeconds() {
+#ifdef CLOCK_PROCESS_CPUTIME_ID
+    struct timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) == 0) {
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+    }
+#endif
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+void CpuThrottle::pace() {
+    double share = share_.load();
+    if (share >= 1.0) {
+        return;
+    }
+
+    std::chrono::nanoseconds sleep(0);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = std::chrono::steady_clock::now();
+        double wall = std::chrono::duration<double>(now - windowStart_).count();
+        double used = processCpuSeconds() - windowCpuStart_;
+        double budget = share * cores_;
+
+        // Time at which the CPU used so far is within budget
+        double ahead = used / budget - wall;
+        if (ahead > 0.0) {
+            sleep = std::min<std::chrono::nanoseconds>(
+                std::chrono::nanoseconds(static_cast<int64_t>(ahead * 1e9)), MAX_SLEEP);
+        }
+
+        // Start a new window periodically so old history does not build up
+        // credit (or debt)
+        if (now - windowStart_ >= WINDOW && ahead <= 0.0) {
+            windowStart_ = now;
+            windowCpuStart_ = processCpuSeconds();
+        }
+    }
+
+    if (sleep.count() > 0) {
+        std::this_thread::sleep_for(sleep);
+        throttledNs_.fetch_add(static_cast<uint64_t>(sleep.count()), std::memory_order_relaxed);
+    }
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
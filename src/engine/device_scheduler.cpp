@@ -0,0 +1,162 @@
+#include "engine/device_scheduler.h"
+#include "core/logger.h"
+#include <algorithm>
+#include <cmath>
+
+namespace FastFileSearch {
+namespace Engine {
+
+DeviceScheduler::DeviceScheduler(std::shared_ptr<StorageTopology> topology, size_t maxThreads)
+    : topology_(topology ? std::move(topology) : std::make_shared<StorageTopology>()),
+      maxThreads_(std::max<size_t>(1, maxThreads)), concurrencyScale_(1.0) {
+}
+
+// Caller holds mutex_
+DeviceScheduler::Slot& DeviceScheduler::slotLocked(uint64_t device) {
+    auto it = slots_.find(device);
+    if (it != slots_.end()) {
+        return it->second;
+    }
+
+    Slot slot;
+    slot.device = topology_->deviceForId(device);
+    slot.device.device = device;
+    applyLimitsLocked(slot);
+    slot.limit = std::clamp(slot.device.initialConcurrency(), slot.minLimit, slot.maxLimit);
+
+    LOG_INFO_F("Scheduling device {} ({}, {}) with {} reader(s), up to {}",
+               slot.device.mountPoint.empty() ? std::to_string(device) : slot.device.mountPoint,
+               storageKindName(slot.device.kind),
+               slot.device.blockDevice.empty() ? slot.device.fileSystem : slot.device.blockDevice,
+               slot.limit, slot.maxLimit);
+
+    return slots_.emplace(device, std::move(slot)).first->second;
+}
+
+void DeviceScheduler::applyLimitsLocked(Slot& slot) {
+    auto scaled = static_cast<size_t>(std::lround(slot.device.maxConcurrency() * concurrencyScale_));
+    slot.maxLimit = std::clamp<size_t>(scaled, 1, maxThreads_);
+    slot.minLimit = 1;
+    slot.limit = std::clamp(slot.limit, slot.minLimit, slot.maxLimit);
+}
+
+bool DeviceScheduler::tryAcquire(uint64_t device) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Slot& slot = slotLocked(device);
+    if (slot.active >= slot.limit) {
+        slot.contended = true;
+        slot.rejected++;
+        return false;
+    }
+    slot.active++;
+    return true;
+}
+
+void DeviceScheduler::release(uint64_t device, std::chrono::nanoseconds latency) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Slot& slot = slotLocked(device);
+    recordLocked(slot, latency);
+    if (slot.active > 0) {
+        slot.active--;
+    }
+}
+
+bool DeviceScheduler::recordAndKeep(uint64_t device, std::chrono::nanoseconds latency) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Slot& slot = slotLocked(device);
+    recordLocked(slot, latency);
+
+    // The last reader always keeps going, otherwise parked work would starve
+    if (slot.active > slot.limit && slot.active > 1) {
+        slot.active--;
+        return false;
+    }
+    return true;
+}
+
+bool DeviceScheduler::hasCapacity(uint64_t device) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = slots_.find(device);
+    return it == slots_.end() || it->second.active < it->second.limit;
+}
+
+void DeviceScheduler::recordLocked(Slot& slot, std::chrono::nanoseconds latency) {
+    double sampleMs = std::chrono::duration<double, std::milli>(latency).count();
+    slot.latencyMs = slot.directories == 0 ? sampleMs :
+                     slot.latencyMs + LATENCY_SMOOTHING * (sampleMs - slot.latencyMs);
+    slot.directories++;
+
+    if (++slot.windowSamples >= ADAPT_WINDOW) {
+        adaptLocked(slot);
+        slot.windowSamples = 0;
+        slot.contended = false;
+    }
+}
+
+void DeviceScheduler::adaptLocked(Slot& slot) {
+    if (slot.baselineMs <= 0.0) {
+        slot.baselineMs = slot.latencyMs;
+        return;
+    }
+
+    // The baseline follows improvements quickly and slower periods (bigger
+    // directories, colder cache) slowly, so a single burst of tiny
+    // directories does not pin the limit low for the rest of the scan
+    double drift = slot.latencyMs < slot.baselineMs ? BASELINE_RECOVERY : BASELINE_DRIFT;
+    slot.baselineMs += drift * (slot.latencyMs - slot.baselineMs);
+
+    size_t previous = slot.limit;
+    if (slot.latencyMs > slot.baselineMs * BACKOFF_RATIO && slot.limit > slot.minLimit) {
+        slot.limit = std::max(slot.minLimit, slot.limit * 3 / 4);
+    } else if (slot.contended && slot.latencyMs < slot.baselineMs * GROW_RATIO && slot.limit < slot.maxLimit) {
+        slot.limit++;
+    }
+
+    if (slot.limit != previous) {
+        LOG_DEBUG_F("Device {} concurrency {} -> {} (latency {} ms, baseline {} ms)",
+                    slot.device.mountPoint, previous, slot.limit, slot.latencyMs, slot.baselineMs);
+    }
+}
+
+void DeviceScheduler::setConcurrencyScale(double scale) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    concurrencyScale_ = std::max(0.0, scale);
+    for (auto& [device, slot] : slots_) {
+        applyLimitsLocked(slot);
+    }
+}
+
+void DeviceScheduler::setMaxThreads(size_t maxThreads) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxThreads_ = std::max<size_t>(1, maxThreads);
+    for (auto& [device, slot] : slots_) {
+        applyLimitsLocked(slot);
+    }
+}
+
+std::vector<DeviceScheduler::DeviceStatistics> DeviceScheduler::getStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<DeviceStatistics> result;
+    result.reserve(slots_.size());
+    for (const auto& [device, slot] : slots_) {
+        DeviceStatistics stats;
+        stats.device = slot.device;
+        stats.limit = slot.limit;
+        stats.maxLimit = slot.maxLimit;
+        stats.active = slot.active;
+        stats.latencyMs = slot.latencyMs;
+        stats.baselineMs = slot.baselineMs;
+        stats.directories = slot.directories;
+        stats.rejected = slot.rejected;
+        result.push_back(stats);
+    }
+    return result;
+}
+
+void DeviceScheduler::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    slots_.clear();
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
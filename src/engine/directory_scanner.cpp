@@ -0,0 +1,190 @@
+#include "engine/directory_scanner.h"
+#include "engine/file_access.h"
+#include "core/logger.h"
+#include <filesystem>
+#include <chrono>
+#include <system_error>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// ScannedDirectory implementation
+void ScannedDirectory::clear() {
+    path.clear();
+    entries.clear();
+    subdirectories.clear();
+    device = 0;
+    inode = 0;
+    lastModified = 0;
+    modifiedNs = 0;
+    changedNs = 0;
+    statCalls = 0;
+    excluded = 0;
+    errors = 0;
+    skipped = false;
+    priority = ScanPriority::Normal;
+}
+
+// DirectoryScanner implementation
+DirectoryScanner::DirectoryScanner(const ScanOptions& options) : options_(options) {
+}
+
+std::unique_ptr<DirectoryScanner> DirectoryScanner::create(const ScanOptions& options) {
+#ifdef __linux__
+    return std::make_unique<LinuxDirectoryScanner>(options);
+#else
+    return std::make_unique<StdDirectoryScanner>(options);
+#endif
+}
+
+bool DirectoryScanner::statDirectory(const std::string& path, ScannedDirectory& result) {
+    result.clear();
+    result.path = path;
+
+#ifndef _WIN32
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return false;
+    }
+
+    result.device = static_cast<uint64_t>(st.st_dev);
+    result.inode = static_cast<uint64_t>(st.st_ino);
+    result.lastModified = st.st_mtime;
+    result.modifiedNs = modifiedNs(st);
+    result.changedNs = changedNs(st);
+    return true;
+#else
+    std::error_code ec;
+    if (!std::filesystem::is_directory(path, ec) || ec) {
+        return false;
+    }
+
+    auto fileTime = std::filesystem::last_write_time(path, ec);
+    if (ec) {
+        return false;
+    }
+
+    result.modifiedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        fileTime.time_since_epoch()).count();
+    auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+        fileTime - std::filesystem::file_time_type::clock::now() + std::chrono::system_clock::now());
+    result.lastModified = std::chrono::system_clock::to_time_t(sctp);
+    return true;
+#endif
+}
+
+std::string DirectoryScanner::joinPath(const std::string& directory, const char* name) {
+    std::string result;
+    result.reserve(directory.size() + 1 + std::char_traits<char>::length(name));
+    result = directory;
+
+    if (!result.empty() && result.back() != '/' && result.back() != '\\') {
+#ifdef _WIN32
+        result += '\\';
+#else
+        result += '/';
+#endif
+    }
+
+    result += name;
+    return result;
+}
+
+// StdDirectoryScanner implementation
+StdDirectoryScanner::StdDirectoryScanner(const ScanOptions& options)
+    : DirectoryScanner(options) {
+}
+
+bool StdDirectoryScanner::scanDirectory(const std::string& path, ScannedDirectory& result) {
+    result.clear();
+    result.path = path;
+
+    std::error_code ec;
+    std::filesystem::directory_iterator it(path, std::filesystem::directory_options::skip_permission_denied, ec);
+    if (ec) {
+        LOG_DEBUG_F("Cannot open directory {}: {}", path, ec.message());
+        result.errors++;
+        return false;
+    }
+
+    auto toTimeT = [](std::filesystem::file_time_type fileTime) {
+        auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+            fileTime - std::filesystem::file_time_type::clock::now() +
+            std::chrono::system_clock::now());
+        return std::chrono::system_clock::to_time_t(sctp);
+    };
+
+    if (openCheck_) {
+        ScannedDirectory identity;
+        if (statDirectory(path, identity) && identity.inode != 0) {
+            result.device = identity.device;
+            result.inode = identity.inode;
+            if (!openCheck_(identity.device, identity.inode)) {
+                result.skipped = true;
+                return true;
+            }
+        }
+    }
+
+    auto dirTime = std::filesystem::last_write_time(path, ec);
+    if (!ec) {
+        result.lastModified = toTimeT(dirTime);
+        result.modifiedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            dirTime.time_since_epoch()).count();
+    }
+
+    for (const auto& dirEntry : it) {
+        std::string name = dirEntry.path().filename().string();
+        if (!options_.includeHidden && isHiddenName(name.c_str())) {
+            continue;
+        }
+
+        // directory_entry caches what the platform iterator reported, so these
+        // only hit the filesystem when the OS did not supply a type
+        FileType type = FileType::Unknown;
+        uint64_t size = 0;
+        std::time_t modified = 0;
+
+        auto linkStatus = dirEntry.symlink_status(ec);
+        if (ec) {
+            result.errors++;
+            continue;
+        }
+
+        if (isExcludedEntry(path, name.c_str(), std::filesystem::is_directory(linkStatus))) {
+            result.excluded++;
+            continue;
+        }
+
+        if (std::filesystem::is_symlink(linkStatus)) {
+            type = FileType::SymbolicLink;
+            if (options_.followSymlinks && dirEntry.is_directory(ec) && !ec) {
+                result.subdirectories.push_back(dirEntry.path().string());
+            }
+        } else if (std::filesystem::is_directory(linkStatus)) {
+            type = FileType::Directory;
+            result.subdirectories.push_back(dirEntry.path().string());
+        } else if (std::filesystem::is_regular_file(linkStatus)) {
+            type = FileType::File;
+            size = dirEntry.file_size(ec);
+            if (ec) {
+                size = 0;
+            }
+            result.statCalls++;
+        }
+
+        if (type != FileType::Directory && type != FileType::SymbolicLink) {
+            auto fileTime = dirEntry.last_write_time(ec);
+            if (!ec) {
+                modified = toTimeT(fileTime);
+            }
+        }
+
+        result.entries.emplace_back(dirEntry.path().string(), name, type, size, modified);
+    }
+
+    return true;
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,280 @@
+#include "engine/dirty_subtrees.h"
+#include "engine/scan_throttle.h"
+#include "core/logger.h"
+#include <algorithm>
+
+namespace FastFileSearch {
+namespace Engine {
+
+namespace {
+
+// Recovery reads a lot of metadata; keep it behind searches and indexing
+const int RECOVERY_NICE = 10;
+
+} // namespace
+
+DirtySubtrees::DirtySubtrees(std::chrono::milliseconds settleDelay, std::chrono::milliseconds maxDelay,
+                             size_t maxDirectories)
+    : shouldStop_(false), recovering_(false),
+      settleDelay_(settleDelay), maxDelay_(std::max(maxDelay, settleDelay)),
+      maxDirectories_(maxDirectories) {
+}
+
+DirtySubtrees::~DirtySubtrees() {
+    stop();
+}
+
+void DirtySubtrees::markOverflow(const std::string& root) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        noteLossLocked();
+        stats_.overflows++;
+        addSubtreeLocked(root);
+    }
+    LOG_WARNING_F("Change events under {} were lost, it will be reconciled once activity settles", root);
+    wakeCondition_.notify_all();
+}
+
+void DirtySubtrees::markDropped(const FileChangeEvent& event) {
+    bool first = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        first = subtrees_.empty() && directories_.empty();
+        noteLossLocked();
+        stats_.droppedEvents++;
+
+        for (const std::string* path : {&event.path, &event.oldPath}) {
+            if (path->empty()) {
+                continue;
+            }
+            addDirectoryLocked(parentOf(*path));
+        }
+    }
+    if (first) {
+        LOG_WARNING("Change event queue is full, dropped events will be recovered by a targeted reconcile");
+    }
+    wakeCondition_.notify_all();
+}
+
+void DirtySubtrees::markSubtree(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        noteLossLocked();
+        addSubtreeLocked(path);
+    }
+    wakeCondition_.notify_all();
+}
+
+void DirtySubtrees::markDirectory(const std::string& directory) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        noteLossLocked();
+        addDirectoryLocked(directory);
+    }
+    wakeCondition_.notify_all();
+}
+
+// Caller holds mutex_; past maxDirectories_ a stamp check has to do
+void DirtySubtrees::addDirectoryLocked(const std::string& directory) {
+    if (directories_.size() < maxDirectories_ || directories_.count(directory) > 0) {
+        directories_.insert(directory);
+    } else {
+        addSubtreeLocked(directory);
+    }
+}
+
+// Caller holds mutex_
+void DirtySubtrees::addSubtreeLocked(const std::string& path) {
+    if (!path.empty()) {
+        subtrees_.insert(path);
+    }
+}
+
+// Caller holds mutex_, before adding the loss
+void DirtySubtrees::noteLossLocked() {
+    auto now = std::chrono::steady_clock::now();
+    if (subtrees_.empty() && directories_.empty()) {
+        firstLossAt_ = now;
+    }
+    lastLossAt_ = now;
+    stats_.lastLoss = std::time(nullptr);
+}
+
+DirtySubtrees::Work DirtySubtrees::take() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Work work;
+    for (const auto& subtree : subtrees_) {
+        // Covered by an ancestor that is itself dirty?
+        bool nested = false;
+        for (std::string ancestor = parentOf(subtree); !ancestor.empty() && ancestor != subtree;
+             ancestor = parentOf(ancestor)) {
+            if (subtrees_.count(ancestor) > 0) {
+                nested = true;
+                break;
+            }
+            if (ancestor == parentOf(ancestor)) {
+                break;
+            }
+        }
+        if (!nested) {
+            work.subtrees.push_back(subtree);
+        }
+    }
+    work.directories.assign(directories_.begin(), directories_.end());
+
+    subtrees_.clear();
+    directories_.clear();
+    return work;
+}
+
+void DirtySubtrees::restore(const Work& work) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (subtrees_.empty() && directories_.empty()) {
+            firstLossAt_ = std::chrono::steady_clock::now();
+        }
+        subtrees_.insert(work.subtrees.begin(), work.subtrees.end());
+        directories_.insert(work.directories.begin(), work.directories.end());
+    }
+    wakeCondition_.notify_all();
+}
+
+bool DirtySubtrees::hasPending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !subtrees_.empty() || !directories_.empty();
+}
+
+bool DirtySubtrees::isPossiblyStale() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return recovering_ || !subtrees_.empty() || !directories_.empty();
+}
+
+bool DirtySubtrees::start(RecoveryTask task, CancelTask cancel) {
+    if (!task) {
+        return false;
+    }
+    stop();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        recoveryTask_ = std::move(task);
+        cancelTask_ = std::move(cancel);
+    }
+
+    shouldStop_.store(false);
+    try {
+        thread_ = std::thread(&DirtySubtrees::run, this);
+    } catch (const std::exception& e) {
+        LOG_ERROR_F("Failed to start overflow recovery: {}", e.what());
+        return false;
+    }
+    return true;
+}
+
+void DirtySubtrees::stop() {
+    shouldStop_.store(true);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cancelTask_ && recovering_) {
+            cancelTask_();
+        }
+    }
+    wakeCondition_.notify_all();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool DirtySubtrees::isRunning() const {
+    return thread_.joinable() && !shouldStop_.load();
+}
+
+DirtySubtrees::Statistics DirtySubtrees::getStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Statistics stats = stats_;
+    stats.pendingSubtrees = subtrees_.size();
+    stats.pendingDirectories = directories_.size();
+    return stats;
+}
+
+void DirtySubtrees::resetStatistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_ = Statistics();
+}
+
+void DirtySubtrees::run() {
+    ScanThrottle::lowerCurrentThreadPriority(RECOVERY_NICE, true);
+
+    auto stopping = [this]() { return shouldStop_.load(); };
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!shouldStop_.load()) {
+        if (subtrees_.empty() && directories_.empty()) {
+            wakeCondition_.wait(lock, [this]() {
+                return shouldStop_.load() || !subtrees_.empty() || !directories_.empty();
+            });
+            continue;
+        }
+
+        // Every new loss pushes the settle point out, up to maxDelay
+        auto due = std::min(lastLossAt_ + settleDelay_, firstLossAt_ + maxDelay_);
+        if (std::chrono::steady_clock::now() < due) {
+            wakeCondition_.wait_until(lock, due, stopping);
+            continue;
+        }
+
+        recovering_ = true;
+        RecoveryTask task = recoveryTask_;
+        lock.unlock();
+        Work work = take();
+        if (work.empty()) {
+            lock.lock();
+            recovering_ = false;
+            continue;
+        }
+
+        LOG_INFO_F("Reconciling {} subtree(s) and {} directories after lost change events",
+                   work.subtrees.size(), work.directories.size());
+        bool succeeded = false;
+        try {
+            // A stop() since the wait ended has cancelled nothing yet
+            succeeded = !shouldStop_.load() && task(work);
+        } catch (const std::exception& e) {
+            LOG_ERROR_F("Overflow recovery failed: {}", e.what());
+        }
+
+        if (!succeeded) {
+            restore(work);
+        }
+
+        lock.lock();
+        recovering_ = false;
+        if (succeeded) {
+            stats_.recoveries++;
+            stats_.subtreesReconciled += work.subtrees.size();
+            stats_.directoriesReconciled += work.directories.size();
+            stats_.lastRecovery = std::time(nullptr);
+        } else {
+            stats_.failedRecoveries++;
+            if (!shouldStop_.load()) {
+                LOG_WARNING_F("Overflow recovery did not complete, retrying in {}s", RETRY_DELAY.count());
+                wakeCondition_.wait_for(lock, RETRY_DELAY, stopping);
+            }
+        }
+    }
+}
+
+std::string DirtySubtrees::parentOf(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    if (slash == std::string::npos) {
+        return std::string();
+    }
+    if (slash == 0) {
+        return path.substr(0, 1);
+    }
+    return path.substr(0, slash);
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
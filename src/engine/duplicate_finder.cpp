@@ -0,0 +1,440 @@
+#include "engine/duplicate_finder.h"
+#include "engine/change_filter.h"
+#include "engine/file_access.h"
+#include "core/logger.h"
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <utility>
+
+namespace FastFileSearch {
+namespace Engine {
+
+DuplicateFinder::DuplicateFinder(const DuplicateOptions& options)
+    : options_(options), running_(false), cancelled_(false),
+      headHashed_(0), fullHashed_(0), cacheHits_(0), bytesRead_(0), changedSkipped_(0), errors_(0) {
+}
+
+std::vector<DuplicateGroup> DuplicateFinder::find(const std::vector<FileEntry>& files) {
+    std::vector<DuplicateGroup> groups;
+    if (running_.exchange(true)) {
+        LOG_WARNING("Duplicate search already in progress");
+        return groups;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    cancelled_.store(false);
+    headHashed_.store(0);
+    fullHashed_.store(0);
+    cacheHits_.store(0);
+    bytesRead_.store(0);
+    changedSkipped_.store(0);
+    errors_.store(0);
+
+    Statistics stats;
+
+    // Regular files, one path per inode
+    std::vector<const FileEntry*> sorted;
+    std::set<std::pair<uint64_t, uint64_t>> linkedInodes;
+    for (const auto& entry : files) {
+        if (!entry.isFile() || entry.size < options_.minSize) {
+            continue;
+        }
+        if (entry.linkCount > 1 && entry.inode != 0 &&
+            !linkedInodes.emplace(entry.device, entry.inode).second) {
+            stats.hardlinksSkipped++;
+            continue;
+        }
+        sorted.push_back(&entry);
+    }
+    stats.candidates = sorted.size();
+
+    // 1. Size groups
+    std::sort(sorted.begin(), sorted.end(), [](const FileEntry* a, const FileEntry* b) {
+        return a->size < b->size;
+    });
+
+    std::vector<Candidate> candidates;
+    for (size_t begin = 0; begin < sorted.size();) {
+        size_t end = begin + 1;
+        while (end < sorted.size() && sorted[end]->size == sorted[begin]->size) {
+            ++end;
+        }
+        if (end - begin > 1) {
+            stats.sizeGroups++;
+            for (size_t i = begin; i < end; ++i) {
+                Candidate candidate;
+                candidate.entry = sorted[i];
+                candidates.push_back(candidate);
+            }
+        }
+        begin = end;
+    }
+
+    // 2. Head hashes
+    forEachParallel(candidates.size(), [this, &candidates](size_t index, std::vector<char>& buffer) {
+        candidates[index].valid = hashCandidate(candidates[index], false, buffer);
+    });
+
+    auto byHash = [&candidates](bool full) {
+        return [&candidates, full](size_t a, size_t b) {
+            const Candidate& left = candidates[a];
+            const Candidate& right = candidates[b];
+            if (left.entry->size != right.entry->size) {
+                return left.entry->size < right.entry->size;
+            }
+            const Utils::Hash128& leftHash = full ? left.full : left.head;
+            const Utils::Hash128& rightHash = full ? right.full : right.head;
+            if (!(leftHash == rightHash)) {
+                return leftHash < rightHash;
+            }
+            return left.entry->fullPath < right.entry->fullPath;
+        };
+    };
+    auto sameHash = [&candidates](size_t a, size_t b, bool full) {
+        const Candidate& left = candidates[a];
+        const Candidate& right = candidates[b];
+        return left.entry->size == right.entry->size &&
+               (full ? left.full == right.full : left.head == right.head);
+    };
+
+    // 3. Full hashes where size and head still collide. Files that fit in
+    // the head are done already.
+    std::vector<size_t> headOrder;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (candidates[i].valid) {
+            headOrder.push_back(i);
+        }
+    }
+    std::sort(headOrder.begin(), headOrder.end(), byHash(false));
+
+    std::vector<size_t> fullWork;
+    std::vector<size_t> finalists;
+    for (size_t begin = 0; begin < headOrder.size();) {
+        size_t end = begin + 1;
+        while (end < headOrder.size() && sameHash(headOrder[begin], headOrder[end], false)) {
+            ++end;
+        }
+        if (end - begin > 1) {
+            for (size_t i = begin; i < end; ++i) {
+                Candidate& candidate = candidates[headOrder[i]];
+                if (candidate.entry->size <= options_.headBytes) {
+                    candidate.full = candidate.head;
+                    candidate.hasFull = true;
+                } else {
+                    fullWork.push_back(headOrder[i]);
+                }
+                finalists.push_back(headOrder[i]);
+            }
+        }
+        begin = end;
+    }
+
+    forEachParallel(fullWork.size(), [this, &candidates, &fullWork](size_t index, std::vector<char>& buffer) {
+        Candidate& candidate = candidates[fullWork[index]];
+        candidate.valid = hashCandidate(candidate, true, buffer);
+    });
+
+    // 4. Groups of equal full hashes
+    auto end = std::remove_if(finalists.begin(), finalists.end(), [&candidates](size_t index) {
+        return !candidates[index].valid || !candidates[index].hasFull;
+    });
+    finalists.erase(end, finalists.end());
+    std::sort(finalists.begin(), finalists.end(), byHash(true));
+
+    for (size_t begin = 0; begin < finalists.size();) {
+        size_t groupEnd = begin + 1;
+        while (groupEnd < finalists.size() && sameHash(finalists[begin], finalists[groupEnd], true)) {
+            ++groupEnd;
+        }
+        if (groupEnd - begin > 1) {
+            DuplicateGroup group;
+            group.size = candidates[finalists[begin]].entry->size;
+            group.hash = candidates[finalists[begin]].full;
+            for (size_t i = begin; i < groupEnd; ++i) {
+                group.paths.push_back(candidates[finalists[i]].entry->fullPath);
+            }
+            groups.push_back(std::move(group));
+        }
+        begin = groupEnd;
+    }
+
+    std::stable_sort(groups.begin(), groups.end(), [](const DuplicateGroup& a, const DuplicateGroup& b) {
+        return a.reclaimableBytes() > b.reclaimableBytes();
+    });
+
+    bool cancelled = cancelled_.load();
+    if (cancelled) {
+        groups.clear();
+    }
+
+    stats.headHashed = headHashed_.load();
+    stats.fullHashed = fullHashed_.load();
+    stats.cacheHits = cacheHits_.load();
+    stats.bytesRead = bytesRead_.load();
+    stats.changedSkipped = changedSkipped_.load();
+    stats.errors = errors_.load();
+    stats.groups = groups.size();
+    for (const auto& group : groups) {
+        stats.reclaimableBytes += group.reclaimableBytes();
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        lastStats_ = stats;
+    }
+
+    if (cancelled) {
+        LOG_INFO("Duplicate search cancelled");
+    } else {
+        LOG_INFO_F("Duplicate search: {} groups, {} MB reclaimable, {} MB read in {}s",
+                   stats.groups, stats.reclaimableBytes / (1024 * 1024),
+                   stats.bytesRead / (1024 * 1024), stats.seconds);
+    }
+
+    running_.store(false);
+    return groups;
+}
+
+bool DuplicateFinder::hashCandidate(Candidate& candidate, bool full, std::vector<char>& buffer) {
+    const FileEntry& entry = *candidate.entry;
+
+    // A cheap lstat() decides whether the index (and the cache) still
+    // describe the file
+    FileFingerprint current;
+    if (!ChangeFilter::capture(entry.fullPath, current)) {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (current.size != entry.size) {
+        changedSkipped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    Utils::Hash128 hash;
+    FileFingerprint hashed = current;
+    if (lookupCache(entry.fullPath, current, full, hash)) {
+        cacheHits_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        FileFingerprint read;
+        uint64_t bytesRead = 0;
+        uint64_t limit = full ? UINT64_MAX : options_.headBytes;
+        if (!hashFile(entry.fullPath, limit, buffer, hash, read, bytesRead)) {
+            errors_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        bytesRead_.fetch_add(bytesRead, std::memory_order_relaxed);
+        if (read.size != entry.size) {
+            changedSkipped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        hashed = read;
+
+        if (full) {
+            fullHashed_.fetch_add(1, std::memory_order_relaxed);
+            // The head hash only belongs with this fingerprint if the file
+            // did not change between the two passes
+            bool sameFile = read == candidate.headFingerprint;
+            storeCache(entry.fullPath, read, sameFile ? &candidate.head : nullptr, &hash);
+        } else {
+            headHashed_.fetch_add(1, std::memory_order_relaxed);
+            storeCache(entry.fullPath, read, &hash, nullptr);
+        }
+
+        if (throttle_) {
+            // open, fstat, close plus the reads
+            uint64_t syscalls = 3 + bytesRead / std::max<size_t>(1, buffer.size()) + 1;
+            throttle_->admit(1, syscalls, cancelled_);
+        }
+    }
+
+    if (full) {
+        candidate.full = hash;
+        candidate.hasFull = true;
+    } else {
+        candidate.head = hash;
+        candidate.headFingerprint = hashed;
+    }
+    return true;
+}
+
+bool DuplicateFinder::lookupCache(const std::string& path, const FileFingerprint& current, bool full,
+                                  Utils::Hash128& hash) {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    auto it = cache_.find(path);
+    if (it == cache_.end() || !(it->second.fingerprint == current)) {
+        return false;
+    }
+    if (full ? !it->second.hasFull : !it->second.hasHead) {
+        return false;
+    }
+    hash = full ? it->second.full : it->second.head;
+    return true;
+}
+
+void DuplicateFinder::storeCache(const std::string& path, const FileFingerprint& fingerprint,
+                                 const Utils::Hash128* head, const Utils::Hash128* full) {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    CachedHash& cached = cache_[path];
+    if (!(cached.fingerprint == fingerprint)) {
+        cached.hasHead = false;
+        cached.hasFull = false;
+    }
+    cached.fingerprint = fingerprint;
+    if (head) {
+        cached.head = *head;
+        cached.hasHead = true;
+    }
+    if (full) {
+        cached.full = *full;
+        cached.hasFull = true;
+    }
+    cached.dirty = true;
+    cached.dirtied = saveGeneration_;
+}
+
+void DuplicateFinder::forEachParallel(size_t count,
+                                      const std::function<void(size_t index, std::vector<char>& buffer)>& work) {
+    if (count == 0) {
+        return;
+    }
+
+    // Always on fresh threads, so lowering their priority never sticks to
+    // the caller
+    std::atomic<size_t> next(0);
+    size_t numThreads = std::clamp<size_t>(options_.threads, 1, count);
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads);
+    for (size_t t = 0; t < numThreads; ++t) {
+        threads.emplace_back([this, count, &next, &work]() {
+            if (options_.lowerPriority) {
+                ScanThrottle::lowerCurrentThreadPriority(ScanThrottleOptions().backgroundNice, true);
+            }
+            std::vector<char> buffer(std::max<size_t>(options_.readBufferSize, options_.headBytes));
+            for (size_t index = next.fetch_add(1); index < count && !cancelled_.load();
+                 index = next.fetch_add(1)) {
+                work(index, buffer);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+bool DuplicateFinder::hashFile(const std::string& path, uint64_t limit, std::vector<char>& buffer,
+                               Utils::Hash128& hash, FileFingerprint& fingerprint, uint64_t& bytesRead) {
+    if (buffer.empty()) {
+        buffer.resize(1 << 20);
+    }
+    bytesRead = 0;
+    Utils::Murmur3Hasher hasher;
+
+    SequentialFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+    fingerprint = file.fingerprint();
+
+    uint64_t remaining = std::min<uint64_t>(limit, fingerprint.size);
+    // Head passes read a few KiB; only a whole-file pass is worth the hint
+    if (remaining == fingerprint.size) {
+        file.adviseSequential(true);
+    }
+
+    while (remaining > 0) {
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(remaining, buffer.size()));
+        long n = file.read(buffer.data(), chunk);
+        if (n < 0) {
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        hasher.update(buffer.data(), static_cast<size_t>(n));
+        bytesRead += static_cast<uint64_t>(n);
+        remaining -= static_cast<uint64_t>(n);
+    }
+
+    hash = hasher.finish();
+    return true;
+}
+
+void DuplicateFinder::loadHashes(const std::vector<Storage::ContentHashRecord>& records) {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    cache_.reserve(cache_.size() + records.size());
+    for (const auto& record : records) {
+        CachedHash& cached = cache_[record.path];
+        cached.fingerprint = record.fingerprint;
+        cached.head = record.headHash;
+        cached.full = record.fullHash;
+        cached.hasHead = record.hasHeadHash;
+        cached.hasFull = record.hasFullHash;
+        cached.dirty = false;
+    }
+}
+
+bool DuplicateFinder::saveHashes(Storage::ContentHashStore& store) {
+    std::lock_guard<std::mutex> saveLock(saveMutex_);
+    std::vector<Storage::ContentHashRecord> records;
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        // Hashes changed from here on belong to the next save
+        generation = saveGeneration_++;
+        for (const auto& [path, cached] : cache_) {
+            if (!cached.dirty) {
+                continue;
+            }
+            Storage::ContentHashRecord record;
+            record.path = path;
+            record.fingerprint = cached.fingerprint;
+            record.headHash = cached.head;
+            record.fullHash = cached.full;
+            record.hasHeadHash = cached.hasHead;
+            record.hasFullHash = cached.hasFull;
+            records.push_back(std::move(record));
+        }
+    }
+
+    if (!records.empty() && !store.saveHashes(records)) {
+        LOG_WARNING("Content hashes not saved; they stay pending for the next save");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    for (const auto& record : records) {
+        auto it = cache_.find(record.path);
+        if (it != cache_.end() && it->second.dirtied <= generation) {
+            it->second.dirty = false;
+        }
+    }
+    return true;
+}
+
+void DuplicateFinder::forget(const std::string& path) {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    cache_.erase(path);
+}
+
+size_t DuplicateFinder::getCachedHashCount() const {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    return cache_.size();
+}
+
+DuplicateFinder::Statistics DuplicateFinder::getStatistics() const {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    Statistics stats = lastStats_;
+    if (running_.load()) {
+        stats.headHashed = headHashed_.load();
+        stats.fullHashed = fullHashed_.load();
+        stats.cacheHits = cacheHits_.load();
+        stats.bytesRead = bytesRead_.load();
+    }
+    return stats;
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,212 @@
+#include "engine/event_coalescer.h"
+#include <algorithm>
+
+namespace FastFileSearch {
+namespace Engine {
+
+namespace {
+
+#ifdef _WIN32
+const char PATH_SEPARATOR = '\\';
+#else
+const char PATH_SEPARATOR = '/';
+#endif
+
+// "dir/" for dir, without doubling the separator of a root
+std::string childPrefix(const std::string& path) {
+    if (!path.empty() && path.back() == PATH_SEPARATOR) {
+        return path;
+    }
+    return path + PATH_SEPARATOR;
+}
+
+std::string parentOf(const std::string& path) {
+    size_t separator = path.find_last_of(PATH_SEPARATOR);
+    return separator == std::string::npos ? std::string() : path.substr(0, separator);
+}
+
+} // namespace
+
+EventCoalescer::EventCoalescer(const CoalescingOptions& options)
+    : pendingEvents_(0), quietGap_(options.minWindow) {
+    setOptions(options);
+}
+
+void EventCoalescer::setOptions(const CoalescingOptions& options) {
+    options_ = options;
+    options_.maxWindow = std::max(options_.maxWindow, options_.minWindow);
+    quietGap_ = std::clamp(quietGap_, options_.minWindow, options_.maxWindow);
+}
+
+void EventCoalescer::add(const FileChangeEvent& event) {
+    auto now = std::chrono::steady_clock::now();
+    if (pendingEvents_ == 0) {
+        openedAt_ = now;
+    }
+    if (segments_.empty()) {
+        segments_.emplace_back();
+    }
+    lastEventAt_ = now;
+    pendingEvents_++;
+    stats_.eventsIn++;
+
+    Segment& segment = segments_.back();
+    if (event.type == FileChangeType::Renamed || event.type == FileChangeType::Moved) {
+        // Written under a temporary name and renamed into place: the target
+        // is simply replaced, and the temporary name deleted like any
+        // other created-then-deleted path
+        auto created = segment.changes.find(event.oldPath);
+        if (created != segment.changes.end() && created->second == NetChange::Created &&
+            !hasBelow(segment.changes, event.oldPath)) {
+            apply(segment.changes, FileChangeType::Deleted, event.oldPath);
+            apply(segment.changes, FileChangeType::Deleted, event.path);
+            apply(segment.changes, FileChangeType::Created, event.path);
+            stats_.foldedRenames++;
+            return;
+        }
+
+        // Paths before and after the move must not be mixed up
+        segment.barrier.push_back(event);
+        segments_.emplace_back();
+        stats_.barriers++;
+        return;
+    }
+
+    apply(segment.changes, event.type, event.path);
+}
+
+bool EventCoalescer::isDue() const {
+    return pendingEvents_ > 0 && timeUntilDue().count() == 0;
+}
+
+std::chrono::milliseconds EventCoalescer::timeUntilDue() const {
+    if (pendingEvents_ == 0) {
+        return std::chrono::milliseconds::max();
+    }
+    if (pendingEvents_ >= options_.maxBatch) {
+        return std::chrono::milliseconds(0);
+    }
+
+    auto due = std::min(lastEventAt_ + quietGap_, openedAt_ + options_.maxWindow);
+    auto now = std::chrono::steady_clock::now();
+    if (due <= now) {
+        return std::chrono::milliseconds(0);
+    }
+    return std::chrono::ceil<std::chrono::milliseconds>(due - now);
+}
+
+std::vector<FileChangeEvent> EventCoalescer::take() {
+    std::vector<FileChangeEvent> batch;
+    for (const auto& segment : segments_) {
+        emit(segment.changes, batch);
+        batch.insert(batch.end(), segment.barrier.begin(), segment.barrier.end());
+    }
+    segments_.clear();
+
+    if (pendingEvents_ > 0) {
+        stats_.batches++;
+        stats_.eventsOut += batch.size();
+        stats_.largestBatch = std::max<uint64_t>(stats_.largestBatch, batch.size());
+
+        if (pendingEvents_ >= options_.busyBatch) {
+            quietGap_ = std::min(quietGap_ * 2, options_.maxWindow);
+        } else {
+            quietGap_ = std::max(quietGap_ / 2, options_.minWindow);
+        }
+    }
+    pendingEvents_ = 0;
+    return batch;
+}
+
+void EventCoalescer::apply(std::map<std::string, NetChange>& changes, FileChangeType type,
+                           const std::string& path) {
+    auto it = changes.find(path);
+    bool known = it != changes.end();
+
+    switch (type) {
+        case FileChangeType::Created:
+            if (!known) {
+                changes.emplace(path, NetChange::Created);
+            } else if (it->second != NetChange::Created) {
+                it->second = NetChange::Replaced;
+            }
+            break;
+
+        case FileChangeType::Modified:
+            if (!known) {
+                changes.emplace(path, NetChange::Modified);
+            } else if (it->second == NetChange::Deleted) {
+                it->second = NetChange::Replaced;
+            }
+            break;
+
+        case FileChangeType::Deleted:
+            // Whatever was pending below a deleted directory goes with it
+            eraseBelow(changes, path);
+            // Also over a pending create: the index may have had the path
+            // before it (a create reported for a replace, or a delete lost
+            // earlier), and removing an unknown path is harmless
+            if (!known) {
+                changes.emplace(path, NetChange::Deleted);
+            } else {
+                it->second = NetChange::Deleted;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void EventCoalescer::eraseBelow(std::map<std::string, NetChange>& changes, const std::string& path) {
+    std::string prefix = childPrefix(path);
+    auto begin = changes.lower_bound(prefix);
+    auto end = begin;
+    while (end != changes.end() && end->first.compare(0, prefix.size(), prefix) == 0) {
+        ++end;
+    }
+    changes.erase(begin, end);
+}
+
+bool EventCoalescer::hasBelow(const std::map<std::string, NetChange>& changes, const std::string& path) {
+    std::string prefix = childPrefix(path);
+    auto it = changes.lower_bound(prefix);
+    return it != changes.end() && it->first.compare(0, prefix.size(), prefix) == 0;
+}
+
+void EventCoalescer::emit(const std::map<std::string, NetChange>& changes, std::vector<FileChangeEvent>& batch) {
+    // By directory, then name: a parent always sorts before its children
+    std::vector<std::pair<std::string, const std::pair<const std::string, NetChange>*>> ordered;
+    ordered.reserve(changes.size());
+    for (const auto& change : changes) {
+        ordered.emplace_back(parentOf(change.first), &change);
+    }
+    std::sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) {
+        if (a.first != b.first) {
+            return a.first < b.first;
+        }
+        return a.second->first < b.second->first;
+    });
+
+    for (const auto& [parent, change] : ordered) {
+        const std::string& path = change->first;
+        switch (change->second) {
+            case NetChange::Created:
+                batch.emplace_back(FileChangeType::Created, path);
+                break;
+            case NetChange::Modified:
+                batch.emplace_back(FileChangeType::Modified, path);
+                break;
+            case NetChange::Deleted:
+                batch.emplace_back(FileChangeType::Deleted, path);
+                break;
+            case NetChange::Replaced:
+                batch.emplace_back(FileChangeType::Deleted, path);
+                batch.emplace_back(FileChangeType::Created, path);
+                break;
+        }
+    }
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,686 @@
+#include "engine/exclusion_rules.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+
+namespace FastFileSearch {
+namespace Engine {
+
+namespace {
+
+// Paths are folded to use '/' only; on other platforms a backslash is an
+// ordinary file name character
+#ifdef _WIN32
+const bool FOLD_SEPARATORS = true;
+#else
+const bool FOLD_SEPARATORS = false;
+#endif
+
+bool isAbsolute(std::string_view path) {
+    return (!path.empty() && path[0] == '/') ||
+           (path.size() >= 2 && path[1] == ':' && std::isalpha(static_cast<unsigned char>(path[0])));
+}
+
+// Matches a bracket expression at pattern[0] ('[') against c. Returns the
+// length of the expression, or 0 if it is not a well-formed class.
+size_t matchClass(std::string_view pattern, char c, bool& matched) {
+    size_t i = 1;
+    bool negate = i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^');
+    if (negate) {
+        ++i;
+    }
+
+    matched = false;
+    bool first = true;
+    while (i < pattern.size() && (pattern[i] != ']' || first)) {
+        first = false;
+        char low = pattern[i];
+        char high = low;
+        if (i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+            high = pattern[i + 2];
+            i += 2;
+        }
+        if (c >= low && c <= high) {
+            matched = true;
+        }
+        ++i;
+    }
+
+    if (i >= pattern.size()) {
+        return 0;
+    }
+    matched = matched != negate;
+    return i + 1;
+}
+
+// '*' and '?' stay within one component unless crossSeparators; "**"
+// always crosses. With allowDescendants a match may end at a separator, so
+// a pattern naming a directory also covers everything below it.
+bool globMatchImpl(std::string_view pattern, std::string_view text, bool crossSeparators, bool allowDescendants) {
+    size_t p = 0;
+    size_t t = 0;
+
+    while (p < pattern.size()) {
+        char c = pattern[p];
+
+        if (c == '*') {
+            bool doubleStar = p + 1 < pattern.size() && pattern[p + 1] == '*';
+            size_t next = p + (doubleStar ? 2 : 1);
+            bool cross = crossSeparators || doubleStar;
+            std::string_view rest = pattern.substr(next);
+
+            // "a/**/b" also matches "a/b"
+            if (doubleStar && !rest.empty() && rest[0] == '/' &&
+                globMatchImpl(rest.substr(1), text.substr(t), crossSeparators, allowDescendants)) {
+                return true;
+            }
+
+            for (size_t i = t; ; ++i) {
+                if (globMatchImpl(rest, text.substr(i), crossSeparators, allowDescendants)) {
+                    return true;
+                }
+                if (i >= text.size() || (!cross && text[i] == '/')) {
+                    return false;
+                }
+            }
+        }
+
+        if (t >= text.size()) {
+            return false;
+        }
+
+        if (c == '?') {
+            if (!crossSeparators && text[t] == '/') {
+                return false;
+            }
+        } else if (c == '[') {
+            bool matched = false;
+            size_t length = matchClass(pattern.substr(p), text[t], matched);
+            if (length > 0) {
+                if (!matched) {
+                    return false;
+                }
+                p += length;
+                ++t;
+                continue;
+            }
+            if (text[t] != c) {
+                return false;
+            }
+        } else if (text[t] != c) {
+            return false;
+        }
+
+        ++p;
+        ++t;
+    }
+
+    return t == text.size() || (allowDescendants && text[t] == '/');
+}
+
+std::atomic<uint64_t> nextRulesId{1};
+
+// Where the prefix trie and the path globs stand after the directory whose
+// entries this thread is checking. Scanners check a whole directory's
+// entries in a row, so the directory is walked once instead of per entry.
+struct DirectoryState {
+    uint64_t rulesId = 0;
+    std::string directory;
+    bool excluded = false;
+    uint32_t trieNode = 0;
+    std::vector<uint64_t> globs;        // Empty once no path glob can match
+    std::vector<uint64_t> scratch;
+};
+
+thread_local DirectoryState directoryState;
+thread_local std::vector<uint64_t> globScratch;
+
+} // namespace
+
+// GlobAutomaton implementation
+void ExclusionRules::GlobAutomaton::add(std::string_view pattern) {
+    starts_.push_back(states_.size());
+
+    size_t p = 0;
+    while (p < pattern.size()) {
+        char c = pattern[p];
+        State state;
+
+        if (c == '*') {
+            bool doubleStar = p + 1 < pattern.size() && pattern[p + 1] == '*';
+            if (doubleStar && p + 2 < pattern.size() && pattern[p + 2] == '/') {
+                // Nothing, or any run that ends at a separator: "a/**/b" also
+                // matches "a/b". The entry state holds no input, so skipping
+                // is only possible before the run starts.
+                State entry;
+                entry.skip = true;
+                entry.jump = true;
+                states_.push_back(entry);
+                state.loop.set();
+                state.advance.set('/');
+                p += 3;
+            } else {
+                state.loop.set();
+                state.skip = true;
+                if (!doubleStar) {
+                    state.loop.reset('/');
+                }
+                p += doubleStar ? 2 : 1;
+            }
+        } else if (c == '?') {
+            state.advance.set();
+            state.advance.reset('/');
+            ++p;
+        } else {
+            size_t length = 0;
+            if (c == '[') {
+                for (int value = 0; value < 256; ++value) {
+                    bool matched = false;
+                    length = matchClass(pattern.substr(p), static_cast<char>(value), matched);
+                    if (length == 0) {
+                        break;
+                    }
+                    state.advance.set(value, matched);
+                }
+            }
+            if (length == 0) {
+                // A literal, or a '[' that does not open a well-formed class
+                state.advance.reset();
+                state.advance.set(static_cast<unsigned char>(c));
+                length = 1;
+            }
+            p += length;
+        }
+
+        states_.push_back(state);
+    }
+
+    accepts_.push_back(states_.size());
+    states_.emplace_back();
+}
+
+void ExclusionRules::GlobAutomaton::compile() {
+    words_ = (states_.size() + 63) / 64;
+    advance_.assign(256 * words_, 0);
+    loop_.assign(256 * words_, 0);
+    skip_.assign(words_, 0);
+    jump_.assign(words_, 0);
+    start_.assign(words_, 0);
+    accept_.assign(words_, 0);
+
+    for (size_t s = 0; s < states_.size(); ++s) {
+        uint64_t bit = uint64_t(1) << (s % 64);
+        size_t word = s / 64;
+        for (size_t c = 0; c < 256; ++c) {
+            if (states_[s].advance.test(c)) {
+                advance_[c * words_ + word] |= bit;
+            }
+            if (states_[s].loop.test(c)) {
+                loop_[c * words_ + word] |= bit;
+            }
+        }
+        if (states_[s].skip) {
+            skip_[word] |= bit;
+        }
+        if (states_[s].jump) {
+            jump_[word] |= bit;
+        }
+    }
+    for (size_t s : starts_) {
+        start_[s / 64] |= uint64_t(1) << (s % 64);
+    }
+    for (size_t s : accepts_) {
+        accept_[s / 64] |= uint64_t(1) << (s % 64);
+    }
+    close(start_);
+
+    states_.clear();
+    states_.shrink_to_fit();
+}
+
+// Follows transitions that take no input; they only ever lead one or two
+// states forward
+void ExclusionRules::GlobAutomaton::close(GlobState& state) const {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        uint64_t carry = 0;
+        for (size_t w = 0; w < words_; ++w) {
+            uint64_t skipping = state[w] & skip_[w];
+            uint64_t jumping = state[w] & jump_[w];
+            uint64_t reached = (skipping << 1) | (jumping << 2) | carry;
+            carry = (skipping >> 63) | (jumping >> 62);
+            if ((reached & ~state[w]) != 0) {
+                state[w] |= reached;
+                changed = true;
+            }
+        }
+    }
+}
+
+bool ExclusionRules::GlobAutomaton::step(GlobState& state, unsigned char c) const {
+    const uint64_t* advance = &advance_[c * words_];
+    const uint64_t* loop = &loop_[c * words_];
+
+    uint64_t carry = 0;
+    uint64_t alive = 0;
+    for (size_t w = 0; w < words_; ++w) {
+        uint64_t advancing = state[w] & advance[w];
+        uint64_t next = (advancing << 1) | carry | (state[w] & loop[w]);
+        carry = advancing >> 63;
+        state[w] = next;
+        alive |= next;
+    }
+    if (alive == 0) {
+        return false;
+    }
+    close(state);
+    return true;
+}
+
+bool ExclusionRules::GlobAutomaton::accepts(const GlobState& state) const {
+    for (size_t w = 0; w < words_ && w < state.size(); ++w) {
+        if ((state[w] & accept_[w]) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ExclusionRules::GlobAutomaton::matches(std::string_view text, bool allowDescendants, GlobState& scratch) const {
+    if (empty()) {
+        return false;
+    }
+    start(scratch);
+    for (char c : text) {
+        if (allowDescendants && c == '/' && accepts(scratch)) {
+            return true;
+        }
+        if (!step(scratch, static_cast<unsigned char>(c))) {
+            return false;
+        }
+    }
+    return accepts(scratch);
+}
+
+// AnchoredGlobs implementation
+bool ExclusionRules::AnchoredGlobs::matches(std::string_view name, bool suffix) const {
+    for (const auto& [length, literals] : byLength) {
+        if (length > name.size()) {
+            continue;
+        }
+        std::string_view part = suffix ? name.substr(name.size() - length) : name.substr(0, length);
+        if (literals.find(part) != literals.end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ExclusionRules implementation
+ExclusionRules::ExclusionRules()
+    : caseSensitive_(defaultCaseSensitivity()), ruleCount_(0), id_(nextRulesId.fetch_add(1)) {
+    trie_.emplace_back();
+    nameGlobs_.compile();
+    pathGlobs_.compile();
+}
+
+ExclusionRules::ExclusionRules(const std::vector<std::string>& pathRules, const std::vector<std::string>& extensions,
+                               bool caseSensitive)
+    : caseSensitive_(caseSensitive), ruleCount_(0), id_(nextRulesId.fetch_add(1)) {
+    trie_.emplace_back();
+
+    for (const auto& rule : pathRules) {
+        addRule(fold(rule));
+    }
+    nameGlobs_.compile();
+    pathGlobs_.compile();
+
+    for (const auto& extension : extensions) {
+        std::string_view trimmed = extension;
+        while (!trimmed.empty() && (trimmed.front() == '*' || trimmed.front() == '.')) {
+            trimmed.remove_prefix(1);
+        }
+        if (trimmed.empty()) {
+            continue;
+        }
+
+        std::string lowered(trimmed);
+        std::transform(lowered.begin(), lowered.end(), lowered.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (extensions_.insert(std::move(lowered)).second) {
+            ruleCount_++;
+        }
+    }
+}
+
+bool ExclusionRules::defaultCaseSensitivity() {
+#ifdef _WIN32
+    return false;
+#else
+    return true;
+#endif
+}
+
+std::string ExclusionRules::fold(std::string_view text) const {
+    std::string result(text);
+    for (auto& c : result) {
+        if (FOLD_SEPARATORS && c == '\\') {
+            c = '/';
+        } else if (!caseSensitive_) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+    }
+    return result;
+}
+
+bool ExclusionRules::hasWildcard(std::string_view text) {
+    return text.find_first_of("*?[") != std::string_view::npos;
+}
+
+std::string_view ExclusionRules::lastComponent(std::string_view path) {
+    while (path.size() > 1 && path.back() == '/') {
+        path.remove_suffix(1);
+    }
+    size_t slash = path.rfind('/');
+    return slash == std::string_view::npos ? path : path.substr(slash + 1);
+}
+
+// Same rules as std::filesystem::path::extension(): dotfiles have none
+std::string_view ExclusionRules::extensionOf(std::string_view name) {
+    size_t dot = name.rfind('.');
+    if (dot == std::string_view::npos || dot == 0 || name == "..") {
+        return {};
+    }
+    return name.substr(dot + 1);
+}
+
+void ExclusionRules::addRule(std::string rule) {
+    while (rule.size() > 1 && rule.back() == '/') {
+        rule.pop_back();
+    }
+    if (rule.empty()) {
+        return;
+    }
+
+    bool hasSlash = rule.find('/') != std::string::npos;
+
+    if (hasWildcard(rule)) {
+        if (!hasSlash) {
+            std::string_view view = rule;
+            if (view.front() == '*' && !hasWildcard(view.substr(1))) {
+                std::string_view literal = view.substr(1);
+                suffixGlobs_.byLength[literal.size()].emplace(literal);
+            } else if (view.back() == '*' && !hasWildcard(view.substr(0, view.size() - 1))) {
+                std::string_view literal = view.substr(0, view.size() - 1);
+                prefixGlobs_.byLength[literal.size()].emplace(literal);
+            } else {
+                nameGlobs_.add(rule);
+            }
+        } else {
+            pathGlobs_.add(isAbsolute(rule) ? rule : "**/" + rule);
+        }
+    } else if (!hasSlash && !isAbsolute(rule)) {
+        names_.insert(rule);
+    } else if (isAbsolute(rule)) {
+        addPrefix(rule);
+    } else {
+        // Relative path: matches that sequence of components at any depth
+        pathGlobs_.add("**/" + rule);
+    }
+
+    ruleCount_++;
+}
+
+void ExclusionRules::addPrefix(std::string_view path) {
+    uint32_t node = 0;
+    size_t pos = 0;
+    while (pos < path.size()) {
+        size_t end = path.find('/', pos);
+        if (end == std::string_view::npos) {
+            end = path.size();
+        }
+
+        std::string_view component = path.substr(pos, end - pos);
+        pos = end + 1;
+        if (component.empty()) {
+            continue;
+        }
+
+        auto it = trie_[node].children.find(component);
+        if (it == trie_[node].children.end()) {
+            uint32_t child = static_cast<uint32_t>(trie_.size());
+            trie_[node].children.emplace(std::string(component), child);
+            trie_.emplace_back();
+            node = child;
+        } else {
+            node = it->second;
+        }
+    }
+    trie_[node].excluded = true;
+}
+
+bool ExclusionRules::isPrefixExcluded(std::string_view path) const {
+    bool excluded = false;
+    walkPrefix(path, 0, excluded);
+    return excluded;
+}
+
+uint32_t ExclusionRules::walkPrefix(std::string_view path, uint32_t node, bool& excluded) const {
+    if (trie_[node].excluded) {
+        excluded = true;
+        return node;
+    }
+    if (trie_[node].children.empty()) {
+        return NO_NODE;
+    }
+
+    size_t pos = 0;
+    while (pos < path.size()) {
+        size_t end = path.find('/', pos);
+        if (end == std::string_view::npos) {
+            end = path.size();
+        }
+
+        std::string_view component = path.substr(pos, end - pos);
+        pos = end + 1;
+        if (component.empty()) {
+            continue;
+        }
+
+        auto it = trie_[node].children.find(component);
+        if (it == trie_[node].children.end()) {
+            return NO_NODE;
+        }
+        node = it->second;
+        if (trie_[node].excluded) {
+            excluded = true;
+            return node;
+        }
+    }
+    return node;
+}
+
+bool ExclusionRules::isNameExcluded(std::string_view name) const {
+    if (names_.find(name) != names_.end()) {
+        return true;
+    }
+    if (!suffixGlobs_.empty() && suffixGlobs_.matches(name, true)) {
+        return true;
+    }
+    if (!prefixGlobs_.empty() && prefixGlobs_.matches(name, false)) {
+        return true;
+    }
+    return !nameGlobs_.empty() && nameGlobs_.matches(name, false, globScratch);
+}
+
+bool ExclusionRules::isPathGlobExcluded(std::string_view path) const {
+    return !pathGlobs_.empty() && pathGlobs_.matches(path, true, globScratch);
+}
+
+bool ExclusionRules::isExtensionExcluded(std::string_view extension) const {
+    if (extensions_.empty() || extension.empty()) {
+        return false;
+    }
+
+    bool lower = std::none_of(extension.begin(), extension.end(),
+                              [](unsigned char c) { return std::isupper(c); });
+    if (lower) {
+        return extensions_.find(extension) != extensions_.end();
+    }
+
+    std::string lowered(extension);
+    std::transform(lowered.begin(), lowered.end(), lowered.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extensions_.find(lowered) != extensions_.end();
+}
+
+bool ExclusionRules::needsFolding() const {
+    return !caseSensitive_ || FOLD_SEPARATORS;
+}
+
+bool ExclusionRules::isExcluded(std::string_view path) const {
+    if (ruleCount_ == 0) {
+        return false;
+    }
+
+    std::string folded;
+    if (needsFolding()) {
+        folded = fold(path);
+        path = folded;
+    }
+
+    if (isPrefixExcluded(path) || isPathGlobExcluded(path)) {
+        return true;
+    }
+
+    size_t pos = 0;
+    while (pos < path.size()) {
+        size_t end = path.find('/', pos);
+        if (end == std::string_view::npos) {
+            end = path.size();
+        }
+        std::string_view component = path.substr(pos, end - pos);
+        if (!component.empty() && isNameExcluded(component)) {
+            return true;
+        }
+        pos = end + 1;
+    }
+
+    return isExtensionExcluded(extensionOf(lastComponent(path)));
+}
+
+bool ExclusionRules::isChildExcluded(std::string_view path, bool isDirectory) const {
+    if (ruleCount_ == 0) {
+        return false;
+    }
+
+    std::string folded;
+    if (needsFolding()) {
+        folded = fold(path);
+        path = folded;
+    }
+
+    std::string_view name = lastComponent(path);
+    if (isNameExcluded(name)) {
+        return true;
+    }
+    if (!isDirectory && isExtensionExcluded(extensionOf(name))) {
+        return true;
+    }
+    return isPrefixExcluded(path) || isPathGlobExcluded(path);
+}
+
+bool ExclusionRules::isChildExcluded(std::string_view directory, std::string_view name, bool isDirectory) const {
+    if (ruleCount_ == 0) {
+        return false;
+    }
+
+    std::string foldedName;
+    if (needsFolding()) {
+        foldedName = fold(name);
+        name = foldedName;
+    }
+
+    if (isNameExcluded(name)) {
+        return true;
+    }
+    if (!isDirectory && isExtensionExcluded(extensionOf(name))) {
+        return true;
+    }
+    if (!hasPathRules()) {
+        return false;
+    }
+
+    DirectoryState& state = directoryState;
+    if (state.rulesId != id_ || state.directory != directory) {
+        state.rulesId = id_;
+        state.directory.assign(directory);
+
+        std::string folded;
+        std::string_view path = directory;
+        if (needsFolding()) {
+            folded = fold(directory);
+            path = folded;
+        }
+
+        state.excluded = false;
+        state.trieNode = walkPrefix(path, 0, state.excluded);
+
+        state.globs.clear();
+        if (!pathGlobs_.empty() && !state.excluded) {
+            bool alive = true;
+            pathGlobs_.start(state.globs);
+            for (char c : path) {
+                if (c == '/' && pathGlobs_.accepts(state.globs)) {
+                    state.excluded = true;
+                    break;
+                }
+                if (!pathGlobs_.step(state.globs, static_cast<unsigned char>(c))) {
+                    alive = false;
+                    break;
+                }
+            }
+            // The separator before the name
+            if (alive && !state.excluded && (path.empty() || path.back() != '/')) {
+                if (pathGlobs_.accepts(state.globs)) {
+                    state.excluded = true;
+                } else {
+                    alive = pathGlobs_.step(state.globs, '/');
+                }
+            }
+            if (!alive || state.excluded) {
+                state.globs.clear();
+            }
+        }
+    }
+
+    if (state.excluded) {
+        return true;
+    }
+    if (state.trieNode != NO_NODE) {
+        const auto& children = trie_[state.trieNode].children;
+        auto it = children.find(name);
+        if (it != children.end() && trie_[it->second].excluded) {
+            return true;
+        }
+    }
+    if (state.globs.empty()) {
+        return false;
+    }
+
+    state.scratch = state.globs;
+    for (char c : name) {
+        if (!pathGlobs_.step(state.scratch, static_cast<unsigned char>(c))) {
+            return false;
+        }
+    }
+    return pathGlobs_.accepts(state.scratch);
+}
+
+bool ExclusionRules::globMatch(std::string_view pattern, std::string_view text, bool crossSeparators) {
+    return globMatchImpl(pattern, text, crossSeparators, false);
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,119 @@
+#include "engine/file_access.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#else
+#include "engine/change_filter.h"
+#endif
+
+namespace FastFileSearch {
+namespace Engine {
+
+SequentialFile::~SequentialFile() {
+    close();
+}
+
+#ifndef _WIN32
+
+bool SequentialFile::open(const std::string& path) {
+    close();
+
+    int flags = O_RDONLY | O_CLOEXEC;
+#ifdef O_NOATIME
+    // Only permitted on files we own
+    fd_ = ::open(path.c_str(), flags | O_NOATIME);
+    if (fd_ < 0 && errno == EPERM) {
+        fd_ = ::open(path.c_str(), flags);
+    }
+#else
+    fd_ = ::open(path.c_str(), flags);
+#endif
+    if (fd_ < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close();
+        return false;
+    }
+    fingerprint_ = fingerprintOf(st);
+    return true;
+}
+
+void SequentialFile::close() {
+    if (fd_ < 0) {
+        return;
+    }
+#ifdef POSIX_FADV_DONTNEED
+    if (dropCache_) {
+        posix_fadvise(fd_, 0, 0, POSIX_FADV_DONTNEED);
+    }
+#endif
+    ::close(fd_);
+    fd_ = -1;
+    dropCache_ = false;
+}
+
+bool SequentialFile::isOpen() const {
+    return fd_ >= 0;
+}
+
+void SequentialFile::adviseSequential(bool dropCache) {
+    if (fd_ < 0) {
+        return;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    dropCache_ = dropCache;
+}
+
+long SequentialFile::read(char* target, size_t size) {
+    for (;;) {
+        ssize_t n = ::read(fd_, target, size);
+        if (n >= 0 || errno != EINTR) {
+            return static_cast<long>(n);
+        }
+    }
+}
+
+#else
+
+bool SequentialFile::open(const std::string& path) {
+    close();
+
+    bool isDirectory = false;
+    if (!ChangeFilter::capture(path, fingerprint_, &isDirectory) || isDirectory) {
+        return false;
+    }
+    stream_.open(path, std::ios::binary);
+    return stream_.is_open();
+}
+
+void SequentialFile::close() {
+    if (stream_.is_open()) {
+        stream_.close();
+    }
+    stream_.clear();
+}
+
+bool SequentialFile::isOpen() const {
+    return stream_.is_open();
+}
+
+void SequentialFile::adviseSequential(bool dropCache) {
+    dropCache_ = dropCache;
+}
+
+long SequentialFile::read(char* target, size_t size) {
+    stream_.read(target, static_cast<std::streamsize>(size));
+    return stream_.bad() ? -1L : static_cast<long>(stream_.gcount());
+}
+
+#endif
+
+} // namespace Engine
+} // namespace FastFileSearch
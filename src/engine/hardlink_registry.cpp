@@ -0,0 +1,82 @@
+#include "engine/hardlink_registry.h"
+#include <algorithm>
+
+namespace FastFileSearch {
+namespace Engine {
+
+HardlinkRegistry::HardlinkRegistry() : secondaryLinks_(0) {
+}
+
+bool HardlinkRegistry::record(const FileEntry& entry) {
+    if (entry.inode == 0 || entry.linkCount < 2) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto [it, inserted] = groups_.try_emplace(Utils::InodeKey{entry.device, entry.inode});
+    Group& group = it->second;
+
+    if (inserted) {
+        group.primaryPath = entry.fullPath;
+        group.size = entry.size;
+        group.lastModified = entry.lastModified;
+        group.linkCount = entry.linkCount;
+        return true;
+    }
+
+    if (group.primaryPath == entry.fullPath) {
+        // Seen again by a later scan; the inode's metadata may have moved on
+        group.size = entry.size;
+        group.lastModified = entry.lastModified;
+        group.linkCount = entry.linkCount;
+        return true;
+    }
+
+    // Rescans with the same registry see every link again
+    if (std::find(group.otherPaths.begin(), group.otherPaths.end(), entry.fullPath) == group.otherPaths.end()) {
+        group.otherPaths.push_back(entry.fullPath);
+        secondaryLinks_++;
+    }
+    return false;
+}
+
+bool HardlinkRegistry::getGroup(uint64_t device, uint64_t inode, Group& group) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = groups_.find(Utils::InodeKey{device, inode});
+    if (it == groups_.end()) {
+        return false;
+    }
+    group = it->second;
+    return true;
+}
+
+std::vector<std::string> HardlinkRegistry::getLinks(uint64_t device, uint64_t inode) const {
+    std::vector<std::string> links;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = groups_.find(Utils::InodeKey{device, inode});
+    if (it != groups_.end()) {
+        links.reserve(it->second.otherPaths.size() + 1);
+        links.push_back(it->second.primaryPath);
+        links.insert(links.end(), it->second.otherPaths.begin(), it->second.otherPaths.end());
+    }
+    return links;
+}
+
+size_t HardlinkRegistry::getGroupCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return groups_.size();
+}
+
+uint64_t HardlinkRegistry::getSecondaryLinkCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return secondaryLinks_;
+}
+
+void HardlinkRegistry::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    groups_.clear();
+    secondaryLinks_ = 0;
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,196 @@
+#include "engine/index_rebuilder.h"
+#include "core/logger.h"
+#include <chrono>
+
+namespace FastFileSearch {
+namespace Engine {
+
+// ActiveIndex implementation
+ActiveIndex::ActiveIndex(std::shared_ptr<Storage::MemoryIndex> index)
+    : current_(std::move(index)), generation_(0) {
+}
+
+std::shared_ptr<Storage::MemoryIndex> ActiveIndex::swap(std::shared_ptr<Storage::MemoryIndex> next) {
+    auto previous = current_.exchange(std::move(next));
+    generation_.fetch_add(1);
+    return previous;
+}
+
+// IndexRebuilder implementation
+IndexRebuilder::IndexRebuilder(ActiveIndex& active)
+    : active_(active), rebuilding_(false), cancelled_(false), recording_(false) {
+}
+
+IndexRebuilder::~IndexRebuilder() {
+    cancel();
+}
+
+bool IndexRebuilder::start(BuildTask build, ReplayTask replay, double cpuShare,
+                           CompletionCallback completion) {
+    if (!build || !replay) {
+        return false;
+    }
+    if (rebuilding_.exchange(true)) {
+        LOG_WARNING("Index rebuild already in progress");
+        return false;
+    }
+    if (buildThread_.joinable()) {
+        buildThread_.join();
+    }
+
+    cancelled_.store(false);
+    throttle_.setShare(cpuShare);
+    {
+        std::lock_guard<std::mutex> lock(eventMutex_);
+        pendingEvents_.clear();
+        recording_ = true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(statusMutex_);
+        status_.rebuilding = true;
+        status_.eventsRecorded = 0;
+        status_.eventsReplayed = 0;
+        status_.buildSeconds = 0.0;
+    }
+
+    try {
+        buildThread_ = std::thread(&IndexRebuilder::run, this, std::move(build), std::move(replay),
+                                   std::move(completion));
+    } catch (const std::exception& e) {
+        LOG_ERROR_F("Failed to start index rebuild: {}", e.what());
+        {
+            std::lock_guard<std::mutex> lock(eventMutex_);
+            recording_ = false;
+        }
+        rebuilding_.store(false);
+        return false;
+    }
+    return true;
+}
+
+void IndexRebuilder::cancel() {
+    cancelled_.store(true);
+    if (buildThread_.joinable()) {
+        buildThread_.join();
+    }
+}
+
+void IndexRebuilder::recordEvents(const std::vector<FileChangeEvent>& events) {
+    std::lock_guard<std::mutex> lock(eventMutex_);
+    if (!recording_) {
+        return;
+    }
+    pendingEvents_.insert(pendingEvents_.end(), events.begin(), events.end());
+
+    std::lock_guard<std::mutex> statusLock(statusMutex_);
+    status_.eventsRecorded += events.size();
+}
+
+// Caller holds eventMutex_
+std::vector<FileChangeEvent> IndexRebuilder::takeEventsLocked() {
+    std::vector<FileChangeEvent> events;
+    events.swap(pendingEvents_);
+    return events;
+}
+
+void IndexRebuilder::run(BuildTask build, ReplayTask replay, CompletionCallback completion) {
+    auto started = std::chrono::steady_clock::now();
+    auto fresh = std::make_shared<Storage::MemoryIndex>();
+
+    LOG_INFO_F("Rebuilding index in the background ({}% CPU share)",
+               static_cast<int>(throttle_.getShare() * 100));
+
+    bool built = false;
+    try {
+        built = build(*fresh, throttle_) && !cancelled_.load();
+    } catch (const std::exception& e) {
+        LOG_ERROR_F("Index rebuild failed: {}", e.what());
+    }
+
+    uint64_t replayed = 0;
+    bool swapped = false;
+
+    if (built) {
+        // Catch up outside the lock while the backlog is large, so the
+        // watcher is never blocked for long
+        for (int round = 0; round < MAX_CATCH_UP_ROUNDS && !cancelled_.load(); ++round) {
+            std::vector<FileChangeEvent> events;
+            {
+                std::lock_guard<std::mutex> lock(eventMutex_);
+                if (pendingEvents_.size() <= FINAL_DRAIN_THRESHOLD) {
+                    break;
+                }
+                events = takeEventsLocked();
+            }
+            replay(*fresh, events);
+            replayed += events.size();
+        }
+
+        if (!cancelled_.load()) {
+            std::shared_ptr<Storage::MemoryIndex> previous;
+            {
+                std::lock_guard<std::mutex> lock(eventMutex_);
+                std::vector<FileChangeEvent> events = takeEventsLocked();
+                replay(*fresh, events);
+                replayed += events.size();
+
+                previous = active_.swap(fresh);
+                recording_ = false;
+            }
+            swapped = true;
+            reclaimInBackground(std::move(previous));
+        }
+    }
+
+    if (!swapped) {
+        std::lock_guard<std::mutex> lock(eventMutex_);
+        recording_ = false;
+        pendingEvents_.clear();
+        pendingEvents_.shrink_to_fit();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    {
+        std::lock_guard<std::mutex> lock(statusMutex_);
+        status_.rebuilding = false;
+        status_.generation = active_.getGeneration();
+        status_.eventsReplayed = replayed;
+        status_.buildSeconds = seconds;
+        status_.throttledSeconds = throttle_.getThrottledTime().count() / 1e9;
+        status_.lastSucceeded = swapped;
+    }
+
+    if (swapped) {
+        LOG_INFO_F("Index rebuilt in {}s and swapped in (generation {}), {} events replayed",
+                   seconds, active_.getGeneration(), replayed);
+    } else {
+        LOG_WARNING_F("Index rebuild {} after {}s; the previous index stays active",
+                      cancelled_.load() ? "cancelled" : "failed", seconds);
+    }
+
+    rebuilding_.store(false);
+    if (completion) {
+        completion(swapped);
+    }
+}
+
+void IndexRebuilder::reclaimInBackground(std::shared_ptr<Storage::MemoryIndex> index) {
+    if (!index) {
+        return;
+    }
+    // Readers still holding it keep it alive; whoever drops the last
+    // reference frees it, which is this thread unless a search is running
+    std::thread([index = std::move(index)]() mutable {
+        index.reset();
+    }).detach();
+}
+
+IndexRebuilder::Status IndexRebuilder::getStatus() const {
+    std::lock_guard<std::mutex> lock(statusMutex_);
+    Status status = status_;
+    status.rebuilding = rebuilding_.load();
+    return status;
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,375 @@
+#include "engine/ingestion_pipeline.h"
+#include "core/logger.h"
+#include <algorithm>
+#include <iterator>
+
+namespace FastFileSearch {
+namespace Engine {
+
+namespace {
+
+// How long an idle stage sleeps before re-checking its queue; wakeups are
+// normally explicit, this only bounds the cost of a missed one
+const std::chrono::milliseconds IDLE_WAIT(100);
+
+// A stage busy for at least this share of the run is saturated
+const double SATURATED_UTILIZATION = 0.8;
+
+} // namespace
+
+// Wakeup implementation
+void IngestionPipeline::Wakeup::notify() {
+    // Pairs with the fence in wait(): either the consumer sees the item, or
+    // we see it asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        condition.notify_one();
+    }
+}
+
+template<typename Ready>
+void IngestionPipeline::Wakeup::wait(std::chrono::milliseconds timeout, Ready ready) {
+    std::unique_lock<std::mutex> lock(mutex);
+    sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!ready()) {
+        condition.wait_for(lock, timeout);
+    }
+    sleeping.store(false, std::memory_order_relaxed);
+}
+
+// IngestionPipeline implementation
+IngestionPipeline::IngestionPipeline(Storage::SQLiteDatabase& database, ActiveIndex& activeIndex,
+                                     const IngestionOptions& options)
+    : database_(database), activeIndex_(activeIndex), options_(options), checkpointer_(nullptr),
+      running_(false), indexStopping_(false), databaseStopping_(false), flushRequests_(0),
+      checkpointValid_(true), runNs_(0),
+      entriesSubmitted_(0), entriesIndexed_(0), entriesCommitted_(0), entriesFailed_(0),
+      indexBatches_(0), databaseBatches_(0), commitFailures_(0), indexBusyNs_(0), databaseBusyNs_(0),
+      producerStalls_(0), producerStallNs_(0) {
+    options_.databaseBatchSize = std::max<size_t>(1, options_.databaseBatchSize);
+    options_.maxPendingEntries = std::max(options_.maxPendingEntries, options_.databaseBatchSize);
+}
+
+IngestionPipeline::~IngestionPipeline() {
+    stop();
+}
+
+bool IngestionPipeline::start() {
+    if (running_.load()) {
+        return true;
+    }
+
+    indexStopping_.store(false);
+    databaseStopping_.store(false);
+    checkpointValid_ = true;
+    startTime_ = std::chrono::steady_clock::now();
+    runNs_.store(0);
+
+    try {
+        running_.store(true);
+        indexThread_ = std::thread(&IngestionPipeline::indexLoop, this);
+        databaseThread_ = std::thread(&IngestionPipeline::databaseLoop, this);
+    } catch (const std::exception& e) {
+        LOG_ERROR_F("Failed to start ingestion pipeline: {}", e.what());
+        stop();
+        return false;
+    }
+
+    LOG_DEBUG_F("Ingestion pipeline started (transactions of {} entries, at most {} pending)",
+                options_.databaseBatchSize, options_.maxPendingEntries);
+    return true;
+}
+
+void IngestionPipeline::stop() {
+    if (!running_.load()) {
+        return;
+    }
+
+    // Stages shut down in order so each one drains what the previous one
+    // still forwards
+    indexStopping_.store(true);
+    indexWakeup_.notify();
+    if (indexThread_.joinable()) {
+        indexThread_.join();
+    }
+
+    databaseStopping_.store(true);
+    databaseWakeup_.notify();
+    if (databaseThread_.joinable()) {
+        databaseThread_.join();
+    }
+
+    runNs_.store(elapsedNs(startTime_));
+    running_.store(false);
+    {
+        std::lock_guard<std::mutex> lock(commitMutex_);
+    }
+    commitCondition_.notify_all();
+
+    Statistics stats = getStatistics();
+    LOG_INFO_F("Ingestion: {} entries committed in {} transactions ({}/s), {} failed; "
+               "index {}% busy, database {}% busy, bottleneck: {}",
+               entriesCommitted_.load(), stats.database.batches, static_cast<uint64_t>(stats.entriesPerSecond),
+               stats.entriesFailed, static_cast<int>(stats.index.utilization * 100),
+               static_cast<int>(stats.database.utilization * 100), stats.bottleneck);
+}
+
+void IngestionPipeline::submit(std::vector<FileEntry>&& entries, ScanPriority priority) {
+    if (entries.empty()) {
+        return;
+    }
+
+    size_t count = entries.size();
+    waitForCapacity(count);
+    entriesSubmitted_.fetch_add(count, std::memory_order_relaxed);
+
+    Batch batch;
+    batch.entries = std::move(entries);
+    batch.priority = priority;
+    scanQueue_.push(std::move(batch));
+    indexWakeup_.notify();
+}
+
+void IngestionPipeline::waitForCapacity(size_t incoming) {
+    auto hasRoom = [this, incoming]() {
+        uint64_t pending = getPendingEntries();
+        return pending == 0 || pending + incoming <= options_.maxPendingEntries || !running_.load();
+    };
+
+    if (hasRoom()) {
+        return;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    producerStalls_.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::unique_lock<std::mutex> lock(commitMutex_);
+        commitCondition_.wait(lock, hasRoom);
+    }
+    producerStallNs_.fetch_add(elapsedNs(begin), std::memory_order_relaxed);
+}
+
+bool IngestionPipeline::flush() {
+    uint64_t target = entriesSubmitted_.load();
+
+    if (running_.load()) {
+        flushRequests_.fetch_add(1);
+        indexWakeup_.notify();
+        databaseWakeup_.notify();
+        {
+            std::unique_lock<std::mutex> lock(commitMutex_);
+            commitCondition_.wait(lock, [this, target]() {
+                return entriesCommitted_.load() + entriesFailed_.load() >= target || !running_.load();
+            });
+        }
+        flushRequests_.fetch_sub(1);
+    }
+
+    return commitFailures_.load() == 0;
+}
+
+uint64_t IngestionPipeline::getPendingEntries() const {
+    uint64_t done = entriesCommitted_.load() + entriesFailed_.load();
+    uint64_t submitted = entriesSubmitted_.load();
+    return submitted > done ? submitted - done : 0;
+}
+
+void IngestionPipeline::indexLoop() {
+    uint64_t lastMarker = 1;
+    Batch batch;
+
+    while (true) {
+        // Captured before draining: every directory journaled before this
+        // point submitted its entries earlier, so the drain below forwards
+        // them ahead of the marker
+        uint64_t sequence = checkpointer_ ? checkpointer_->currentSequence() : 0;
+
+        bool received = false;
+        while (scanQueue_.pop(batch)) {
+            received = true;
+
+            // Pinned per batch: the index a rebuild swaps out stays alive
+            // until this batch is in, and the next one goes to its successor
+            auto begin = std::chrono::steady_clock::now();
+            if (auto index = activeIndex_.acquire()) {
+                index->addFilesBatch(batch.entries);
+            }
+            indexBusyNs_.fetch_add(elapsedNs(begin), std::memory_order_relaxed);
+            indexBatches_.fetch_add(1, std::memory_order_relaxed);
+            entriesIndexed_.fetch_add(batch.entries.size(), std::memory_order_relaxed);
+
+            databaseQueue_.push(std::move(batch));
+            databaseWakeup_.notify();
+            batch = Batch();
+        }
+
+        if (sequence > lastMarker) {
+            Batch marker;
+            marker.checkpointSequence = sequence;
+            databaseQueue_.push(std::move(marker));
+            databaseWakeup_.notify();
+            lastMarker = sequence;
+        }
+
+        if (!received) {
+            // Producers are done once stop() was called, so empty means drained
+            if (indexStopping_.load()) {
+                break;
+            }
+            indexWakeup_.wait(IDLE_WAIT, [this]() {
+                return !scanQueue_.empty() || indexStopping_.load();
+            });
+        }
+    }
+}
+
+void IngestionPipeline::databaseLoop() {
+    std::vector<FileEntry> pending;
+    uint64_t sequence = 0;
+    bool urgent = false;
+    auto firstPending = std::chrono::steady_clock::now();
+    Batch batch;
+
+    while (true) {
+        bool received = false;
+        while (pending.size() < options_.databaseBatchSize && databaseQueue_.pop(batch)) {
+            received = true;
+            // Markers arrive after the entries they cover, so everything
+            // before one is already in pending
+            sequence = std::max(sequence, batch.checkpointSequence);
+            if (batch.entries.empty()) {
+                continue;
+            }
+
+            if (pending.empty()) {
+                firstPending = std::chrono::steady_clock::now();
+                pending = std::move(batch.entries);
+            } else {
+                pending.insert(pending.end(), std::make_move_iterator(batch.entries.begin()),
+                               std::make_move_iterator(batch.entries.end()));
+            }
+            if (batch.priority < ScanPriority::Normal) {
+                urgent = true;
+            }
+            batch = Batch();
+        }
+
+        auto waited = std::chrono::steady_clock::now() - firstPending;
+        bool drained = databaseQueue_.empty();
+        bool due = pending.size() >= options_.databaseBatchSize || urgent ||
+                   (drained && (flushRequests_.load() > 0 || databaseStopping_.load())) ||
+                   (!pending.empty() && waited >= options_.maxCommitDelay);
+
+        // A marker with nothing pending only confirms earlier commits
+        if (due || (pending.empty() && sequence > 0)) {
+            commit(pending, sequence);
+            sequence = 0;
+            urgent = false;
+        }
+
+        if (!received) {
+            if (databaseStopping_.load() && pending.empty() && databaseQueue_.empty()) {
+                break;
+            }
+
+            auto timeout = IDLE_WAIT;
+            if (!pending.empty()) {
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    options_.maxCommitDelay - waited);
+                timeout = std::clamp(remaining, std::chrono::milliseconds(1), IDLE_WAIT);
+            }
+            databaseWakeup_.wait(timeout, [this, &pending]() {
+                return !databaseQueue_.empty() || databaseStopping_.load() ||
+                       (!pending.empty() && flushRequests_.load() > 0);
+            });
+        }
+    }
+}
+
+void IngestionPipeline::commit(std::vector<FileEntry>& pending, uint64_t checkpointSequence) {
+    if (!pending.empty()) {
+        size_t count = pending.size();
+        auto begin = std::chrono::steady_clock::now();
+        bool committed = database_.insertFilesBatch(pending);
+        databaseBusyNs_.fetch_add(elapsedNs(begin), std::memory_order_relaxed);
+        databaseBatches_.fetch_add(1, std::memory_order_relaxed);
+
+        if (committed) {
+            entriesCommitted_.fetch_add(count);
+        } else {
+            commitFailures_.fetch_add(1, std::memory_order_relaxed);
+            entriesFailed_.fetch_add(count);
+            LOG_ERROR_F("Failed to commit {} entries: {}", count, database_.getLastError());
+
+            // Later commits must not mark these directories as done
+            if (checkpointValid_ && checkpointer_) {
+                LOG_WARNING("Scan checkpoint frozen after a failed commit; a resumed scan will redo the rest");
+            }
+            checkpointValid_ = false;
+        }
+        pending.clear();
+    }
+
+    if (checkpointSequence > 0 && checkpointer_ && checkpointValid_) {
+        checkpointer_->batchCommitted(checkpointSequence);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(commitMutex_);
+    }
+    commitCondition_.notify_all();
+}
+
+IngestionPipeline::Statistics IngestionPipeline::getStatistics() const {
+    Statistics stats;
+
+    uint64_t runNs = running_.load() ? elapsedNs(startTime_) : runNs_.load();
+    stats.elapsedSeconds = runNs / 1e9;
+
+    uint64_t submitted = entriesSubmitted_.load();
+    uint64_t indexed = entriesIndexed_.load();
+    uint64_t committed = entriesCommitted_.load();
+    uint64_t failed = entriesFailed_.load();
+
+    stats.entriesSubmitted = submitted;
+    stats.entriesFailed = failed;
+    stats.commitFailures = commitFailures_.load();
+    stats.producerStalls = producerStalls_.load();
+    stats.producerStallSeconds = producerStallNs_.load() / 1e9;
+
+    stats.index.entries = indexed;
+    stats.index.batches = indexBatches_.load();
+    stats.index.queuedEntries = submitted > indexed ? submitted - indexed : 0;
+    stats.index.busySeconds = indexBusyNs_.load() / 1e9;
+
+    stats.database.entries = committed;
+    stats.database.batches = databaseBatches_.load();
+    stats.database.queuedEntries = indexed > committed + failed ? indexed - committed - failed : 0;
+    stats.database.busySeconds = databaseBusyNs_.load() / 1e9;
+
+    if (stats.elapsedSeconds > 0.0) {
+        stats.index.utilization = std::min(1.0, stats.index.busySeconds / stats.elapsedSeconds);
+        stats.database.utilization = std::min(1.0, stats.database.busySeconds / stats.elapsedSeconds);
+        stats.entriesPerSecond = committed / stats.elapsedSeconds;
+    }
+
+    // Scanners that had to wait, or a stage that was busy nearly all the
+    // time, mean a downstream stage set the pace; otherwise enumeration did
+    const StageStatistics& busiest =
+        stats.database.utilization >= stats.index.utilization ? stats.database : stats.index;
+    if (stats.producerStalls > 0 || busiest.utilization >= SATURATED_UTILIZATION) {
+        stats.bottleneck = &busiest == &stats.database ? "database" : "index";
+    }
+
+    return stats;
+}
+
+uint64_t IngestionPipeline::elapsedNs(std::chrono::steady_clock::time_point since) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - since).count());
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,127 @@
+#include "engine/move_pairer.h"
+#include <algorithm>
+
+namespace FastFileSearch {
+namespace Engine {
+
+MovePairer::MovePairer(EventSink eventSink, std::chrono::milliseconds window)
+    : eventSink_(std::move(eventSink)), window_(window) {
+}
+
+void MovePairer::movedFrom(uint32_t cookie, const std::string& path, bool isDirectory) {
+    // Keep the order of anything already held at or around this path
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        if (related(it->path, path)) {
+            stats_.released++;
+            release(*it);
+            it = pending_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (pending_.size() >= MAX_PENDING) {
+        stats_.movedOut++;
+        release(pending_.front());
+        pending_.pop_front();
+    }
+    pending_.push_back({cookie, path, isDirectory, std::chrono::steady_clock::now() + window_});
+}
+
+void MovePairer::movedTo(uint32_t cookie, const std::string& path, bool isDirectory) {
+    auto match = std::find_if(pending_.begin(), pending_.end(),
+                              [cookie](const PendingMove& move) { return move.cookie == cookie; });
+
+    if (match == pending_.end()) {
+        pass(FileChangeEvent(FileChangeType::Created, path), isDirectory);
+        stats_.movedIn++;
+        return;
+    }
+
+    std::string oldPath = std::move(match->path);
+    pending_.erase(match);
+
+    // Halves held from before this rename go out first
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        if (related(it->path, oldPath) || related(it->path, path)) {
+            stats_.released++;
+            release(*it);
+            it = pending_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    stats_.paired++;
+    if (eventSink_) {
+        eventSink_(FileChangeEvent(classify(oldPath, path), path, oldPath), isDirectory);
+    }
+}
+
+void MovePairer::pass(const FileChangeEvent& event, bool isDirectory) {
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        if (related(it->path, event.path) || (!event.oldPath.empty() && related(it->path, event.oldPath))) {
+            stats_.released++;
+            release(*it);
+            it = pending_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (eventSink_) {
+        eventSink_(event, isDirectory);
+    }
+}
+
+std::chrono::milliseconds MovePairer::expire() {
+    auto now = std::chrono::steady_clock::now();
+    while (!pending_.empty() && pending_.front().expires <= now) {
+        stats_.movedOut++;
+        release(pending_.front());
+        pending_.pop_front();
+    }
+
+    if (pending_.empty()) {
+        return std::chrono::milliseconds::max();
+    }
+    auto wait = std::chrono::ceil<std::chrono::milliseconds>(pending_.front().expires - now);
+    return std::max(wait, std::chrono::milliseconds(1));
+}
+
+void MovePairer::flush() {
+    while (!pending_.empty()) {
+        stats_.movedOut++;
+        release(pending_.front());
+        pending_.pop_front();
+    }
+}
+
+void MovePairer::release(const PendingMove& move) {
+    if (eventSink_) {
+        eventSink_(FileChangeEvent(FileChangeType::Deleted, move.path), move.isDirectory);
+    }
+}
+
+FileChangeType MovePairer::classify(const std::string& oldPath, const std::string& newPath) {
+    size_t oldSlash = oldPath.find_last_of('/');
+    size_t newSlash = newPath.find_last_of('/');
+    if (oldSlash == newSlash && oldPath.compare(0, oldSlash, newPath, 0, newSlash) == 0) {
+        return FileChangeType::Renamed;
+    }
+    return FileChangeType::Moved;
+}
+
+// Same path, or one is inside the other
+bool MovePairer::related(const std::string& a, const std::string& b) {
+    const std::string& shorter = a.size() <= b.size() ? a : b;
+    const std::string& longer = a.size() <= b.size() ? b : a;
+    if (longer.compare(0, shorter.size(), shorter) != 0) {
+        return false;
+    }
+    return longer.size() == shorter.size() || longer[shorter.size()] == '/' ||
+           (!shorter.empty() && shorter.back() == '/');
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
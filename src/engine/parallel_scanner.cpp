@@ -0,0 +1,357 @@
+#include "engine/parallel_scanner.h"
+#include "core/logger.h"
+#include <algorithm>
+
+namespace FastFileSearch {
+namespace Engine {
+
+ParallelScanner::ParallelScanner(size_t numThreads, const ScanOptions& options)
+    : numThreads_(std::max<size_t>(1, numThreads)), options_(options), pool_(numThreads_, SCAN_PRIORITY_LEVELS),
+      appliedFactor_(1.0), isRunning_(false), shouldStop_(false), isPaused_(false),
+      directoriesScanned_(0), entriesFound_(0), statCalls_(0),
+      directoriesPruned_(0), deferrals_(0), duplicatesSkipped_(0), mountsSkipped_(0),
+      hardlinkDuplicates_(0), errors_(0) {
+}
+
+ParallelScanner::~ParallelScanner() {
+    stop();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+bool ParallelScanner::run(const std::vector<std::string>& roots) {
+    if (isRunning_.exchange(true)) {
+        LOG_WARNING("ParallelScanner::run() called while a scan is already in progress");
+        return false;
+    }
+
+    shouldStop_.store(false);
+    pool_.reset();
+    deferred_.clear();
+    visited_.clear();
+
+    ScannedDirectory rootInfo;
+    for (const auto& root : roots) {
+        ScanTask task;
+        task.path = root;
+        if ((deviceScheduler_ || options_.stayOnFilesystem) && DirectoryScanner::statDirectory(root, rootInfo)) {
+            task.device = rootInfo.device;
+            task.rootDevice = rootInfo.device;
+        }
+        if (priorityPlanner_) {
+            task.priority = priorityPlanner_->forRoot(root);
+        }
+        size_t band = static_cast<size_t>(task.priority.priority);
+        pool_.pushExternal(std::move(task), band);
+    }
+
+    LOG_INFO_F("Scanning {} root(s) with {} thread(s)", roots.size(), numThreads_);
+
+    workers_.clear();
+    workers_.reserve(numThreads_);
+    for (size_t i = 0; i < numThreads_; ++i) {
+        workers_.emplace_back(&ParallelScanner::workerLoop, this, i);
+    }
+
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+
+    bool completed = !shouldStop_.load() && pool_.isDone();
+    isRunning_.store(false);
+
+    LOG_INFO_F("Scan {}: {} directories, {} entries, {} steals",
+               completed ? "completed" : "stopped",
+               directoriesScanned_.load(), entriesFound_.load(), pool_.getStealCount());
+    return completed;
+}
+
+void ParallelScanner::workerLoop(size_t workerIndex) {
+    // Workers are created per run, so lowering their priority here never
+    // leaks into other threads
+    struct ThrottleAttachment {
+        ScanThrottle* throttle;
+        explicit ThrottleAttachment(ScanThrottle* attached) : throttle(attached) {
+            if (throttle) {
+                throttle->attachWorker();
+            }
+        }
+        ~ThrottleAttachment() {
+            if (throttle) {
+                throttle->detachWorker();
+            }
+        }
+    } attachment(throttle_.get());
+
+    // The workers are the parallelism: a fallback stat pool per worker would
+    // multiply threads and run them outside the throttle's priority
+    ScanOptions workerOptions = options_;
+    workerOptions.metadataThreads = 0;
+    auto scanner = DirectoryScanner::create(workerOptions);
+    ScannedDirectory scanned;
+    TaskBands children;
+    ScanTask task;
+
+    uint64_t rootDevice = 0;
+    scanner->setOpenCheck([this, &rootDevice](uint64_t device, uint64_t inode) {
+        return admitDirectory(device, inode, rootDevice);
+    });
+
+    while (pool_.acquire(workerIndex, task)) {
+        if (!waitWhilePaused()) {
+            pool_.complete();
+            break;
+        }
+
+        if (!acquireOrDefer(task)) {
+            continue;
+        }
+
+        // Keep reading from this device while it has parked directories
+        bool hasNext = true;
+        while (hasNext) {
+            rootDevice = task.rootDevice;
+            auto started = std::chrono::steady_clock::now();
+            scanTask(workerIndex, *scanner, task, scanned, children);
+            auto latency = std::chrono::steady_clock::now() - started;
+
+            if (!deviceScheduler_) {
+                throttle(scanned);
+                break;
+            }
+
+            uint64_t device = task.device;
+            hasNext = finishAndTakeDeferred(workerIndex, task, latency, task);
+            // Holding the next slot while throttled is fine: the budget is
+            // shared, so any other reader would have to wait as well
+            bool proceed = throttle(scanned);
+            if (hasNext && (!proceed || !waitWhilePaused())) {
+                deviceScheduler_->release(device, std::chrono::nanoseconds(0));
+                pool_.complete();
+                return;
+            }
+        }
+    }
+}
+
+void ParallelScanner::scanTask(size_t workerIndex, DirectoryScanner& scanner, const ScanTask& task,
+                               ScannedDirectory& scanned, TaskBands& children) {
+    if (scanner.scanDirectory(task.path, scanned) && !scanned.skipped) {
+        directoriesScanned_.fetch_add(1, std::memory_order_relaxed);
+        entriesFound_.fetch_add(scanned.entries.size(), std::memory_order_relaxed);
+
+        if (directoryFilter_) {
+            auto pruned = std::remove_if(scanned.subdirectories.begin(), scanned.subdirectories.end(),
+                                         [this](const std::string& subdirectory) {
+                                             return !directoryFilter_(subdirectory);
+                                         });
+            directoriesPruned_.fetch_add(std::distance(pruned, scanned.subdirectories.end()),
+                                         std::memory_order_relaxed);
+            scanned.subdirectories.erase(pruned, scanned.subdirectories.end());
+        }
+
+        // Children go onto our own deque as a single batch before this
+        // directory is completed, which keeps termination detection exact.
+        // They are assumed to share the parent's device; a mount point is
+        // corrected once it has been opened.
+        uint64_t childDevice = scanned.device != 0 ? scanned.device : task.device;
+        uint64_t childRootDevice = task.rootDevice != 0 ? task.rootDevice : scanned.device;
+        ScanPriorityPlanner::ParentContext parentContext;
+        if (priorityPlanner_ && !scanned.subdirectories.empty()) {
+            parentContext = priorityPlanner_->forParent(task.priority, scanned.modifiedNs);
+        }
+        for (const auto& subdirectory : scanned.subdirectories) {
+            ScanTask child{subdirectory, childDevice, childRootDevice, task.priority};
+            if (parentContext.hints) {
+                child.priority = ScanPriorityPlanner::forChild(subdirectory, parentContext);
+            }
+            children[static_cast<size_t>(child.priority.priority)].push_back(std::move(child));
+        }
+        for (size_t band = 0; band < children.size(); ++band) {
+            pool_.pushBatch(workerIndex, children[band], band);
+            children[band].clear();
+        }
+
+        scanned.priority = task.priority.priority;
+
+        if (hardlinks_) {
+            for (const auto& entry : scanned.entries) {
+                if (entry.linkCount > 1 && entry.isFile() && !hardlinks_->record(entry)) {
+                    hardlinkDuplicates_.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        if (directoryCallback_) {
+            try {
+                directoryCallback_(scanned, workerIndex);
+            } catch (const std::exception& e) {
+                LOG_ERROR_F("Error processing directory {}: {}", task.path, e.what());
+                errors_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    statCalls_.fetch_add(scanned.statCalls, std::memory_order_relaxed);
+    errors_.fetch_add(scanned.errors, std::memory_order_relaxed);
+    pool_.complete();
+}
+
+// Taking a slot and parking happen under deferredMutex_, as do releasing and
+// checking for parked work, so a directory can never be parked on a device
+// that no worker is reading from
+bool ParallelScanner::acquireOrDefer(ScanTask& task) {
+    if (!deviceScheduler_) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(deferredMutex_);
+    if (deviceScheduler_->tryAcquire(task.device)) {
+        return true;
+    }
+
+    deferred_[task.device][static_cast<size_t>(task.priority.priority)].push_back(std::move(task));
+    deferrals_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool ParallelScanner::finishAndTakeDeferred(size_t workerIndex, const ScanTask& finished,
+                                            std::chrono::nanoseconds latency, ScanTask& next) {
+    uint64_t device = finished.device;
+
+    std::lock_guard<std::mutex> lock(deferredMutex_);
+    auto it = deferred_.find(device);
+    std::vector<ScanTask>* parked = nullptr;
+    if (it != deferred_.end()) {
+        for (auto& band : it->second) {
+            if (!band.empty()) {
+                parked = &band;
+                break;
+            }
+        }
+    }
+
+    if (!parked) {
+        deviceScheduler_->release(device, latency);
+        return false;
+    }
+
+    if (!deviceScheduler_->recordAndKeep(device, latency)) {
+        // Over the limit; the device's remaining readers drain the queue
+        return false;
+    }
+
+    next = std::move(parked->back());
+    parked->pop_back();
+
+    // The limit grew: let an idle worker start another reader
+    if (!parked->empty() && deviceScheduler_->hasCapacity(device)) {
+        size_t band = static_cast<size_t>(parked->back().priority.priority);
+        pool_.requeue(workerIndex, std::move(parked->back()), band);
+        parked->pop_back();
+    }
+    return true;
+}
+
+bool ParallelScanner::admitDirectory(uint64_t device, uint64_t inode, uint64_t rootDevice) {
+    if (options_.stayOnFilesystem && rootDevice != 0 && device != rootDevice) {
+        mountsSkipped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    if (inode != 0 && !visited_.insert(device, inode)) {
+        duplicatesSkipped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+// Returns false if the scan was stopped while waiting for the budget
+bool ParallelScanner::throttle(const ScannedDirectory& scanned) {
+    if (!throttle_) {
+        return !shouldStop_.load();
+    }
+
+    // open, getdents until it returns nothing, close, plus the stats issued
+    uint64_t syscalls = scanned.statCalls + 3;
+    bool proceed = throttle_->admit(scanned.entries.size(), syscalls, shouldStop_);
+
+    double factor = throttle_->getFactor();
+    if (deviceScheduler_ && appliedFactor_.exchange(factor) != factor) {
+        deviceScheduler_->setConcurrencyScale(factor);
+    }
+    return proceed;
+}
+
+bool ParallelScanner::waitWhilePaused() {
+    if (!isPaused_.load()) {
+        return !shouldStop_.load();
+    }
+
+    std::unique_lock<std::mutex> lock(pauseMutex_);
+    pauseCondition_.wait(lock, [this] { return !isPaused_.load() || shouldStop_.load(); });
+    return !shouldStop_.load();
+}
+
+void ParallelScanner::pause() {
+    isPaused_.store(true);
+}
+
+void ParallelScanner::resume() {
+    {
+        std::lock_guard<std::mutex> lock(pauseMutex_);
+        isPaused_.store(false);
+    }
+    pauseCondition_.notify_all();
+}
+
+void ParallelScanner::stop() {
+    {
+        std::lock_guard<std::mutex> lock(pauseMutex_);
+        shouldStop_.store(true);
+    }
+    pauseCondition_.notify_all();
+    pool_.shutdown();
+}
+
+void ParallelScanner::setDirectoryCallback(DirectoryCallback callback) {
+    directoryCallback_ = std::move(callback);
+}
+
+void ParallelScanner::setDirectoryFilter(DirectoryFilter filter) {
+    directoryFilter_ = std::move(filter);
+}
+
+ParallelScanner::Statistics ParallelScanner::getStatistics() const {
+    Statistics stats;
+    stats.directoriesScanned = directoriesScanned_.load();
+    stats.entriesFound = entriesFound_.load();
+    stats.statCalls = statCalls_.load();
+    stats.directoriesPruned = directoriesPruned_.load();
+    stats.steals = pool_.getStealCount();
+    stats.deferrals = deferrals_.load();
+    stats.duplicatesSkipped = duplicatesSkipped_.load();
+    stats.mountsSkipped = mountsSkipped_.load();
+    stats.hardlinkDuplicates = hardlinkDuplicates_.load();
+    stats.errors = errors_.load();
+    return stats;
+}
+
+void ParallelScanner::resetStatistics() {
+    directoriesScanned_.store(0);
+    entriesFound_.store(0);
+    statCalls_.store(0);
+    directoriesPruned_.store(0);
+    deferrals_.store(0);
+    duplicatesSkipped_.store(0);
+    mountsSkipped_.store(0);
+    hardlinkDuplicates_.store(0);
+    errors_.store(0);
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,356 @@
+#include "engine/reconcile_scanner.h"
+#include "engine/parallel_scanner.h"
+#include "core/logger.h"
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+
+namespace FastFileSearch {
+namespace Engine {
+
+namespace {
+
+// Known directories are handed to checking threads in chunks of this size
+const size_t CHECK_CHUNK_SIZE = 256;
+
+} // namespace
+
+ReconcileScanner::ReconcileScanner(Storage::ScanStateStore& stateStore, size_t numThreads,
+                                   const ScanOptions& options)
+    : stateStore_(stateStore), numThreads_(std::max<size_t>(1, numThreads)), options_(options),
+      batchSize_(1000), shouldStop_(false),
+      directoriesChecked_(0), directoriesRescanned_(0), directoriesRemoved_(0),
+      newDirectoriesScanned_(0), created_(0), deleted_(0), modified_(0) {
+}
+
+void ReconcileScanner::setIndexedChildrenProvider(IndexedChildrenProvider provider) {
+    childrenProvider_ = std::move(provider);
+}
+
+void ReconcileScanner::setBatchCallback(BatchCallback callback) {
+    batchCallback_ = std::move(callback);
+}
+
+Storage::DirectoryStamp ReconcileScanner::makeStamp(const ScannedDirectory& scanned) {
+    Storage::DirectoryStamp stamp;
+    stamp.path = scanned.path;
+    stamp.device = scanned.device;
+    stamp.inode = scanned.inode;
+    stamp.modifiedNs = scanned.modifiedNs;
+    stamp.changedNs = scanned.changedNs;
+    stamp.childCount = scanned.entries.size();
+    stamp.lastScanned = std::time(nullptr);
+    return stamp;
+}
+
+// Leaves shouldStop_ alone: a stop() that arrives before reconcile() gets
+// here must still cut the pass short
+void ReconcileScanner::resetState() {
+    pendingEvents_.clear();
+    pendingStamps_.clear();
+    removedDirectories_.clear();
+    newDirectories_.clear();
+    roots_.clear();
+    rescanned_.clear();
+
+    directoriesChecked_.store(0);
+    directoriesRescanned_.store(0);
+    directoriesRemoved_.store(0);
+    newDirectoriesScanned_.store(0);
+    created_.store(0);
+    deleted_.store(0);
+    modified_.store(0);
+}
+
+bool ReconcileScanner::reconcile(const std::vector<std::string>& roots) {
+    return reconcile(roots, {});
+}
+
+bool ReconcileScanner::reconcile(const std::vector<std::string>& roots,
+                                 const std::vector<std::string>& forcedDirectories) {
+    resetState();
+
+    std::vector<Storage::DirectoryStamp> known;
+    for (const auto& root : roots) {
+        roots_.insert(root);
+
+        auto stamps = stateStore_.loadDirectoryStamps(root);
+        if (stamps.empty()) {
+            // Never scanned (or stamps were lost): nothing to compare against
+            LOG_INFO_F("No directory stamps for {}, scanning it in full", root);
+            newDirectories_.push_back(root);
+            continue;
+        }
+
+        known.insert(known.end(), std::make_move_iterator(stamps.begin()),
+                     std::make_move_iterator(stamps.end()));
+    }
+
+    LOG_INFO_F("Reconciling {} known directories under {} root(s)", known.size(), roots.size());
+
+    // Phase 1: stat every known directory, re-read the changed ones
+    std::atomic<size_t> cursor(0);
+    size_t numCheckers = std::min(numThreads_, known.size() / CHECK_CHUNK_SIZE + 1);
+    std::vector<std::thread> checkers;
+    checkers.reserve(numCheckers);
+    for (size_t i = 0; i < numCheckers; ++i) {
+        checkers.emplace_back(&ReconcileScanner::checkDirectories, this, std::cref(known), std::ref(cursor));
+    }
+    for (auto& checker : checkers) {
+        checker.join();
+    }
+    if (!shouldStop_.load()) {
+        rescanForced(forcedDirectories);
+    }
+
+    // Phase 2: walk directories that did not exist at the last scan
+    bool completed = !shouldStop_.load() && scanNewDirectories();
+
+    // Forget stamps of directories that are gone, including their subtrees
+    for (const auto& removed : removedDirectories_) {
+        stateStore_.deleteDirectoryStampsUnder(removed);
+    }
+
+    flushStamps();
+    {
+        std::lock_guard<std::mutex> lock(outputMutex_);
+        flushEventsLocked();
+    }
+
+    Result result = getResult();
+    LOG_INFO_F("Reconcile {}: checked {}, rescanned {}, new {}, removed {} directories; "
+               "{} created, {} deleted, {} modified",
+               completed ? "completed" : "stopped",
+               result.directoriesChecked, result.directoriesRescanned, result.newDirectoriesScanned,
+               result.directoriesRemoved, result.created, result.deleted, result.modified);
+    return completed;
+}
+
+// Nanosecond times where both sides have them; entries indexed before they
+// were recorded only have whole seconds to go by
+bool ReconcileScanner::isModified(const FileEntry& previous, const FileEntry& current) {
+    if (previous.size != current.size) {
+        return true;
+    }
+    if (previous.modifiedNs == 0 || current.modifiedNs == 0) {
+        return previous.lastModified != current.lastModified;
+    }
+    if (previous.modifiedNs != current.modifiedNs) {
+        return true;
+    }
+    // Catches a write that restored the mtime (tar, rsync -t)
+    return previous.changedNs != 0 && current.changedNs != 0 && previous.changedNs != current.changedNs;
+}
+
+void ReconcileScanner::checkDirectories(const std::vector<Storage::DirectoryStamp>& known,
+                                        std::atomic<size_t>& cursor) {
+    // Checkers already run in parallel; stat on this thread instead of a pool per checker
+    ScanOptions checkerOptions = options_;
+    checkerOptions.metadataThreads = 0;
+    auto scanner = DirectoryScanner::create(checkerOptions);
+    ScannedDirectory current;
+
+    while (!shouldStop_.load()) {
+        size_t begin = cursor.fetch_add(CHECK_CHUNK_SIZE);
+        if (begin >= known.size()) {
+            break;
+        }
+        size_t end = std::min(begin + CHECK_CHUNK_SIZE, known.size());
+
+        for (size_t i = begin; i < end && !shouldStop_.load(); ++i) {
+            const auto& stamp = known[i];
+            directoriesChecked_.fetch_add(1, std::memory_order_relaxed);
+
+            if (!DirectoryScanner::statDirectory(stamp.path, current)) {
+                if (roots_.count(stamp.path) > 0) {
+                    // An unavailable root is treated as offline, not as deleted
+                    LOG_WARNING_F("Root {} is not accessible, skipping reconcile", stamp.path);
+                    continue;
+                }
+
+                // The parent's stamp changed too, so its diff reports the delete
+                directoriesRemoved_.fetch_add(1, std::memory_order_relaxed);
+                std::lock_guard<std::mutex> lock(outputMutex_);
+                removedDirectories_.push_back(stamp.path);
+                continue;
+            }
+
+            if (stamp.matches(makeStamp(current))) {
+                continue;
+            }
+
+            rescanDirectory(*scanner, stamp.path);
+        }
+    }
+}
+
+void ReconcileScanner::rescanDirectory(DirectoryScanner& scanner, const std::string& path) {
+    ScannedDirectory scanned;
+    if (!scanner.scanDirectory(path, scanned)) {
+        return;
+    }
+    directoriesRescanned_.fetch_add(1, std::memory_order_relaxed);
+
+    std::vector<FileEntry> indexed;
+    if (childrenProvider_) {
+        indexed = childrenProvider_(path);
+    }
+
+    std::unordered_map<std::string, const FileEntry*> indexedByPath;
+    indexedByPath.reserve(indexed.size());
+    for (const auto& entry : indexed) {
+        indexedByPath.emplace(entry.fullPath, &entry);
+    }
+
+    std::vector<std::string> newDirectories;
+
+    for (const auto& entry : scanned.entries) {
+        auto it = indexedByPath.find(entry.fullPath);
+
+        if (it == indexedByPath.end()) {
+            emitEvent(FileChangeType::Created, entry.fullPath);
+            if (entry.isDirectory()) {
+                newDirectories.push_back(entry.fullPath);
+            }
+            continue;
+        }
+
+        const FileEntry& previous = *it->second;
+        if (previous.type != entry.type) {
+            // Replaced by something of a different kind
+            emitEvent(FileChangeType::Deleted, entry.fullPath);
+            emitEvent(FileChangeType::Created, entry.fullPath);
+            if (entry.isDirectory()) {
+                newDirectories.push_back(entry.fullPath);
+            }
+        } else if (entry.isFile() && isModified(previous, entry)) {
+            emitEvent(FileChangeType::Modified, entry.fullPath);
+        }
+
+        indexedByPath.erase(it);
+    }
+
+    // Whatever is left in the index no longer exists on disk
+    for (const auto& [removedPath, removedEntry] : indexedByPath) {
+        emitEvent(FileChangeType::Deleted, removedPath);
+    }
+
+    std::lock_guard<std::mutex> lock(outputMutex_);
+    rescanned_.insert(path);
+    for (const auto& [removedPath, removedEntry] : indexedByPath) {
+        if (removedEntry->isDirectory()) {
+            removedDirectories_.push_back(removedPath);
+        }
+    }
+    newDirectories_.insert(newDirectories_.end(), newDirectories.begin(), newDirectories.end());
+    pendingStamps_.push_back(makeStamp(scanned));
+}
+
+// Directories whose watcher events were dropped: their stamps may match
+// while files in them were modified in place
+void ReconcileScanner::rescanForced(const std::vector<std::string>& directories) {
+    if (directories.empty()) {
+        return;
+    }
+    // Like the checkers: stat on this thread, no pool for a handful of directories
+    ScanOptions forcedOptions = options_;
+    forcedOptions.metadataThreads = 0;
+    auto scanner = DirectoryScanner::create(forcedOptions);
+    ScannedDirectory current;
+
+    for (const auto& directory : directories) {
+        if (shouldStop_.load()) {
+            break;
+        }
+        {
+            std::lock_guard<std::mutex> lock(outputMutex_);
+            if (rescanned_.count(directory) > 0) {
+                continue;   // Its stamp had changed, already diffed
+            }
+        }
+
+        if (!DirectoryScanner::statDirectory(directory, current)) {
+            if (roots_.count(directory) > 0) {
+                continue;
+            }
+            // Deleting the directory takes its indexed subtree with it
+            directoriesRemoved_.fetch_add(1, std::memory_order_relaxed);
+            emitEvent(FileChangeType::Deleted, directory);
+            std::lock_guard<std::mutex> lock(outputMutex_);
+            removedDirectories_.push_back(directory);
+            continue;
+        }
+
+        rescanDirectory(*scanner, directory);
+    }
+}
+
+bool ReconcileScanner::scanNewDirectories() {
+    if (newDirectories_.empty()) {
+        return true;
+    }
+
+    // Subdirectories of a new directory are new as well, so a full
+    // traversal reports every entry below them as created
+    ParallelScanner scanner(numThreads_, options_);
+    scanner.setDirectoryCallback([this](const ScannedDirectory& scanned, size_t) {
+        newDirectoriesScanned_.fetch_add(1, std::memory_order_relaxed);
+        for (const auto& entry : scanned.entries) {
+            emitEvent(FileChangeType::Created, entry.fullPath);
+        }
+
+        std::lock_guard<std::mutex> lock(outputMutex_);
+        pendingStamps_.push_back(makeStamp(scanned));
+    });
+
+    std::vector<std::string> roots;
+    roots.swap(newDirectories_);
+    return scanner.run(roots);
+}
+
+void ReconcileScanner::emitEvent(FileChangeType type, const std::string& path) {
+    switch (type) {
+        case FileChangeType::Created: created_.fetch_add(1, std::memory_order_relaxed); break;
+        case FileChangeType::Deleted: deleted_.fetch_add(1, std::memory_order_relaxed); break;
+        case FileChangeType::Modified: modified_.fetch_add(1, std::memory_order_relaxed); break;
+        default: break;
+    }
+
+    std::lock_guard<std::mutex> lock(outputMutex_);
+    pendingEvents_.emplace_back(type, path);
+    if (pendingEvents_.size() >= batchSize_) {
+        flushEventsLocked();
+    }
+}
+
+// Caller holds outputMutex_. Batches are delivered under the lock so the
+// consumer sees them in discovery order.
+void ReconcileScanner::flushEventsLocked() {
+    if (!pendingEvents_.empty() && batchCallback_) {
+        batchCallback_(pendingEvents_);
+    }
+    pendingEvents_.clear();
+}
+
+void ReconcileScanner::flushStamps() {
+    std::lock_guard<std::mutex> lock(outputMutex_);
+    if (!stateStore_.saveDirectoryStamps(pendingStamps_)) {
+        LOG_WARNING("Failed to persist directory stamps; next reconcile will rescan more than needed");
+    }
+    pendingStamps_.clear();
+}
+
+ReconcileScanner::Result ReconcileScanner::getResult() const {
+    Result result;
+    result.directoriesChecked = directoriesChecked_.load();
+    result.directoriesRescanned = directoriesRescanned_.load();
+    result.directoriesRemoved = directoriesRemoved_.load();
+    result.newDirectoriesScanned = newDirectoriesScanned_.load();
+    result.created = created_.load();
+    result.deleted = deleted_.load();
+    result.modified = modified_.load();
+    return result;
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
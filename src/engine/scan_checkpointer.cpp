@@ -0,0 +1,209 @@
+#include "engine/scan_checkpointer.h"
+#include "core/logger.h"
+#include <algorithm>
+#include <sstream>
+#include <ctime>
+
+namespace FastFileSearch {
+namespace Engine {
+
+namespace {
+
+const char* ROOTS_KEY = "roots";
+const char* STARTED_KEY = "started_at";
+
+} // namespace
+
+ScanCheckpointer::ScanCheckpointer(Storage::ScanStateStore& stateStore, std::chrono::seconds interval)
+    : stateStore_(stateStore), interval_(interval), nextSequence_(1),
+      lastPersist_(std::chrono::steady_clock::now()), checkpointsWritten_(0), lastCheckpoint_(0) {
+}
+
+void ScanCheckpointer::resetLocked() {
+    journal_.clear();
+    frontier_.clear();
+    completed_.clear();
+    frontierDelta_.clear();
+    completedDelta_.clear();
+    lastPersist_ = std::chrono::steady_clock::now();
+}
+
+bool ScanCheckpointer::begin(const std::vector<std::string>& roots) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    resetLocked();
+
+    if (!stateStore_.clearCheckpoint()) {
+        return false;
+    }
+
+    std::string joinedRoots;
+    for (const auto& root : roots) {
+        joinedRoots += root;
+        joinedRoots += '\n';
+        setFrontierLocked(root, true);
+    }
+
+    stateStore_.setCheckpointValue(ROOTS_KEY, joinedRoots);
+    stateStore_.setCheckpointValue(STARTED_KEY, std::to_string(std::time(nullptr)));
+    return persistLocked();
+}
+
+bool ScanCheckpointer::resume(std::vector<std::string>& frontier, std::vector<std::string>& roots) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    resetLocked();
+
+    std::vector<std::string> completed;
+    if (!stateStore_.loadCheckpoint(frontier, completed)) {
+        return false;
+    }
+
+    frontier_.insert(frontier.begin(), frontier.end());
+    completed_.insert(completed.begin(), completed.end());
+
+    roots.clear();
+    std::istringstream stream(stateStore_.getCheckpointValue(ROOTS_KEY));
+    std::string root;
+    while (std::getline(stream, root)) {
+        if (!root.empty()) {
+            roots.push_back(root);
+        }
+    }
+
+    LOG_INFO_F("Resuming interrupted scan: {} pending directories, {} completed markers",
+               frontier_.size(), completed_.size());
+    return true;
+}
+
+bool ScanCheckpointer::hasCheckpoint() const {
+    return stateStore_.hasCheckpoint();
+}
+
+uint64_t ScanCheckpointer::directoryScanned(const std::string& path, const std::vector<std::string>& children) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t sequence = nextSequence_++;
+    journal_.push_back({sequence, path, children});
+    return sequence;
+}
+
+uint64_t ScanCheckpointer::currentSequence() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nextSequence_;
+}
+
+void ScanCheckpointer::batchCommitted(uint64_t sequence) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    applyJournalLocked(sequence);
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastPersist_ >= interval_) {
+        persistLocked();
+    }
+}
+
+// Journal entries are appended in sequence order, so the committed ones form
+// a prefix
+void ScanCheckpointer::applyJournalLocked(uint64_t sequence) {
+    auto end = std::find_if(journal_.begin(), journal_.end(),
+                            [sequence](const JournalEntry& entry) { return entry.sequence >= sequence; });
+
+    for (auto it = journal_.begin(); it != end; ++it) {
+        if (frontier_.count(it->path) > 0) {
+            setFrontierLocked(it->path, false);
+        } else {
+            // Committed before the parent that discovered it
+            setCompletedLocked(it->path, true);
+        }
+
+        for (const auto& child : it->children) {
+            if (completed_.count(child) > 0) {
+                setCompletedLocked(child, false);
+            } else {
+                setFrontierLocked(child, true);
+            }
+        }
+    }
+
+    journal_.erase(journal_.begin(), end);
+}
+
+void ScanCheckpointer::setFrontierLocked(const std::string& path, bool present) {
+    if (present) {
+        frontier_.insert(path);
+    } else {
+        frontier_.erase(path);
+    }
+    frontierDelta_[path] = present;
+}
+
+void ScanCheckpointer::setCompletedLocked(const std::string& path, bool present) {
+    if (present) {
+        completed_.insert(path);
+    } else {
+        completed_.erase(path);
+    }
+    completedDelta_[path] = present;
+}
+
+bool ScanCheckpointer::shouldScan(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return completed_.count(path) == 0;
+}
+
+bool ScanCheckpointer::persist() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return persistLocked();
+}
+
+bool ScanCheckpointer::persistLocked() {
+    lastPersist_ = std::chrono::steady_clock::now();
+    if (frontierDelta_.empty() && completedDelta_.empty()) {
+        return true;
+    }
+
+    std::vector<std::string> frontierAdded, frontierRemoved, completedAdded, completedRemoved;
+    for (const auto& [path, present] : frontierDelta_) {
+        (present ? frontierAdded : frontierRemoved).push_back(path);
+    }
+    for (const auto& [path, present] : completedDelta_) {
+        (present ? completedAdded : completedRemoved).push_back(path);
+    }
+
+    if (!stateStore_.saveCheckpointDelta(frontierAdded, frontierRemoved, completedAdded, completedRemoved)) {
+        // Keep the deltas; the next attempt writes them again
+        LOG_WARNING("Failed to persist scan checkpoint");
+        return false;
+    }
+
+    frontierDelta_.clear();
+    completedDelta_.clear();
+    checkpointsWritten_++;
+    lastCheckpoint_ = std::time(nullptr);
+
+    LOG_DEBUG_F("Scan checkpoint written: {} pending directories", frontier_.size());
+    return true;
+}
+
+bool ScanCheckpointer::finish() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    resetLocked();
+    return stateStore_.clearCheckpoint();
+}
+
+void ScanCheckpointer::setInterval(std::chrono::seconds interval) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    interval_ = interval;
+}
+
+ScanCheckpointer::Statistics ScanCheckpointer::getStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Statistics stats;
+    stats.frontierSize = frontier_.size();
+    stats.completedMarkers = completed_.size();
+    stats.journaledDirectories = journal_.size();
+    stats.checkpointsWritten = checkpointsWritten_;
+    stats.lastCheckpoint = lastCheckpoint_;
+    return stats;
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
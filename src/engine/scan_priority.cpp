@@ -0,0 +1,233 @@
+#include "engine/scan_priority.h"
+#include "core/logger.h"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <system_error>
+
+namespace FastFileSearch {
+namespace Engine {
+
+const char* scanPriorityName(ScanPriority priority) {
+    switch (priority) {
+        case ScanPriority::Hot: return "hot";
+        case ScanPriority::User: return "user";
+        case ScanPriority::Recent: return "recent";
+        default: return "normal";
+    }
+}
+
+ScanPriorityPlanner::ScanPriorityPlanner() : hints_(std::make_shared<const Hints>()) {
+}
+
+std::string ScanPriorityPlanner::normalize(const std::string& path) {
+    std::string result = path;
+    while (result.size() > 1 && (result.back() == '/' || result.back() == '\\')) {
+        result.pop_back();
+    }
+    return result;
+}
+
+std::string ScanPriorityPlanner::parentOf(const std::string& path) {
+    size_t pos = path.find_last_of("/\\");
+    if (pos == std::string::npos) {
+        return "";
+    }
+    if (pos == 0) {
+        return path.size() > 1 ? path.substr(0, 1) : "";
+    }
+    return path.substr(0, pos);
+}
+
+std::shared_ptr<const ScanPriorityPlanner::Hints> ScanPriorityPlanner::loadHints() const {
+    std::shared_lock<std::shared_mutex> lock(hintsMutex_);
+    return hints_;
+}
+
+// Caller holds mutex_
+void ScanPriorityPlanner::storeHints(std::shared_ptr<const Hints> hints) {
+    std::unique_lock<std::shared_mutex> lock(hintsMutex_);
+    hints_ = std::move(hints);
+}
+
+void ScanPriorityPlanner::addSubtree(const std::string& path, ScanPriority priority) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto hints = std::make_shared<Hints>(*loadHints());
+    addSubtree(*hints, path, priority);
+    storeHints(std::move(hints));
+}
+
+void ScanPriorityPlanner::addSubtree(Hints& hints, const std::string& path, ScanPriority priority) {
+    std::string normalized = normalize(path);
+    if (normalized.empty()) {
+        return;
+    }
+
+    auto [it, inserted] = hints.subtrees.emplace(normalized, priority);
+    if (!inserted) {
+        it->second = higher(it->second, priority);
+    }
+
+    for (std::string ancestor = parentOf(normalized); !ancestor.empty(); ancestor = parentOf(ancestor)) {
+        auto [ancestorIt, added] = hints.ancestors.emplace(ancestor, priority);
+        if (!added) {
+            ancestorIt->second = higher(ancestorIt->second, priority);
+        }
+        if (ancestor.size() == 1) {
+            break;
+        }
+    }
+}
+
+void ScanPriorityPlanner::addHomeDirectories() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto hints = std::make_shared<Hints>(*loadHints());
+
+#ifdef _WIN32
+    const char* profile = std::getenv("USERPROFILE");
+    if (profile && *profile) {
+        addSubtree(*hints, profile, ScanPriority::User);
+    }
+#else
+    const char* home = std::getenv("HOME");
+    if (home && *home && std::string(home) != "/") {
+        addSubtree(*hints, home, ScanPriority::User);
+    }
+
+    // Other accounts on shared machines
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator("/home", ec)) {
+        if (entry.is_directory(ec) && !ec) {
+            addSubtree(*hints, entry.path().string(), ScanPriority::User);
+        }
+    }
+#endif
+
+    storeHints(std::move(hints));
+}
+
+void ScanPriorityPlanner::recordAccess(const std::string& path) {
+    std::error_code ec;
+    std::string directory = std::filesystem::is_directory(path, ec) && !ec ? normalize(path) : parentOf(normalize(path));
+    if (directory.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    accessCounts_[directory]++;
+}
+
+void ScanPriorityPlanner::promoteFrequentPaths(size_t maxPaths, uint32_t minAccesses) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<std::pair<std::string, uint32_t>> ranked(accessCounts_.begin(), accessCounts_.end());
+    std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+    auto hints = std::make_shared<Hints>(*loadHints());
+    size_t promoted = 0;
+    for (const auto& [directory, count] : ranked) {
+        if (promoted >= maxPaths || count < minAccesses) {
+            break;
+        }
+        addSubtree(*hints, directory, ScanPriority::Hot);
+        promoted++;
+    }
+
+    if (promoted > 0) {
+        storeHints(std::move(hints));
+        LOG_DEBUG_F("Promoted {} frequently used directories to the hot scan band", promoted);
+    }
+}
+
+void ScanPriorityPlanner::setRecentWindow(std::chrono::seconds window) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto hints = std::make_shared<Hints>(*loadHints());
+    hints->recentWindow = window;
+    storeHints(std::move(hints));
+}
+
+void ScanPriorityPlanner::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto hints = std::make_shared<Hints>();
+    hints->recentWindow = loadHints()->recentWindow;
+    storeHints(std::move(hints));
+    accessCounts_.clear();
+}
+
+ScanPriorityPlanner::Assignment ScanPriorityPlanner::forRoot(const std::string& path) const {
+    auto hints = loadHints();
+    Assignment assignment;
+
+    // A root inside a hinted subtree inherits from it
+    std::string normalized = normalize(path);
+    for (std::string current = normalized; !current.empty(); current = parentOf(current)) {
+        auto it = hints->subtrees.find(current);
+        if (it != hints->subtrees.end()) {
+            assignment.inherited = higher(assignment.inherited, it->second);
+        }
+        if (current.size() == 1) {
+            break;
+        }
+    }
+
+    assignment.priority = assignment.inherited;
+    auto ancestor = hints->ancestors.find(normalized);
+    if (ancestor != hints->ancestors.end()) {
+        assignment.priority = higher(assignment.priority, ancestor->second);
+    }
+    return assignment;
+}
+
+ScanPriorityPlanner::ParentContext ScanPriorityPlanner::forParent(const Assignment& parent,
+                                                                  int64_t parentModifiedNs) const {
+    ParentContext context;
+    context.hints = loadHints();
+    context.parent = parent;
+
+    if (parentModifiedNs > 0) {
+        auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        auto window = std::chrono::duration_cast<std::chrono::nanoseconds>(context.hints->recentWindow).count();
+        context.recentlyModified = now - parentModifiedNs <= window;
+    }
+    return context;
+}
+
+ScanPriorityPlanner::Assignment ScanPriorityPlanner::forChild(const std::string& path, const ParentContext& parent) {
+    const Hints& hints = *parent.hints;
+    Assignment assignment;
+    assignment.inherited = parent.parent.inherited;
+
+    if (!hints.subtrees.empty()) {
+        auto it = hints.subtrees.find(path);
+        if (it != hints.subtrees.end()) {
+            assignment.inherited = higher(assignment.inherited, it->second);
+        }
+    }
+    assignment.priority = assignment.inherited;
+
+    if (!hints.ancestors.empty()) {
+        auto it = hints.ancestors.find(path);
+        if (it != hints.ancestors.end()) {
+            assignment.priority = higher(assignment.priority, it->second);
+        }
+    }
+
+    if (parent.recentlyModified) {
+        assignment.priority = higher(assignment.priority, ScanPriority::Recent);
+    }
+    return assignment;
+}
+
+std::vector<std::string> ScanPriorityPlanner::getHintedPaths() const {
+    auto hints = loadHints();
+    std::vector<std::string> paths;
+    paths.reserve(hints->subtrees.size());
+    for (const auto& [path, priority] : hints->subtrees) {
+        paths.push_back(path);
+    }
+    return paths;
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,183 @@
+#include "engine/scan_progress.h"
+#include "core/logger.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <unordered_set>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#endif
+
+namespace FastFileSearch {
+namespace Engine {
+
+const char* progressEstimateSourceName(ProgressEstimateSource source) {
+    switch (source) {
+        case ProgressEstimateSource::PriorRun: return "previous run";
+        case ProgressEstimateSource::Filesystem: return "filesystem inodes";
+        case ProgressEstimateSource::UpperBound: return "filesystem inodes (upper bound)";
+        default: return "unknown";
+    }
+}
+
+ScanProgressEstimator::ScanProgressEstimator()
+    : expected_(0), processed_(0), source_(ProgressEstimateSource::Unknown), finished_(false),
+      startTime_(std::chrono::steady_clock::now()), sampleTime_(startTime_), sampleProcessed_(0), rate_(0.0) {
+}
+
+bool ScanProgressEstimator::usedInodes(const std::string& path, uint64_t& used, uint64_t& device,
+                                       bool& isMountPoint) {
+#ifndef _WIN32
+    struct statvfs fs;
+    struct stat st;
+    if (statvfs(path.c_str(), &fs) != 0 || stat(path.c_str(), &st) != 0) {
+        return false;
+    }
+
+    // Filesystems without a fixed inode table (btrfs, some FUSE) report 0
+    if (fs.f_files == 0 || fs.f_files < fs.f_ffree) {
+        return false;
+    }
+
+    used = static_cast<uint64_t>(fs.f_files - fs.f_ffree);
+    device = static_cast<uint64_t>(st.st_dev);
+
+    std::string parent = std::filesystem::path(path).parent_path().string();
+    struct stat parentSt;
+    isMountPoint = parent.empty() || parent == path || stat(parent.c_str(), &parentSt) != 0 ||
+                   parentSt.st_dev != st.st_dev;
+    return true;
+#else
+    (void)path;
+    (void)used;
+    (void)device;
+    (void)isMountPoint;
+    return false;
+#endif
+}
+
+void ScanProgressEstimator::begin(const std::vector<std::string>& roots,
+                                  const std::unordered_map<std::string, uint64_t>& priorCounts,
+                                  uint64_t alreadyProcessed) {
+    std::vector<RootEstimate> estimates;
+    std::unordered_set<uint64_t> countedDevices;
+    uint64_t expected = 0;
+    ProgressEstimateSource weakest = ProgressEstimateSource::Unknown;
+    bool unestimated = false;
+
+    for (const auto& root : roots) {
+        RootEstimate estimate;
+        estimate.path = root;
+
+        auto prior = priorCounts.find(root);
+        uint64_t used = 0;
+        uint64_t device = 0;
+        bool isMountPoint = false;
+
+        if (prior != priorCounts.end() && prior->second > 0) {
+            estimate.expected = prior->second;
+            estimate.source = ProgressEstimateSource::PriorRun;
+        } else if (usedInodes(root, used, device, isMountPoint)) {
+            // Roots inside one filesystem share its inode count
+            estimate.expected = countedDevices.insert(device).second ? used : 0;
+            estimate.source = isMountPoint ? ProgressEstimateSource::Filesystem
+                                           : ProgressEstimateSource::UpperBound;
+        }
+
+        LOG_DEBUG_F("Expecting {} entries under {} ({})", estimate.expected, root,
+                    progressEstimateSourceName(estimate.source));
+
+        expected += estimate.expected;
+        // The least reliable estimate determines how far the total can be
+        // trusted; a root with none at all leaves no total to trust
+        if (estimate.source == ProgressEstimateSource::Unknown) {
+            unestimated = true;
+        } else {
+            weakest = std::max(weakest, estimate.source);
+        }
+        estimates.push_back(std::move(estimate));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    roots_ = std::move(estimates);
+    if (unestimated || roots_.empty() || expected == 0) {
+        // Counting the other roots alone would overstate percent and ETA
+        expected_ = 0;
+        source_ = ProgressEstimateSource::Unknown;
+    } else {
+        expected_ = expected;
+        source_ = weakest;
+    }
+    processed_ = alreadyProcessed;
+    finished_ = false;
+    startTime_ = sampleTime_ = std::chrono::steady_clock::now();
+    sampleProcessed_ = alreadyProcessed;
+    rate_ = 0.0;
+
+    LOG_INFO_F("Expecting about {} entries under {} root(s), estimated from {}",
+               expected_, roots_.size(), progressEstimateSourceName(source_));
+}
+
+void ScanProgressEstimator::update(uint64_t processed) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    processed_ = std::max(processed_, processed);
+
+    if (expected_ > 0 && processed_ >= expected_) {
+        expected_ = processed_ + static_cast<uint64_t>(std::ceil(processed_ * OVERRUN_HEADROOM));
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - sampleTime_).count();
+    if (seconds < MIN_SAMPLE_SECONDS) {
+        return;
+    }
+
+    double sample = (processed_ - sampleProcessed_) / seconds;
+    rate_ = rate_ == 0.0 ? sample : rate_ + RATE_SMOOTHING * (sample - rate_);
+    sampleTime_ = now;
+    sampleProcessed_ = processed_;
+}
+
+void ScanProgressEstimator::finish() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = true;
+    expected_ = processed_;
+}
+
+ScanProgress ScanProgressEstimator::getProgress() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return snapshotLocked();
+}
+
+std::vector<ScanProgressEstimator::RootEstimate> ScanProgressEstimator::getRootEstimates() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return roots_;
+}
+
+// Caller holds mutex_
+ScanProgress ScanProgressEstimator::snapshotLocked() const {
+    ScanProgress progress;
+    progress.processed = processed_;
+    progress.expected = expected_;
+    progress.itemsPerSecond = rate_;
+    progress.source = source_;
+    progress.finished = finished_;
+    progress.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime_).count();
+
+    if (finished_) {
+        progress.fraction = 1.0;
+        progress.etaSeconds = 0;
+    } else if (expected_ > 0) {
+        progress.fraction = std::min(1.0, static_cast<double>(processed_) / expected_);
+        if (rate_ > 0.0) {
+            progress.etaSeconds = static_cast<int64_t>(std::ceil((expected_ - processed_) / rate_));
+        }
+    }
+
+    return progress;
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
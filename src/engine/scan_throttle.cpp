@@ -0,0 +1,233 @@
+#include "engine/scan_throttle.h"
+#include "core/logger.h"
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <cstdlib>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace FastFileSearch {
+namespace Engine {
+
+#ifdef __linux__
+namespace {
+// From linux/ioprio.h, which not every toolchain ships
+constexpr int IOPRIO_WHO_PROCESS = 1;
+constexpr int IOPRIO_CLASS_IDLE = 3;
+constexpr int IOPRIO_CLASS_SHIFT = 13;
+}
+#endif
+
+ScanThrottle::ScanThrottle(const ScanThrottleOptions& options)
+    : options_(options), lastSample_(std::chrono::steady_clock::now()),
+      filesAtLastSample_(0), observedFilesPerSecond_(0.0), observedSyscallsPerSecond_(0.0),
+      syscallsAtLastSample_(0), loadPerCore_(-1.0), ioPressure_(-1.0), backoffs_(0),
+      factor_(1.0), workers_(0), filesAdmitted_(0), syscallsAdmitted_(0), throttledNs_(0) {
+    applyRatesLocked();
+}
+
+void ScanThrottle::setOptions(const ScanThrottleOptions& options) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    options_ = options;
+    if (!options_.adaptive) {
+        factor_.store(1.0);
+    }
+    applyRatesLocked();
+}
+
+ScanThrottleOptions ScanThrottle::getOptions() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return options_;
+}
+
+void ScanThrottle::attachWorker() {
+    workers_.fetch_add(1);
+
+    bool lower;
+    int nice;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        lower = options_.lowerPriority;
+        nice = options_.backgroundNice;
+    }
+    if (lower) {
+        lowerCurrentThreadPriority(nice, true);
+    }
+}
+
+void ScanThrottle::detachWorker() {
+    workers_.fetch_sub(1);
+}
+
+bool ScanThrottle::admit(uint64_t files, uint64_t syscalls, const std::atomic<bool>& cancel) {
+    filesAdmitted_.fetch_add(files, std::memory_order_relaxed);
+    syscallsAdmitted_.fetch_add(syscalls, std::memory_order_relaxed);
+
+    std::chrono::nanoseconds wait(0);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = std::chrono::steady_clock::now();
+        sampleLocked(now);
+        wait = std::max(files_.take(static_cast<double>(files), now),
+                        syscalls_.take(static_cast<double>(syscalls), now));
+    }
+
+    // Sleep in slices so stop() is not held up by a long debt
+    while (wait.count() > 0) {
+        if (cancel.load()) {
+            return false;
+        }
+        auto slice = std::min<std::chrono::nanoseconds>(wait, SLEEP_SLICE);
+        std::this_thread::sleep_for(slice);
+        throttledNs_.fetch_add(static_cast<uint64_t>(slice.count()), std::memory_order_relaxed);
+        wait -= slice;
+    }
+    return !cancel.load();
+}
+
+// Caller holds mutex_
+void ScanThrottle::sampleLocked(std::chrono::steady_clock::time_point now) {
+    double elapsed = std::chrono::duration<double>(now - lastSample_).count();
+    if (now - lastSample_ < SAMPLE_INTERVAL) {
+        return;
+    }
+
+    uint64_t files = filesAdmitted_.load(std::memory_order_relaxed);
+    uint64_t syscalls = syscallsAdmitted_.load(std::memory_order_relaxed);
+    double filesRate = (files - filesAtLastSample_) / elapsed;
+    double syscallsRate = (syscalls - syscallsAtLastSample_) / elapsed;
+    filesAtLastSample_ = files;
+    syscallsAtLastSample_ = syscalls;
+    lastSample_ = now;
+
+    double factor = factor_.load();
+
+    // Only unthrottled periods say what the scan can do on its own
+    if (factor >= 1.0 && filesRate > 0.0) {
+        observedFilesPerSecond_ = observedFilesPerSecond_ == 0.0 ? filesRate
+            : observedFilesPerSecond_ + RATE_SMOOTHING * (filesRate - observedFilesPerSecond_);
+        observedSyscallsPerSecond_ = observedSyscallsPerSecond_ == 0.0 ? syscallsRate
+            : observedSyscallsPerSecond_ + RATE_SMOOTHING * (syscallsRate - observedSyscallsPerSecond_);
+    }
+
+    if (!options_.adaptive) {
+        return;
+    }
+
+    // Our own workers count towards the load while they run or wait on the
+    // disk; discount them by the share they are currently allowed
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    double load = readLoadAverage();
+    loadPerCore_ = load < 0.0 ? -1.0
+        : std::max(0.0, load - workers_.load() * factor) / cores;
+    ioPressure_ = readIoPressure();
+
+    bool busy = (loadPerCore_ > options_.loadThreshold) ||
+                (ioPressure_ > options_.ioPressureThreshold);
+    bool quiet = loadPerCore_ < options_.loadThreshold * 0.8 &&
+                 ioPressure_ < options_.ioPressureThreshold * 0.5;
+
+    double next = factor;
+    if (busy) {
+        if (now - lastBackoff_ >= BACKOFF_HOLD) {
+            next = std::max(options_.minimumFactor, factor * 0.5);
+            lastBackoff_ = now;
+        }
+    } else if (quiet && factor < 1.0) {
+        next = std::min(1.0, factor + RECOVERY_STEP);
+    }
+
+    if (next != factor) {
+        if (next < factor) {
+            backoffs_++;
+            LOG_DEBUG_F("Scan throttle backing off to {}% (load/core {}, io pressure {}%)",
+                        static_cast<int>(next * 100), loadPerCore_, ioPressure_);
+        }
+        factor_.store(next);
+        applyRatesLocked();
+    }
+}
+
+// Caller holds mutex_ (or is the constructor)
+void ScanThrottle::applyRatesLocked() {
+    double factor = factor_.load();
+
+    auto effectiveRate = [factor](double configured, double observed) {
+        double base = configured > 0.0 ? configured : (factor < 1.0 ? observed : 0.0);
+        return base > 0.0 ? std::max(1.0, base * factor) : 0.0;
+    };
+
+    files_.setRate(effectiveRate(options_.filesPerSecond, observedFilesPerSecond_));
+    syscalls_.setRate(effectiveRate(options_.syscallsPerSecond, observedSyscallsPerSecond_));
+}
+
+ScanThrottle::Statistics ScanThrottle::getStatistics() const {
+    Statistics stats;
+    stats.filesAdmitted = filesAdmitted_.load();
+    stats.syscallsAdmitted = syscallsAdmitted_.load();
+    stats.throttledSeconds = throttledNs_.load() / 1e9;
+    stats.factor = factor_.load();
+    stats.workers = workers_.load();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.loadPerCore = loadPerCore_;
+    stats.ioPressure = ioPressure_;
+    stats.backoffs = backoffs_;
+    return stats;
+}
+
+void ScanThrottle::lowerCurrentThreadPriority(int nice, bool idleIo) {
+#ifdef __linux__
+    // Both the nice value and the I/O priority are per thread on Linux
+    pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+    if (setpriority(PRIO_PROCESS, static_cast<id_t>(tid), nice) != 0) {
+        LOG_DEBUG("Could not lower background thread priority");
+    }
+#ifdef SYS_ioprio_set
+    if (idleIo &&
+        syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, tid, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) != 0) {
+        LOG_DEBUG("Could not move background thread to the idle I/O class");
+    }
+#endif
+#else
+    (void)nice;
+    (void)idleIo;
+#endif
+}
+
+double ScanThrottle::readLoadAverage() {
+#ifndef _WIN32
+    double load[1];
+    if (getloadavg(load, 1) == 1) {
+        return load[0];
+    }
+#endif
+    return -1.0;
+}
+
+double ScanThrottle::readIoPressure() {
+#ifdef __linux__
+    // some avg10=0.12 avg60=0.05 avg300=0.01 total=123456
+    std::ifstream pressure("/proc/pressure/io");
+    std::string line;
+    while (std::getline(pressure, line)) {
+        if (line.compare(0, 5, "some ") != 0) {
+            continue;
+        }
+        auto pos = line.find("avg10=");
+        if (pos != std::string::npos) {
+            return std::strtod(line.c_str() + pos + 6, nullptr);
+        }
+    }
+#endif
+    return -1.0;
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,182 @@
+#include "engine/sharded_index_builder.h"
+#include "core/logger.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+
+namespace FastFileSearch {
+namespace Engine {
+
+namespace {
+
+// Transparent hashing so parent lookups take string_view without allocating
+struct PathHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+};
+
+} // namespace
+
+// IndexShard implementation
+void IndexShard::addDirectory(const ScannedDirectory& scanned) {
+    entries_.insert(entries_.end(), scanned.entries.begin(), scanned.entries.end());
+    sealed_ = false;
+}
+
+void IndexShard::seal() {
+    if (!sealed_) {
+        std::sort(entries_.begin(), entries_.end(), [](const FileEntry& a, const FileEntry& b) {
+            return a.fullPath < b.fullPath;
+        });
+        sealed_ = true;
+    }
+}
+
+void IndexShard::clear() {
+    entries_.clear();
+    entries_.shrink_to_fit();
+    sealed_ = false;
+}
+
+// ShardedIndexBuilder implementation
+ShardedIndexBuilder::ShardedIndexBuilder(size_t numShards)
+    : shards_(std::max<size_t>(1, numShards)) {
+}
+
+void ShardedIndexBuilder::addDirectory(const ScannedDirectory& scanned, size_t workerIndex) {
+    shards_[workerIndex % shards_.size()].addDirectory(scanned);
+}
+
+uint64_t ShardedIndexBuilder::getEntryCount() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.size();
+    }
+    return total;
+}
+
+void ShardedIndexBuilder::sealShards() {
+    std::vector<std::thread> sorters;
+    sorters.reserve(shards_.size());
+    for (auto& shard : shards_) {
+        sorters.emplace_back([&shard]() { shard.seal(); });
+    }
+    for (auto& sorter : sorters) {
+        sorter.join();
+    }
+}
+
+uint64_t ShardedIndexBuilder::merge(const MergeSink& sink, size_t batchSize, uint64_t firstId) {
+    statistics_ = Statistics();
+    statistics_.shards = shards_.size();
+    statistics_.smallestShard = UINT64_MAX;
+    for (const auto& shard : shards_) {
+        statistics_.largestShard = std::max<uint64_t>(statistics_.largestShard, shard.size());
+        statistics_.smallestShard = std::min<uint64_t>(statistics_.smallestShard, shard.size());
+    }
+
+    auto sortStart = std::chrono::steady_clock::now();
+    sealShards();
+    auto mergeStart = std::chrono::steady_clock::now();
+    statistics_.sortSeconds = std::chrono::duration<double>(mergeStart - sortStart).count();
+
+    // Min-heap of one cursor per non-empty shard, ordered by the path under it
+    struct Cursor {
+        size_t shard;
+        size_t position;
+    };
+    auto later = [this](const Cursor& a, const Cursor& b) {
+        return shards_[a.shard].entries()[a.position].fullPath >
+               shards_[b.shard].entries()[b.position].fullPath;
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(later)> heap(later);
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (shards_[i].size() > 0) {
+            heap.push({i, 0});
+        }
+    }
+
+    batchSize = std::max<size_t>(1, batchSize);
+    std::vector<FileEntry> batch;
+    batch.reserve(std::min<uint64_t>(batchSize, getEntryCount()));
+
+    // Directory path -> id, to resolve parent ids; parents always sort
+    // before their children
+    std::unordered_map<std::string, uint64_t, PathHash, std::equal_to<>> directoryIds;
+    uint64_t nextId = firstId;
+    std::string lastPath;
+    bool havePrevious = false;
+
+    while (!heap.empty()) {
+        Cursor cursor = heap.top();
+        heap.pop();
+
+        FileEntry& entry = shards_[cursor.shard].entries()[cursor.position];
+        if (cursor.position + 1 < shards_[cursor.shard].size()) {
+            heap.push({cursor.shard, cursor.position + 1});
+        }
+
+        if (havePrevious && entry.fullPath == lastPath) {
+            statistics_.duplicates++;
+            continue;
+        }
+        lastPath = entry.fullPath;
+        havePrevious = true;
+
+        if (firstId > 0) {
+            entry.id = nextId++;
+            auto parent = directoryIds.find(parentPath(entry.fullPath));
+            if (parent != directoryIds.end()) {
+                entry.parentId = parent->second;
+            }
+            if (entry.isDirectory()) {
+                directoryIds.emplace(entry.fullPath, entry.id);
+            }
+        }
+
+        batch.push_back(std::move(entry));
+        statistics_.entries++;
+        if (batch.size() >= batchSize) {
+            sink(std::move(batch));
+            batch.clear();
+            batch.reserve(batchSize);
+        }
+    }
+
+    if (!batch.empty()) {
+        sink(std::move(batch));
+    }
+
+    for (auto& shard : shards_) {
+        shard.clear();
+    }
+
+    statistics_.mergeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - mergeStart).count();
+
+    LOG_INFO_F("Merged {} shards ({} to {} entries) into {} entries, {} duplicates; sort {}s, merge {}s",
+               statistics_.shards, statistics_.smallestShard, statistics_.largestShard,
+               statistics_.entries, statistics_.duplicates, statistics_.sortSeconds, statistics_.mergeSeconds);
+    return statistics_.entries;
+}
+
+void ShardedIndexBuilder::clear() {
+    for (auto& shard : shards_) {
+        shard.clear();
+    }
+    statistics_ = Statistics();
+}
+
+std::string_view ShardedIndexBuilder::parentPath(const std::string& path) {
+    size_t separator = path.find_last_of("/\\");
+    if (separator == std::string::npos) {
+        return std::string_view();
+    }
+    // Keep the root separator itself ("/a" -> "/")
+    return std::string_view(path.data(), separator == 0 ? 1 : separator);
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
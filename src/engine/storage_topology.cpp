@@ -0,0 +1,338 @@
+#include "engine/storage_topology.h"
+#include "core/logger.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <unordered_set>
+#include <system_error>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#endif
+
+namespace FastFileSearch {
+namespace Engine {
+
+const char* storageKindName(StorageKind kind) {
+    switch (kind) {
+        case StorageKind::Rotational: return "rotational";
+        case StorageKind::SolidState: return "ssd";
+        case StorageKind::NVMe: return "nvme";
+        case StorageKind::Network: return "network";
+        case StorageKind::Virtual: return "virtual";
+        default: return "unknown";
+    }
+}
+
+// StorageDevice implementation
+size_t StorageDevice::initialConcurrency() const {
+    switch (kind) {
+        case StorageKind::Rotational: return 1;
+        case StorageKind::SolidState: return 4;
+        case StorageKind::NVMe: return 8;
+        case StorageKind::Network: return 4;
+        case StorageKind::Virtual: return 4;
+        default: return 4;
+    }
+}
+
+size_t StorageDevice::maxConcurrency() const {
+    switch (kind) {
+        case StorageKind::Rotational: return 2;
+        case StorageKind::SolidState: return 16;
+        case StorageKind::NVMe: return 64;
+        case StorageKind::Network: return 16;
+        case StorageKind::Virtual: return 32;
+        default: return 16;
+    }
+}
+
+namespace {
+
+#ifdef __linux__
+// Mount points in mountinfo escape space, tab, newline and backslash as \ooo
+std::string unescapeMountField(const std::string& field) {
+    std::string result;
+    result.reserve(field.size());
+    for (size_t i = 0; i < field.size(); ++i) {
+        if (field[i] == '\\' && i + 3 < field.size()) {
+            int value = 0;
+            bool octal = true;
+            for (size_t j = 1; j <= 3; ++j) {
+                char c = field[i + j];
+                if (c < '0' || c > '7') {
+                    octal = false;
+                    break;
+                }
+                value = value * 8 + (c - '0');
+            }
+            if (octal) {
+                result += static_cast<char>(value);
+                i += 3;
+                continue;
+            }
+        }
+        result += field[i];
+    }
+    return result;
+}
+
+std::string readFirstLine(const std::filesystem::path& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+#endif
+
+bool isUnderMountPoint(const std::string& path, const std::string& mountPoint) {
+    if (mountPoint == "/") {
+        return !path.empty() && path[0] == '/';
+    }
+    if (path.compare(0, mountPoint.size(), mountPoint) != 0) {
+        return false;
+    }
+    return path.size() == mountPoint.size() || path[mountPoint.size()] == '/';
+}
+
+} // namespace
+
+// StorageTopology implementation
+StorageTopology::StorageTopology() {
+    refresh();
+}
+
+StorageKind StorageTopology::classifyFileSystem(const std::string& fileSystem) {
+    static const std::unordered_set<std::string> networkTypes = {
+        "nfs", "nfs4", "cifs", "smb3", "smbfs", "9p", "afs", "ceph", "glusterfs",
+        "fuse.sshfs", "fuse.rclone", "fuse.s3fs", "lustre", "gpfs", "beegfs"
+    };
+    static const std::unordered_set<std::string> virtualTypes = {
+        "tmpfs", "ramfs", "proc", "sysfs", "devtmpfs", "devpts", "cgroup", "cgroup2",
+        "debugfs", "tracefs", "securityfs", "pstore", "bpf", "configfs", "fusectl",
+        "mqueue", "hugetlbfs", "autofs", "binfmt_misc", "efivarfs", "nsfs"
+    };
+
+    if (networkTypes.count(fileSystem) > 0) {
+        return StorageKind::Network;
+    }
+    if (virtualTypes.count(fileSystem) > 0) {
+        return StorageKind::Virtual;
+    }
+    return StorageKind::Unknown;
+}
+
+StorageKind StorageTopology::classifyBlockDevice(uint32_t major, uint32_t minor, std::string& blockDevice) {
+#ifdef __linux__
+    namespace fs = std::filesystem;
+    std::error_code ec;
+
+    fs::path devicePath = fs::canonical("/sys/dev/block/" + std::to_string(major) + ":" + std::to_string(minor), ec);
+    if (ec) {
+        return StorageKind::Unknown;
+    }
+
+    // Partitions carry no queue/ of their own; the whole disk is the parent
+    if (fs::exists(devicePath / "partition", ec)) {
+        devicePath = devicePath.parent_path();
+    }
+    blockDevice = devicePath.filename().string();
+
+    if (blockDevice.compare(0, 4, "zram") == 0 || blockDevice.compare(0, 3, "ram") == 0) {
+        return StorageKind::Virtual;
+    }
+
+    // Device-mapper and md stacks: as slow as the slowest member
+    fs::path slaves = devicePath / "slaves";
+    if (fs::is_directory(slaves, ec) && !fs::is_empty(slaves, ec)) {
+        auto slowness = [](StorageKind kind) {
+            switch (kind) {
+                case StorageKind::NVMe: return 0;
+                case StorageKind::SolidState: return 1;
+                case StorageKind::Rotational: return 3;
+                default: return 2;
+            }
+        };
+
+        StorageKind combined = StorageKind::Unknown;
+        int worst = -1;
+        for (const auto& slave : fs::directory_iterator(slaves, ec)) {
+            std::string dev = readFirstLine(slave.path() / "dev");
+            uint32_t slaveMajor = 0;
+            uint32_t slaveMinor = 0;
+            if (std::sscanf(dev.c_str(), "%u:%u", &slaveMajor, &slaveMinor) != 2) {
+                continue;
+            }
+
+            std::string slaveName;
+            StorageKind kind = classifyBlockDevice(slaveMajor, slaveMinor, slaveName);
+            if (slowness(kind) > worst) {
+                worst = slowness(kind);
+                combined = kind;
+            }
+        }
+        if (worst >= 0) {
+            return combined;
+        }
+    }
+
+    std::string rotational = readFirstLine(devicePath / "queue" / "rotational");
+    if (rotational == "1") {
+        return StorageKind::Rotational;
+    }
+    if (rotational == "0") {
+        return blockDevice.compare(0, 4, "nvme") == 0 ? StorageKind::NVMe : StorageKind::SolidState;
+    }
+#else
+    (void)major;
+    (void)minor;
+    (void)blockDevice;
+#endif
+    return StorageKind::Unknown;
+}
+
+bool StorageTopology::refresh() {
+    std::vector<StorageDevice> mounts;
+
+#ifdef __linux__
+    std::ifstream mountInfo("/proc/self/mountinfo");
+    if (!mountInfo) {
+        LOG_WARNING("Cannot read /proc/self/mountinfo, treating all paths as one device");
+    }
+
+    // Classifying walks sysfs, so do it once per distinct device
+    std::unordered_map<uint64_t, std::pair<StorageKind, std::string>> classified;
+
+    std::string line;
+    while (std::getline(mountInfo, line)) {
+        // id parent major:minor root mount-point options [optional...] - fstype source super-options
+        std::istringstream stream(line);
+        std::vector<std::string> fields;
+        std::string field;
+        while (stream >> field) {
+            fields.push_back(field);
+        }
+
+        auto separator = std::find(fields.begin(), fields.end(), "-");
+        if (fields.size() < 7 || separator == fields.end() || std::distance(separator, fields.end()) < 3) {
+            continue;
+        }
+
+        StorageDevice device;
+        if (std::sscanf(fields[2].c_str(), "%u:%u", &device.major, &device.minor) != 2) {
+            continue;
+        }
+        device.device = static_cast<uint64_t>(makedev(device.major, device.minor));
+        device.mountPoint = unescapeMountField(fields[4]);
+        device.fileSystem = *(separator + 1);
+        device.source = unescapeMountField(*(separator + 2));
+
+        device.kind = classifyFileSystem(device.fileSystem);
+        if (device.kind == StorageKind::Unknown) {
+            // Filesystems like btrfs report an anonymous 0:N device; the
+            // source block device tells what is underneath
+            uint32_t major = device.major;
+            uint32_t minor = device.minor;
+            struct stat st;
+            if (major == 0 && stat(device.source.c_str(), &st) == 0 && S_ISBLK(st.st_mode)) {
+                major = ::major(st.st_rdev);
+                minor = ::minor(st.st_rdev);
+            }
+
+            uint64_t key = static_cast<uint64_t>(makedev(major, minor));
+            auto it = classified.find(key);
+            if (it == classified.end()) {
+                std::string blockDevice;
+                StorageKind kind = major != 0 ? classifyBlockDevice(major, minor, blockDevice) : StorageKind::Unknown;
+                it = classified.emplace(key, std::make_pair(kind, blockDevice)).first;
+            }
+            device.kind = it->second.first;
+            device.blockDevice = it->second.second;
+        }
+
+        mounts.push_back(std::move(device));
+    }
+#endif
+
+    if (mounts.empty()) {
+        StorageDevice root;
+        root.mountPoint = "/";
+        mounts.push_back(root);
+    }
+
+    std::stable_sort(mounts.begin(), mounts.end(), [](const StorageDevice& a, const StorageDevice& b) {
+        return a.mountPoint.size() > b.mountPoint.size();
+    });
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    mounts_ = std::move(mounts);
+    byDevice_.clear();
+    for (size_t i = 0; i < mounts_.size(); ++i) {
+        // Bind mounts share a device; keep the first (deepest) entry
+        byDevice_.emplace(mounts_[i].device, i);
+    }
+
+    LOG_DEBUG_F("Storage topology: {} mounts", mounts_.size());
+    return true;
+}
+
+StorageDevice StorageTopology::findByPrefixLocked(const std::string& path) const {
+    for (const auto& mount : mounts_) {
+        if (isUnderMountPoint(path, mount.mountPoint)) {
+            return mount;
+        }
+    }
+    return mounts_.empty() ? StorageDevice() : mounts_.back();
+}
+
+StorageDevice StorageTopology::deviceForPath(const std::string& path) const {
+#ifndef _WIN32
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0) {
+        StorageDevice device = deviceForId(static_cast<uint64_t>(st.st_dev));
+        device.device = static_cast<uint64_t>(st.st_dev);
+        return device;
+    }
+#endif
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return findByPrefixLocked(path);
+}
+
+StorageDevice StorageTopology::deviceForId(uint64_t device) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = byDevice_.find(device);
+    if (it != byDevice_.end()) {
+        return mounts_[it->second];
+    }
+
+    StorageDevice unknown;
+    unknown.device = device;
+    return unknown;
+}
+
+std::vector<StorageDevice> StorageTopology::getDevices() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return mounts_;
+}
+
+size_t StorageTopology::recommendedThreads(const std::vector<std::string>& roots, size_t maxThreads) const {
+    std::unordered_set<uint64_t> seen;
+    size_t threads = 0;
+    for (const auto& root : roots) {
+        StorageDevice device = deviceForPath(root);
+        if (seen.insert(device.device).second) {
+            threads += device.maxConcurrency();
+        }
+    }
+    return std::max<size_t>(1, std::min(threads, maxThreads));
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,636 @@
+#include "engine/watch_manager.h"
+#include "core/logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+
+namespace FastFileSearch {
+namespace Engine {
+
+namespace {
+
+// Interest counts like this many changes
+constexpr double INTEREST_WEIGHT = 5.0;
+// Swaps per rebalance, so one busy round cannot churn the whole budget
+constexpr size_t MAX_SWAPS_PER_ROUND = 256;
+// Budget when the kernel limit cannot be read
+constexpr uint64_t FALLBACK_BUDGET = 8192;
+// How long a budget cut by ENOSPC stands before the full budget is retried
+constexpr std::chrono::minutes LIMIT_RETRY_INTERVAL(10);
+
+// Keys of the directories below path start with this
+std::string childPrefix(const std::string& path) {
+    return path == "/" ? path : path + "/";
+}
+
+} // namespace
+
+WatchManager::WatchManager(const WatchBudgetOptions& options, AddWatch addWatch, RemoveWatch removeWatch,
+                           EventSink eventSink, ReconcileSink reconcileSink)
+    : options_(options), addWatch_(std::move(addWatch)), removeWatch_(std::move(removeWatch)),
+      eventSink_(std::move(eventSink)), reconcileSink_(std::move(reconcileSink)),
+      kernelLimit_(readKernelLimit()) {
+    budget_ = kernelLimit_ > 0 ? static_cast<uint64_t>(static_cast<double>(kernelLimit_) * options_.limitShare)
+                               : FALLBACK_BUDGET;
+    if (options_.maxWatches > 0) {
+        budget_ = std::min<uint64_t>(budget_, options_.maxWatches);
+    }
+    maxBudget_ = budget_;
+
+    ScanOptions scanOptions;
+    scanOptions.includeHidden = options_.includeHidden;
+    scanOptions.followSymlinks = false;
+    scanOptions.metadataThreads = 1;
+    scanOptions.exclusions = options_.exclusions;
+    scanner_ = DirectoryScanner::create(scanOptions);
+
+    nextPoll_ = std::chrono::steady_clock::now() + options_.pollInterval;
+    stats_.budget = budget_;
+    stats_.kernelLimit = kernelLimit_;
+}
+
+WatchManager::~WatchManager() {
+    removeAll();
+}
+
+uint64_t WatchManager::readKernelLimit() {
+#ifdef __linux__
+    std::ifstream file("/proc/sys/fs/inotify/max_user_watches");
+    uint64_t limit = 0;
+    if (file >> limit) {
+        return limit;
+    }
+#endif
+    return 0;
+}
+
+bool WatchManager::addRoot(const std::string& root) {
+    std::string normalized = root;
+    while (normalized.size() > 1 && normalized.back() == '/') {
+        normalized.pop_back();
+    }
+
+    // Breadth first, so the eager watches go to the shallowest directories
+    std::deque<std::pair<std::string, uint32_t>> queue;
+    queue.emplace_back(normalized, 0);
+    std::vector<std::string> eager;
+    uint64_t lookups = 0;
+
+    while (!queue.empty()) {
+        auto [path, depth] = std::move(queue.front());
+        queue.pop_front();
+
+        std::vector<EntryStamp> snapshot;
+        std::vector<std::string> subdirectories;
+        if (!takeSnapshot(path, snapshot, &subdirectories, lookups)) {
+            if (depth == 0) {
+                LOG_ERROR_F("Cannot watch {}: not a readable directory", path);
+                return false;
+            }
+            continue;
+        }
+
+        auto [it, inserted] = directories_.try_emplace(path);
+        if (!inserted) {
+            continue;
+        }
+        it->second.depth = depth;
+        it->second.snapshot = std::move(snapshot);
+        it->second.primed = true;
+        it->second.scoredAt = std::chrono::steady_clock::now();
+        if (depth <= options_.eagerDepth) {
+            eager.push_back(path);
+        }
+
+        for (auto& subdirectory : subdirectories) {
+            queue.emplace_back(std::move(subdirectory), depth + 1);
+        }
+    }
+
+    for (const auto& path : eager) {
+        // Just listed; nothing to report before the watch takes over
+        Directory& directory = directories_[path];
+        directory.primed = false;
+        if (!watch(path, directory)) {
+            // A directory that vanished or is unreadable costs no watch;
+            // only a spent budget (or ENOSPC, which cuts it) ends the loop
+            directory.primed = true;
+            if (pathByWatch_.size() >= budget_) {
+                break;
+            }
+        }
+    }
+
+    LOG_INFO_F("Watching {}: {} directories, {} with inotify, {} polled (budget {} of {})",
+               normalized, directories_.size(), pathByWatch_.size(),
+               directories_.size() - pathByWatch_.size(), budget_, kernelLimit_);
+    return true;
+}
+
+void WatchManager::removeAll() {
+    for (const auto& [wd, path] : pathByWatch_) {
+        removeWatch_(wd);
+    }
+    pathByWatch_.clear();
+    directories_.clear();
+}
+
+std::string WatchManager::pathOf(int wd) const {
+    auto it = pathByWatch_.find(wd);
+    return it != pathByWatch_.end() ? it->second : std::string();
+}
+
+void WatchManager::recordChange(const std::string& directory) {
+    auto it = directories_.find(directory);
+    if (it == directories_.end()) {
+        it = directories_.find(parentOf(directory));
+        if (it == directories_.end()) {
+            return;
+        }
+    }
+    decay(it->second, std::chrono::steady_clock::now());
+    it->second.changes += 1.0;
+}
+
+void WatchManager::recordInterest(const std::string& path) {
+    std::lock_guard<std::mutex> lock(interestMutex_);
+    pendingInterest_.push_back(path);
+}
+
+void WatchManager::applyPendingInterest() {
+    std::vector<std::string> pending;
+    {
+        std::lock_guard<std::mutex> lock(interestMutex_);
+        pending.swap(pendingInterest_);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    for (auto path : pending) {
+        // The nearest known directory at or above the path
+        while (!path.empty()) {
+            auto it = directories_.find(path);
+            if (it != directories_.end()) {
+                decay(it->second, now);
+                it->second.interest += INTEREST_WEIGHT;
+                break;
+            }
+            std::string parent = parentOf(path);
+            if (parent == path) {
+                break;
+            }
+            path = std::move(parent);
+        }
+    }
+}
+
+void WatchManager::directoryCreated(const std::string& path) {
+    if (directories_.count(path) > 0) {
+        return;
+    }
+    auto parent = directories_.find(parentOf(path));
+    uint32_t depth = parent != directories_.end() ? parent->second.depth + 1 : 0;
+    bool parentWatched = parent != directories_.end() && parent->second.wd >= 0;
+
+    // Empty and primed: whatever is already inside shows up as created,
+    // either right away when it gets a watch or at its first poll
+    addDirectory(path, depth, true);
+    if (parentWatched) {
+        watch(path, directories_[path]);
+    }
+}
+
+void WatchManager::directoryRemoved(const std::string& path) {
+    auto erase = [this](std::map<std::string, Directory>::iterator it) {
+        if (it->second.wd >= 0) {
+            removeWatch_(it->second.wd);
+            pathByWatch_.erase(it->second.wd);
+        }
+        return directories_.erase(it);
+    };
+
+    auto self = directories_.find(path);
+    if (self != directories_.end()) {
+        erase(self);
+    }
+    auto end = subtreeEnd(path);
+    for (auto it = directories_.lower_bound(childPrefix(path)); it != end;) {
+        it = erase(it);
+    }
+}
+
+void WatchManager::directoryMoved(const std::string& oldPath, const std::string& newPath) {
+    std::vector<std::map<std::string, Directory>::node_type> nodes;
+    auto self = directories_.find(oldPath);
+    if (self != directories_.end()) {
+        nodes.push_back(directories_.extract(self));
+    }
+    auto end = subtreeEnd(oldPath);
+    for (auto it = directories_.lower_bound(childPrefix(oldPath)); it != end;) {
+        auto next = std::next(it);
+        nodes.push_back(directories_.extract(it));
+        it = next;
+    }
+
+    // Kernel watches follow the inode; only our names for them change
+    for (auto& node : nodes) {
+        node.key() = newPath + node.key().substr(oldPath.size());
+        if (node.mapped().wd >= 0) {
+            pathByWatch_[node.mapped().wd] = node.key();
+        }
+        directories_.insert(std::move(node));
+    }
+}
+
+void WatchManager::watchRemoved(int wd) {
+    auto watched = pathByWatch_.find(wd);
+    if (watched == pathByWatch_.end()) {
+        return;
+    }
+    std::string path = std::move(watched->second);
+    pathByWatch_.erase(watched);
+
+    auto it = directories_.find(path);
+    if (it == directories_.end()) {
+        return;
+    }
+    it->second.wd = -1;
+
+    ScannedDirectory stamp;
+    if (!DirectoryScanner::statDirectory(path, stamp)) {
+        directoryRemoved(path);
+        return;
+    }
+    // Still there (e.g. the watch was dropped on unmount): poll it from now on
+    uint64_t lookups = 0;
+    it->second.primed = takeSnapshot(path, it->second.snapshot, nullptr, lookups);
+}
+
+std::chrono::milliseconds WatchManager::poll() {
+    auto now = std::chrono::steady_clock::now();
+    if (now < nextPoll_) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(nextPoll_ - now) +
+               std::chrono::milliseconds(1);
+    }
+
+    applyPendingInterest();
+    rebalance();
+    pollRound();
+
+    nextPoll_ = std::chrono::steady_clock::now() + options_.pollInterval;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(options_.pollInterval);
+}
+
+void WatchManager::decay(Directory& directory, std::chrono::steady_clock::time_point now) const {
+    double elapsed = std::chrono::duration<double>(now - directory.scoredAt).count();
+    if (elapsed > 0.0 && options_.changeHalfLifeSeconds > 0.0) {
+        double factor = std::exp2(-elapsed / options_.changeHalfLifeSeconds);
+        directory.changes *= factor;
+        directory.interest *= factor;
+    }
+    directory.scoredAt = now;
+}
+
+double WatchManager::scoreOf(const std::string& path, Directory& directory,
+                             std::chrono::steady_clock::time_point now) {
+    decay(directory, now);
+    double score = directory.changes + directory.interest;
+    auto parent = directories_.find(parentOf(path));
+    if (parent != directories_.end() && parent->first != path) {
+        decay(parent->second, now);
+        score += 0.5 * (parent->second.changes + parent->second.interest);
+    }
+    return score;
+}
+
+void WatchManager::rebalance() {
+    auto now = std::chrono::steady_clock::now();
+    // Other programs may have released watches since the limit was hit
+    if (budget_ < maxBudget_ && now - limitHitAt_ >= LIMIT_RETRY_INTERVAL) {
+        budget_ = maxBudget_;
+    }
+    std::vector<std::pair<double, std::string>> cold;
+    std::vector<std::pair<double, std::string>> watched;
+    for (auto& [path, directory] : directories_) {
+        double score = scoreOf(path, directory, now);
+        if (directory.wd >= 0) {
+            watched.emplace_back(score, path);
+        } else if (score > 0.0) {
+            cold.emplace_back(score, path);
+        }
+    }
+    if (cold.empty()) {
+        return;
+    }
+
+    std::sort(cold.begin(), cold.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    std::sort(watched.begin(), watched.end());
+
+    size_t weakest = 0;
+    size_t swaps = 0;
+    for (const auto& [score, path] : cold) {
+        auto it = directories_.find(path);
+        if (it == directories_.end() || it->second.wd >= 0) {
+            continue;
+        }
+
+        if (pathByWatch_.size() < budget_) {
+            if (watch(path, it->second)) {
+                stats_.promotions++;
+                continue;
+            }
+            if (pathByWatch_.size() < budget_) {
+                continue;       // This directory failed (e.g. gone), not the budget
+            }
+        }
+
+        // Budget spent: displace the weakest watched directory if clearly
+        // outscored
+        if (swaps >= MAX_SWAPS_PER_ROUND || weakest >= watched.size() ||
+            score <= watched[weakest].first * options_.promoteRatio || score <= 0.0) {
+            break;
+        }
+        auto victim = directories_.find(watched[weakest].second);
+        weakest++;
+        if (victim == directories_.end() || victim->second.wd < 0) {
+            continue;
+        }
+        unwatch(victim->first, victim->second);
+        stats_.evictions++;
+        if (watch(path, it->second)) {
+            stats_.promotions++;
+        }
+        swaps++;
+    }
+}
+
+bool WatchManager::watch(const std::string& path, Directory& directory) {
+    if (directory.wd >= 0) {
+        return true;
+    }
+    if (pathByWatch_.size() >= budget_) {
+        return false;
+    }
+
+    int wd = addWatch_(path);
+    if (wd == -ENOSPC) {
+        // Someone else holds watches too; what we have is all we get
+        budget_ = pathByWatch_.size();
+        limitHitAt_ = std::chrono::steady_clock::now();
+        stats_.limitHits++;
+        stats_.budget = budget_;
+        LOG_WARNING_F("inotify watch limit reached at {} watches; the rest is polled every {}s",
+                      budget_, options_.pollInterval.count());
+        return false;
+    }
+    if (wd < 0) {
+        return false;
+    }
+
+    directory.wd = wd;
+    pathByWatch_[wd] = path;
+
+    // Report what changed since the last poll; from here on inotify does
+    Directory* current = &directory;
+    if (current->primed) {
+        pollDirectory(path, *current);
+        auto it = directories_.find(path);
+        if (it == directories_.end()) {
+            return false;       // Deleted meanwhile; the watch went with it
+        }
+        current = &it->second;
+    }
+    current->snapshot.clear();
+    current->snapshot.shrink_to_fit();
+    current->primed = false;
+    return true;
+}
+
+void WatchManager::unwatch(const std::string& path, Directory& directory) {
+    if (directory.wd < 0) {
+        return;
+    }
+    removeWatch_(directory.wd);
+    pathByWatch_.erase(directory.wd);
+    directory.wd = -1;
+
+    uint64_t lookups = 0;
+    directory.primed = takeSnapshot(path, directory.snapshot, nullptr, lookups);
+}
+
+void WatchManager::pollRound() {
+    stats_.pollRounds++;
+    uint64_t spent = 0;
+    size_t visits = 0;
+    size_t total = directories_.size();
+
+    auto it = directories_.upper_bound(pollCursor_);
+    while (visits < total && spent < options_.pollStatsPerRound && !directories_.empty()) {
+        if (it == directories_.end()) {
+            it = directories_.begin();
+        }
+        std::string path = it->first;
+        if (it->second.wd < 0) {
+            spent += pollDirectory(path, it->second);
+        }
+        visits++;
+        pollCursor_ = path;
+        it = directories_.upper_bound(path);
+    }
+    stats_.polledLookups += spent;
+}
+
+uint64_t WatchManager::pollDirectory(const std::string& path, Directory& directory) {
+    ScannedDirectory scanned;
+    uint64_t lookups = 0;
+    if (!listDirectory(path, scanned, lookups)) {
+        ScannedDirectory stamp;
+        if (!DirectoryScanner::statDirectory(path, stamp)) {
+            // Gone; its parent reports the deletion
+            directoryRemoved(path);
+        }
+        return lookups;
+    }
+
+    // Fresh stamps with the entries they came from, ordered like the snapshot
+    std::vector<std::pair<EntryStamp, const FileEntry*>> fresh;
+    fresh.reserve(scanned.entries.size());
+    for (const auto& entry : scanned.entries) {
+        fresh.emplace_back(stampOf(entry), &entry);
+    }
+    std::sort(fresh.begin(), fresh.end(),
+              [](const auto& a, const auto& b) { return a.first.name < b.first.name; });
+    auto keepFresh = [&directory, &fresh]() {
+        directory.snapshot.clear();
+        directory.snapshot.reserve(fresh.size());
+        for (const auto& [stamp, entry] : fresh) {
+            directory.snapshot.push_back(stamp);
+        }
+    };
+
+    if (!directory.primed) {
+        keepFresh();
+        directory.primed = true;
+        return lookups;
+    }
+
+    uint32_t depth = directory.depth;
+    uint64_t events = 0;
+    bool vanished = false;
+    std::vector<std::string> addedDirectories;
+    auto before = directory.snapshot.begin();
+    auto after = fresh.begin();
+    while (before != directory.snapshot.end() || after != fresh.end()) {
+        bool removed = after == fresh.end() ||
+                       (before != directory.snapshot.end() && before->name < after->first.name);
+        bool added = !removed &&
+                     (before == directory.snapshot.end() || after->first.name < before->name);
+
+        if (removed) {
+            // Only its hash is left to name it by
+            vanished = true;
+            ++before;
+        } else if (added) {
+            const FileEntry& entry = *after->second;
+            std::string full = path == "/" ? path + entry.fileName : path + "/" + entry.fileName;
+            eventSink_(FileChangeEvent(FileChangeType::Created, full));
+            if (entry.isDirectory()) {
+                addedDirectories.push_back(std::move(full));
+            }
+            ++after;
+            events++;
+        } else {
+            const FileEntry& entry = *after->second;
+            if (!entry.isDirectory() && before->state != after->first.state) {
+                std::string full = path == "/" ? path + entry.fileName : path + "/" + entry.fileName;
+                eventSink_(FileChangeEvent(FileChangeType::Modified, full));
+                events++;
+            }
+            ++before;
+            ++after;
+        }
+    }
+
+    keepFresh();
+    if (events > 0 || vanished) {
+        // A cold directory that keeps changing earns a watch
+        decay(directory, std::chrono::steady_clock::now());
+        directory.changes += 1.0;
+        stats_.polledEvents += events;
+    }
+
+    // Known child directories missing from the listing went with the
+    // vanished entries
+    std::vector<std::string> removedDirectories;
+    if (vanished) {
+        std::unordered_set<std::string> present(scanned.subdirectories.begin(), scanned.subdirectories.end());
+        std::string prefix = childPrefix(path);
+        auto end = subtreeEnd(path);
+        for (auto it = directories_.lower_bound(prefix); it != end;) {
+            size_t slash = it->first.find('/', prefix.size());
+            if (slash != std::string::npos) {
+                // Below a child: skip the rest of that child's subtree
+                it = directories_.lower_bound(it->first.substr(0, slash) + "0");
+                continue;
+            }
+            if (present.count(it->first) == 0) {
+                removedDirectories.push_back(it->first);
+            }
+            ++it;
+        }
+        stats_.polledReconciles++;
+        if (reconcileSink_) {
+            reconcileSink_(path);
+        }
+    }
+
+    // Only children are erased or added here, never 'directory' itself
+    for (const auto& removed : removedDirectories) {
+        directoryRemoved(removed);
+    }
+    for (const auto& added : addedDirectories) {
+        addDirectory(added, depth + 1, true);
+    }
+    return lookups;
+}
+
+bool WatchManager::listDirectory(const std::string& path, ScannedDirectory& scanned, uint64_t& lookups) {
+    bool ok = scanner_->scanDirectory(path, scanned);
+    lookups += scanned.statCalls + 1;
+    return ok && !scanned.skipped;
+}
+
+bool WatchManager::takeSnapshot(const std::string& path, std::vector<EntryStamp>& snapshot,
+                                std::vector<std::string>* subdirectories, uint64_t& lookups) {
+    snapshot.clear();
+    ScannedDirectory scanned;
+    if (!listDirectory(path, scanned, lookups)) {
+        return false;
+    }
+
+    snapshot.reserve(scanned.entries.size());
+    for (const auto& entry : scanned.entries) {
+        snapshot.push_back(stampOf(entry));
+    }
+    std::sort(snapshot.begin(), snapshot.end(),
+              [](const EntryStamp& a, const EntryStamp& b) { return a.name < b.name; });
+
+    if (subdirectories) {
+        *subdirectories = std::move(scanned.subdirectories);
+    }
+    return true;
+}
+
+WatchManager::EntryStamp WatchManager::stampOf(const FileEntry& entry) {
+    // A 64-bit name collision would hide one entry from the poller; at
+    // directory sizes that is negligible
+    EntryStamp stamp;
+    stamp.name = static_cast<uint64_t>(std::hash<std::string_view>{}(entry.fileName));
+    uint64_t state = static_cast<uint64_t>(entry.modifiedNs) * 0x9E3779B97F4A7C15ULL;
+    state ^= entry.size + 0x9E3779B97F4A7C15ULL + (state << 6) + (state >> 2);
+    stamp.state = (state << 1) | (entry.isDirectory() ? 1 : 0);
+    return stamp;
+}
+
+void WatchManager::addDirectory(const std::string& path, uint32_t depth, bool primed) {
+    auto [it, inserted] = directories_.try_emplace(path);
+    if (inserted) {
+        it->second.depth = depth;
+        it->second.primed = primed;
+        it->second.scoredAt = std::chrono::steady_clock::now();
+    }
+}
+
+std::string WatchManager::parentOf(const std::string& path) const {
+    size_t slash = path.rfind('/');
+    if (slash == std::string::npos) {
+        return path;
+    }
+    return slash == 0 ? std::string("/") : path.substr(0, slash);
+}
+
+std::map<std::string, WatchManager::Directory>::iterator WatchManager::subtreeEnd(const std::string& path) {
+    // Keys below path start with path + '/'; '0' is the character after '/'
+    if (path == "/") {
+        return directories_.end();
+    }
+    return directories_.lower_bound(path + "0");
+}
+
+WatchManager::Statistics WatchManager::getStatistics() const {
+    Statistics stats = stats_;
+    stats.directories = directories_.size();
+    stats.watched = pathByWatch_.size();
+    stats.polled = stats.directories - stats.watched;
+    stats.budget = budget_;
+    stats.kernelLimit = kernelLimit_;
+    return stats;
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -46,6 +46,8 @@ Commands:
   rebuild                 Rebuild the entire index
   watch                   Start file system monitoring
   stats                   Show indexing statistics
+  duplicates [min-size]   List files with identical content (min-size in bytes)
+  grep <pattern> [query]  Search the contents of files whose names match the query
   config                  Show current configuration
   help                    Show this help message
 
@@ -58,12 +60,15 @@ Options:
   --quiet                 Suppress output except errors
   --daemon                Run as background daemon
   --no-watch              Disable file system monitoring
+  --regex                 Treat the grep pattern as a regular expression
 
 Examples:
   FastFileSearch search "*.txt"
   FastFileSearch search --mode fuzzy "document"
   FastFileSearch index --drives C:,D:
   FastFileSearch rebuild
+  FastFileSearch duplicates 1048576
+  FastFileSearch grep --regex "TODO:? \w+" "*.cpp"
   FastFileSearch watch --daemon
 
 )" << std::endl;
@@ -81,6 +86,7 @@ struct CommandLineArgs {
     bool quiet = false;
     bool daemon = false;
     bool noWatch = false;
+    bool contentRegex = false;
 };
 
 CommandLineArgs parseCommandLine(int argc, char* argv[]) {
@@ -130,6 +136,8 @@ CommandLineArgs parseCommandLine(int argc, char* argv[]) {
             args.daemon = true;
         } else if (arg == "--no-watch") {
             args.noWatch = true;
+        } else if (arg == "--regex") {
+            args.contentRegex = true;
         } else if (arg[0] != '-') {
             // This is a command or argument
             if (args.command.empty()) {
@@ -282,6 +290,17 @@ int executeStats(const CommandLineArgs& args, App::SearchManager& searchManager)
         std::cout << "Indexing Progress: " << std::fixed << std::setprecision(1) 
                  << (stats.indexingProgress * 100) << "%" << std::endl;
         std::cout << "Currently Indexing: " << (stats.isIndexing ? "Yes" : "No") << std::endl;
+        if (stats.isIndexing) {
+            std::cout << "Entries Indexed: " << stats.itemsProcessed;
+            if (stats.itemsExpected > 0) {
+                std::cout << " of ~" << stats.itemsExpected;
+            }
+            std::cout << " (" << static_cast<uint64_t>(stats.itemsPerSecond) << "/s)" << std::endl;
+            if (stats.etaSeconds >= 0) {
+                std::cout << "Estimated Time Left: " << (stats.etaSeconds / 60) << "m "
+                          << (stats.etaSeconds % 60) << "s" << std::endl;
+            }
+        }
         
         return 0;
     } catch (const std::exception& e) {
@@ -290,6 +309,73 @@ int executeStats(const CommandLineArgs& args, App::SearchManager& searchManager)
     }
 }
 
+// Execute duplicates command
+int executeDuplicates(const CommandLineArgs& args, App::SearchManager& searchManager) {
+    try {
+        uint64_t minSize = args.args.empty() ? 1 : std::stoull(args.args[0]);
+        
+        auto groups = searchManager.findDuplicates(minSize);
+        
+        uint64_t reclaimable = 0;
+        size_t shown = 0;
+        for (const auto& group : groups) {
+            reclaimable += group.reclaimableBytes();
+            if (shown++ >= args.maxResults) {
+                continue;
+            }
+            std::cout << group.paths.size() << " copies of " << group.size << " bytes ("
+                      << group.hash.toHex() << "):" << std::endl;
+            for (const auto& path : group.paths) {
+                std::cout << "  " << path << std::endl;
+            }
+        }
+        
+        std::cout << std::string(60, '-') << std::endl;
+        std::cout << groups.size() << " duplicate groups, "
+                  << (reclaimable / (1024 * 1024)) << " MB reclaimable" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Duplicate search error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+// Execute grep command
+int executeGrep(const CommandLineArgs& args, App::SearchManager& searchManager) {
+    if (args.args.empty()) {
+        std::cerr << "Error: Content pattern is required" << std::endl;
+        return 1;
+    }
+    
+    try {
+        SearchQuery searchQuery;
+        searchQuery.contentPattern = args.args[0];
+        searchQuery.contentRegex = args.contentRegex;
+        searchQuery.query = args.args.size() > 1 ? args.args[1] : "";
+        searchQuery.mode = args.args.size() > 1 ? args.searchMode : SearchMode::Wildcard;
+        searchQuery.maxResults = args.maxResults;
+        
+        // Matches are printed as they are found
+        auto stats = searchManager.searchContent(searchQuery, [](const Engine::ContentMatch& match) {
+            std::cout << match.path << ":" << match.lineNumber << ":" << match.line << "\n";
+            return !g_shouldExit.load();
+        });
+        
+        std::cout << std::string(60, '-') << std::endl;
+        std::cout << stats.matches << " matches in " << stats.filesMatched << " of "
+                  << stats.filesSearched << " files (" << std::fixed << std::setprecision(2)
+                  << stats.seconds << "s)";
+        if (stats.truncated) {
+            std::cout << ", stopped early";
+        }
+        std::cout << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Content search error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
 // Main application entry point
 int main(int argc, char* argv[]) {
     // Set up signal handlers
@@ -353,6 +439,10 @@ int main(int argc, char* argv[]) {
             result = executeWatch(args, *g_searchManager);
         } else if (args.command == "stats") {
             result = executeStats(args, *g_searchManager);
+        } else if (args.command == "duplicates") {
+            result = executeDuplicates(args, *g_searchManager);
+        } else if (args.command == "grep") {
+            result = executeGrep(args, *g_searchManager);
         } else if (args.command == "config") {
             std::cout << "Configuration:" << std::endl;
             std::cout << configManager.exportToJSON() << std::endl;
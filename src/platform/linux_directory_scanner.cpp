@@ -0,0 +1,220 @@
+#include "engine/directory_scanner.h"
+#include "engine/file_access.h"
+#include "core/logger.h"
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+namespace FastFileSearch {
+namespace Engine {
+
+namespace {
+
+// Kernel layout of the records returned by getdents64()
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+// RAII wrapper so every early return closes the directory handle
+class ScopedFd {
+private:
+    int fd_;
+
+public:
+    explicit ScopedFd(int fd) : fd_(fd) {}
+    ~ScopedFd() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    ScopedFd(const ScopedFd&) = delete;
+    ScopedFd& operator=(const ScopedFd&) = delete;
+
+    int get() const { return fd_; }
+};
+
+bool isDotOrDotDot(const char* name) {
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+FileType fileTypeFromDType(unsigned char dType) {
+    switch (dType) {
+        case DT_REG: return FileType::File;
+        case DT_DIR: return FileType::Directory;
+        case DT_LNK: return FileType::SymbolicLink;
+        default: return FileType::Unknown;
+    }
+}
+
+} // namespace
+
+// LinuxDirectoryScanner implementation
+LinuxDirectoryScanner::LinuxDirectoryScanner(const ScanOptions& options)
+    : DirectoryScanner(options), buffer_(BUFFER_SIZE),
+      metadataCollector_(MetadataCollector::create(options.enableIoUring, options.metadataThreads)) {
+}
+
+const char* LinuxDirectoryScanner::getMetadataCollectorName() const {
+    return metadataCollector_ ? metadataCollector_->getName() : "fstatat";
+}
+
+bool LinuxDirectoryScanner::scanDirectory(const std::string& path, ScannedDirectory& result) {
+    result.clear();
+    result.path = path;
+
+    ScopedFd dirFd(open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (dirFd.get() < 0) {
+        LOG_DEBUG_F("Cannot open directory {}: {}", path, std::strerror(errno));
+        result.errors++;
+        return false;
+    }
+
+    struct stat dirStat;
+    if (fstat(dirFd.get(), &dirStat) == 0) {
+        result.device = static_cast<uint64_t>(dirStat.st_dev);
+        result.inode = static_cast<uint64_t>(dirStat.st_ino);
+        result.lastModified = dirStat.st_mtime;
+        result.modifiedNs = modifiedNs(dirStat);
+        result.changedNs = changedNs(dirStat);
+
+        if (openCheck_ && !openCheck_(result.device, result.inode)) {
+            result.skipped = true;
+            return true;
+        }
+    }
+
+    while (true) {
+        long bytesRead = syscall(SYS_getdents64, dirFd.get(), buffer_.data(), buffer_.size());
+        if (bytesRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_DEBUG_F("getdents64 failed for {}: {}", path, std::strerror(errno));
+            result.errors++;
+            break;
+        }
+
+        if (bytesRead == 0) {
+            break;
+        }
+
+        pending_.clear();
+        metadataNames_.clear();
+
+        for (long offset = 0; offset < bytesRead;) {
+            const auto* dirent = reinterpret_cast<const LinuxDirent64*>(buffer_.data() + offset);
+            offset += dirent->d_reclen;
+
+            const char* name = dirent->d_name;
+            if (isDotOrDotDot(name)) {
+                continue;
+            }
+
+            if (!options_.includeHidden && isHiddenName(name)) {
+                continue;
+            }
+
+            if (isExcludedEntry(path, name, dirent->d_type == DT_DIR)) {
+                result.excluded++;
+                continue;
+            }
+
+            // Only regular files need metadata from the inode; directories are
+            // described by their own fstat() when they are scanned, and d_type
+            // is enough to classify everything else. DT_UNKNOWN (some network
+            // and older filesystems) needs a lookup to learn the type.
+            size_t metadataIndex = NO_METADATA;
+            if (dirent->d_type == DT_REG || dirent->d_type == DT_UNKNOWN) {
+                metadataIndex = metadataNames_.size();
+                metadataNames_.push_back(name);
+            }
+
+            pending_.push_back({name, dirent->d_type, metadataIndex});
+        }
+
+        // Names point into buffer_, so the batch must be finished before the
+        // next getdents64() call overwrites it
+        processBatch(dirFd.get(), path, result);
+    }
+
+    return true;
+}
+
+void LinuxDirectoryScanner::processBatch(int dirFd, const std::string& directory, ScannedDirectory& result) {
+    if (!metadataNames_.empty()) {
+        result.statCalls += metadataNames_.size();
+
+        if (metadataCollector_) {
+            metadataCollector_->collect(dirFd, metadataNames_, metadata_);
+        } else {
+            metadata_.assign(metadataNames_.size(), FileMetadata());
+            for (size_t i = 0; i < metadataNames_.size(); ++i) {
+                MetadataCollector::statSynchronously(dirFd, metadataNames_[i], metadata_[i]);
+            }
+        }
+    }
+
+    for (const auto& pendingEntry : pending_) {
+        const FileMetadata* metadata = nullptr;
+        if (pendingEntry.metadataIndex != NO_METADATA) {
+            metadata = &metadata_[pendingEntry.metadataIndex];
+        }
+        processEntry(dirFd, directory, pendingEntry, metadata, result);
+    }
+}
+
+void LinuxDirectoryScanner::processEntry(int dirFd, const std::string& directory, const PendingEntry& pendingEntry,
+                                         const FileMetadata* metadata, ScannedDirectory& result) {
+    FileType type = fileTypeFromDType(pendingEntry.dType);
+    uint64_t size = 0;
+    std::time_t modified = 0;
+
+    if (metadata) {
+        if (!metadata->valid) {
+            // Entry vanished between getdents64() and the lookup
+            result.errors++;
+            return;
+        }
+
+        type = metadata->type;
+        size = metadata->size;
+        if (type == FileType::File) {
+            modified = metadata->lastModified;
+        }
+    }
+
+    std::string fullPath = joinPath(directory, pendingEntry.name);
+
+    if (type == FileType::Directory) {
+        result.subdirectories.push_back(fullPath);
+    } else if (type == FileType::SymbolicLink && options_.followSymlinks) {
+        struct stat st;
+        result.statCalls++;
+        if (fstatat(dirFd, pendingEntry.name, &st, 0) == 0 && S_ISDIR(st.st_mode)) {
+            result.subdirectories.push_back(fullPath);
+        }
+    }
+
+    result.entries.emplace_back(fullPath, pendingEntry.name, type, size, modified);
+    if (metadata) {
+        FileEntry& entry = result.entries.back();
+        entry.device = metadata->device;
+        entry.inode = metadata->inode;
+        entry.linkCount = metadata->linkCount;
+        entry.modifiedNs = metadata->modifiedNs;
+        entry.changedNs = metadata->changedNs;
+    }
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
@@ -0,0 +1,398 @@
+#include "engine/file_watcher.h"
+#include "core/logger.h"
+#include <cerrno>
+#include <cstring>
+#include <climits>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/fanotify.h>
+#include <sys/stat.h>
+
+namespace FastFileSearch {
+namespace Engine {
+
+namespace {
+
+// Directory entry changes plus content and metadata changes, for
+// directories too
+constexpr uint64_t BASE_MASK = FAN_CREATE | FAN_DELETE | FAN_MODIFY | FAN_ATTRIB | FAN_ONDIR;
+constexpr uint64_t MOVE_MASK = FAN_MOVED_FROM | FAN_MOVED_TO;
+#ifdef FAN_RENAME
+constexpr uint64_t RENAME_MASK = FAN_RENAME;
+#else
+// Headers older than Linux 5.17: moves only arrive as their two halves
+constexpr uint64_t RENAME_MASK = 0;
+#endif
+
+int initGroup() {
+    return fanotify_init(FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK | FAN_REPORT_DFID_NAME,
+                         O_RDONLY | O_CLOEXEC | O_LARGEFILE);
+}
+
+// Resolving event handles needs open_by_handle_at(), which needs
+// CAP_DAC_READ_SEARCH; without it every event would go unresolved
+bool canResolveHandles(const std::string& path) {
+    std::vector<char> storage(sizeof(struct file_handle) + MAX_HANDLE_SZ);
+    auto* handle = reinterpret_cast<struct file_handle*>(storage.data());
+    handle->handle_bytes = MAX_HANDLE_SZ;
+    int mountId = 0;
+    if (name_to_handle_at(AT_FDCWD, path.c_str(), handle, &mountId, 0) != 0) {
+        return false;
+    }
+
+    int mountFd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (mountFd < 0) {
+        return false;
+    }
+    int fd = open_by_handle_at(mountFd, handle, O_PATH | O_CLOEXEC);
+    close(mountFd);
+    if (fd < 0) {
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+std::string parentOf(const std::string& path) {
+    size_t slash = path.rfind('/');
+    if (slash == std::string::npos) {
+        return std::string();
+    }
+    return slash == 0 ? std::string("/") : path.substr(0, slash);
+}
+
+std::string joinPath(const std::string& directory, const char* name) {
+    if (directory == "/") {
+        return directory + name;
+    }
+    return directory + "/" + name;
+}
+
+} // namespace
+
+// FanotifyFileWatcher implementation
+FanotifyFileWatcher::FanotifyFileWatcher(const std::string& drivePath,
+                                         Utils::ThreadSafeQueue<FileChangeEvent>* eventQueue)
+    : DriveWatcher(drivePath, eventQueue), fanotifyFd_(-1), mountFd_(-1), wakeFd_(-1),
+      renameEvents_(false), eventsRead_(0), overflows_(0), unresolved_(0) {
+    root_ = drivePath_;
+    while (root_.size() > 1 && root_.back() == '/') {
+        root_.pop_back();
+    }
+}
+
+FanotifyFileWatcher::~FanotifyFileWatcher() {
+    stopWatching();
+}
+
+bool FanotifyFileWatcher::isAvailable(const std::string& path) {
+    if (!canResolveHandles(path)) {
+        // EPERM without CAP_DAC_READ_SEARCH, EOPNOTSUPP where the
+        // filesystem cannot encode handles
+        return false;
+    }
+
+    int fd = initGroup();
+    if (fd < 0) {
+        // EPERM without CAP_SYS_ADMIN, EINVAL before Linux 5.9
+        return false;
+    }
+    // Filesystems that cannot encode handles (and btrfs subvolumes, with
+    // EXDEV) refuse the mark
+    bool ok = fanotify_mark(fd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, BASE_MASK | MOVE_MASK,
+                            AT_FDCWD, path.c_str()) == 0;
+    close(fd);
+    return ok;
+}
+
+std::unique_ptr<DriveWatcher> FanotifyFileWatcher::createPreferred(
+        const std::string& drivePath, Utils::ThreadSafeQueue<FileChangeEvent>* eventQueue) {
+    if (isAvailable(drivePath)) {
+        LOG_INFO_F("Watching {} with a fanotify filesystem mark", drivePath);
+        return std::make_unique<FanotifyFileWatcher>(drivePath, eventQueue);
+    }
+    LOG_INFO_F("fanotify not available for {}, using inotify", drivePath);
+    return std::make_unique<LinuxFileWatcher>(drivePath, eventQueue);
+}
+
+bool FanotifyFileWatcher::startWatching() {
+    if (isWatching_.load()) {
+        return true;
+    }
+
+    // Resolved handles come back as canonical paths
+    char resolved[PATH_MAX];
+    if (realpath(drivePath_.c_str(), resolved) != nullptr) {
+        root_ = resolved;
+    }
+
+    fanotifyFd_ = initGroup();
+    if (fanotifyFd_ < 0) {
+        LOG_ERROR_F("fanotify_init failed: {}", std::strerror(errno));
+        return false;
+    }
+
+    mountFd_ = open(root_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    wakeFd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (mountFd_ < 0 || wakeFd_ < 0) {
+        LOG_ERROR_F("Cannot open {} for fanotify: {}", root_, std::strerror(errno));
+        closeDescriptors();
+        return false;
+    }
+
+    // Prefer FAN_RENAME, which reports a move as one event with both names;
+    // older kernels reject it (and older headers lack it) and report the
+    // two halves separately
+    unsigned int markFlags = FAN_MARK_ADD | FAN_MARK_FILESYSTEM;
+    renameEvents_ = RENAME_MASK != 0 &&
+                    fanotify_mark(fanotifyFd_, markFlags, BASE_MASK | RENAME_MASK, AT_FDCWD, root_.c_str()) == 0;
+    if (!renameEvents_ &&
+        fanotify_mark(fanotifyFd_, markFlags, BASE_MASK | MOVE_MASK, AT_FDCWD, root_.c_str()) != 0) {
+        LOG_ERROR_F("fanotify_mark on {} failed: {}", root_, std::strerror(errno));
+        closeDescriptors();
+        return false;
+    }
+
+    shouldStop_.store(false);
+    isWatching_.store(true);
+    watchThread_ = std::thread(&FanotifyFileWatcher::watchLoop, this);
+
+    LOG_INFO_F("fanotify watching {} ({} events)", root_, renameEvents_ ? "rename" : "move");
+    return true;
+}
+
+void FanotifyFileWatcher::stopWatching() {
+    shouldStop_.store(true);
+    if (wakeFd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeFd_, &one, sizeof(one));
+        (void)ignored;
+    }
+    if (watchThread_.joinable()) {
+        watchThread_.join();
+    }
+    closeDescriptors();
+    directoryCache_.clear();
+    isWatching_.store(false);
+}
+
+void FanotifyFileWatcher::closeDescriptors() {
+    for (int* fd : {&fanotifyFd_, &mountFd_, &wakeFd_}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void FanotifyFileWatcher::watchLoop() {
+    std::vector<char> buffer(BUFFER_SIZE);
+    struct pollfd fds[2];
+    fds[0].fd = fanotifyFd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = wakeFd_;
+    fds[1].events = POLLIN;
+
+    while (shouldContinueWatching()) {
+        int ready = poll(fds, 2, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR_F("fanotify poll failed: {}", std::strerror(errno));
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            break;
+        }
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+
+        // Drain everything queued before polling again
+        for (;;) {
+            ssize_t length = read(fanotifyFd_, buffer.data(), buffer.size());
+            if (length < 0) {
+                if (errno != EAGAIN && errno != EINTR) {
+                    LOG_ERROR_F("fanotify read failed: {}", std::strerror(errno));
+                }
+                break;
+            }
+            if (length == 0) {
+                break;
+            }
+            processEvents(buffer.data(), static_cast<size_t>(length));
+        }
+    }
+
+    isWatching_.store(false);
+}
+
+void FanotifyFileWatcher::processEvents(const char* buffer, size_t length) {
+    const auto* metadata = reinterpret_cast<const struct fanotify_event_metadata*>(buffer);
+    auto remaining = static_cast<ssize_t>(length);
+    bool lost = false;
+
+    for (; FAN_EVENT_OK(metadata, remaining); metadata = FAN_EVENT_NEXT(metadata, remaining)) {
+        if (metadata->vers != FANOTIFY_METADATA_VERSION) {
+            LOG_ERROR("fanotify metadata version mismatch");
+            break;
+        }
+        eventsRead_.fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t mask = metadata->mask;
+        if (mask & FAN_Q_OVERFLOW) {
+            overflows_.fetch_add(1, std::memory_order_relaxed);
+            LOG_WARNING_F("fanotify queue overflowed on {}, events were lost", root_);
+            // No hint where: the whole root gets a stamp reconcile
+            reportOverflow(root_);
+            continue;
+        }
+
+        // Collect the (directory, name) records of this event
+        std::string path;
+        std::string oldPath;
+        std::string newPath;
+        const char* record = reinterpret_cast<const char*>(metadata) + metadata->metadata_len;
+        const char* end = reinterpret_cast<const char*>(metadata) + metadata->event_len;
+        while (record + sizeof(struct fanotify_event_info_header) <= end) {
+            const auto* info = reinterpret_cast<const struct fanotify_event_info_fid*>(record);
+            if (info->hdr.len == 0 || record + info->hdr.len > end) {
+                break;
+            }
+            uint8_t type = info->hdr.info_type;
+            bool named = type == FAN_EVENT_INFO_TYPE_DFID_NAME;
+#ifdef FAN_EVENT_INFO_TYPE_OLD_DFID_NAME
+            named = named || type == FAN_EVENT_INFO_TYPE_OLD_DFID_NAME || type == FAN_EVENT_INFO_TYPE_NEW_DFID_NAME;
+#endif
+            if (named) {
+                const auto* handle = reinterpret_cast<const struct file_handle*>(info->handle);
+                const char* name = reinterpret_cast<const char*>(handle->f_handle) + handle->handle_bytes;
+                std::string directory;
+                if (std::strcmp(name, ".") == 0) {
+                    // The directory itself rather than an entry in it
+                } else if (!resolveDirectory(handle, directory)) {
+                    lost = true;
+                } else {
+                    std::string full = joinPath(directory, name);
+#ifdef FAN_EVENT_INFO_TYPE_OLD_DFID_NAME
+                    if (type == FAN_EVENT_INFO_TYPE_OLD_DFID_NAME) {
+                        oldPath = std::move(full);
+                    } else if (type == FAN_EVENT_INFO_TYPE_NEW_DFID_NAME) {
+                        newPath = std::move(full);
+                    } else {
+                        path = std::move(full);
+                    }
+#else
+                    path = std::move(full);
+#endif
+                }
+            }
+            record += info->hdr.len;
+        }
+
+        // Cached paths below a moved or deleted directory are wrong now
+        if ((mask & FAN_ONDIR) && (mask & (FAN_DELETE | MOVE_MASK | RENAME_MASK))) {
+            directoryCache_.clear();
+        }
+
+        if (mask & RENAME_MASK) {
+            bool fromInside = !oldPath.empty() && isUnderRoot(oldPath);
+            bool toInside = !newPath.empty() && isUnderRoot(newPath);
+            if (fromInside && toInside) {
+                FileChangeType type = parentOf(oldPath) == parentOf(newPath) ? FileChangeType::Renamed
+                                                                              : FileChangeType::Moved;
+                postEvent(FileChangeEvent(type, newPath, oldPath));
+            } else if (fromInside) {
+                postEvent(FileChangeEvent(FileChangeType::Deleted, oldPath));
+            } else if (toInside) {
+                postEvent(FileChangeEvent(FileChangeType::Created, newPath));
+            }
+            continue;
+        }
+
+        if (path.empty() || !isUnderRoot(path)) {
+            continue;
+        }
+
+        // Merged events: when an entry appeared and went away in one batch,
+        // the disk decides which happened last
+        bool added = (mask & (FAN_CREATE | FAN_MOVED_TO)) != 0;
+        bool removed = (mask & (FAN_DELETE | FAN_MOVED_FROM)) != 0;
+        if (added && removed) {
+            struct stat st;
+            bool exists = lstat(path.c_str(), &st) == 0;
+            added = exists;
+            removed = !exists;
+        }
+
+        if (removed) {
+            postEvent(FileChangeEvent(FileChangeType::Deleted, path));
+        } else if (added) {
+            postEvent(FileChangeEvent(FileChangeType::Created, path));
+        } else if (mask & (FAN_MODIFY | FAN_ATTRIB)) {
+            postEvent(FileChangeEvent(FileChangeType::Modified, path));
+        }
+    }
+
+    // Events in directories whose handle no longer resolves were dropped;
+    // like an overflow there is no path to narrow them to
+    if (lost) {
+        reportOverflow(root_);
+    }
+}
+
+bool FanotifyFileWatcher::resolveDirectory(const void* fileHandle, std::string& path) {
+    const auto* handle = static_cast<const struct file_handle*>(fileHandle);
+    std::string key(reinterpret_cast<const char*>(&handle->handle_type), sizeof(handle->handle_type));
+    key.append(reinterpret_cast<const char*>(handle->f_handle), handle->handle_bytes);
+
+    auto it = directoryCache_.find(key);
+    if (it != directoryCache_.end()) {
+        path = it->second;
+        return true;
+    }
+
+    // open_by_handle_at() wants a mutable handle
+    std::vector<char> copy(sizeof(struct file_handle) + handle->handle_bytes);
+    std::memcpy(copy.data(), handle, copy.size());
+    int fd = open_by_handle_at(mountFd_, reinterpret_cast<struct file_handle*>(copy.data()),
+                               O_PATH | O_CLOEXEC);
+    if (fd < 0) {
+        // ESTALE: the directory was deleted before we got to the event
+        unresolved_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    char link[64];
+    std::snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+    char target[PATH_MAX];
+    ssize_t n = readlink(link, target, sizeof(target) - 1);
+    close(fd);
+    if (n <= 0) {
+        unresolved_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    path.assign(target, static_cast<size_t>(n));
+
+    if (directoryCache_.size() >= MAX_CACHED_DIRECTORIES) {
+        directoryCache_.clear();
+    }
+    directoryCache_.emplace(std::move(key), path);
+    return true;
+}
+
+bool FanotifyFileWatcher::isUnderRoot(const std::string& path) const {
+    if (root_ == "/") {
+        return !path.empty() && path[0] == '/';
+    }
+    return path.size() >= root_.size() && path.compare(0, root_.size(), root_) == 0 &&
+           (path.size() == root_.size() || path[root_.size()] == '/');
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
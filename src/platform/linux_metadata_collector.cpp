@@ -0,0 +1,481 @@
+#include "engine/metadata_collector.h"
+#include "engine/file_access.h"
+#include "core/logger.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define FFS_HAVE_IO_URING 1
+#endif
+
+namespace FastFileSearch {
+namespace Engine {
+
+namespace {
+
+// How long teardown waits for statx requests still in flight
+constexpr std::chrono::seconds DRAIN_TIMEOUT(5);
+
+FileType fileTypeFromMode(mode_t mode) {
+    if (S_ISREG(mode)) return FileType::File;
+    if (S_ISDIR(mode)) return FileType::Directory;
+    if (S_ISLNK(mode)) return FileType::SymbolicLink;
+    return FileType::Unknown;
+}
+
+} // namespace
+
+// MetadataCollector implementation
+std::unique_ptr<MetadataCollector> MetadataCollector::create(bool enableIoUring, size_t fallbackThreads) {
+    if (enableIoUring) {
+        auto ring = std::make_unique<IoUringMetadataCollector>();
+        if (ring->initialize()) {
+            return ring;
+        }
+        LOG_INFO("io_uring statx is not available, falling back to thread pool metadata collection");
+    }
+
+    return std::make_unique<ThreadPoolMetadataCollector>(fallbackThreads);
+}
+
+void MetadataCollector::statSynchronously(int dirFd, const char* name, FileMetadata& result) {
+    struct stat st;
+    if (fstatat(dirFd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        result.valid = false;
+        return;
+    }
+
+    result.valid = true;
+    result.type = fileTypeFromMode(st.st_mode);
+    result.size = result.type == FileType::File ? static_cast<uint64_t>(st.st_size) : 0;
+    result.lastModified = st.st_mtime;
+    result.device = static_cast<uint64_t>(st.st_dev);
+    result.inode = static_cast<uint64_t>(st.st_ino);
+    result.linkCount = static_cast<uint32_t>(st.st_nlink);
+    result.modifiedNs = modifiedNs(st);
+    result.changedNs = changedNs(st);
+}
+
+// ThreadPoolMetadataCollector implementation
+ThreadPoolMetadataCollector::ThreadPoolMetadataCollector(size_t numThreads) {
+    workers_.reserve(numThreads);
+    for (size_t i = 0; i < numThreads; ++i) {
+        workers_.emplace_back(&ThreadPoolMetadataCollector::workerLoop, this);
+    }
+}
+
+ThreadPoolMetadataCollector::~ThreadPoolMetadataCollector() {
+    tasks_.shutdown();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void ThreadPoolMetadataCollector::workerLoop() {
+    std::function<void()> task;
+    while (tasks_.pop(task)) {
+        task();
+    }
+}
+
+void ThreadPoolMetadataCollector::collect(int dirFd, const std::vector<const char*>& names,
+                                          std::vector<FileMetadata>& results) {
+    results.assign(names.size(), FileMetadata());
+
+    if (names.size() < MIN_PARALLEL_BATCH || workers_.empty()) {
+        for (size_t i = 0; i < names.size(); ++i) {
+            statSynchronously(dirFd, names[i], results[i]);
+        }
+        return;
+    }
+
+    // The calling thread takes one chunk itself, the workers take the rest
+    size_t numChunks = workers_.size() + 1;
+    size_t chunkSize = (names.size() + numChunks - 1) / numChunks;
+
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    size_t remaining = 0;
+
+    auto runChunk = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            statSynchronously(dirFd, names[i], results[i]);
+        }
+    };
+
+    for (size_t begin = chunkSize; begin < names.size(); begin += chunkSize) {
+        size_t end = std::min(begin + chunkSize, names.size());
+        {
+            std::lock_guard<std::mutex> lock(doneMutex);
+            remaining++;
+        }
+        tasks_.push([&, begin, end]() {
+            runChunk(begin, end);
+            std::lock_guard<std::mutex> lock(doneMutex);
+            if (--remaining == 0) {
+                doneCondition.notify_one();
+            }
+        });
+    }
+
+    runChunk(0, std::min(chunkSize, names.size()));
+
+    std::unique_lock<std::mutex> lock(doneMutex);
+    doneCondition.wait(lock, [&remaining] { return remaining == 0; });
+}
+
+// IoUringMetadataCollector implementation
+IoUringMetadataCollector::IoUringMetadataCollector(uint32_t ringEntries)
+    : ringFd_(-1), ringEntries_(ringEntries),
+      sqRing_(nullptr), cqRing_(nullptr), sqes_(nullptr),
+      sqRingSize_(0), cqRingSize_(0), sqesSize_(0),
+      sqHead_(nullptr), sqTail_(nullptr), sqMask_(nullptr), sqArray_(nullptr),
+      cqHead_(nullptr), cqTail_(nullptr), cqMask_(nullptr), cqes_(nullptr), inFlight_(0) {
+}
+
+IoUringMetadataCollector::~IoUringMetadataCollector() {
+    teardown();
+}
+
+#ifdef FFS_HAVE_IO_URING
+
+bool IoUringMetadataCollector::initialize() {
+    if (ringFd_ >= 0) {
+        return true;
+    }
+
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    int fd = static_cast<int>(syscall(__NR_io_uring_setup, ringEntries_, &params));
+    if (fd < 0) {
+        LOG_DEBUG_F("io_uring_setup failed: {}", std::strerror(errno));
+        return false;
+    }
+    ringFd_ = fd;
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMmap) {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+
+    sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) {
+        sqRing_ = nullptr;
+        teardown();
+        return false;
+    }
+
+    if (singleMmap) {
+        cqRing_ = sqRing_;
+    } else {
+        cqRing_ = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ringFd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED) {
+            cqRing_ = nullptr;
+            teardown();
+            return false;
+        }
+    }
+
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                 ringFd_, IORING_OFF_SQES);
+    if (sqes_ == MAP_FAILED) {
+        sqes_ = nullptr;
+        teardown();
+        return false;
+    }
+
+    auto* sq = static_cast<unsigned char*>(sqRing_);
+    sqHead_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+    sqMask_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+    sqArray_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+
+    auto* cq = static_cast<unsigned char*>(cqRing_);
+    cqHead_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+    cqMask_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+    cqes_ = cq + params.cq_off.cqes;
+
+    ringEntries_ = params.sq_entries;
+    statxBuffers_.resize(static_cast<size_t>(ringEntries_) * sizeof(struct statx));
+
+    if (!probeStatxSupport()) {
+        LOG_DEBUG("io_uring is available but IORING_OP_STATX is not supported by this kernel");
+        teardown();
+        return false;
+    }
+
+    LOG_DEBUG_F("io_uring metadata collector ready ({} entries)", ringEntries_);
+    return true;
+}
+
+bool IoUringMetadataCollector::probeStatxSupport() {
+    const size_t maxOps = 256;
+    std::vector<unsigned char> buffer(sizeof(io_uring_probe) + maxOps * sizeof(io_uring_probe_op), 0);
+    auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+
+    if (syscall(__NR_io_uring_register, ringFd_, IORING_REGISTER_PROBE, probe, maxOps) < 0) {
+        // IORING_REGISTER_PROBE and IORING_OP_STATX both arrived in 5.6
+        return false;
+    }
+
+    return probe->last_op >= IORING_OP_STATX &&
+           (probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED) != 0;
+}
+
+int IoUringMetadataCollector::enter(uint32_t toSubmit, uint32_t minComplete) {
+    while (true) {
+        long result = syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete,
+                              IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (result >= 0 || errno != EINTR) {
+            return static_cast<int>(result);
+        }
+    }
+}
+
+void IoUringMetadataCollector::collect(int dirFd, const std::vector<const char*>& names,
+                                       std::vector<FileMetadata>& results) {
+    results.assign(names.size(), FileMetadata());
+
+    for (size_t first = 0; first < names.size(); first += ringEntries_) {
+        uint32_t count = static_cast<uint32_t>(std::min<size_t>(ringEntries_, names.size() - first));
+
+        if (ringFd_ < 0 || !submitBatch(dirFd, names, first, count) ||
+            !reapCompletions(dirFd, names, first, count, results)) {
+            // Ring is unusable; finish the directory synchronously
+            for (size_t i = first; i < names.size(); ++i) {
+                statSynchronously(dirFd, names[i], results[i]);
+            }
+            return;
+        }
+    }
+}
+
+bool IoUringMetadataCollector::submitBatch(int dirFd, const std::vector<const char*>& names,
+                                           size_t first, uint32_t count) {
+    auto* sqes = static_cast<io_uring_sqe*>(sqes_);
+    auto* buffers = reinterpret_cast<struct statx*>(statxBuffers_.data());
+    uint32_t mask = *sqMask_;
+    uint32_t tail = *sqTail_; // Only this thread produces
+
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t index = (tail + i) & mask;
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = dirFd;
+        sqe->addr = reinterpret_cast<uint64_t>(names[first + i]);
+        sqe->len = STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME | STATX_CTIME | STATX_INO | STATX_NLINK;
+        sqe->off = reinterpret_cast<uint64_t>(&buffers[i]);
+        sqe->statx_flags = AT_SYMLINK_NOFOLLOW;
+        sqe->user_data = i;
+
+        sqArray_[index] = index;
+    }
+
+    uint32_t newTail = tail + count;
+    std::atomic_ref<uint32_t>(*sqTail_).store(newTail, std::memory_order_release);
+
+    // The kernel may consume fewer entries than offered; keep going until the
+    // submission queue is drained
+    while (true) {
+        uint32_t pending = newTail - std::atomic_ref<uint32_t>(*sqHead_).load(std::memory_order_acquire);
+        if (pending == 0) {
+            return true;
+        }
+
+        int submitted = enter(pending, 0);
+        if (submitted > 0) {
+            inFlight_ += static_cast<uint32_t>(submitted);
+        }
+        if (submitted < 0) {
+            LOG_WARNING_F("io_uring_enter failed: {}", std::strerror(errno));
+            teardown();
+            return false;
+        }
+
+        if (submitted == 0) {
+            // Completion queue is full; this cannot happen since we reap a
+            // batch before submitting the next one, but don't spin if it does
+            teardown();
+            return false;
+        }
+    }
+}
+
+bool IoUringMetadataCollector::reapCompletions(int dirFd, const std::vector<const char*>& names,
+                                               size_t first, uint32_t count,
+                                               std::vector<FileMetadata>& results) {
+    auto* cqes = static_cast<io_uring_cqe*>(cqes_);
+    auto* buffers = reinterpret_cast<struct statx*>(statxBuffers_.data());
+    uint32_t mask = *cqMask_;
+    uint32_t harvested = 0;
+
+    while (harvested < count) {
+        uint32_t head = std::atomic_ref<uint32_t>(*cqHead_).load(std::memory_order_relaxed);
+        uint32_t tail = std::atomic_ref<uint32_t>(*cqTail_).load(std::memory_order_acquire);
+
+        if (head == tail) {
+            if (enter(0, 1) < 0) {
+                LOG_WARNING_F("io_uring_enter (wait) failed: {}", std::strerror(errno));
+                teardown();
+                return false;
+            }
+            continue;
+        }
+
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes[head & mask];
+            size_t i = static_cast<size_t>(cqe.user_data);
+            FileMetadata& metadata = results[first + i];
+
+            if (cqe.res == 0) {
+                const struct statx& stx = buffers[i];
+                metadata.valid = true;
+                metadata.type = fileTypeFromMode(stx.stx_mode);
+                metadata.size = metadata.type == FileType::File ? stx.stx_size : 0;
+                metadata.lastModified = static_cast<std::time_t>(stx.stx_mtime.tv_sec);
+                metadata.device = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+                metadata.inode = stx.stx_ino;
+                metadata.linkCount = stx.stx_nlink;
+                metadata.modifiedNs = toNanoseconds(stx.stx_mtime.tv_sec, stx.stx_mtime.tv_nsec);
+                metadata.changedNs = toNanoseconds(stx.stx_ctime.tv_sec, stx.stx_ctime.tv_nsec);
+            } else if (cqe.res == -EAGAIN || cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP) {
+                statSynchronously(dirFd, names[first + i], metadata);
+            } else {
+                metadata.valid = false; // Typically ENOENT: entry vanished after getdents64()
+            }
+
+            harvested++;
+            inFlight_--;
+        }
+
+        std::atomic_ref<uint32_t>(*cqHead_).store(head, std::memory_order_release);
+    }
+
+    return true;
+}
+
+// Waits for every submitted request to complete so the kernel is done with
+// statxBuffers_ before the ring goes away. Results are discarded: the caller
+// redoes the batch synchronously. A failed wait (EAGAIN, ENOMEM under memory
+// pressure) is retried until DRAIN_TIMEOUT; a statx taking that long means a
+// hung filesystem, not a transient error.
+bool IoUringMetadataCollector::drainInFlight() {
+    auto deadline = std::chrono::steady_clock::now() + DRAIN_TIMEOUT;
+
+    while (inFlight_ > 0) {
+        uint32_t head = std::atomic_ref<uint32_t>(*cqHead_).load(std::memory_order_relaxed);
+        uint32_t tail = std::atomic_ref<uint32_t>(*cqTail_).load(std::memory_order_acquire);
+        if (head != tail) {
+            inFlight_ -= std::min(inFlight_, tail - head);
+            std::atomic_ref<uint32_t>(*cqHead_).store(tail, std::memory_order_release);
+            continue;
+        }
+
+        if (enter(0, 1) < 0) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    return true;
+}
+
+#else // !FFS_HAVE_IO_URING
+
+bool IoUringMetadataCollector::initialize() {
+    return false;
+}
+
+bool IoUringMetadataCollector::probeStatxSupport() {
+    return false;
+}
+
+int IoUringMetadataCollector::enter(uint32_t, uint32_t) {
+    return -1;
+}
+
+void IoUringMetadataCollector::collect(int dirFd, const std::vector<const char*>& names,
+                                       std::vector<FileMetadata>& results) {
+    results.assign(names.size(), FileMetadata());
+    for (size_t i = 0; i < names.size(); ++i) {
+        statSynchronously(dirFd, names[i], results[i]);
+    }
+}
+
+bool IoUringMetadataCollector::submitBatch(int, const std::vector<const char*>&, size_t, uint32_t) {
+    return false;
+}
+
+bool IoUringMetadataCollector::reapCompletions(int, const std::vector<const char*>&, size_t, uint32_t,
+                                               std::vector<FileMetadata>&) {
+    return false;
+}
+
+bool IoUringMetadataCollector::drainInFlight() {
+    return true;
+}
+
+#endif // FFS_HAVE_IO_URING
+
+void IoUringMetadataCollector::teardown() {
+    bool drained = inFlight_ == 0 || !cqRing_ || drainInFlight();
+    inFlight_ = 0;
+
+    // Unmap and close the ring, as io_uring_queue_exit() does, before the
+    // buffers can be released
+    if (sqes_) {
+        munmap(sqes_, sqesSize_);
+        sqes_ = nullptr;
+    }
+    if (cqRing_ && cqRing_ != sqRing_) {
+        munmap(cqRing_, cqRingSize_);
+    }
+    cqRing_ = nullptr;
+    if (sqRing_) {
+        munmap(sqRing_, sqRingSize_);
+        sqRing_ = nullptr;
+    }
+    if (ringFd_ >= 0) {
+        close(ringFd_);
+        ringFd_ = -1;
+    }
+
+    if (!drained) {
+        // Closing the ring does not wait for requests a worker is already
+        // running; only after DRAIN_TIMEOUT of a hung filesystem are their
+        // buffers kept rather than let the kernel write into freed memory
+        LOG_ERROR_F("io_uring statx requests did not complete within {}s; keeping their buffers",
+                    DRAIN_TIMEOUT.count());
+        new std::vector<unsigned char>(std::move(statxBuffers_));
+    }
+}
+
+} // namespace Engine
+} // namespace FastFileSearch
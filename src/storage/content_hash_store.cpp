@@ -0,0 +1,185 @@
+#include "storage/content_hash_store.h"
+#include "core/logger.h"
+
+namespace FastFileSearch {
+namespace Storage {
+
+// Schema. Hashes are stored as two 64-bit halves; full_low/full_high are
+// NULL until the file has been read completely, head_low/head_high when the
+// file changed after its head was hashed.
+const char* ContentHashStore::CREATE_CONTENT_HASHES_TABLE = R"(
+    CREATE TABLE IF NOT EXISTS content_hashes (
+        path TEXT PRIMARY KEY,
+        size INTEGER NOT NULL,
+        modified_ns INTEGER NOT NULL,
+        changed_ns INTEGER NOT NULL,
+        inode INTEGER NOT NULL,
+        head_low INTEGER,
+        head_high INTEGER,
+        full_low INTEGER,
+        full_high INTEGER
+    ) WITHOUT ROWID
+)";
+
+const char* ContentHashStore::UPSERT_CONTENT_HASH_SQL =
+    "INSERT OR REPLACE INTO content_hashes "
+    "(path, size, modified_ns, changed_ns, inode, head_low, head_high, full_low, full_high) "
+    "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)";
+
+const char* ContentHashStore::DELETE_CONTENT_HASH_SQL =
+    "DELETE FROM content_hashes WHERE path = ?";
+
+const char* ContentHashStore::SELECT_CONTENT_HASHES_SQL =
+    "SELECT path, size, modified_ns, changed_ns, inode, head_low, head_high, full_low, full_high "
+    "FROM content_hashes";
+
+ContentHashStore::ContentHashStore(SQLiteDatabase& database) : connection_(database, "ContentHashStore") {
+}
+
+bool ContentHashStore::createTables() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connection_.open() && connection_.execute(CREATE_CONTENT_HASHES_TABLE);
+}
+
+bool ContentHashStore::saveHashes(const std::vector<ContentHashRecord>& records) {
+    if (records.empty()) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    sqlite3* db = connection_.get();
+
+    sqlite3_stmt* rawStmt = nullptr;
+    if (sqlite3_prepare_v2(db, UPSERT_CONTENT_HASH_SQL, -1, &rawStmt, nullptr) != SQLITE_OK) {
+        LOG_ERROR_F("Failed to prepare content hash insert: {}", sqlite3_errmsg(db));
+        return false;
+    }
+    SQLiteStatement stmt(rawStmt);
+
+    StoreConnection::Transaction transaction(connection_);
+    if (!transaction.isActive()) {
+        return false;
+    }
+
+    for (const auto& record : records) {
+        sqlite3_bind_text(stmt.get(), 1, record.path.c_str(), static_cast<int>(record.path.size()), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt.get(), 2, static_cast<sqlite3_int64>(record.fingerprint.size));
+        sqlite3_bind_int64(stmt.get(), 3, record.fingerprint.modifiedNs);
+        sqlite3_bind_int64(stmt.get(), 4, record.fingerprint.changedNs);
+        sqlite3_bind_int64(stmt.get(), 5, static_cast<sqlite3_int64>(record.fingerprint.inode));
+        if (record.hasHeadHash) {
+            sqlite3_bind_int64(stmt.get(), 6, static_cast<sqlite3_int64>(record.headHash.low));
+            sqlite3_bind_int64(stmt.get(), 7, static_cast<sqlite3_int64>(record.headHash.high));
+        } else {
+            sqlite3_bind_null(stmt.get(), 6);
+            sqlite3_bind_null(stmt.get(), 7);
+        }
+        if (record.hasFullHash) {
+            sqlite3_bind_int64(stmt.get(), 8, static_cast<sqlite3_int64>(record.fullHash.low));
+            sqlite3_bind_int64(stmt.get(), 9, static_cast<sqlite3_int64>(record.fullHash.high));
+        } else {
+            sqlite3_bind_null(stmt.get(), 8);
+            sqlite3_bind_null(stmt.get(), 9);
+        }
+
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE) {
+            LOG_ERROR_F("Failed to save content hash for {}: {}", record.path, sqlite3_errmsg(db));
+            return false;
+        }
+        sqlite3_reset(stmt.get());
+    }
+
+    return transaction.commit();
+}
+
+bool ContentHashStore::deleteHashes(const std::vector<std::string>& paths) {
+    if (paths.empty()) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    sqlite3* db = connection_.get();
+
+    sqlite3_stmt* rawStmt = nullptr;
+    if (sqlite3_prepare_v2(db, DELETE_CONTENT_HASH_SQL, -1, &rawStmt, nullptr) != SQLITE_OK) {
+        LOG_ERROR_F("Failed to prepare content hash delete: {}", sqlite3_errmsg(db));
+        return false;
+    }
+    SQLiteStatement stmt(rawStmt);
+
+    StoreConnection::Transaction transaction(connection_);
+    if (!transaction.isActive()) {
+        return false;
+    }
+
+    for (const auto& path : paths) {
+        sqlite3_bind_text(stmt.get(), 1, path.c_str(), static_cast<int>(path.size()), SQLITE_STATIC);
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE) {
+            LOG_ERROR_F("Failed to delete content hash for {}: {}", path, sqlite3_errmsg(db));
+            return false;
+        }
+        sqlite3_reset(stmt.get());
+    }
+
+    return transaction.commit();
+}
+
+std::vector<ContentHashRecord> ContentHashStore::loadHashes() {
+    std::vector<ContentHashRecord> records;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    sqlite3* db = connection_.get();
+
+    sqlite3_stmt* rawStmt = nullptr;
+    if (sqlite3_prepare_v2(db, SELECT_CONTENT_HASHES_SQL, -1, &rawStmt, nullptr) != SQLITE_OK) {
+        LOG_ERROR_F("Failed to prepare content hash query: {}", sqlite3_errmsg(db));
+        return records;
+    }
+    SQLiteStatement stmt(rawStmt);
+
+    while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+        ContentHashRecord record;
+        const auto* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 0));
+        record.path = text ? text : "";
+        record.fingerprint.size = static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 1));
+        record.fingerprint.modifiedNs = sqlite3_column_int64(stmt.get(), 2);
+        record.fingerprint.changedNs = sqlite3_column_int64(stmt.get(), 3);
+        record.fingerprint.inode = static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 4));
+        if (sqlite3_column_type(stmt.get(), 5) != SQLITE_NULL) {
+            record.headHash.low = static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 5));
+            record.headHash.high = static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 6));
+            record.hasHeadHash = true;
+        }
+        if (sqlite3_column_type(stmt.get(), 7) != SQLITE_NULL) {
+            record.fullHash.low = static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 7));
+            record.fullHash.high = static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 8));
+            record.hasFullHash = true;
+        }
+        records.push_back(std::move(record));
+    }
+    return records;
+}
+
+uint64_t ContentHashStore::getHashCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sqlite3* db = connection_.get();
+
+    sqlite3_stmt* rawStmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM content_hashes", -1, &rawStmt, nullptr) != SQLITE_OK) {
+        return 0;
+    }
+    SQLiteStatement stmt(rawStmt);
+
+    if (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+        return static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 0));
+    }
+    return 0;
+}
+
+bool ContentHashStore::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connection_.execute("DELETE FROM content_hashes");
+}
+
+} // namespace Storage
+} // namespace FastFileSearch
@@ -0,0 +1,436 @@
+#include "storage/content_index_store.h"
+#include "core/logger.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace FastFileSearch {
+namespace Storage {
+
+// Schema. Dead documents lose their row right away but stay in the
+// postings until the index is compacted; loading treats ids without a
+// document row as dead.
+const char* ContentIndexStore::CREATE_CONTENT_DOCUMENTS_TABLE = R"(
+    CREATE TABLE IF NOT EXISTS content_documents (
+        id INTEGER PRIMARY KEY,
+        path TEXT NOT NULL,
+        size INTEGER NOT NULL,
+        modified_ns INTEGER NOT NULL,
+        changed_ns INTEGER NOT NULL,
+        inode INTEGER NOT NULL,
+        binary INTEGER NOT NULL DEFAULT 0
+    )
+)";
+
+const char* ContentIndexStore::CREATE_CONTENT_TRIGRAMS_TABLE = R"(
+    CREATE TABLE IF NOT EXISTS content_trigrams (
+        trigram INTEGER PRIMARY KEY,
+        documents BLOB NOT NULL
+    )
+)";
+
+// Ids appended since the list row was written, in save order; sequence
+// numbers are unique across the whole log
+const char* ContentIndexStore::CREATE_CONTENT_TRIGRAM_LOG_TABLE = R"(
+    CREATE TABLE IF NOT EXISTS content_trigram_log (
+        trigram INTEGER NOT NULL,
+        sequence INTEGER NOT NULL,
+        documents BLOB NOT NULL,
+        PRIMARY KEY (trigram, sequence)
+    ) WITHOUT ROWID
+)";
+
+const char* ContentIndexStore::UPSERT_DOCUMENT_SQL =
+    "INSERT OR REPLACE INTO content_documents (id, path, size, modified_ns, changed_ns, inode, binary) "
+    "VALUES (?, ?, ?, ?, ?, ?, ?)";
+
+const char* ContentIndexStore::DELETE_DOCUMENT_SQL =
+    "DELETE FROM content_documents WHERE id = ?";
+
+const char* ContentIndexStore::UPSERT_TRIGRAM_SQL =
+    "INSERT OR REPLACE INTO content_trigrams (trigram, documents) VALUES (?, ?)";
+
+const char* ContentIndexStore::DELETE_TRIGRAM_SQL =
+    "DELETE FROM content_trigrams WHERE trigram = ?";
+
+const char* ContentIndexStore::APPEND_TRIGRAM_LOG_SQL =
+    "INSERT INTO content_trigram_log (trigram, sequence, documents) VALUES (?, ?, ?)";
+
+const char* ContentIndexStore::DELETE_TRIGRAM_LOG_SQL =
+    "DELETE FROM content_trigram_log WHERE trigram = ?";
+
+ContentIndexStore::ContentIndexStore(SQLiteDatabase& database) : connection_(database, "ContentIndexStore") {
+}
+
+bool ContentIndexStore::createTables() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connection_.open() &&
+           connection_.execute(CREATE_CONTENT_DOCUMENTS_TABLE) && connection_.execute(CREATE_CONTENT_TRIGRAMS_TABLE) &&
+           connection_.execute(CREATE_CONTENT_TRIGRAM_LOG_TABLE) && loadLogState();
+}
+
+bool ContentIndexStore::loadLogState() {
+    sqlite3_stmt* rawStmt = nullptr;
+    const char* sql = "SELECT COUNT(*), COALESCE(MAX(sequence), 0) FROM content_trigram_log";
+    if (sqlite3_prepare_v2(connection_.get(), sql, -1, &rawStmt, nullptr) != SQLITE_OK) {
+        LOG_ERROR_F("Failed to read the content trigram log: {}", sqlite3_errmsg(connection_.get()));
+        return false;
+    }
+    SQLiteStatement stmt(rawStmt);
+
+    if (sqlite3_step(stmt.get()) != SQLITE_ROW) {
+        return false;
+    }
+    logRows_ = static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 0));
+    nextSequence_ = sqlite3_column_int64(stmt.get(), 1) + 1;
+    return true;
+}
+
+bool ContentIndexStore::saveChanges(const ContentIndexChanges& changes) {
+    if (changes.empty()) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    sqlite3* db = connection_.get();
+
+    sqlite3_stmt* rawUpsertDocument = nullptr;
+    sqlite3_stmt* rawDeleteDocument = nullptr;
+    sqlite3_stmt* rawUpsertTrigram = nullptr;
+    sqlite3_stmt* rawDeleteTrigram = nullptr;
+    sqlite3_stmt* rawAppendLog = nullptr;
+    sqlite3_stmt* rawDeleteLog = nullptr;
+    bool prepared =
+        sqlite3_prepare_v2(db, UPSERT_DOCUMENT_SQL, -1, &rawUpsertDocument, nullptr) == SQLITE_OK &&
+        sqlite3_prepare_v2(db, DELETE_DOCUMENT_SQL, -1, &rawDeleteDocument, nullptr) == SQLITE_OK &&
+        sqlite3_prepare_v2(db, UPSERT_TRIGRAM_SQL, -1, &rawUpsertTrigram, nullptr) == SQLITE_OK &&
+        sqlite3_prepare_v2(db, DELETE_TRIGRAM_SQL, -1, &rawDeleteTrigram, nullptr) == SQLITE_OK &&
+        sqlite3_prepare_v2(db, APPEND_TRIGRAM_LOG_SQL, -1, &rawAppendLog, nullptr) == SQLITE_OK &&
+        sqlite3_prepare_v2(db, DELETE_TRIGRAM_LOG_SQL, -1, &rawDeleteLog, nullptr) == SQLITE_OK;
+    SQLiteStatement upsertDocument(rawUpsertDocument);
+    SQLiteStatement deleteDocument(rawDeleteDocument);
+    SQLiteStatement upsertTrigram(rawUpsertTrigram);
+    SQLiteStatement deleteTrigram(rawDeleteTrigram);
+    SQLiteStatement appendLog(rawAppendLog);
+    SQLiteStatement deleteLog(rawDeleteLog);
+    if (!prepared) {
+        LOG_ERROR_F("Failed to prepare content index statements: {}", sqlite3_errmsg(db));
+        return false;
+    }
+
+    StoreConnection::Transaction transaction(connection_);
+    if (!transaction.isActive()) {
+        return false;
+    }
+
+    auto fail = [db](const char* what) {
+        LOG_ERROR_F("Failed to save content index {}: {}", what, sqlite3_errmsg(db));
+        return false;
+    };
+
+    // Applied to the members only once the transaction commits
+    uint64_t logRows = logRows_;
+    int64_t sequence = nextSequence_;
+
+    if (changes.replaceAll) {
+        if (!connection_.execute("DELETE FROM content_documents") ||
+            !connection_.execute("DELETE FROM content_trigrams") ||
+            !connection_.execute("DELETE FROM content_trigram_log")) {
+            return false;
+        }
+        logRows = 0;
+    }
+
+    for (uint32_t id : changes.removedDocuments) {
+        sqlite3_bind_int64(deleteDocument.get(), 1, id);
+        if (sqlite3_step(deleteDocument.get()) != SQLITE_DONE) {
+            return fail("document delete");
+        }
+        sqlite3_reset(deleteDocument.get());
+    }
+
+    for (const auto& document : changes.documents) {
+        sqlite3_bind_int64(upsertDocument.get(), 1, document.id);
+        sqlite3_bind_text(upsertDocument.get(), 2, document.path.c_str(),
+                          static_cast<int>(document.path.size()), SQLITE_STATIC);
+        sqlite3_bind_int64(upsertDocument.get(), 3, static_cast<sqlite3_int64>(document.fingerprint.size));
+        sqlite3_bind_int64(upsertDocument.get(), 4, document.fingerprint.modifiedNs);
+        sqlite3_bind_int64(upsertDocument.get(), 5, document.fingerprint.changedNs);
+        sqlite3_bind_int64(upsertDocument.get(), 6, static_cast<sqlite3_int64>(document.fingerprint.inode));
+        sqlite3_bind_int(upsertDocument.get(), 7, document.binary ? 1 : 0);
+        if (sqlite3_step(upsertDocument.get()) != SQLITE_DONE) {
+            return fail("document");
+        }
+        sqlite3_reset(upsertDocument.get());
+    }
+
+    // Whole lists and removed trigrams replace the row and drop the log
+    auto dropLog = [&deleteLog, &logRows, db](uint32_t trigram) {
+        sqlite3_bind_int64(deleteLog.get(), 1, trigram);
+        bool ok = sqlite3_step(deleteLog.get()) == SQLITE_DONE;
+        logRows -= std::min<uint64_t>(logRows, static_cast<uint64_t>(sqlite3_changes(db)));
+        sqlite3_reset(deleteLog.get());
+        return ok;
+    };
+
+    for (uint32_t trigram : changes.removedTrigrams) {
+        sqlite3_bind_int64(deleteTrigram.get(), 1, trigram);
+        if (sqlite3_step(deleteTrigram.get()) != SQLITE_DONE || !dropLog(trigram)) {
+            return fail("trigram delete");
+        }
+        sqlite3_reset(deleteTrigram.get());
+    }
+
+    std::string blob;
+    for (const auto& postings : changes.postings) {
+        blob = encodePostings(postings.documents);
+        sqlite3_bind_int64(upsertTrigram.get(), 1, postings.trigram);
+        sqlite3_bind_blob(upsertTrigram.get(), 2, blob.data(), static_cast<int>(blob.size()), SQLITE_STATIC);
+        if (sqlite3_step(upsertTrigram.get()) != SQLITE_DONE) {
+            return fail("postings");
+        }
+        sqlite3_reset(upsertTrigram.get());
+        if (!changes.replaceAll && !dropLog(postings.trigram)) {
+            return fail("postings");
+        }
+    }
+
+    for (const auto& append : changes.appended) {
+        if (append.documents.empty()) {
+            continue;
+        }
+        blob = encodePostings(append.documents, append.stored > 0 ? append.previous : 0);
+        sqlite3_bind_int64(appendLog.get(), 1, append.trigram);
+        sqlite3_bind_int64(appendLog.get(), 2, sequence++);
+        sqlite3_bind_blob(appendLog.get(), 3, blob.data(), static_cast<int>(blob.size()), SQLITE_STATIC);
+        if (sqlite3_step(appendLog.get()) != SQLITE_DONE) {
+            return fail("postings log");
+        }
+        sqlite3_reset(appendLog.get());
+        logRows++;
+    }
+
+    if (logRows >= MERGE_LOG_ROWS && !mergeLog(logRows)) {
+        return false;
+    }
+
+    if (!transaction.commit()) {
+        return false;
+    }
+    logRows_ = logRows;
+    nextSequence_ = sequence;
+    return true;
+}
+
+bool ContentIndexStore::mergeLog(uint64_t& logRows) {
+    sqlite3* db = connection_.get();
+
+    sqlite3_stmt* rawLog = nullptr;
+    sqlite3_stmt* rawList = nullptr;
+    sqlite3_stmt* rawUpsert = nullptr;
+    bool prepared =
+        sqlite3_prepare_v2(db, "SELECT trigram, documents FROM content_trigram_log ORDER BY trigram, sequence",
+                           -1, &rawLog, nullptr) == SQLITE_OK &&
+        sqlite3_prepare_v2(db, "SELECT documents FROM content_trigrams WHERE trigram = ?",
+                           -1, &rawList, nullptr) == SQLITE_OK &&
+        sqlite3_prepare_v2(db, UPSERT_TRIGRAM_SQL, -1, &rawUpsert, nullptr) == SQLITE_OK;
+    SQLiteStatement log(rawLog);
+    SQLiteStatement list(rawList);
+    SQLiteStatement upsert(rawUpsert);
+    if (!prepared) {
+        LOG_ERROR_F("Failed to prepare content trigram log merge: {}", sqlite3_errmsg(db));
+        return false;
+    }
+
+    // Log rows continue the encoding of their list, so a merge is a
+    // concatenation; nothing is decoded
+    uint64_t merged = 0;
+    auto write = [&](uint32_t trigram, std::string& blob) {
+        std::string combined;
+        sqlite3_bind_int64(list.get(), 1, trigram);
+        if (sqlite3_step(list.get()) == SQLITE_ROW) {
+            const auto* data = static_cast<const char*>(sqlite3_column_blob(list.get(), 0));
+            combined.assign(data ? data : "", static_cast<size_t>(sqlite3_column_bytes(list.get(), 0)));
+        }
+        sqlite3_reset(list.get());
+        combined += blob;
+        blob.clear();
+
+        sqlite3_bind_int64(upsert.get(), 1, trigram);
+        sqlite3_bind_blob(upsert.get(), 2, combined.data(), static_cast<int>(combined.size()), SQLITE_STATIC);
+        bool ok = sqlite3_step(upsert.get()) == SQLITE_DONE;
+        sqlite3_reset(upsert.get());
+        merged++;
+        return ok;
+    };
+
+    std::string pending;
+    uint32_t current = 0;
+    bool any = false;
+    int result;
+    while ((result = sqlite3_step(log.get())) == SQLITE_ROW) {
+        uint32_t trigram = static_cast<uint32_t>(sqlite3_column_int64(log.get(), 0));
+        if (any && trigram != current && !write(current, pending)) {
+            LOG_ERROR_F("Failed to merge content trigram log: {}", sqlite3_errmsg(db));
+            return false;
+        }
+        current = trigram;
+        any = true;
+        const auto* data = static_cast<const char*>(sqlite3_column_blob(log.get(), 1));
+        pending.append(data ? data : "", static_cast<size_t>(sqlite3_column_bytes(log.get(), 1)));
+    }
+    if (result != SQLITE_DONE || (any && !write(current, pending))) {
+        LOG_ERROR_F("Failed to merge content trigram log: {}", sqlite3_errmsg(db));
+        return false;
+    }
+    sqlite3_reset(log.get());
+
+    if (!connection_.execute("DELETE FROM content_trigram_log")) {
+        return false;
+    }
+    LOG_DEBUG_F("Merged {} content trigram log rows into {} lists", logRows, merged);
+    logRows = 0;
+    return true;
+}
+
+std::vector<ContentIndexDocument> ContentIndexStore::loadDocuments() {
+    std::vector<ContentIndexDocument> documents;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    sqlite3* db = connection_.get();
+
+    sqlite3_stmt* rawStmt = nullptr;
+    const char* sql = "SELECT id, path, size, modified_ns, changed_ns, inode, binary FROM content_documents";
+    if (sqlite3_prepare_v2(db, sql, -1, &rawStmt, nullptr) != SQLITE_OK) {
+        LOG_ERROR_F("Failed to prepare content document query: {}", sqlite3_errmsg(db));
+        return documents;
+    }
+    SQLiteStatement stmt(rawStmt);
+
+    while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+        ContentIndexDocument document;
+        document.id = static_cast<uint32_t>(sqlite3_column_int64(stmt.get(), 0));
+        const auto* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 1));
+        document.path = text ? text : "";
+        document.fingerprint.size = static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 2));
+        document.fingerprint.modifiedNs = sqlite3_column_int64(stmt.get(), 3);
+        document.fingerprint.changedNs = sqlite3_column_int64(stmt.get(), 4);
+        document.fingerprint.inode = static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 5));
+        document.binary = sqlite3_column_int(stmt.get(), 6) != 0;
+        documents.push_back(std::move(document));
+    }
+    return documents;
+}
+
+std::vector<ContentIndexPostings> ContentIndexStore::loadPostings() {
+    std::vector<ContentIndexPostings> postings;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    sqlite3* db = connection_.get();
+
+    // Encoded lists, each followed by its log rows in order
+    std::unordered_map<uint32_t, std::string> encoded;
+    const char* queries[] = {
+        "SELECT trigram, documents FROM content_trigrams",
+        "SELECT trigram, documents FROM content_trigram_log ORDER BY trigram, sequence",
+    };
+    for (const char* sql : queries) {
+        sqlite3_stmt* rawStmt = nullptr;
+        if (sqlite3_prepare_v2(db, sql, -1, &rawStmt, nullptr) != SQLITE_OK) {
+            LOG_ERROR_F("Failed to prepare content trigram query: {}", sqlite3_errmsg(db));
+            return postings;
+        }
+        SQLiteStatement stmt(rawStmt);
+
+        while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+            uint32_t trigram = static_cast<uint32_t>(sqlite3_column_int64(stmt.get(), 0));
+            const auto* data = static_cast<const char*>(sqlite3_column_blob(stmt.get(), 1));
+            encoded[trigram].append(data ? data : "", static_cast<size_t>(sqlite3_column_bytes(stmt.get(), 1)));
+        }
+    }
+
+    postings.reserve(encoded.size());
+    for (auto& [trigram, blob] : encoded) {
+        ContentIndexPostings entry;
+        entry.trigram = trigram;
+        if (!decodePostings(blob.data(), blob.size(), entry.documents)) {
+            LOG_WARNING_F("Corrupt content postings for trigram {}", trigram);
+            continue;
+        }
+        std::string().swap(blob);
+        postings.push_back(std::move(entry));
+    }
+    return postings;
+}
+
+uint64_t ContentIndexStore::getDocumentCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sqlite3* db = connection_.get();
+
+    sqlite3_stmt* rawStmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM content_documents", -1, &rawStmt, nullptr) != SQLITE_OK) {
+        return 0;
+    }
+    SQLiteStatement stmt(rawStmt);
+
+    if (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+        return static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 0));
+    }
+    return 0;
+}
+
+bool ContentIndexStore::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    StoreConnection::Transaction transaction(connection_);
+    if (!transaction.isActive() || !connection_.execute("DELETE FROM content_documents") ||
+        !connection_.execute("DELETE FROM content_trigrams") ||
+        !connection_.execute("DELETE FROM content_trigram_log") || !transaction.commit()) {
+        return false;
+    }
+    logRows_ = 0;
+    return true;
+}
+
+std::string ContentIndexStore::encodePostings(const std::vector<uint32_t>& documents, uint32_t previous) {
+    std::string out;
+    out.reserve(documents.size() + 4);
+    for (uint32_t id : documents) {
+        // Ids are sorted, so each delta is small; 7 bits per byte, high bit
+        // set on all but the last byte
+        uint32_t delta = id - previous;
+        previous = id;
+        while (delta >= 0x80) {
+            out.push_back(static_cast<char>((delta & 0x7F) | 0x80));
+            delta >>= 7;
+        }
+        out.push_back(static_cast<char>(delta));
+    }
+    return out;
+}
+
+bool ContentIndexStore::decodePostings(const void* data, size_t size, std::vector<uint32_t>& documents) {
+    documents.clear();
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    uint32_t previous = 0;
+    size_t i = 0;
+    while (i < size) {
+        uint32_t delta = 0;
+        int shift = 0;
+        for (;;) {
+            if (i >= size || shift > 28) {
+                return false;
+            }
+            unsigned char byte = bytes[i++];
+            delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+            shift += 7;
+        }
+        previous += delta;
+        documents.push_back(previous);
+    }
+    return true;
+}
+
+} // namespace Storage
+} // namespace FastFileSearch
@@ -0,0 +1,390 @@
+#include "storage/scan_state_store.h"
+#include "core/logger.h"
+
+namespace FastFileSearch {
+namespace Storage {
+
+// Schema
+const char* ScanStateStore::CREATE_DIRECTORY_STAMPS_TABLE = R"(
+    CREATE TABLE IF NOT EXISTS directory_stamps (
+        path TEXT PRIMARY KEY,
+        device INTEGER NOT NULL,
+        inode INTEGER NOT NULL,
+        modified_ns INTEGER NOT NULL,
+        changed_ns INTEGER NOT NULL,
+        child_count INTEGER NOT NULL,
+        last_scanned INTEGER NOT NULL
+    ) WITHOUT ROWID
+)";
+
+const char* ScanStateStore::UPSERT_DIRECTORY_STAMP_SQL =
+    "INSERT OR REPLACE INTO directory_stamps "
+    "(path, device, inode, modified_ns, changed_ns, child_count, last_scanned) "
+    "VALUES (?, ?, ?, ?, ?, ?, ?)";
+
+const char* ScanStateStore::DELETE_DIRECTORY_STAMP_SQL =
+    "DELETE FROM directory_stamps WHERE path = ?";
+
+// Subtree queries use a [prefix, prefixEnd) range so they can walk the primary key
+const char* ScanStateStore::DELETE_DIRECTORY_STAMPS_UNDER_SQL =
+    "DELETE FROM directory_stamps WHERE path = ?1 OR (path >= ?2 AND path < ?3)";
+
+// Byte offsets: substr() on TEXT would count characters
+const char* ScanStateStore::MOVE_DIRECTORY_STAMPS_SQL =
+    "UPDATE OR REPLACE directory_stamps "
+    "SET path = ?4 || CAST(substr(CAST(path AS BLOB), ?5) AS TEXT) "
+    "WHERE path = ?1 OR (path >= ?2 AND path < ?3)";
+
+const char* ScanStateStore::SELECT_DIRECTORY_STAMPS_UNDER_SQL =
+    "SELECT path, device, inode, modified_ns, changed_ns, child_count, last_scanned "
+    "FROM directory_stamps WHERE path = ?1 OR (path >= ?2 AND path < ?3)";
+
+const char* ScanStateStore::CREATE_CHECKPOINT_TABLES = R"(
+    CREATE TABLE IF NOT EXISTS scan_checkpoint_frontier (
+        path TEXT PRIMARY KEY
+    ) WITHOUT ROWID;
+    CREATE TABLE IF NOT EXISTS scan_checkpoint_completed (
+        path TEXT PRIMARY KEY
+    ) WITHOUT ROWID;
+    CREATE TABLE IF NOT EXISTS scan_checkpoint_meta (
+        key TEXT PRIMARY KEY,
+        value TEXT NOT NULL
+    ) WITHOUT ROWID;
+)";
+
+ScanStateStore::ScanStateStore(SQLiteDatabase& database) : connection_(database, "ScanStateStore") {
+}
+
+bool ScanStateStore::createTables() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connection_.open() &&
+           connection_.execute(CREATE_DIRECTORY_STAMPS_TABLE) && connection_.execute(CREATE_CHECKPOINT_TABLES);
+}
+
+std::string ScanStateStore::subtreePrefix(const std::string& rootPath) {
+    std::string prefix = rootPath;
+    if (!prefix.empty() && prefix.back() != '/' && prefix.back() != '\\') {
+#ifdef _WIN32
+        prefix += '\\';
+#else
+        prefix += '/';
+#endif
+    }
+    return prefix;
+}
+
+bool ScanStateStore::saveDirectoryStamps(const std::vector<DirectoryStamp>& stamps) {
+    if (stamps.empty()) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    sqlite3* db = connection_.get();
+
+    sqlite3_stmt* rawStmt = nullptr;
+    if (sqlite3_prepare_v2(db, UPSERT_DIRECTORY_STAMP_SQL, -1, &rawStmt, nullptr) != SQLITE_OK) {
+        LOG_ERROR_F("Failed to prepare directory stamp insert: {}", sqlite3_errmsg(db));
+        return false;
+    }
+    SQLiteStatement stmt(rawStmt);
+
+    StoreConnection::Transaction transaction(connection_);
+    if (!transaction.isActive()) {
+        return false;
+    }
+
+    for (const auto& stamp : stamps) {
+        sqlite3_bind_text(stmt.get(), 1, stamp.path.c_str(), static_cast<int>(stamp.path.size()), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt.get(), 2, static_cast<sqlite3_int64>(stamp.device));
+        sqlite3_bind_int64(stmt.get(), 3, static_cast<sqlite3_int64>(stamp.inode));
+        sqlite3_bind_int64(stmt.get(), 4, stamp.modifiedNs);
+        sqlite3_bind_int64(stmt.get(), 5, stamp.changedNs);
+        sqlite3_bind_int64(stmt.get(), 6, static_cast<sqlite3_int64>(stamp.childCount));
+        sqlite3_bind_int64(stmt.get(), 7, static_cast<sqlite3_int64>(stamp.lastScanned));
+
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE) {
+            LOG_ERROR_F("Failed to save directory stamp for {}: {}", stamp.path, sqlite3_errmsg(db));
+            return false;
+        }
+        sqlite3_reset(stmt.get());
+    }
+
+    return transaction.commit();
+}
+
+bool ScanStateStore::deleteDirectoryStamps(const std::vector<std::string>& paths) {
+    if (paths.empty()) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    sqlite3* db = connection_.get();
+
+    sqlite3_stmt* rawStmt = nullptr;
+    if (sqlite3_prepare_v2(db, DELETE_DIRECTORY_STAMP_SQL, -1, &rawStmt, nullptr) != SQLITE_OK) {
+        LOG_ERROR_F("Failed to prepare directory stamp delete: {}", sqlite3_errmsg(db));
+        return false;
+    }
+    SQLiteStatement stmt(rawStmt);
+
+    StoreConnection::Transaction transaction(connection_);
+    if (!transaction.isActive()) {
+        return false;
+    }
+
+    for (const auto& path : paths) {
+        sqlite3_bind_text(stmt.get(), 1, path.c_str(), static_cast<int>(path.size()), SQLITE_STATIC);
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE) {
+            LOG_ERROR_F("Failed to delete directory stamp for {}: {}", path, sqlite3_errmsg(db));
+            return false;
+        }
+        sqlite3_reset(stmt.get());
+    }
+
+    return transaction.commit();
+}
+
+bool ScanStateStore::deleteDirectoryStampsUnder(const std::string& rootPath) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sqlite3* db = connection_.get();
+
+    sqlite3_stmt* rawStmt = nullptr;
+    if (sqlite3_prepare_v2(db, DELETE_DIRECTORY_STAMPS_UNDER_SQL, -1, &rawStmt, nullptr) != SQLITE_OK) {
+        LOG_ERROR_F("Failed to prepare directory stamp subtree delete: {}", sqlite3_errmsg(db));
+        return false;
+    }
+    SQLiteStatement stmt(rawStmt);
+
+    std::string prefix = subtreePrefix(rootPath);
+    std::string prefixEnd = prefix;
+    prefixEnd.back() = static_cast<char>(prefixEnd.back() + 1);
+
+    sqlite3_bind_text(stmt.get(), 1, rootPath.c_str(), static_cast<int>(rootPath.size()), SQLITE_STATIC);
+    sqlite3_bind_text(stmt.get(), 2, prefix.c_str(), static_cast<int>(prefix.size()), SQLITE_STATIC);
+    sqlite3_bind_text(stmt.get(), 3, prefixEnd.c_str(), static_cast<int>(prefixEnd.size()), SQLITE_STATIC);
+
+    if (sqlite3_step(stmt.get()) != SQLITE_DONE) {
+        LOG_ERROR_F("Failed to delete directory stamps under {}: {}", rootPath, sqlite3_errmsg(db));
+        return false;
+    }
+    return true;
+}
+
+bool ScanStateStore::moveDirectoryStamps(const std::string& oldPath, const std::string& newPath) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sqlite3* db = connection_.get();
+
+    sqlite3_stmt* rawStmt = nullptr;
+    if (sqlite3_prepare_v2(db, MOVE_DIRECTORY_STAMPS_SQL, -1, &rawStmt, nullptr) != SQLITE_OK) {
+        LOG_ERROR_F("Failed to prepare directory stamp move: {}", sqlite3_errmsg(db));
+        return false;
+    }
+    SQLiteStatement stmt(rawStmt);
+
+    std::string prefix = subtreePrefix(oldPath);
+    std::string prefixEnd = prefix;
+    prefixEnd.back() = static_cast<char>(prefixEnd.back() + 1);
+
+    sqlite3_bind_text(stmt.get(), 1, oldPath.c_str(), static_cast<int>(oldPath.size()), SQLITE_STATIC);
+    sqlite3_bind_text(stmt.get(), 2, prefix.c_str(), static_cast<int>(prefix.size()), SQLITE_STATIC);
+    sqlite3_bind_text(stmt.get(), 3, prefixEnd.c_str(), static_cast<int>(prefixEnd.size()), SQLITE_STATIC);
+    sqlite3_bind_text(stmt.get(), 4, newPath.c_str(), static_cast<int>(newPath.size()), SQLITE_STATIC);
+    sqlite3_bind_int64(stmt.get(), 5, static_cast<sqlite3_int64>(oldPath.size()) + 1);
+
+    if (sqlite3_step(stmt.get()) != SQLITE_DONE) {
+        LOG_ERROR_F("Failed to move directory stamps from {} to {}: {}", oldPath, newPath, sqlite3_errmsg(db));
+        return false;
+    }
+    return true;
+}
+
+std::vector<DirectoryStamp> ScanStateStore::loadDirectoryStamps(const std::string& rootPath) {
+    std::vector<DirectoryStamp> stamps;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    sqlite3* db = connection_.get();
+
+    sqlite3_stmt* rawStmt = nullptr;
+    if (sqlite3_prepare_v2(db, SELECT_DIRECTORY_STAMPS_UNDER_SQL, -1, &rawStmt, nullptr) != SQLITE_OK) {
+        LOG_ERROR_F("Failed to prepare directory stamp query: {}", sqlite3_errmsg(db));
+        return stamps;
+    }
+    SQLiteStatement stmt(rawStmt);
+
+    std::string prefix = subtreePrefix(rootPath);
+    std::string prefixEnd = prefix;
+    prefixEnd.back() = static_cast<char>(prefixEnd.back() + 1);
+
+    sqlite3_bind_text(stmt.get(), 1, rootPath.c_str(), static_cast<int>(rootPath.size()), SQLITE_STATIC);
+    sqlite3_bind_text(stmt.get(), 2, prefix.c_str(), static_cast<int>(prefix.size()), SQLITE_STATIC);
+    sqlite3_bind_text(stmt.get(), 3, prefixEnd.c_str(), static_cast<int>(prefixEnd.size()), SQLITE_STATIC);
+
+    while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+        DirectoryStamp stamp;
+        const auto* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 0));
+        stamp.path = text ? text : "";
+        stamp.device = static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 1));
+        stamp.inode = static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 2));
+        stamp.modifiedNs = sqlite3_column_int64(stmt.get(), 3);
+        stamp.changedNs = sqlite3_column_int64(stmt.get(), 4);
+        stamp.childCount = static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 5));
+        stamp.lastScanned = static_cast<std::time_t>(sqlite3_column_int64(stmt.get(), 6));
+        stamps.push_back(std::move(stamp));
+    }
+
+    return stamps;
+}
+
+uint64_t ScanStateStore::getDirectoryStampCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sqlite3* db = connection_.get();
+
+    sqlite3_stmt* rawStmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM directory_stamps", -1, &rawStmt, nullptr) != SQLITE_OK) {
+        return 0;
+    }
+    SQLiteStatement stmt(rawStmt);
+
+    if (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+        return static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 0));
+    }
+    return 0;
+}
+
+bool ScanStateStore::executePathBatch(sqlite3_stmt* stmt, const std::vector<std::string>& paths) {
+    for (const auto& path : paths) {
+        sqlite3_bind_text(stmt, 1, path.c_str(), static_cast<int>(path.size()), SQLITE_STATIC);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            LOG_ERROR_F("Checkpoint write failed for {}: {}", path, sqlite3_errmsg(connection_.get()));
+            sqlite3_reset(stmt);
+            return false;
+        }
+        sqlite3_reset(stmt);
+    }
+    return true;
+}
+
+std::vector<std::string> ScanStateStore::selectPaths(const char* sql) {
+    std::vector<std::string> paths;
+    sqlite3_stmt* rawStmt = nullptr;
+    if (sqlite3_prepare_v2(connection_.get(), sql, -1, &rawStmt, nullptr) != SQLITE_OK) {
+        return paths;
+    }
+    SQLiteStatement stmt(rawStmt);
+
+    while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+        const auto* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 0));
+        if (text) {
+            paths.emplace_back(text);
+        }
+    }
+    return paths;
+}
+
+bool ScanStateStore::saveCheckpointDelta(const std::vector<std::string>& frontierAdded,
+                                         const std::vector<std::string>& frontierRemoved,
+                                         const std::vector<std::string>& completedAdded,
+                                         const std::vector<std::string>& completedRemoved) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sqlite3* db = connection_.get();
+
+    const char* statements[] = {
+        "INSERT OR IGNORE INTO scan_checkpoint_frontier (path) VALUES (?)",
+        "DELETE FROM scan_checkpoint_frontier WHERE path = ?",
+        "INSERT OR IGNORE INTO scan_checkpoint_completed (path) VALUES (?)",
+        "DELETE FROM scan_checkpoint_completed WHERE path = ?"
+    };
+    const std::vector<std::string>* batches[] = {
+        &frontierAdded, &frontierRemoved, &completedAdded, &completedRemoved
+    };
+
+    StoreConnection::Transaction transaction(connection_);
+    if (!transaction.isActive()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < 4; ++i) {
+        if (batches[i]->empty()) {
+            continue;
+        }
+
+        sqlite3_stmt* rawStmt = nullptr;
+        if (sqlite3_prepare_v2(db, statements[i], -1, &rawStmt, nullptr) != SQLITE_OK) {
+            LOG_ERROR_F("Failed to prepare checkpoint statement: {}", sqlite3_errmsg(db));
+            return false;
+        }
+        SQLiteStatement stmt(rawStmt);
+
+        if (!executePathBatch(stmt.get(), *batches[i])) {
+            return false;
+        }
+    }
+
+    std::string updated = "INSERT OR REPLACE INTO scan_checkpoint_meta (key, value) VALUES ('updated_at', '" +
+                          std::to_string(std::time(nullptr)) + "')";
+    if (!connection_.execute(updated.c_str())) {
+        return false;
+    }
+
+    return transaction.commit();
+}
+
+bool ScanStateStore::loadCheckpoint(std::vector<std::string>& frontier, std::vector<std::string>& completed) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    frontier = selectPaths("SELECT path FROM scan_checkpoint_frontier");
+    completed = selectPaths("SELECT path FROM scan_checkpoint_completed");
+    return !frontier.empty();
+}
+
+bool ScanStateStore::setCheckpointValue(const std::string& key, const std::string& value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sqlite3* db = connection_.get();
+
+    sqlite3_stmt* rawStmt = nullptr;
+    if (sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO scan_checkpoint_meta (key, value) VALUES (?, ?)",
+                           -1, &rawStmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    SQLiteStatement stmt(rawStmt);
+
+    sqlite3_bind_text(stmt.get(), 1, key.c_str(), static_cast<int>(key.size()), SQLITE_STATIC);
+    sqlite3_bind_text(stmt.get(), 2, value.c_str(), static_cast<int>(value.size()), SQLITE_STATIC);
+    return sqlite3_step(stmt.get()) == SQLITE_DONE;
+}
+
+std::string ScanStateStore::getCheckpointValue(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sqlite3* db = connection_.get();
+
+    sqlite3_stmt* rawStmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT value FROM scan_checkpoint_meta WHERE key = ?",
+                           -1, &rawStmt, nullptr) != SQLITE_OK) {
+        return "";
+    }
+    SQLiteStatement stmt(rawStmt);
+
+    sqlite3_bind_text(stmt.get(), 1, key.c_str(), static_cast<int>(key.size()), SQLITE_STATIC);
+    if (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+        const auto* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 0));
+        return text ? text : "";
+    }
+    return "";
+}
+
+bool ScanStateStore::hasCheckpoint() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !selectPaths("SELECT path FROM scan_checkpoint_frontier LIMIT 1").empty();
+}
+
+bool ScanStateStore::clearCheckpoint() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    StoreConnection::Transaction transaction(connection_);
+    return transaction.isActive() &&
+           connection_.execute("DELETE FROM scan_checkpoint_frontier") &&
+           connection_.execute("DELETE FROM scan_checkpoint_completed") &&
+           connection_.execute("DELETE FROM scan_checkpoint_meta") &&
+           transaction.commit();
+}
+
+} // namespace Storage
+} // namespace FastFileSearch
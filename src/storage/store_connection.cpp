@@ -0,0 +1,86 @@
+#include "storage/store_connection.h"
+#include "core/logger.h"
+
+namespace FastFileSearch {
+namespace Storage {
+
+StoreConnection::StoreConnection(SQLiteDatabase& database, std::string owner)
+    : database_(database), db_(nullptr), owner_(std::move(owner)) {
+}
+
+StoreConnection::~StoreConnection() {
+    close();
+}
+
+bool StoreConnection::open() {
+    if (db_) {
+        return true;
+    }
+
+    sqlite3* shared = database_.getHandle();
+    if (!shared) {
+        LOG_ERROR_F("{}: index database is not open", owner_);
+        return false;
+    }
+
+    const char* filename = sqlite3_db_filename(shared, "main");
+    if (!filename || filename[0] == '\0') {
+        LOG_DEBUG_F("{}: in-memory database, sharing its connection", owner_);
+        return true;
+    }
+
+    int result = sqlite3_open_v2(filename, &db_, SQLITE_OPEN_READWRITE, nullptr);
+    if (result != SQLITE_OK) {
+        LOG_ERROR_F("{}: cannot open {}: {}", owner_, filename, db_ ? sqlite3_errmsg(db_) : sqlite3_errstr(result));
+        close();
+        return false;
+    }
+
+    sqlite3_busy_timeout(db_, BUSY_TIMEOUT_MS);
+    return true;
+}
+
+void StoreConnection::close() {
+    if (db_) {
+        sqlite3_close_v2(db_);
+        db_ = nullptr;
+    }
+}
+
+bool StoreConnection::execute(const char* sql) {
+    char* errorMessage = nullptr;
+    int result = sqlite3_exec(get(), sql, nullptr, nullptr, &errorMessage);
+    if (result != SQLITE_OK) {
+        LOG_ERROR_F("{} SQL error: {}", owner_, errorMessage ? errorMessage : "unknown");
+        sqlite3_free(errorMessage);
+        return false;
+    }
+    return true;
+}
+
+// StoreConnection::Transaction implementation
+StoreConnection::Transaction::Transaction(StoreConnection& connection)
+    : connection_(connection), active_(connection.execute("BEGIN IMMEDIATE")) {
+}
+
+StoreConnection::Transaction::~Transaction() {
+    if (active_) {
+        connection_.execute("ROLLBACK");
+    }
+}
+
+bool StoreConnection::Transaction::commit() {
+    if (!active_) {
+        return false;
+    }
+    // A failed COMMIT (e.g. SQLITE_BUSY) leaves the transaction open; the
+    // destructor rolls it back
+    if (!connection_.execute("COMMIT")) {
+        return false;
+    }
+    active_ = false;
+    return true;
+}
+
+} // namespace Storage
+} // namespace FastFileSearch
@@ -425,6 +425,9 @@ void ConsoleUI::performSearch() {
 
     std::cout << std::endl;
     printSuccess("Search completed in " + std::to_string(searchTime.count()) + "ms");
+    if (results.isPossiblyStale()) {
+        printWarning("Index is still being reconciled; recent changes may be missing.");
+    }
 
     if (results.empty()) {
         printWarning("No files found matching your query.");
@@ -672,6 +675,9 @@ void ConsoleUI::executeSearchCommand(const std::vector<std::string>& args) {
 
     std::cout << std::endl;
     printSuccess("Search completed in " + std::to_string(searchTime.count()) + "ms");
+    if (results.isPossiblyStale()) {
+        printWarning("Index is still being reconciled; recent changes may be missing.");
+    }
 
     if (results.empty()) {
         printWarning("No files found matching your query.");